@@ -0,0 +1,330 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <gmpxx.h>
+#define USE_GMP
+
+#include "util.hpp"
+#include "mpint.hpp"
+#include "qform.hpp"
+
+using namespace ff_util;
+
+#define BENCHF "%s:\t% 10.1f ops/sec\n"
+#define GNUPLOTF " % 15.1f"
+
+#define OUTPUT_GNUPLOT
+
+namespace {
+
+/*
+  -p for a prime p = 3 mod 4 of bits bits, times m.
+*/
+mpz_class randomDiscriminant(gmp_randclass& rng, const size_t bits, const unsigned long m = 1)
+{
+  mpz_class p = rng.get_z_bits(bits);
+  mpz_setbit(p.get_mpz_t(), bits - 1);
+  do {
+    mpz_nextprime(p.get_mpz_t(), p.get_mpz_t());
+  } while (mpz_fdiv_ui(p.get_mpz_t(), 4) != 3);
+  return -(p*m);
+}
+
+/*
+  Product of prime forms of small primes to random exponents,
+  by the classic composition.
+*/
+integer::QuadraticForm randomForm(const integer::ClassGroup& cg, gmp_randclass& rng)
+{
+  using namespace integer;
+
+  QuadraticForm z = cg.identity();
+  size_t k = 0;
+  for (uint32_t p = 2; k < 8 && p < 1000; ++p) {
+    if (! mpz_probab_prime_p(mpz_class(p).get_mpz_t(), 25)) {
+      continue;
+    }
+    QuadraticForm f;
+    if (! cg.primeForm(f, p)) {
+      continue;
+    }
+    ++k;
+    const unsigned long e = mpz_class(rng.get_z_bits(16)).get_ui();
+    for (size_t i = 0; i < 64; ++i) {
+      if ((e >> i) == 0) {
+        break;
+      }
+      if ((e >> i) & 1) {
+        cg.composeClassic(z, z, f);
+      }
+      cg.composeClassic(f, f, f);
+    }
+  }
+  return z;
+}
+
+} // namespace
+
+void test_classgroup()
+{
+  PUTSERR(__func__);
+
+  using namespace std;
+  using namespace integer;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  {
+    // class numbers of small discriminants.
+    const int64_t D[] = { -3, -4, -20, -23, -47, -56, -71, -84, -103, -199, -9*23 };
+    const int64_t h[] = { 1, 1, 2, 3, 5, 4, 7, 4, 5, 9, 6 };
+    for (size_t i = 0; i < sizeof(D)/sizeof(D[0]); ++i) {
+      const ClassGroup cg((MPInt(D[i])));
+      const QuadraticForm one = cg.identity();
+      TEST_ASSERT(cg.isForm(one));
+      TEST_ASSERT(one.isReduced());
+      for (uint32_t p = 2; p < 60; ++p) {
+        if (! mpz_probab_prime_p(mpz_class(p).get_mpz_t(), 25)) {
+          continue;
+        }
+        QuadraticForm f;
+        if (! cg.primeForm(f, p)) {
+          continue;
+        }
+        TEST_ASSERT(cg.isForm(f));
+        TEST_ASSERT(f.isReduced());
+        QuadraticForm z;
+        cg.pow(z, f, MPInt(h[i]));
+        TEST_EQ(z, one);
+        cg.pow(z, f, MPInt(h[i] + 1));
+        TEST_EQ(z, f);
+      }
+    }
+  }
+
+  {
+    const ClassGroup cg((MPInt(-23)));
+    QuadraticForm f;
+    TEST_ASSERT(cg.primeForm(f, 2));
+    TEST_EQ(f, QuadraticForm(MPInt(2), MPInt(1), MPInt(3)));
+    TEST_ASSERT(! cg.primeForm(f, 5));
+    TEST_EQ(f, QuadraticForm(MPInt(2), MPInt(1), MPInt(3)));
+    // 3^2 divides -36.
+    TEST_ASSERT(! ClassGroup(MPInt(-36)).primeForm(f, 3));
+  }
+
+  const size_t sizes[] = { 64, 128, 200, 512, 1024 };
+  const unsigned long multipliers[] = { 1, 4, 9, 15*15 };
+  for (size_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); ++i) {
+    for (size_t j = 0; j < sizeof(multipliers)/sizeof(multipliers[0]); ++j) {
+      const ClassGroup cg(MPInt(randomDiscriminant(rng, sizes[i], multipliers[j])));
+      const QuadraticForm one = cg.identity();
+      const size_t count = sizes[i] < 512 ? 8 : 2;
+      for (size_t k = 0; k < count; ++k) {
+        const QuadraticForm x = randomForm(cg, rng);
+        const QuadraticForm y = randomForm(cg, rng);
+        TEST_ASSERT(cg.isForm(x));
+        TEST_ASSERT(x.isReduced());
+
+        QuadraticForm z, w;
+        cg.compose(z, x, y);
+        TEST_ASSERT(cg.isForm(z));
+        TEST_ASSERT(z.isReduced());
+        cg.composeClassic(w, x, y);
+        TEST_EQ(z, w);
+        cg.compose(w, y, x);
+        TEST_EQ(z, w);
+
+        cg.square(z, x);
+        TEST_ASSERT(z.isReduced());
+        cg.composeClassic(w, x, x);
+        TEST_EQ(z, w);
+        cg.compose(w, x, x);
+        TEST_EQ(z, w);
+
+        cg.compose(z, x, one);
+        TEST_EQ(z, x);
+        cg.inverse(w, x);
+        cg.compose(z, x, w);
+        TEST_EQ(z, one);
+
+        // aliasing.
+        z = x;
+        cg.compose(z, z, y);
+        cg.compose(w, x, y);
+        TEST_EQ(z, w);
+        z = x;
+        cg.square(z, z);
+        cg.square(w, x);
+        TEST_EQ(z, w);
+
+        const MPInt e1(rng.get_z_bits(sizes[i]));
+        const MPInt e2(rng.get_z_bits(70));
+        QuadraticForm u, v;
+        cg.pow(u, x, e1);
+        cg.pow(v, x, e2);
+        cg.compose(z, u, v);
+        cg.pow(w, x, e1 + e2);
+        TEST_EQ(z, w);
+        cg.pow(w, x, -e1);
+        cg.inverse(u, u);
+        TEST_EQ(w, u);
+        cg.pow(w, x, MPInt(0));
+        TEST_EQ(w, one);
+      }
+    }
+  }
+
+  {
+    const int64_t bad[] = { 5, 0, -1, -2, -5, -6 };
+    for (size_t i = 0; i < sizeof(bad)/sizeof(bad[0]); ++i) {
+      TEST_THROW(ClassGroup(MPInt(bad[i])), std::invalid_argument);
+    }
+  }
+}
+
+void bench_classgroup()
+{
+  printf("\n\n# %s\n", __func__);
+
+  using namespace std;
+  using namespace integer;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+  const size_t count = 2000;
+
+  for (size_t bits = 1024; bits <= 2048; bits += 256) {
+    const ClassGroup cg(MPInt(randomDiscriminant(rng, bits)));
+    vector<QuadraticForm> x;
+    for (size_t j = 0; j < 16; ++j) {
+      x.push_back(randomForm(cg, rng));
+    }
+#ifdef OUTPUT_GNUPLOT
+    /*
+      @note: Output is operations per second:
+      bits classic_compose nucomp nudupl
+    */
+    cout << bits << " ";
+#else
+    PUT(bits);
+#endif
+
+    for (size_t i = 0; i < 3; ++i) {
+      QuadraticForm z = x[0];
+      const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      for (size_t j = 0; j < count; ++j) {
+        switch (i) {
+        case 0:
+          cg.composeClassic(z, z, x[j & 15]);
+          break;
+        case 1:
+          cg.compose(z, z, x[j & 15]);
+          break;
+        default:
+          cg.square(z, z);
+          break;
+        }
+      }
+      const double t = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+      TEST_ASSERT(cg.isForm(z));
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, (double)count / t);
+#else
+      printf(BENCHF, i == 0 ? "ClassGroup::composeClassic" : i == 1 ? "ClassGroup::compose" : "ClassGroup::square", (double)count / t);
+#endif
+    }
+#ifdef OUTPUT_GNUPLOT
+    puts("");
+#endif
+  }
+}
+
+void info_gmp()
+{
+  using namespace std;
+
+  cerr << "GMP Version is " << gmp_version << endl
+       << "number of bits in mp_limb is " << mp_bits_per_limb << endl;
+}
+
+void test_all()
+{
+  using namespace std;
+  using namespace mpint;
+
+  MPInt::codeGen(0);
+
+  test_classgroup();
+
+  cout.flush();
+
+  MPInt::codeGen();
+
+  test_classgroup();
+
+  cout.flush();
+}
+
+void bench_for_gnuplot()
+{
+  using namespace std;
+  using namespace mpint;
+
+  bench_classgroup();
+}
+
+int main()
+{
+  using namespace std;
+  using namespace mpint;
+
+#ifndef NDEBUG
+  cerr << "NDEBUG is undefined" << endl;
+#endif
+
+  info_gmp();
+  MPIntCodeGen();
+
+  test_all();
+
+  bench_for_gnuplot();
+
+  return testsAreSucceeded() ? 0 : 1;
+}
@@ -0,0 +1,450 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <gmpxx.h>
+#define USE_GMP
+
+#include "util.hpp"
+#include "mpint.hpp"
+#include "montgomery.hpp"
+#include "siqs.hpp"
+#include "rho.hpp"
+
+using namespace ff_util;
+
+#define BENCHF "%s:\t% 10.4f sec\n"
+#define GNUPLOTF " % 15.4f"
+
+#define OUTPUT_GNUPLOT
+
+namespace {
+
+mpz_class randomPrime(gmp_randclass& rng, const size_t bits)
+{
+  mpz_class p = rng.get_z_bits(bits);
+  mpz_setbit(p.get_mpz_t(), bits - 1);
+  mpz_nextprime(p.get_mpz_t(), p.get_mpz_t());
+  return p;
+}
+
+/*
+  Product of two primes of about digits/2 decimal digits.
+*/
+mpz_class semiprime(gmp_randclass& rng, const size_t digits)
+{
+  const size_t bits = (size_t)((double)digits * 3.3219280948873623);
+  return randomPrime(rng, bits / 2) * randomPrime(rng, bits - bits / 2);
+}
+
+/*
+  QuadraticSieve finds a proper factor of gn.
+*/
+void check_siqs(const mpz_class& gn, const size_t threads)
+{
+  using namespace mpint;
+  using namespace integer;
+
+  QuadraticSieve qs(MPInt(gn), threads);
+  MPInt d;
+  TEST_ASSERT(qs.factor(d));
+  const mpz_class gd(d.toString());
+  TEST_ASSERT(gd > 1);
+  TEST_ASSERT(gd < gn);
+  TEST_ASSERT(mpz_divisible_p(gn.get_mpz_t(), gd.get_mpz_t()) != 0);
+  const QuadraticSieve::Stats& st = qs.stats();
+  TEST_EQ(st.factorBase, qs.primes().size());
+  TEST_LESSEQ(st.factorBase + 1, st.full + st.combined);
+  TEST_LESSEQ(st.combined, st.partial);
+}
+
+/*
+  Floyd's rho on mpz_class with a gcd per step, the baseline of bench_rho.
+*/
+mpz_class floydRho(const mpz_class& n, const unsigned long c)
+{
+  mpz_class x = 2, y = 2, g = 1, t;
+  while (g == 1) {
+    x = (x*x + c) % n;
+    y = (y*y + c) % n;
+    y = (y*y + c) % n;
+    t = x - y;
+    mpz_gcd(g.get_mpz_t(), t.get_mpz_t(), n.get_mpz_t());
+  }
+  return g;
+}
+
+/*
+  impl::pollardRho finds a proper factor of gn.
+*/
+void check_rho(const mpz_class& gn, const size_t threads)
+{
+  using namespace mpint;
+  using namespace integer;
+
+  MPInt d;
+  TEST_ASSERT(integer::impl::pollardRho(d, MPInt(gn), threads));
+  const mpz_class gd(d.toString());
+  TEST_ASSERT(gd > 1);
+  TEST_ASSERT(gd < gn);
+  TEST_ASSERT(mpz_divisible_p(gn.get_mpz_t(), gd.get_mpz_t()) != 0);
+}
+
+} // namespace
+
+void test_rho()
+{
+  PUTSERR(__func__);
+
+  using namespace std;
+  using namespace integer;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  const size_t threads[] = { 1, 3 };
+  for (size_t t = 0; t < sizeof(threads)/sizeof(threads[0]); ++t) {
+    for (size_t bits = 8; bits <= 36; bits += 4) {
+      check_rho(randomPrime(rng, bits) * randomPrime(rng, 128), threads[t]);
+    }
+    check_rho(randomPrime(rng, 20) * randomPrime(rng, 24) * randomPrime(rng, 600), threads[t]);
+  }
+
+  {
+    const size_t batch = integer::impl::rhoBatchSize;
+    const size_t sizes[] = { 1, 7, 1000 };
+    for (size_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); ++i) {
+      integer::impl::rhoBatchSize = sizes[i];
+      check_rho(randomPrime(rng, 28) * randomPrime(rng, 100), 1);
+    }
+    integer::impl::rhoBatchSize = batch;
+  }
+
+  {
+    // a square, and a prime which has no proper factor.
+    const mpz_class p = randomPrime(rng, 24);
+    MPInt d;
+    TEST_ASSERT(integer::impl::pollardRho(d, MPInt(p*p)));
+    TEST_EQ(d, MPInt(p));
+    TEST_ASSERT(! integer::impl::pollardRho(d, MPInt(randomPrime(rng, 100)), 1, 1 << 12, 3));
+    TEST_ASSERT(! integer::impl::pollardRho(d, MPInt(randomPrime(rng, 100)), 3, 1 << 12, 5));
+  }
+
+  {
+    const MPInt n(randomPrime(rng, 40) * randomPrime(rng, 40));
+    const std::atomic<bool> cancel(true);
+    MPInt d;
+    TEST_ASSERT(! integer::impl::pollardBrent(d, n, 1, 2, integer::impl::rhoMaxSteps, &cancel));
+  }
+
+  {
+    // cancelled while a prime runs long sequences.
+    const MPInt n(randomPrime(rng, 512));
+    std::atomic<bool> cancel(false);
+    bool result = true;
+    std::thread worker([&]() {
+        MPInt d;
+        result = integer::impl::pollardBrent(d, n, 1, 2, (uint64_t)1 << 40, &cancel);
+      });
+    std::this_thread::sleep_for(chrono::milliseconds(1000));
+    const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    cancel = true;
+    worker.join();
+    const double t = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    TEST_ASSERT(! result);
+    TEST_ASSERT(t < 0.1);
+  }
+
+  {
+    const MPInt bad[] = { MPInt(0), MPInt(1), MPInt(-15), MPInt(1 << 20) };
+    MPInt d;
+    for (size_t i = 0; i < sizeof(bad)/sizeof(bad[0]); ++i) {
+      TEST_THROW(integer::impl::pollardRho(d, bad[i]), std::invalid_argument);
+    }
+    TEST_THROW(integer::impl::pollardRho(d, MPInt(15), 0), std::invalid_argument);
+  }
+}
+
+void test_siqs()
+{
+  PUTSERR(__func__);
+
+  using namespace std;
+  using namespace integer;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  const size_t threads[] = { 1, 3 };
+  for (size_t t = 0; t < sizeof(threads)/sizeof(threads[0]); ++t) {
+    for (size_t digits = 21; digits <= 45; digits += 4) {
+      check_siqs(semiprime(rng, digits), threads[t]);
+    }
+  }
+
+  // three factors, and an unbalanced one.
+  check_siqs(randomPrime(rng, 30) * randomPrime(rng, 40) * randomPrime(rng, 50), 1);
+  check_siqs(randomPrime(rng, 24) * randomPrime(rng, 100), 1);
+
+  {
+    // a factor in the factor base is found while it is built.
+    const mpz_class gn = 7 * randomPrime(rng, 100);
+    QuadraticSieve qs((MPInt(gn)));
+    MPInt d;
+    TEST_ASSERT(qs.factor(d));
+    TEST_EQ(d, MPInt(7));
+  }
+
+  {
+    // the same seed gives the same relations with one thread.
+    const MPInt n(semiprime(rng, 35));
+    QuadraticSieve a(n), b(n);
+    MPInt da, db;
+    TEST_ASSERT(a.factor(da));
+    TEST_ASSERT(b.factor(db));
+    TEST_EQ(da, db);
+    TEST_EQ(a.stats().polynomials, b.stats().polynomials);
+    TEST_EQ(a.stats().full, b.stats().full);
+  }
+
+  {
+    const mpz_class p = randomPrime(rng, 80);
+    const mpz_class bad[] = {
+      semiprime(rng, 30) * 2, semiprime(rng, 19), p, p * p, p * p * p,
+    };
+    for (size_t i = 0; i < sizeof(bad)/sizeof(bad[0]); ++i) {
+      TEST_THROW(QuadraticSieve(MPInt(bad[i])), std::invalid_argument);
+    }
+    const MPInt n(semiprime(rng, 30));
+    QuadraticSieve::Params params[4];
+    for (size_t i = 0; i < 4; ++i) {
+      params[i] = QuadraticSieve::defaultParams(30);
+    }
+    params[0].factorBase = 15;
+    params[1].blockSize = 3 << 12;
+    params[2].blocks = 0;
+    params[3].threads = 0;
+    for (size_t i = 0; i < 4; ++i) {
+      TEST_THROW(QuadraticSieve(n, params[i]), std::invalid_argument);
+    }
+  }
+}
+
+void bench_siqs()
+{
+  printf("\n\n# %s\n", __func__);
+
+  using namespace std;
+  using namespace integer;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+  const size_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+
+  for (size_t digits = 30; digits <= 60; digits += 5) {
+    const size_t count = digits < 50 ? 4 : 1;
+    vector<MPInt> n;
+    for (size_t j = 0; j < count; ++j) {
+      n.push_back(MPInt(semiprime(rng, digits)));
+    }
+#ifdef OUTPUT_GNUPLOT
+    /*
+      @note: Output is seconds per number:
+      digits 1_thread all_cores sieve_1_thread linear_algebra_1_thread
+    */
+    cout << digits << " ";
+#else
+    PUT(digits);
+#endif
+
+    double sieve = 0;
+    double linear = 0;
+    const size_t threads[] = { 1, cores };
+    for (size_t i = 0; i < 2; ++i) {
+      const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      for (size_t j = 0; j < count; ++j) {
+        QuadraticSieve qs(n[j], threads[i]);
+        MPInt d;
+        TEST_ASSERT(qs.factor(d));
+        if (i == 0) {
+          sieve += qs.stats().sieveSeconds;
+          linear += qs.stats().linearSeconds;
+        }
+      }
+      const double t = chrono::duration<double>(chrono::steady_clock::now() - start).count() / (double)count;
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, t);
+#else
+      printf(BENCHF, i == 0 ? "QuadraticSieve(1)" : "QuadraticSieve(cores)", t);
+#endif
+    }
+#ifdef OUTPUT_GNUPLOT
+    printf(GNUPLOTF, sieve / (double)count);
+    printf(GNUPLOTF, linear / (double)count);
+    puts("");
+#else
+    printf(BENCHF, "sieve", sieve / (double)count);
+    printf(BENCHF, "linear algebra", linear / (double)count);
+#endif
+  }
+}
+
+void bench_rho()
+{
+  printf("\n\n# %s\n", __func__);
+
+  using namespace std;
+  using namespace integer;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+  const size_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+  const size_t batch = integer::impl::rhoBatchSize;
+
+  for (size_t bits = 24; bits <= 40; bits += 4) {
+    const size_t count = bits <= 32 ? 16 : 2;
+    vector<mpz_class> gn;
+    for (size_t j = 0; j < count; ++j) {
+      gn.push_back(randomPrime(rng, bits) * randomPrime(rng, 256));
+    }
+#ifdef OUTPUT_GNUPLOT
+    /*
+      @note: Output is seconds per number:
+      bits mpz_floyd gcd_per_step batched_1_thread batched_all_cores
+    */
+    cout << bits << " ";
+#else
+    PUT(bits);
+#endif
+
+    {
+      const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      for (size_t j = 0; j < count; ++j) {
+        const mpz_class g = floydRho(gn[j], 1);
+        TEST_ASSERT(g > 1);
+      }
+      const double t = chrono::duration<double>(chrono::steady_clock::now() - start).count() / (double)count;
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, t);
+#else
+      printf(BENCHF, "mpz Floyd", t);
+#endif
+    }
+
+    const size_t batches[] = { 1, batch, batch };
+    const size_t threads[] = { 1, 1, cores };
+    for (size_t i = 0; i < 3; ++i) {
+      integer::impl::rhoBatchSize = batches[i];
+      const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      for (size_t j = 0; j < count; ++j) {
+        MPInt d;
+        TEST_ASSERT(integer::impl::pollardRho(d, MPInt(gn[j]), threads[i]));
+      }
+      const double t = chrono::duration<double>(chrono::steady_clock::now() - start).count() / (double)count;
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, t);
+#else
+      printf(BENCHF, i == 0 ? "impl::pollardRho(batch 1)" : i == 1 ? "impl::pollardRho(1)" : "impl::pollardRho(cores)", t);
+#endif
+    }
+    integer::impl::rhoBatchSize = batch;
+#ifdef OUTPUT_GNUPLOT
+    puts("");
+#endif
+  }
+}
+
+void info_gmp()
+{
+  using namespace std;
+
+  cerr << "GMP Version is " << gmp_version << endl
+       << "number of bits in mp_limb is " << mp_bits_per_limb << endl;
+}
+
+void test_all()
+{
+  using namespace std;
+  using namespace mpint;
+
+  MontgomeryContext::codeGen(0);
+
+  test_rho();
+  test_siqs();
+
+  cout.flush();
+
+  MontgomeryContext::codeGen();
+
+  test_rho();
+  test_siqs();
+
+  cout.flush();
+}
+
+void bench_for_gnuplot()
+{
+  using namespace std;
+  using namespace mpint;
+
+  bench_rho();
+
+  bench_siqs();
+}
+
+int main()
+{
+  using namespace std;
+  using namespace mpint;
+
+#ifndef NDEBUG
+  cerr << "NDEBUG is undefined" << endl;
+#endif
+
+  info_gmp();
+  MPIntCodeGen();
+
+  test_all();
+
+  bench_for_gnuplot();
+
+  return testsAreSucceeded() ? 0 : 1;
+}
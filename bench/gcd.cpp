@@ -0,0 +1,433 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <stdexcept>
+#include <xbyak/xbyak_util.h>
+
+#include <gmpxx.h>
+#define USE_GMP
+
+#include "util.hpp"
+#include "mpint.hpp"
+#include "gcd.hpp"
+
+using namespace ff_util;
+
+const int N = 10000;
+
+#define BENCHF "%s:\t% 10.2f clk\n"
+#define GNUPLOTF " % 15.2f"
+
+#define OUTPUT_GNUPLOT
+
+namespace {
+
+/*
+  All gcd variants against mpz_gcd.
+*/
+void check_gcd(const mpz_class& gx, const mpz_class& gy)
+{
+  using namespace mpint;
+  using namespace integer;
+
+  mpz_class gz;
+  mpz_gcd(gz.get_mpz_t(), gx.get_mpz_t(), gy.get_mpz_t());
+  const MPInt mx(gx), my(gy), mz(gz);
+
+  TEST_EQ(impl::gcd(mx, my), mz);
+  TEST_EQ(impl::gcd(my, mx), mz);
+  TEST_EQ(impl::gcdBinary(mx, my), mz);
+  TEST_EQ(impl::gcdLehmer(mx, my), mz);
+  TEST_EQ(impl::gcdHalf(mx, my), mz);
+}
+
+/*
+  invert and gcdext against mpz_invert and mpz_gcd.
+*/
+void check_invert(const mpz_class& ga, const mpz_class& gm)
+{
+  using namespace mpint;
+  using namespace integer;
+
+  mpz_class gz;
+  const bool exists = mpz_invert(gz.get_mpz_t(), ga.get_mpz_t(), gm.get_mpz_t()) != 0;
+  const MPInt ma(ga), mm(gm);
+  MPInt mz;
+
+  TEST_EQ(impl::invert(mz, ma, mm), exists);
+  if (exists) {
+    TEST_EQ(mz, MPInt(gz));
+  }
+  if (mpz_odd_p(gm.get_mpz_t())) {
+    MPInt cz;
+    TEST_EQ(impl::invert(cz, ma, mm, true), exists);
+    if (exists) {
+      TEST_EQ(cz, MPInt(gz));
+    }
+  }
+
+  mpz_gcd(gz.get_mpz_t(), ga.get_mpz_t(), gm.get_mpz_t());
+  MPInt s, t, sx, ty;
+  const MPInt g = impl::gcdext(s, t, ma, mm);
+  TEST_EQ(g, MPInt(gz));
+  MPInt::mul(sx, s, ma);
+  MPInt::mul(ty, t, mm);
+  MPInt::add(sx, sx, ty);
+  TEST_EQ(sx, g);
+}
+
+mpz_class fibonacci(const size_t n)
+{
+  mpz_class f;
+  mpz_fib_ui(f.get_mpz_t(), n);
+  return f;
+}
+
+} // namespace
+
+void test_gcd()
+{
+  PUTSERR(__func__);
+
+  using namespace std;
+
+  check_gcd(0, 0);
+  check_gcd(0, 12);
+  check_gcd(-12, 0);
+  check_gcd(12, 18);
+  check_gcd(-12, 18);
+  check_gcd(-12, -18);
+  check_gcd(1, 1);
+  check_gcd(mpz_class(1) << 200, mpz_class(3) << 130);
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  for (size_t i = 0; i < 300; ++i) {
+    const size_t lx = 1 + 211*i % 40000;
+    const size_t ly = i % 3 == 0 ? 1 + 97*i % 40000 : lx;
+    const size_t lg = i % 5 == 0 ? 0 : 1 + 13*i % (lx / 2 + 1);
+    mpz_class gg = rng.get_z_bits(lg) + 1;
+    mpz_class gx = rng.get_z_bits(lx) * gg;
+    mpz_class gy = rng.get_z_bits(ly) * gg;
+    if (i & 1) {
+      gx = -gx;
+    }
+    if (i % 7 == 0) {
+      gx <<= i % 150;
+      gy <<= i % 130;
+    }
+    check_gcd(gx, gy);
+  }
+
+  // many small quotients.
+  for (size_t n = 10; n < 20000; n = n*2 + 1) {
+    check_gcd(fibonacci(n), fibonacci(n + 1));
+    check_gcd(fibonacci(n)*fibonacci(n / 2), fibonacci(n + 1)*fibonacci(n / 2));
+  }
+
+  // equal operands and all ones digits.
+  for (size_t n = 1; n < 700; n = n*3 + 1) {
+    mpz_class g = 0;
+    mpz_setbit(g.get_mpz_t(), 64*n);
+    g -= 1;
+    check_gcd(g, g);
+    check_gcd(g, g - 2);
+    check_gcd(g * g, g);
+  }
+}
+
+void test_invert()
+{
+  PUTSERR(__func__);
+
+  using namespace std;
+
+  check_invert(0, 7);
+  check_invert(1, 1);
+  check_invert(3, 1);
+  check_invert(3, 7);
+  check_invert(-3, 7);
+  check_invert(3, -7);
+  check_invert(6, 9);
+  check_invert(7, 8);
+  check_invert(6, 8);
+  check_invert(0, 12);
+  check_invert(mpz_class(3) << 200, (mpz_class(1) << 255) - 19);
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  for (size_t i = 0; i < 300; ++i) {
+    const size_t lm = 1 + 131*i % 4000;
+    const size_t la = i % 4 == 0 ? lm + 100 : 1 + 71*i % lm;
+    mpz_class gm = rng.get_z_bits(lm) + 2;
+    mpz_class ga = rng.get_z_bits(la);
+    if (i % 3 == 0) {
+      gm |= 1;
+    }
+    if (i % 5 == 0) {
+      ga *= 3;
+      gm *= 6;
+    }
+    if (i & 1) {
+      ga = -ga;
+    }
+    check_invert(ga, gm);
+  }
+
+  // modulus of all ones digits.
+  for (size_t n = 1; n < 100; n = n*3 + 1) {
+    mpz_class m = 0;
+    mpz_setbit(m.get_mpz_t(), 64*n);
+    m -= 1;
+    check_invert(m - 2, m);
+    check_invert(2, m);
+    check_invert(m - 1, m + 1);
+  }
+
+  {
+    using namespace mpint;
+    MPInt z;
+    TEST_THROW(integer::impl::invert(z, MPInt(3), MPInt(0)), std::invalid_argument);
+    TEST_THROW(integer::impl::invert(z, MPInt(3), MPInt(8), true), std::invalid_argument);
+  }
+}
+
+void bench_gcd()
+{
+  printf("\n\n# %s\n", __func__);
+
+  using namespace std;
+  using namespace integer;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  for (size_t n = 1; n <= 8192; n *= 2) {
+    const size_t len = 64*n;
+    const int numOfSample = std::max(N / (int)(n*n), 2);
+#ifdef OUTPUT_GNUPLOT
+    /*
+      @note: Output is:
+      digits gmp_timing gcd_timing binary_timing lehmer_timing half_timing
+    */
+    cout << n << " ";
+#else
+    PUT(len);
+#endif
+
+    mpz_class gx = rng.get_z_bits(len);
+    mpz_class gy = rng.get_z_bits(len);
+    mpz_class gz;
+    MPInt mx(gx), my(gy), mz;
+
+    {
+      Xbyak::util::Clock clk;
+      for (int j = 0; j < numOfSample; ++j) {
+        clk.begin();
+        mpz_gcd(gz.get_mpz_t(), gx.get_mpz_t(), gy.get_mpz_t());
+        clk.end();
+      }
+      const double t = (double)clk.getClock() / clk.getCount();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, t);
+#else
+      printf(BENCHF, "mpz_gcd", t);
+#endif
+    }
+
+    MPInt (*const funcs[])(const MPInt&, const MPInt&) = {
+      impl::gcd, impl::gcdBinary, impl::gcdLehmer, impl::gcdHalf
+    };
+#ifndef OUTPUT_GNUPLOT
+    const char* const names[] = {
+      "impl::gcd", "impl::gcdBinary", "impl::gcdLehmer", "impl::gcdHalf"
+    };
+#endif
+    for (size_t f = 0; f < 4; ++f) {
+      Xbyak::util::Clock clk;
+      for (int j = 0; j < numOfSample; ++j) {
+        clk.begin();
+        mz = funcs[f](mx, my);
+        clk.end();
+      }
+      const double t = (double)clk.getClock() / clk.getCount();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, t);
+#else
+      printf(BENCHF, names[f], t);
+#endif
+      TEST_EQ(mz, MPInt(gz));
+    }
+
+#ifdef OUTPUT_GNUPLOT
+    puts("");
+#endif
+  }
+}
+
+void bench_invert()
+{
+  printf("\n\n# %s\n", __func__);
+
+  using namespace std;
+  using namespace integer;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  for (size_t n = 1; n <= 64; n *= 2) {
+    const size_t len = 64*n;
+    const int numOfSample = std::max(N / (int)n, 2);
+#ifdef OUTPUT_GNUPLOT
+    /*
+      @note: Output is:
+      digits gmp_timing invert_timing constant_time_timing
+    */
+    cout << n << " ";
+#else
+    PUT(len);
+#endif
+
+    mpz_class gm = rng.get_z_bits(len);
+    mpz_setbit(gm.get_mpz_t(), len - 1);
+    gm |= 1;
+    mpz_class ga = rng.get_z_range(gm);
+    mpz_class gz;
+    const MPInt ma(ga), mm(gm);
+    MPInt mz;
+
+    {
+      Xbyak::util::Clock clk;
+      for (int j = 0; j < numOfSample; ++j) {
+        clk.begin();
+        mpz_invert(gz.get_mpz_t(), ga.get_mpz_t(), gm.get_mpz_t());
+        clk.end();
+      }
+      const double t = (double)clk.getClock() / clk.getCount();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, t);
+#else
+      printf(BENCHF, "mpz_invert", t);
+#endif
+    }
+
+    for (int ct = 0; ct < 2; ++ct) {
+      Xbyak::util::Clock clk;
+      for (int j = 0; j < numOfSample; ++j) {
+        clk.begin();
+        impl::invert(mz, ma, mm, ct != 0);
+        clk.end();
+      }
+      const double t = (double)clk.getClock() / clk.getCount();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, t);
+#else
+      printf(BENCHF, ct ? "impl::invert constant-time" : "impl::invert", t);
+#endif
+      TEST_EQ(mz, MPInt(gz));
+    }
+
+#ifdef OUTPUT_GNUPLOT
+    puts("");
+#endif
+  }
+}
+
+void info_gmp()
+{
+  using namespace std;
+
+  cerr << "GMP Version is " << gmp_version << endl
+       << "number of bits in mp_limb is " << mp_bits_per_limb << endl;
+}
+
+void test_all()
+{
+  using namespace std;
+  using namespace mpint;
+
+  MPInt::codeGen(0);
+
+  test_gcd();
+  test_invert();
+
+  cout.flush();
+
+  MPInt::codeGen();
+
+  test_gcd();
+  test_invert();
+
+  cout.flush();
+}
+
+void bench_for_gnuplot()
+{
+  using namespace std;
+  using namespace mpint;
+
+  MPInt::codeGen(0);
+  bench_gcd();
+  bench_invert();
+
+  MPInt::codeGen();
+  bench_gcd();
+  bench_invert();
+}
+
+int main()
+{
+  using namespace std;
+  using namespace mpint;
+
+#ifndef NDEBUG
+  cerr << "NDEBUG is undefined" << endl;
+#endif
+  cerr << "Number of sampling loop: " << N << endl;
+
+  info_gmp();
+  MPIntCodeGen();
+
+  test_all();
+
+  bench_for_gnuplot();
+
+  return testsAreSucceeded() ? 0 : 1;
+}
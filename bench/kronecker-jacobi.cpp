@@ -25,10 +25,16 @@
   @license: The MIT license <http://opensource.org/licenses/MIT>
 */
 
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
+#include <cstdio>
 #include <iostream>
 #include <string>
 #include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 #include <xbyak/xbyak_util.h>
 
 #include <gmpxx.h>
@@ -37,6 +43,12 @@
 #include "util.hpp"
 #include "mpint.hpp"
 #include "kronecker-jacobi.hpp"
+#include "kronecker-constexpr.hpp"
+#include "qrcache.hpp"
+#include "multimod.hpp"
+#include "jacobi-batch.hpp"
+#include "legendre-prf.hpp"
+#include "qr-batch.hpp"
 
 using namespace ff_util;
 
@@ -594,6 +606,98 @@ void test_mpint_shr()
   }
 }
 
+void test_mpint_arith()
+{
+  PUTSERR(__func__);
+
+  using namespace std;
+  using namespace mpint;
+
+  {
+    MPInt a(7), b(0), q, r;
+    TEST_THROW(MPInt::divmod(q, r, a, b), std::invalid_argument);
+  }
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  const size_t numOfLoop = 100;
+  const size_t multiLen = 50;
+  const size_t offsetLen = 1;
+  for (size_t i = 0; i < numOfLoop; ++i) {
+    const size_t lx = multiLen*i + offsetLen;
+    const size_t ly = multiLen*(i % 13) + offsetLen;
+    mpz_class gx = rng.get_z_bits(lx);
+    mpz_class gy = rng.get_z_bits(ly) + 1;
+    if (i & 1) {
+      gx = -gx;
+    }
+    if (i & 2) {
+      gy = -gy;
+    }
+    if (i % 10 == 9) {
+      // divisor with all ones digits, qhat correction paths.
+      gy = 0;
+      mpz_setbit(gy.get_mpz_t(), 64*(i % 7 + 1));
+      gy -= 1;
+    }
+
+    MPInt mx(gx), my(gy), mz, mq, mr;
+
+    MPInt::add(mz, mx, my);
+    TEST_EQ(mz, MPInt(mpz_class(gx + gy)));
+
+    MPInt::sub(mz, mx, my);
+    TEST_EQ(mz, MPInt(mpz_class(gx - gy)));
+
+    MPInt::mul(mz, mx, my);
+    TEST_EQ(mz, MPInt(mpz_class(gx * gy)));
+
+    mz = mx;
+    MPInt::mul(mz, mz, mz);
+    TEST_EQ(mz, MPInt(mpz_class(gx * gx)));
+
+    MPInt::divmod(mq, mr, mx, my);
+    mpz_class gq, gr;
+    mpz_tdiv_qr(gq.get_mpz_t(), gr.get_mpz_t(), gx.get_mpz_t(), gy.get_mpz_t());
+    TEST_EQ(mq, MPInt(gq));
+    TEST_EQ(mr, MPInt(gr));
+
+    MPInt::mod(mr, mx, my);
+    mpz_mod(gr.get_mpz_t(), gx.get_mpz_t(), gy.get_mpz_t());
+    TEST_EQ(mr, MPInt(gr));
+
+    MPInt::shl(mz, mx, i);
+    TEST_EQ(mz, MPInt(mpz_class(gx << i)));
+  }
+
+  // long operands, balanced and unbalanced.
+  for (size_t i = 0; i < 40; ++i) {
+    mpz_class gx = rng.get_z_bits(64*(30 + 97*i % 400));
+    mpz_class gy = rng.get_z_bits(64*(30 + 53*i % 200));
+    if (i % 4 == 0) {
+      gy = rng.get_z_bits(mpz_sizeinbase(gx.get_mpz_t(), 2));
+    } else if (i % 4 == 1) {
+      // all ones digits.
+      gx = 0;
+      mpz_setbit(gx.get_mpz_t(), 64*(30 + 7*i));
+      gx -= 1;
+      gy = gx;
+    }
+    MPInt mx(gx), my(gy), mz, mq, mr;
+
+    MPInt::mul(mz, mx, my);
+    TEST_EQ(mz, MPInt(mpz_class(gx * gy)));
+
+    if (gy != 0) {
+      MPInt::divmod(mq, mr, mx, my);
+      TEST_EQ(mq, MPInt(mpz_class(gx / gy)));
+      TEST_EQ(mr, MPInt(mpz_class(gx % gy)));
+    }
+  }
+}
+
 void test_mpint_kronecker()
 {
   PUTSERR(__func__);
@@ -641,6 +745,140 @@ void test_mpint_kronecker()
     TEST_LESSEQ(-1, mr);
     TEST_LESSEQ(mr, 1);
     TEST_EQ(gr, mr);
+
+    TEST_EQ(gr, impl::kroneckerDivsteps(mx, my));
+    TEST_EQ(gr, impl::kroneckerDivsteps(mx, my, true));
+    TEST_EQ(mpz_kronecker(gy.get_mpz_t(), gx.get_mpz_t()), impl::kroneckerDivsteps(my, mx));
+
+    for (size_t logK = 4; logK <= 16; logK += 2) {
+      TEST_EQ(gr, impl::kroneckerKary(mx, my, logK));
+    }
+  }
+}
+
+void test_mpint_kronecker_kary()
+{
+  PUTSERR(__func__);
+
+  using namespace std;
+  using namespace mpint;
+  using namespace integer;
+
+  for (int64_t x = -40; x <= 40; ++x) {
+    for (int64_t y = -40; y <= 40; ++y) {
+      MPInt mx(x), my(y);
+      TEST_EQ(kronecker(x, y), impl::kroneckerKary(mx, my));
+    }
+  }
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  const size_t logKs[] = { 4, 8, 16 };
+  for (size_t i = 0; i < 300; ++i) {
+    const size_t lx = 1 + 37*i % 3000;
+    const size_t ly = i % 3 == 0 ? lx : 1 + 53*i % 3000;
+    mpz_class gx = rng.get_z_bits(lx);
+    mpz_class gy = rng.get_z_bits(ly) + 1;
+    if (i % 5 == 0) {
+      // common factor.
+      const mpz_class gg = rng_odd(rng, 1 + i % 200);
+      gx *= gg;
+      gy *= gg;
+    }
+    if (i % 7 == 0) {
+      gy <<= i % 5;
+    }
+    if (i & 1) {
+      gx = -gx;
+    }
+    if (i & 2) {
+      gy = -gy;
+    }
+    MPInt mx(gx), my(gy);
+    const int gr = mpz_kronecker(gx.get_mpz_t(), gy.get_mpz_t());
+    for (size_t j = 0; j < sizeof(logKs)/sizeof(logKs[0]); ++j) {
+      TEST_EQ(gr, impl::kroneckerKary(mx, my, logKs[j]));
+    }
+  }
+
+  // multiples of small odd numbers, which make (a/v) = 0.
+  for (size_t i = 0; i < 100; ++i) {
+    const mpz_class gx = rng_odd(rng, 500) * (2*(i % 128) + 1);
+    const mpz_class gy = rng_odd(rng, 500) * (2*(i / 2 % 128) + 1);
+    MPInt mx(gx), my(gy);
+    const int gr = mpz_kronecker(gx.get_mpz_t(), gy.get_mpz_t());
+    for (size_t j = 0; j < sizeof(logKs)/sizeof(logKs[0]); ++j) {
+      TEST_EQ(gr, impl::kroneckerKary(mx, my, logKs[j]));
+    }
+  }
+
+  const size_t invalid[] = { 0, 2, 5, 18 };
+  for (size_t j = 0; j < sizeof(invalid)/sizeof(invalid[0]); ++j) {
+    TEST_THROW(impl::kroneckerKary(MPInt(3), MPInt(5), invalid[j]), std::invalid_argument);
+  }
+}
+
+void test_mpint_kronecker_divsteps()
+{
+  PUTSERR(__func__);
+
+  using namespace std;
+  using namespace mpint;
+  using namespace integer;
+
+  for (int64_t x = -40; x <= 40; ++x) {
+    for (int64_t y = -40; y <= 40; ++y) {
+      MPInt mx(x), my(y);
+      const int r = kronecker(x, y);
+      TEST_EQ(r, impl::kroneckerDivsteps(mx, my));
+      TEST_EQ(r, impl::kroneckerDivsteps(mx, my, true));
+    }
+  }
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  for (size_t i = 0; i < 300; ++i) {
+    const size_t lx = 1 + 37*i % 3000;
+    const size_t ly = i % 3 == 0 ? lx : 1 + 53*i % 3000;
+    mpz_class gx = rng.get_z_bits(lx);
+    mpz_class gy = rng.get_z_bits(ly) + 1;
+    if (i % 5 == 0) {
+      // common factor.
+      const mpz_class gg = rng_odd(rng, 1 + i % 200);
+      gx *= gg;
+      gy *= gg;
+    }
+    if (i % 7 == 0) {
+      gy <<= i % 5;
+    }
+    if (i & 1) {
+      gx = -gx;
+    }
+    if (i & 2) {
+      gy = -gy;
+    }
+    MPInt mx(gx), my(gy);
+    const int gr = mpz_kronecker(gx.get_mpz_t(), gy.get_mpz_t());
+    TEST_EQ(gr, impl::kroneckerDivsteps(mx, my));
+    TEST_EQ(gr, impl::kroneckerDivsteps(mx, my, true));
+  }
+
+  // equal and close values, all ones digits.
+  for (size_t n = 1; n < 40; n = n*2 + 1) {
+    mpz_class g = 0;
+    mpz_setbit(g.get_mpz_t(), 64*n);
+    g -= 1;
+    const mpz_class xs[] = { g, g - 2, g + 2, g * g - 2, mpz_class(2) };
+    for (size_t j = 0; j < sizeof(xs)/sizeof(xs[0]); ++j) {
+      MPInt mx(xs[j]), my(g);
+      const int gr = mpz_kronecker(xs[j].get_mpz_t(), g.get_mpz_t());
+      TEST_EQ(gr, impl::kroneckerDivsteps(mx, my));
+      TEST_EQ(gr, impl::kroneckerDivsteps(mx, my, true));
+    }
   }
 }
 
@@ -935,7 +1173,7 @@ void bench_kronecker()
 #ifdef OUTPUT_GNUPLOT
     /*
       @note: Output is:
-      length gmp_timing my_impl_timing
+      length gmp_timing my_impl_timing divsteps_timing divsteps_constant_time_timing kary_2^4_timing kary_2^8_timing kary_2^16_timing
     */
     cout << len << " ";
 #else
@@ -985,6 +1223,43 @@ void bench_kronecker()
 #endif
     }
 
+    for (int ct = 0; ct < 2; ++ct) {
+      int dr;
+      Xbyak::util::Clock clk;
+      for (int j = 0; j < N; ++j) {
+        clk.begin();
+        dr = impl::kroneckerDivsteps(mx, my, ct != 0);
+        clk.end();
+      }
+      TEST_EQ(gr, dr);
+      const double t = (double)clk.getClock() / clk.getCount();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, t);
+#else
+      printf(BENCHF, ct ? "impl::kroneckerDivsteps constant-time" : "impl::kroneckerDivsteps", t);
+#endif
+    }
+
+    const size_t logKs[] = { 4, 8, 16 };
+    for (size_t i = 0; i < sizeof(logKs)/sizeof(logKs[0]); ++i) {
+      int kr;
+      Xbyak::util::Clock clk;
+      for (int j = 0; j < N; ++j) {
+        clk.begin();
+        kr = impl::kroneckerKary(mx, my, logKs[i]);
+        clk.end();
+      }
+      TEST_EQ(gr, kr);
+      const double t = (double)clk.getClock() / clk.getCount();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, t);
+#else
+      char name[64];
+      snprintf(name, sizeof(name), "impl::kroneckerKary k = 2^%d", (int)logKs[i]);
+      printf(BENCHF, name, t);
+#endif
+    }
+
 #ifdef OUTPUT_GNUPLOT
     puts("");
 #else
@@ -1002,6 +1277,456 @@ void info_gmp()
        << "number of bits in mp_limb is " << mp_bits_per_limb << endl;
 }
 
+namespace integer {
+extern int tbl1[];
+}
+
+void test_kronecker_constexpr()
+{
+  PUTSERR(__func__);
+
+  using namespace std;
+  using namespace integer;
+
+  for (size_t i = 0; i < 8; ++i) {
+    TEST_EQ(tbl1[i], tbl1Const[i]);
+  }
+
+  for (int64_t x = -100; x <= 100; ++x) {
+    for (int64_t y = -100; y <= 100; ++y) {
+      TEST_EQ(kronecker(x, y), kroneckerConst(x, y));
+    }
+  }
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+  for (size_t i = 0; i < 10000; ++i) {
+    int64_t x = (int64_t)mpz_class(rng.get_z_bits(1 + i % 62)).get_ui();
+    int64_t y = (int64_t)mpz_class(rng.get_z_bits(1 + i * 7 % 62)).get_ui();
+    if (i & 1) {
+      x = -x;
+    }
+    if (i & 2) {
+      y = -y;
+    }
+    TEST_EQ(kronecker(x, y), kroneckerConst(x, y));
+  }
+
+  // usable in constant expressions.
+  static_assert(kroneckerConst(-1, 65521) == 1 && squares11[3] && ! squares11[2], "");
+
+  const size_t ms[] = { 64, 63, 65, 11 };
+  for (size_t i = 0; i < sizeof(ms)/sizeof(ms[0]); ++i) {
+    const size_t m = ms[i];
+    vector<bool> sq(m, false);
+    for (size_t y = 0; y < m; ++y) {
+      sq[y * y % m] = true;
+    }
+    for (size_t r = 0; r < m; ++r) {
+      const bool t = m == 64 ? squares64[r] : m == 63 ? squares63[r] : m == 65 ? squares65[r] : squares11[r];
+      TEST_EQ(sq[r], t);
+    }
+  }
+}
+
+void test_qrcache()
+{
+  PUTSERR(__func__);
+
+  using namespace std;
+  using namespace mpint;
+  using namespace integer;
+
+  const uint32_t primes[] = { 3, 5, 7, 11, 13, 101, 257, 4093, 65521 };
+  const size_t np = sizeof(primes)/sizeof(primes[0]);
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  QRCache cache;
+  for (size_t i = 0; i < np; ++i) {
+    const uint32_t p = primes[i];
+    const QRCache::bitmap_ptr b = cache.get(p);
+    TEST_EQ(p, b->prime());
+    for (int64_t x = -2*(int64_t)p; x <= 2*(int64_t)p; x += 1 + p / 1000) {
+      TEST_EQ(kronecker(x, p), b->kronecker(x));
+    }
+    for (size_t j = 0; j < 20; ++j) {
+      mpz_class gx = rng.get_z_bits(1 + 97*j);
+      if (j & 1) {
+        gx = -gx;
+      }
+      const int gr = mpz_kronecker_ui(gx.get_mpz_t(), p);
+      TEST_EQ(gr, b->kronecker(MPInt(gx)));
+    }
+  }
+  TEST_EQ(np, cache.size());
+
+  // the least recently used ones are dropped.
+  {
+    QRCache small(3 * QRBitmap(65521).bytes());
+    QRCache::bitmap_ptr first = small.get(65521);
+    small.get(65519);
+    small.get(65497);
+    TEST_EQ(3u, small.size());
+    small.get(65521);
+    small.get(65479);
+    TEST_EQ(3u, small.size());
+    TEST_LESSEQ(small.bytes(), small.maxBytes());
+    // 65519 was dropped, and the held one is still valid.
+    TEST_EQ(kronecker(-1, 65521), first->kronecker(-1));
+    small.clear();
+    TEST_EQ(0u, small.size());
+    TEST_EQ(0u, small.bytes());
+    TEST_EQ(kronecker(5, 65521), first->kronecker(5));
+  }
+
+  // shared between threads.
+  {
+    const size_t numThreads = 4;
+    vector<int> errors(numThreads, 0);
+    vector<thread> ths;
+    for (size_t t = 0; t < numThreads; ++t) {
+      ths.push_back(thread([t, &errors]() {
+            for (int64_t p = 3; p < 3000; p += 2) {
+              bool prime = true;
+              for (int64_t d = 3; d*d <= p; d += 2) {
+                prime = prime && p % d != 0;
+              }
+              if (! prime) {
+                continue;
+              }
+              const QRCache::bitmap_ptr b = QRCache::shared().get((uint32_t)p);
+              for (int64_t x = -(int64_t)t; x < 50; x += 7) {
+                if (b->kronecker(x) != kronecker(x, p)) {
+                  ++errors[t];
+                }
+              }
+            }
+          }));
+    }
+    for (size_t t = 0; t < numThreads; ++t) {
+      ths[t].join();
+      TEST_EQ(0, errors[t]);
+    }
+  }
+
+  const uint32_t invalid[] = { 0, 1, 2, 9, 65535, 65537 };
+  for (size_t j = 0; j < sizeof(invalid)/sizeof(invalid[0]); ++j) {
+    TEST_THROW(cache.get(invalid[j]), std::invalid_argument);
+  }
+  TEST_EQ(np, cache.size());
+}
+
+namespace {
+
+/*
+  Odd primes p < limit.
+*/
+std::vector<uint32_t> oddPrimes(const uint32_t limit)
+{
+  std::vector<uint32_t> ps;
+  for (uint32_t p = 3; p < limit; p += 2) {
+    bool prime = true;
+    for (uint32_t d = 3; prime && d*d <= p; d += 2) {
+      prime = p % d != 0;
+    }
+    if (prime) {
+      ps.push_back(p);
+    }
+  }
+  return ps;
+}
+
+/*
+  x[0..n) as mpz_class.
+*/
+mpz_class fromDigits(const mpint::MPInt::value_type* x, const size_t n)
+{
+  mpz_class z;
+  mpz_import(z.get_mpz_t(), n, -1, sizeof(x[0]), 0, 0, x);
+  return z;
+}
+
+/*
+  A random prime of the bits.
+*/
+mpz_class randomPrime(gmp_randclass& rng, const size_t bits)
+{
+  mpz_class p = rng.get_z_bits(bits);
+  mpz_setbit(p.get_mpz_t(), bits - 1);
+  mpz_nextprime(p.get_mpz_t(), p.get_mpz_t());
+  return p;
+}
+
+/*
+  Goldwasser-Micali ciphertexts of the bits, c = y^2 z^b mod N
+  for (z/p) = (z/q) = -1, as count*n digits.
+*/
+std::vector<mpint::MPInt::value_type> gmEncrypt(gmp_randclass& rng, const mpz_class& p, const mpz_class& q, const std::vector<int>& bits)
+{
+  const mpz_class N = p * q;
+  mpz_class z = 2;
+  while (mpz_legendre(z.get_mpz_t(), p.get_mpz_t()) != -1 || mpz_legendre(z.get_mpz_t(), q.get_mpz_t()) != -1) {
+    ++z;
+  }
+  const size_t n = mpint::MPInt(N).size();
+  std::vector<mpint::MPInt::value_type> c(bits.size() * n, 0);
+  for (size_t i = 0; i < bits.size(); ++i) {
+    const mpz_class y = rng.get_z_range(N);
+    mpz_class ci = y * y % N;
+    if (bits[i]) {
+      ci = ci * z % N;
+    }
+    const mpint::MPInt mc(ci);
+    std::copy(mc.get(), mc.get() + mc.size(), &c[i * n]);
+  }
+  return c;
+}
+
+} // namespace
+
+void test_multimod()
+{
+  PUTSERR(__func__);
+
+  using namespace std;
+  using namespace mpint;
+  using namespace integer;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  vector<uint32_t> ps = oddPrimes(2000);
+  ps.push_back(65521);
+  ps.push_back(65519);
+  // not primes.
+  ps.push_back(65535);
+  ps.push_back(9);
+  ps.push_back(3);
+
+  for (int version = 0; version >= -1; --version) {
+    MultiModulus::codeGen(version);
+    MultiModulus mm(ps);
+    TEST_EQ(ps.size(), mm.size());
+    vector<uint32_t> r(ps.size());
+    vector<int> sym(ps.size());
+    for (size_t i = 0; i < 100; ++i) {
+      mpz_class gx = rng.get_z_bits(i * 61);
+      if (i & 1) {
+        gx = -gx;
+      }
+      if (i % 10 == 0) {
+        // all ones digits.
+        gx = 1;
+        gx <<= 64 * (i / 10 + 1);
+        gx -= 1;
+      }
+      MPInt mx(gx);
+      mm.residues(&r[0], mx);
+      mm.kronecker(&sym[0], mx);
+      for (size_t j = 0; j < ps.size(); ++j) {
+        TEST_EQ(mpz_fdiv_ui(gx.get_mpz_t(), ps[j]), r[j]);
+        TEST_EQ(mpz_kronecker_ui(gx.get_mpz_t(), ps[j]), sym[j]);
+      }
+    }
+  }
+  MultiModulus::codeGen();
+
+  const uint32_t invalid[] = { 0, 1, 2, 4, 65537 };
+  for (size_t j = 0; j < sizeof(invalid)/sizeof(invalid[0]); ++j) {
+    TEST_THROW(MultiModulus(vector<uint32_t>(1, invalid[j])), std::invalid_argument);
+  }
+}
+
+void test_jacobi_batch()
+{
+  PUTSERR(__func__);
+
+  using namespace std;
+  using namespace mpint;
+  using namespace integer;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  for (int version = 0; version >= -1; --version) {
+    JacobiBatch::codeGen(version);
+    for (size_t bits = 2; bits <= 1100; bits = bits * 3 / 2 + 1) {
+      mpz_class gm = rng.get_z_bits(bits);
+      gm |= 1;
+      if (gm == 1) {
+        gm = 3;
+      }
+      if (bits % 4 == 1) {
+        // the top digit is full.
+        gm |= (mpz_class)(1) << ((bits + 63) / 64 * 64 - 1);
+      }
+      if (bits % 3 == 0) {
+        // odd composite.
+        gm *= 15;
+      }
+      JacobiBatch batch((MPInt(gm)));
+      const size_t n = batch.size();
+      // partial groups of lanes.
+      const size_t count = 37 + bits % 4;
+      vector<MPInt::value_type> x(count * n, 0);
+      vector<mpz_class> gx(count);
+      vector<int8_t> s(count);
+      for (size_t i = 0; i < count; ++i) {
+        if (i % 7 == 0) {
+          gx[i] = 0;
+        } else if (i % 7 == 1) {
+          gx[i] = gm - 1;
+        } else if (i % 7 == 2) {
+          gx[i] = 15 * (mpz_class)(i);
+          gx[i] %= gm;
+        } else {
+          gx[i] = rng.get_z_range(gm);
+        }
+        const MPInt mx(gx[i]);
+        std::copy(mx.get(), mx.get() + mx.size(), &x[i * n]);
+      }
+      batch.symbols(&s[0], &x[0], count);
+      for (size_t i = 0; i < count; ++i) {
+        TEST_EQ(mpz_jacobi(gx[i].get_mpz_t(), gm.get_mpz_t()), s[i]);
+      }
+    }
+  }
+  JacobiBatch::codeGen();
+
+  const int invalid[] = { 0, 1, 2, -3 };
+  for (size_t j = 0; j < sizeof(invalid)/sizeof(invalid[0]); ++j) {
+    TEST_THROW(JacobiBatch(MPInt(invalid[j])), std::invalid_argument);
+  }
+}
+
+void test_legendre_prf()
+{
+  PUTSERR(__func__);
+
+  using namespace std;
+  using namespace mpint;
+  using namespace integer;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  for (size_t bits = 8; bits <= 300; bits *= 3) {
+    mpz_class gp;
+    mpz_class r = rng.get_z_bits(bits);
+    mpz_nextprime(gp.get_mpz_t(), r.get_mpz_t());
+    LegendrePRF prf((MPInt(gp)));
+    TEST_ASSERT(prf.prime() == MPInt(gp));
+
+    // k is negative, k >= p and k + i passes over a multiple of p.
+    const mpz_class keys[] = { rng.get_z_range(gp), -rng.get_z_range(gp), gp * 3 - 700 };
+    for (size_t j = 0; j < sizeof(keys)/sizeof(keys[0]); ++j) {
+      const MPInt mk(keys[j]);
+      const uint64_t counts[] = { 1, 9, 1000 };
+      for (size_t c = 0; c < sizeof(counts)/sizeof(counts[0]); ++c) {
+        const uint64_t count = counts[c];
+        for (size_t threads = 1; threads <= 3; ++threads) {
+          vector<uint8_t> out((count + 7) / 8, 0xff);
+          prf.evaluate(&out[0], mk, count, threads);
+          for (uint64_t i = 0; i < count; ++i) {
+            const mpz_class a = keys[j] + (mpz_class)(unsigned long)i;
+            const int bit = (out[i / 8] >> (i % 8)) & 1;
+            TEST_EQ(mpz_kronecker(a.get_mpz_t(), gp.get_mpz_t()) == -1 ? 1 : 0, bit);
+            if (i < 20) {
+              TEST_EQ(prf.bit(mk, i), bit);
+            }
+          }
+          if (count % 8 != 0) {
+            TEST_EQ(0, out.back() >> (count % 8));
+          }
+        }
+      }
+    }
+  }
+
+  {
+    uint8_t out;
+    TEST_THROW(LegendrePRF(MPInt(4)), std::invalid_argument);
+    TEST_THROW(LegendrePRF(MPInt(7)).evaluate(&out, MPInt(1), 1, 0), std::invalid_argument);
+  }
+}
+
+void test_qr_batch()
+{
+  PUTSERR(__func__);
+
+  using namespace std;
+  using namespace mpint;
+  using namespace integer;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  // the last ones have q of much less digits than p.
+  const size_t sizes[][2] = { { 32, 30 }, { 64, 64 }, { 100, 160 }, { 512, 512 }, { 400, 60 }, { 64, 700 } };
+  for (size_t j = 0; j < sizeof(sizes)/sizeof(sizes[0]); ++j) {
+    const mpz_class p = randomPrime(rng, sizes[j][0]);
+    const mpz_class q = randomPrime(rng, sizes[j][1]);
+    const mpz_class N = p * q;
+    const QRBatch pub((MPInt(N)));
+    const QRBatch sec((MPInt(p)), (MPInt(q)));
+    TEST_ASSERT(! pub.hasFactors());
+    TEST_ASSERT(sec.hasFactors());
+    TEST_ASSERT(sec.modulus() == MPInt(N));
+    TEST_EQ(pub.size(), sec.size());
+    const size_t n = sec.size();
+
+    const size_t count = 300 + j;
+    vector<int> bits(count);
+    for (size_t i = 0; i < count; ++i) {
+      bits[i] = (int)mpz_class(rng.get_z_bits(1)).get_ui();
+    }
+    vector<MPInt::value_type> c = gmEncrypt(rng, p, q, bits);
+    // not ciphertexts.
+    std::fill(&c[0], &c[n], 0);
+    c[n] = 1;
+    const MPInt mp(p);
+    std::copy(mp.get(), mp.get() + mp.size(), &c[2*n]);
+
+    for (size_t threads = 1; threads <= 3; ++threads) {
+      vector<uint8_t> out((count + 7) / 8, 0xff);
+      sec.decrypt(&out[0], &c[0], count, threads);
+      for (size_t i = 3; i < count; ++i) {
+        TEST_EQ(bits[i], (out[i / 8] >> (i % 8)) & 1);
+      }
+      if (count % 8 != 0) {
+        TEST_EQ(0, out.back() >> (count % 8));
+      }
+
+      vector<int8_t> s0(count), s1(count);
+      pub.jacobi(&s0[0], &c[0], count, threads);
+      sec.jacobi(&s1[0], &c[0], count, threads);
+      for (size_t i = 0; i < count; ++i) {
+        const mpz_class gc = fromDigits(&c[i * n], n);
+        TEST_EQ(mpz_jacobi(gc.get_mpz_t(), N.get_mpz_t()), s0[i]);
+        TEST_EQ(s0[i], s1[i]);
+      }
+    }
+  }
+
+  {
+    uint8_t out;
+    MPInt::value_type c = 4;
+    TEST_THROW(QRBatch(MPInt(15)).decrypt(&out, &c, 1), std::invalid_argument);
+  }
+  const int invalid[][2] = { { 7, 7 }, { 4, 7 }, { 7, 1 } };
+  for (size_t j = 0; j < sizeof(invalid)/sizeof(invalid[0]); ++j) {
+    TEST_THROW(QRBatch(MPInt(invalid[j][0]), MPInt(invalid[j][1])), std::invalid_argument);
+  }
+}
+
 void test_all()
 {
   using namespace std;
@@ -1013,7 +1738,10 @@ void test_all()
   test_mpint_NTZ();
   test_mpint_shr();
   test_mpint_sub();
+  test_mpint_arith();
   test_mpint_kronecker();
+  test_mpint_kronecker_divsteps();
+  test_mpint_kronecker_kary();
 
   cout.flush();
 
@@ -1023,7 +1751,10 @@ void test_all()
   test_mpint_NTZ();
   test_mpint_shr();
   test_mpint_sub();
+  test_mpint_arith();
   test_mpint_kronecker();
+  test_mpint_kronecker_divsteps();
+  test_mpint_kronecker_kary();
 
   cout.flush();
 
@@ -1033,9 +1764,361 @@ void test_all()
   test_mpint_NTZ();
   test_mpint_shr();
   test_mpint_sub();
+  test_mpint_arith();
   test_mpint_kronecker();
+  test_mpint_kronecker_divsteps();
+  test_mpint_kronecker_kary();
 
   cout.flush();
+
+  test_kronecker_constexpr();
+  test_qrcache();
+  test_multimod();
+  test_jacobi_batch();
+  test_legendre_prf();
+  test_qr_batch();
+}
+
+void bench_qrcache()
+{
+  printf("\n\n# %s\n", __func__);
+
+  using namespace std;
+  using namespace integer;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  const size_t numOfValues = 1000;
+  vector<int64_t> xs(numOfValues);
+  vector<mpz_class> gxs(numOfValues);
+  vector<MPInt> mxs(numOfValues);
+  for (size_t i = 0; i < numOfValues; ++i) {
+    gxs[i] = rng.get_z_bits(1024);
+    mxs[i] = MPInt(gxs[i]);
+    xs[i] = (int64_t)mpz_class(rng.get_z_bits(62)).get_ui();
+  }
+
+  const uint32_t primes[] = { 251, 4093, 65521 };
+  QRCache cache;
+  for (size_t i = 0; i < sizeof(primes)/sizeof(primes[0]); ++i) {
+    const uint32_t p = primes[i];
+    const QRCache::bitmap_ptr b = cache.get(p);
+#ifdef OUTPUT_GNUPLOT
+    /*
+      @note: Output is:
+      p kronecker_int64 bitmap_int64 mpz_kronecker_ui_1024bit bitmap_1024bit
+      in clocks for one value.
+    */
+    cout << p << " ";
+#else
+    PUT(p);
+#endif
+
+    int sum[4] = { 0, 0, 0, 0 };
+    double t[4];
+    {
+      Xbyak::util::Clock clk;
+      clk.begin();
+      for (size_t j = 0; j < numOfValues; ++j) {
+        sum[0] += kronecker(xs[j], p);
+      }
+      clk.end();
+      t[0] = (double)clk.getClock() / numOfValues;
+    }
+    {
+      Xbyak::util::Clock clk;
+      clk.begin();
+      for (size_t j = 0; j < numOfValues; ++j) {
+        sum[1] += b->kronecker(xs[j]);
+      }
+      clk.end();
+      t[1] = (double)clk.getClock() / numOfValues;
+    }
+    {
+      Xbyak::util::Clock clk;
+      clk.begin();
+      for (size_t j = 0; j < numOfValues; ++j) {
+        sum[2] += mpz_kronecker_ui(gxs[j].get_mpz_t(), p);
+      }
+      clk.end();
+      t[2] = (double)clk.getClock() / numOfValues;
+    }
+    {
+      Xbyak::util::Clock clk;
+      clk.begin();
+      for (size_t j = 0; j < numOfValues; ++j) {
+        sum[3] += b->kronecker(mxs[j]);
+      }
+      clk.end();
+      t[3] = (double)clk.getClock() / numOfValues;
+    }
+    TEST_EQ(sum[0], sum[1]);
+    TEST_EQ(sum[2], sum[3]);
+
+#ifdef OUTPUT_GNUPLOT
+    for (size_t j = 0; j < 4; ++j) {
+      printf(GNUPLOTF, t[j]);
+    }
+    puts("");
+#else
+    const char* names[] = { "kronecker(int64_t)", "QRBitmap(int64_t)", "mpz_kronecker_ui 1024 bit", "QRBitmap(MPInt) 1024 bit" };
+    for (size_t j = 0; j < 4; ++j) {
+      printf(BENCHF, names[j], t[j]);
+    }
+#endif
+  }
+}
+
+void bench_multimod()
+{
+  printf("\n\n# %s\n", __func__);
+
+  using namespace std;
+  using namespace integer;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  // 500 odd primes.
+  vector<uint32_t> ps = oddPrimes(3600);
+  ps.resize(500);
+  vector<uint32_t> r(ps.size());
+  vector<int> sym(ps.size());
+
+  MultiModulus::codeGen(0);
+  MultiModulus portable(ps);
+  MultiModulus::codeGen();
+  MultiModulus best(ps);
+
+  for (size_t bits = 1024; bits <= 8192; bits *= 2) {
+    const mpz_class gx = rng.get_z_bits(bits);
+    const MPInt mx(gx);
+#ifdef OUTPUT_GNUPLOT
+    /*
+      @note: Output is:
+      bits divrem_1 portable best_kernel kronecker_with_best_kernel
+      in clocks for all the 500 primes.
+    */
+    cout << bits << " ";
+#else
+    PUT(bits);
+#endif
+
+    double t[4];
+    uint32_t sum = 0;
+    {
+      Xbyak::util::Clock clk;
+      for (int j = 0; j < N / 100; ++j) {
+        clk.begin();
+        for (size_t i = 0; i < ps.size(); ++i) {
+          r[i] = (uint32_t)MPInt::divrem_1(0, mx.get(), mx.size(), ps[i]);
+        }
+        clk.end();
+      }
+      t[0] = (double)clk.getClock() / clk.getCount();
+      sum = r[0] + r[ps.size() - 1];
+    }
+    MultiModulus* const mms[] = { &portable, &best };
+    for (size_t k = 0; k < 2; ++k) {
+      Xbyak::util::Clock clk;
+      for (int j = 0; j < N / 100; ++j) {
+        clk.begin();
+        mms[k]->residues(&r[0], mx);
+        clk.end();
+      }
+      t[k + 1] = (double)clk.getClock() / clk.getCount();
+      TEST_EQ(sum, r[0] + r[ps.size() - 1]);
+    }
+    {
+      Xbyak::util::Clock clk;
+      for (int j = 0; j < N / 100; ++j) {
+        clk.begin();
+        best.kronecker(&sym[0], mx);
+        clk.end();
+      }
+      t[3] = (double)clk.getClock() / clk.getCount();
+      TEST_EQ(mpz_kronecker_ui(gx.get_mpz_t(), ps[0]), sym[0]);
+    }
+
+#ifdef OUTPUT_GNUPLOT
+    for (size_t j = 0; j < 4; ++j) {
+      printf(GNUPLOTF, t[j]);
+    }
+    puts("");
+#else
+    const char* names[] = { "MPInt::divrem_1", "MultiModulus portable", "MultiModulus", "MultiModulus::kronecker" };
+    for (size_t j = 0; j < 4; ++j) {
+      printf(BENCHF, names[j], t[j]);
+    }
+#endif
+  }
+}
+
+void bench_legendre_prf()
+{
+  printf("\n\n# %s\n", __func__);
+
+  using namespace std;
+  using namespace integer;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  const size_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+  const uint64_t count = 1 << 16;
+  vector<uint8_t> out(count / 8);
+
+  for (size_t bits = 64; bits <= 512; bits *= 2) {
+    mpz_class gp;
+    mpz_class r = rng.get_z_bits(bits);
+    mpz_nextprime(gp.get_mpz_t(), r.get_mpz_t());
+    const mpz_class gk = rng.get_z_range(gp);
+    const MPInt mp(gp), mk(gk);
+
+    JacobiBatch::codeGen(0);
+    LegendrePRF portable(mp);
+    JacobiBatch::codeGen();
+    LegendrePRF best(mp);
+#ifdef OUTPUT_GNUPLOT
+    /*
+      @note: Output is:
+      bits mpz_legendre portable best_kernel best_kernel_all_cores
+      in symbols per second.
+    */
+    cout << bits << " ";
+#else
+    PUT(bits);
+#endif
+
+    double t[4];
+    int sum = 0;
+    {
+      const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      mpz_class a = gk;
+      for (uint64_t i = 0; i < count; ++i) {
+        sum += mpz_legendre(a.get_mpz_t(), gp.get_mpz_t()) == -1;
+        ++a;
+      }
+      t[0] = (double)count / chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    const LegendrePRF* const prfs[] = { &portable, &best, &best };
+    const size_t threads[] = { 1, 1, cores };
+    for (size_t k = 0; k < 3; ++k) {
+      const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      prfs[k]->evaluate(&out[0], mk, count, threads[k]);
+      t[k + 1] = (double)count / chrono::duration<double>(chrono::steady_clock::now() - start).count();
+      int ones = 0;
+      for (size_t i = 0; i < out.size(); ++i) {
+        ones += __builtin_popcount(out[i]);
+      }
+      TEST_EQ(sum, ones);
+    }
+
+#ifdef OUTPUT_GNUPLOT
+    for (size_t j = 0; j < 4; ++j) {
+      printf(GNUPLOTF, t[j]);
+    }
+    puts("");
+#else
+    const char* names[] = { "mpz_legendre", "LegendrePRF portable", "LegendrePRF", "LegendrePRF all cores" };
+    for (size_t j = 0; j < 4; ++j) {
+      printf("%s:\t% 14.1f symbols/sec\n", names[j], t[j]);
+    }
+#endif
+  }
+}
+
+void bench_qr_batch()
+{
+  printf("\n\n# %s\n", __func__);
+
+  using namespace std;
+  using namespace integer;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  const size_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+  const size_t count = 1024;
+  vector<int> bits(count);
+  for (size_t i = 0; i < count; ++i) {
+    bits[i] = (int)(i * 7 % 3 == 0);
+  }
+  vector<uint8_t> out(count / 8);
+  vector<int8_t> s(count);
+
+  for (size_t nbits = 1024; nbits <= 4096; nbits *= 2) {
+    const mpz_class p = randomPrime(rng, nbits / 2);
+    const mpz_class q = randomPrime(rng, nbits / 2);
+    const vector<MPInt::value_type> c = gmEncrypt(rng, p, q, bits);
+    const QRBatch pub((MPInt(p * q)));
+    const QRBatch sec((MPInt(p)), (MPInt(q)));
+    const size_t n = sec.size();
+    vector<mpz_class> gc(count);
+    for (size_t i = 0; i < count; ++i) {
+      gc[i] = fromDigits(&c[i * n], n);
+    }
+#ifdef OUTPUT_GNUPLOT
+    /*
+      @note: Output is:
+      bits mpz_legendre_mod_p jacobi_mod_N decrypt decrypt_all_cores
+      in ciphertexts per second.
+    */
+    cout << nbits << " ";
+#else
+    PUT(nbits);
+#endif
+
+    double t[4];
+    int sum = 0;
+    {
+      const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      mpz_class r;
+      for (size_t i = 0; i < count; ++i) {
+        mpz_mod(r.get_mpz_t(), gc[i].get_mpz_t(), p.get_mpz_t());
+        sum += mpz_legendre(r.get_mpz_t(), p.get_mpz_t()) == -1;
+      }
+      t[0] = (double)count / chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    {
+      const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      pub.jacobi(&s[0], &c[0], count);
+      t[1] = (double)count / chrono::duration<double>(chrono::steady_clock::now() - start).count();
+      TEST_EQ(count, (size_t)std::count(s.begin(), s.end(), 1));
+    }
+    const size_t threads[] = { 1, cores };
+    for (size_t k = 0; k < 2; ++k) {
+      const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      sec.decrypt(&out[0], &c[0], count, threads[k]);
+      t[k + 2] = (double)count / chrono::duration<double>(chrono::steady_clock::now() - start).count();
+      int ones = 0;
+      for (size_t i = 0; i < out.size(); ++i) {
+        ones += __builtin_popcount(out[i]);
+      }
+      TEST_EQ(sum, ones);
+    }
+
+#ifdef OUTPUT_GNUPLOT
+    for (size_t j = 0; j < 4; ++j) {
+      printf(GNUPLOTF, t[j]);
+    }
+    puts("");
+#else
+    const char* names[] = { "mpz_mod + mpz_legendre", "QRBatch::jacobi mod N", "QRBatch::decrypt", "QRBatch::decrypt all cores" };
+    for (size_t j = 0; j < 4; ++j) {
+      printf("%s:\t% 14.1f ciphertexts/sec\n", names[j], t[j]);
+    }
+#endif
+  }
 }
 
 void bench_for_gnuplot()
@@ -1060,6 +2143,11 @@ void bench_for_gnuplot()
   bench_shr();
   bench_sub();
   bench_kronecker();
+
+  bench_qrcache();
+  bench_multimod();
+  bench_legendre_prf();
+  bench_qr_batch();
 }
 
 int main()
@@ -0,0 +1,1709 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <xbyak/xbyak_util.h>
+
+#include <gmpxx.h>
+#define USE_GMP
+
+#include "util.hpp"
+#include "mpint.hpp"
+#include "montgomery.hpp"
+#include "barrett.hpp"
+#include "modint.hpp"
+#include "powm.hpp"
+#include "batchinv.hpp"
+#include "gcd.hpp"
+#include "prodtree.hpp"
+#include "sqrtmod.hpp"
+
+using namespace ff_util;
+
+const int N = 10000;
+
+#define BENCHF "%s:\t% 10.2f clk\n"
+#define GNUPLOTF " % 15.2f"
+
+#define OUTPUT_GNUPLOT
+
+namespace {
+
+typedef mpint::MPInt::value_type value_type;
+
+/*
+  n-limb buffer <-> mpz_class.
+*/
+mpz_class toMpz(const value_type* x, const size_t n)
+{
+  mpz_class z;
+  mpz_import(z.get_mpz_t(), n, -1, sizeof(value_type), 0, 0, x);
+  return z;
+}
+
+void fromMpz(value_type* x, const size_t n, const mpz_class& z)
+{
+  std::fill(x, x + n, 0);
+  mpz_export(x, nullptr, -1, sizeof(value_type), 0, 0, z.get_mpz_t());
+}
+
+/*
+  A prime p = k 2^s + 1 of bits bits with odd k, or p = r mod 8 if s == 0.
+*/
+mpz_class primeOfForm(gmp_randclass& rng, const size_t bits, const size_t s, const unsigned long r = 1)
+{
+  for (;;) {
+    mpz_class p;
+    if (s > 0) {
+      mpz_class k = rng.get_z_bits(bits - s);
+      mpz_setbit(k.get_mpz_t(), bits - s - 1);
+      mpz_setbit(k.get_mpz_t(), 0);
+      p = (k << s) + 1;
+    } else {
+      p = rng.get_z_bits(bits);
+      mpz_setbit(p.get_mpz_t(), bits - 1);
+      p += r + 8 - mpz_fdiv_ui(p.get_mpz_t(), 8);
+    }
+    if (mpz_probab_prime_p(p.get_mpz_t(), 24)) {
+      return p;
+    }
+  }
+}
+
+} // namespace
+
+void test_montgomery()
+{
+  PUTSERR(__func__);
+
+  using namespace std;
+  using namespace mpint;
+
+  {
+    MPInt a(0), b(1), c(10), d(-7);
+    TEST_THROW(MontgomeryContext(a), std::invalid_argument);
+    TEST_THROW(MontgomeryContext(b), std::invalid_argument);
+    TEST_THROW(MontgomeryContext(c), std::invalid_argument);
+    TEST_THROW(MontgomeryContext(d), std::invalid_argument);
+  }
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  for (size_t n = 1; n <= MontgomeryContext::maxCodeSize + 2; ++n) {
+    for (size_t i = 0; i < 4; ++i) {
+      mpz_class gm = rng_odd(rng, 64*n);
+      mpz_setbit(gm.get_mpz_t(), 64*n - 1 - i);
+      if (i == 3) {
+        // 2^(64n) - 1.
+        gm = 0;
+        mpz_setbit(gm.get_mpz_t(), 64*n);
+        gm -= 1;
+      }
+
+      MPInt mm(gm);
+      MontgomeryContext ctx(mm);
+      TEST_EQ(ctx.size(), n);
+
+      mpz_class gR, gRinv;
+      mpz_ui_pow_ui(gR.get_mpz_t(), 2, 64*n);
+      mpz_invert(gRinv.get_mpz_t(), gR.get_mpz_t(), gm.get_mpz_t());
+      TEST_EQ(toMpz(ctx.one(), n), gR % gm);
+      TEST_EQ(toMpz(ctx.R2(), n), gR * gR % gm);
+      TEST_EQ(ctx.rp() * ctx.modulus()[0], ~value_type(0));
+
+      mpz_class gx = rng.get_z_range(gm);
+      mpz_class gy = rng.get_z_range(gm);
+      if (i == 3) {
+        gx = gm - 1;
+        gy = gm - 1;
+      }
+      vector<value_type> x(n), y(n), z(n);
+      fromMpz(&x[0], n, gx);
+      fromMpz(&y[0], n, gy);
+
+      ctx.mul(&z[0], &x[0], &y[0]);
+      TEST_EQ(toMpz(&z[0], n), gx * gy * gRinv % gm);
+
+      ctx.sqr(&z[0], &x[0]);
+      TEST_EQ(toMpz(&z[0], n), gx * gx * gRinv % gm);
+
+      z = x;
+      ctx.mul(&z[0], &z[0], &y[0]);
+      TEST_EQ(toMpz(&z[0], n), gx * gy * gRinv % gm);
+
+      ctx.sqr(&z[0], &z[0]);
+      mpz_class gz = gx * gy * gRinv % gm;
+      TEST_EQ(toMpz(&z[0], n), gz * gz * gRinv % gm);
+
+      ctx.add(&z[0], &x[0], &y[0]);
+      TEST_EQ(toMpz(&z[0], n), (gx + gy) % gm);
+
+      ctx.sub(&z[0], &x[0], &y[0]);
+      TEST_EQ(toMpz(&z[0], n), (gx - gy + gm) % gm);
+
+      MPInt mx(gx), my(gy), mz, mt;
+      ctx.toMont(mz, mx);
+      TEST_EQ(mz, MPInt(mpz_class(gx * gR % gm)));
+      ctx.fromMont(mt, mz);
+      TEST_EQ(mt, mx);
+
+      ctx.toMont(mt, my);
+      ctx.mul(mz, mz, mt);
+      ctx.fromMont(mt, mz);
+      TEST_EQ(mt, MPInt(mpz_class(gx * gy % gm)));
+
+      mpz_class gb = rng.get_z_bits(64*n);
+      ctx.toMont(mz, MPInt(gb));
+      ctx.fromMont(mt, mz);
+      TEST_EQ(mt, MPInt(mpz_class(gb % gm)));
+    }
+  }
+}
+
+void test_barrett()
+{
+  PUTSERR(__func__);
+
+  using namespace std;
+  using namespace mpint;
+
+  {
+    MPInt a(0), b(-7);
+    TEST_THROW(BarrettContext(a), std::invalid_argument);
+    TEST_THROW(BarrettContext(b), std::invalid_argument);
+  }
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  for (size_t n = 1; n <= 66; ++n) {
+    for (size_t i = 0; i < 5; ++i) {
+      mpz_class gm = rng.get_z_bits(64*n);
+      mpz_setbit(gm.get_mpz_t(), 64*n - 1 - i);
+      if (i == 1) {
+        // even modulus.
+        mpz_clrbit(gm.get_mpz_t(), 0);
+      } else if (i == 3) {
+        // B^(k-1), mu does not fit in k + 1 digits.
+        gm = 0;
+        mpz_setbit(gm.get_mpz_t(), 64*(n - 1));
+      } else if (i == 4) {
+        // B^k - 1.
+        gm = 0;
+        mpz_setbit(gm.get_mpz_t(), 64*n);
+        gm -= 1;
+      }
+
+      MPInt mm(gm);
+      BarrettContext ctx(mm);
+      TEST_EQ(ctx.size(), n);
+
+      mpz_class gB2k, gmu;
+      mpz_ui_pow_ui(gB2k.get_mpz_t(), 2, 128*n);
+      gmu = gB2k / gm;
+      TEST_EQ(ctx.mu(), MPInt(gmu));
+
+      vector<value_type> x(2*n), r(n), work(ctx.workSize());
+      for (size_t j = 0; j < 4; ++j) {
+        mpz_class gx = rng.get_z_bits(128*n);
+        if (j == 1) {
+          gx = gB2k - 1;
+        } else if (j == 2) {
+          gx = gm * gm - 1;
+        } else if (j == 3) {
+          gx = rng.get_z_bits(64*n);
+        }
+        fromMpz(&x[0], 2*n, gx);
+
+        ctx.reduce(&r[0], &x[0], 2*n, &work[0]);
+        TEST_EQ(toMpz(&r[0], n), gx % gm);
+
+        // x fits in fewer digits.
+        const size_t xn = (mpz_sizeinbase(gx.get_mpz_t(), 2) + 63) / 64;
+        ctx.reduce(&x[0], &x[0], xn, &work[0]);
+        TEST_EQ(toMpz(&x[0], n), gx % gm);
+
+        MPInt mr;
+        ctx.reduce(mr, MPInt(gx));
+        TEST_EQ(mr, MPInt(mpz_class(gx % gm)));
+      }
+
+      mpz_class gx = rng.get_z_range(gm);
+      mpz_class gy = rng.get_z_range(gm);
+      MPInt mz;
+      ctx.mul(mz, MPInt(gx), MPInt(gy));
+      TEST_EQ(mz, MPInt(mpz_class(gx * gy % gm)));
+
+      // out of range inputs fall back to MPInt::mod.
+      mpz_class gb = rng.get_z_bits(64*(3*n + 1));
+      ctx.reduce(mz, MPInt(gb));
+      TEST_EQ(mz, MPInt(mpz_class(gb % gm)));
+      ctx.reduce(mz, MPInt(mpz_class(-gb)));
+      mpz_class gt;
+      mpz_mod(gt.get_mpz_t(), mpz_class(-gb).get_mpz_t(), gm.get_mpz_t());
+      TEST_EQ(mz, MPInt(gt));
+    }
+  }
+}
+
+namespace {
+
+typedef mpint::Modulus<0x1fffffffffffffff> M61;
+typedef mpint::Modulus<0x86e1d0ed5cbad8a5, 0x1e3c43b0c1e2d1b7> M127;
+typedef mpint::Modulus<0xffffffffffffffff, 0xffffffff, 0, 0xffffffff00000001> P256;
+typedef mpint::Modulus<0xfffffffefffffc2f, 0xffffffffffffffff, 0xffffffffffffffff, 0xffffffffffffffff> Secp256k1;
+typedef mpint::Modulus<0xffffffff, 0xffffffff00000000, 0xfffffffffffffffe,
+                       0xffffffffffffffff, 0xffffffffffffffff, 0xffffffffffffffff> P384;
+
+template<size_t N, class Modulus>
+void test_modint_(gmp_randclass& rng)
+{
+  using namespace mpint;
+
+  typedef ModInt<N, Modulus> mod_t;
+
+  MPInt mm = mod_t::modulus();
+  mpz_class gm = toMpz(mod_t::m_.v, N);
+  TEST_EQ(mm, MPInt(gm));
+
+  mpz_class gR, gRinv;
+  mpz_ui_pow_ui(gR.get_mpz_t(), 2, 64*N);
+  mpz_invert(gRinv.get_mpz_t(), gR.get_mpz_t(), gm.get_mpz_t());
+  TEST_EQ(toMpz(mod_t::r1_.v, N), gR % gm);
+  TEST_EQ(toMpz(mod_t::r2_.v, N), gR * gR % gm);
+  TEST_EQ(toMpz(mod_t::one().raw(), N), gR % gm);
+
+  MPInt mt;
+  mod_t zero;
+  TEST_ASSERT(zero.isZero());
+  zero.get(mt);
+  TEST_ASSERT(mt.isZero());
+
+  for (size_t i = 0; i < 100; ++i) {
+    mpz_class gx = rng.get_z_range(gm);
+    mpz_class gy = rng.get_z_range(gm);
+    if (i == 0) {
+      gx = gm - 1;
+      gy = gm - 1;
+    }
+
+    mod_t x((MPInt(gx))), y((MPInt(gy))), z;
+    TEST_EQ(toMpz(x.raw(), N), gx * gR % gm);
+    x.get(mt);
+    TEST_EQ(mt, MPInt(gx));
+
+    (x + y).get(mt);
+    TEST_EQ(mt, MPInt(mpz_class((gx + gy) % gm)));
+
+    (x - y).get(mt);
+    TEST_EQ(mt, MPInt(mpz_class((gx - gy + gm) % gm)));
+
+    (-x).get(mt);
+    TEST_EQ(mt, MPInt(mpz_class((gm - gx) % gm)));
+
+    (x * y).get(mt);
+    TEST_EQ(mt, MPInt(mpz_class(gx * gy % gm)));
+
+    mod_t::sqr(z, x);
+    z.get(mt);
+    TEST_EQ(mt, MPInt(mpz_class(gx * gx % gm)));
+
+    z = x;
+    z *= z;
+    mod_t::sqr(y, x);
+    TEST_ASSERT(z == y);
+    z += x;
+    TEST_ASSERT(z != y);
+    z -= x;
+    TEST_ASSERT(z == y);
+
+    mpz_class gb = rng.get_z_bits(64*N + 64);
+    mpz_class gt;
+    mod_t b((MPInt(gb)));
+    b.get(mt);
+    TEST_EQ(mt, MPInt(mpz_class(gb % gm)));
+    mod_t nb((MPInt(mpz_class(-gb))));
+    nb.get(mt);
+    mpz_mod(gt.get_mpz_t(), mpz_class(-gb).get_mpz_t(), gm.get_mpz_t());
+    TEST_EQ(mt, MPInt(gt));
+    TEST_ASSERT((b + nb).isZero());
+  }
+}
+
+} // namespace
+
+void test_modint()
+{
+  PUTSERR(__func__);
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  test_modint_<1, M61>(rng);
+  test_modint_<2, M127>(rng);
+  // modulus shorter than N.
+  test_modint_<3, M127>(rng);
+  test_modint_<4, P256>(rng);
+  test_modint_<4, Secp256k1>(rng);
+  test_modint_<6, P384>(rng);
+}
+
+void test_powm()
+{
+  PUTSERR(__func__);
+
+  using namespace std;
+  using namespace mpint;
+
+  {
+    MPInt a(3), b(5), c(0), d(-7), z;
+    TEST_THROW(powm(z, a, b, c), std::invalid_argument);
+    TEST_THROW(powm(z, a, b, d), std::invalid_argument);
+    TEST_THROW(powm(z, a, d, b), std::invalid_argument);
+    TEST_THROW(powm(z, a, b, b, MontgomeryPowm::maxWindow + 1), std::invalid_argument);
+
+    powm(z, a, b, MPInt(1));
+    TEST_ASSERT(z.isZero());
+
+    powm(z, a, c, b);
+    TEST_EQ(z, 1);
+
+    powm(z, c, c, b);
+    TEST_EQ(z, 1);
+
+    powm(z, c, b, b);
+    TEST_ASSERT(z.isZero());
+  }
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  for (size_t i = 0; i < 200; ++i) {
+    const size_t lm = 1 + 37*i % 1100;
+    const size_t le = 1 + 53*i % 1300;
+    mpz_class gm = rng.get_z_bits(lm) + 2;
+    mpz_class ge = rng.get_z_bits(le);
+    mpz_class gx = rng.get_z_bits(lm + 70);
+    if (i & 1) {
+      gx = -gx;
+    }
+    if (i % 4 == 0) {
+      mpz_setbit(gm.get_mpz_t(), 0);
+    }
+
+    mpz_class gz;
+    mpz_powm(gz.get_mpz_t(), gx.get_mpz_t(), ge.get_mpz_t(), gm.get_mpz_t());
+
+    MPInt mx(gx), me(ge), mm(gm), mz;
+    powm(mz, mx, me, mm);
+    TEST_EQ(mz, MPInt(gz));
+
+    const size_t w = 1 + i % MontgomeryPowm::maxWindow;
+    powm(mz, mx, me, mm, w);
+    TEST_EQ(mz, MPInt(gz));
+
+    if (gm % 2 == 1) {
+      MontgomeryContext ctx(mm);
+      MontgomeryPowm p(ctx, w);
+      p.pow(mz, mx, me);
+      TEST_EQ(mz, MPInt(gz));
+
+      // Montgomery form, in place, exponent with upper zero digits.
+      const size_t n = ctx.size();
+      vector<value_type> x(n), e(me.size() + 2, 0);
+      std::copy(me.get(), me.get() + me.size(), e.begin());
+      ctx.toMont(&x[0], MPInt(mpz_class(gx % gm + gm)));
+      MontgomeryPowm q(ctx);
+      q.pow(&x[0], &x[0], &e[0], e.size());
+      ctx.fromMont(mz, &x[0]);
+      TEST_EQ(mz, MPInt(gz));
+    }
+  }
+}
+
+void test_fixedbase()
+{
+  PUTSERR(__func__);
+
+  using namespace std;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  const size_t budgets[] = { 0, 1 << 12, 1 << 16, FixedBasePowm::defaultBudget };
+  for (size_t i = 0; i < 40; ++i) {
+    const size_t lm = 64 + 97*i % 1000;
+    const size_t maxBits = 1 + 131*i % 1100;
+    mpz_class gm = rng_odd(rng, lm) + 2;
+    mpz_class gg = rng.get_z_bits(lm + 10);
+    if (i & 1) {
+      gg = -gg;
+    }
+
+    MPInt mm(gm), mz;
+    MontgomeryContext ctx(mm);
+    FixedBasePowm fb(ctx, MPInt(gg), maxBits, budgets[i % 4]);
+    TEST_ASSERT(fb.teeth() >= 1);
+    TEST_ASSERT(fb.blocks() >= 1);
+    TEST_ASSERT(fb.tableBytes() <= budgets[i % 4] || (fb.teeth() == 1 && fb.blocks() == 1));
+
+    for (size_t j = 0; j < 8; ++j) {
+      mpz_class ge = rng.get_z_bits(maxBits);
+      if (j == 0) {
+        ge = 0;
+      } else if (j == 1) {
+        ge = 1;
+      } else if (j == 2) {
+        // all ones of maxBits.
+        ge = 0;
+        mpz_setbit(ge.get_mpz_t(), maxBits);
+        ge -= 1;
+      } else if (j == 3) {
+        // longer than maxBits.
+        ge = rng.get_z_bits(maxBits + 100);
+        mpz_setbit(ge.get_mpz_t(), maxBits + 99);
+      }
+
+      mpz_class gz;
+      mpz_powm(gz.get_mpz_t(), gg.get_mpz_t(), ge.get_mpz_t(), gm.get_mpz_t());
+
+      fb.pow(mz, MPInt(ge));
+      TEST_EQ(mz, MPInt(gz));
+    }
+  }
+}
+
+void test_multipowm()
+{
+  PUTSERR(__func__);
+
+  using namespace std;
+  using namespace mpint;
+
+  {
+    vector<MPInt> g(2, MPInt(3)), e(1, MPInt(5));
+    MPInt z;
+    TEST_THROW(multiPowm(z, g, e, MPInt(7)), std::invalid_argument);
+
+    g.clear();
+    e.clear();
+    multiPowm(z, g, e, MPInt(7));
+    TEST_EQ(z, 1);
+  }
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  const size_t counts[] = { 1, 2, 3, 5, 8, 16, 40, 100 };
+  const MultiPowm::Method methods[] = { MultiPowm::Auto, MultiPowm::Straus, MultiPowm::Pippenger };
+  for (size_t c = 0; c < sizeof(counts)/sizeof(counts[0]); ++c) {
+    for (size_t i = 0; i < 4; ++i) {
+      const size_t k = counts[c];
+      const size_t lm = 64 + 301*(c + i) % 1000;
+      mpz_class gm = rng.get_z_bits(lm) + 2;
+      if (i != 3) {
+        mpz_setbit(gm.get_mpz_t(), 0);
+      }
+
+      vector<mpz_class> gg(k), ge(k);
+      vector<MPInt> mg(k), me(k);
+      mpz_class gz = 1, gt;
+      for (size_t j = 0; j < k; ++j) {
+        gg[j] = rng.get_z_bits(lm + 10);
+        if (j & 1) {
+          gg[j] = -gg[j];
+        }
+        // exponents of different lengths, some zero.
+        ge[j] = j % 7 == 3 ? mpz_class(0) : rng.get_z_bits(1 + (37*j + 11*i) % 400);
+        mg[j] = MPInt(gg[j]);
+        me[j] = MPInt(ge[j]);
+        mpz_powm(gt.get_mpz_t(), gg[j].get_mpz_t(), ge[j].get_mpz_t(), gm.get_mpz_t());
+        gz = gz * gt % gm;
+      }
+
+      MPInt mz;
+      multiPowm(mz, mg, me, MPInt(gm));
+      TEST_EQ(mz, MPInt(gz));
+
+      if (i != 3) {
+        MontgomeryContext ctx((MPInt(gm)));
+        MultiPowm p(ctx);
+        for (size_t j = 0; j < 3; ++j) {
+          p.pow(mz, mg, me, methods[j]);
+          TEST_EQ(mz, MPInt(gz));
+        }
+      }
+    }
+  }
+}
+
+void test_batchinv()
+{
+  PUTSERR(__func__);
+
+  using namespace std;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  const size_t counts[] = { 1, 2, 3, 7, 100, 1000 };
+  const size_t threads[] = { 1, 2, 3, 8 };
+  for (size_t c = 0; c < sizeof(counts)/sizeof(counts[0]); ++c) {
+    for (size_t i = 0; i < 3; ++i) {
+      const size_t k = counts[c];
+      const size_t lm = 64 + 211*(c + i) % 1500;
+      const mpz_class gm = rng_odd(rng, lm) + 2;
+      const MPInt mm(gm);
+      MontgomeryContext ctx(mm);
+      BatchInverse bi(ctx);
+
+      vector<mpz_class> gx(k), gz(k);
+      vector<MPInt> mx(k), mz;
+      for (size_t j = 0; j < k; ++j) {
+        do {
+          gx[j] = rng.get_z_bits(lm + 10);
+          if (j & 1) {
+            gx[j] = -gx[j];
+          }
+        } while (! mpz_invert(gz[j].get_mpz_t(), gx[j].get_mpz_t(), gm.get_mpz_t()));
+        mx[j] = MPInt(gx[j]);
+      }
+
+      for (size_t t = 0; t < sizeof(threads)/sizeof(threads[0]); ++t) {
+        mz.clear();
+        TEST_ASSERT(bi.invert(mz, mx, threads[t]));
+        TEST_EQ(mz.size(), k);
+        for (size_t j = 0; j < mz.size(); ++j) {
+          TEST_EQ(mz[j], MPInt(gz[j]));
+        }
+      }
+
+      // one of them is not invertible.
+      if (k > 1) {
+        mx[k / 2] = MPInt(gm * 3);
+        TEST_ASSERT(! bi.invert(mz, mx, 2));
+      }
+    }
+  }
+}
+
+void test_prodtree()
+{
+  PUTSERR(__func__);
+
+  using namespace std;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  const size_t counts[] = { 1, 2, 3, 5, 100, 1000 };
+  const size_t threads[] = { 1, 3 };
+  for (size_t c = 0; c < sizeof(counts)/sizeof(counts[0]); ++c) {
+    const size_t k = counts[c];
+    vector<mpz_class> gm(k);
+    vector<MPInt> mm(k);
+    mpz_class gp = 1;
+    for (size_t j = 0; j < k; ++j) {
+      // from 1 to 40 digits, B^i and B^i - 1 among them.
+      const size_t bits = 1 + (j*53 + c*7) % (k < 1000 ? 2560 : 256);
+      if (j % 17 == 5) {
+        gm[j] = 1;
+        gm[j] <<= 64*(1 + j % (k < 1000 ? 40 : 4));
+        gm[j] -= j % 2;
+      } else {
+        gm[j] = rng.get_z_bits(bits) + 1;
+      }
+      mm[j] = MPInt(gm[j]);
+      gp *= gm[j];
+    }
+
+    ProductTree tree(mm, threads[c % 2]);
+    TEST_EQ(k, tree.size());
+    MPInt mp;
+    tree.product(mp);
+    TEST_EQ(MPInt(gp), mp);
+
+    const size_t pbits = mpz_sizeinbase(gp.get_mpz_t(), 2);
+    for (size_t i = 0; i < 6; ++i) {
+      const size_t xbits = i < 2 ? pbits / (i + 2) : pbits * (i - 1) + 1;
+      mpz_class gx = rng.get_z_bits(xbits);
+      if (i & 1) {
+        gx = -gx;
+      }
+      if (i == 5) {
+        gx = gp - 1;
+      }
+      vector<MPInt> r;
+      for (size_t t = 0; t < sizeof(threads)/sizeof(threads[0]); ++t) {
+        tree.remainders(r, MPInt(gx), threads[t]);
+        TEST_EQ(k, r.size());
+        for (size_t j = 0; j < k; ++j) {
+          mpz_class gr;
+          mpz_fdiv_r(gr.get_mpz_t(), gx.get_mpz_t(), gm[j].get_mpz_t());
+          TEST_EQ(MPInt(gr), r[j]);
+        }
+      }
+    }
+  }
+
+  {
+    TEST_THROW(ProductTree(vector<MPInt>(2, MPInt(0))), std::invalid_argument);
+  }
+}
+
+void test_sqrtmod()
+{
+  PUTSERR(__func__);
+
+  using namespace std;
+  using namespace mpint;
+  using namespace integer;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  vector<mpz_class> primes;
+  const char* const small[] = { "3", "5", "7", "13", "17", "41", "97", "257", "65537", "18446744069414584321" };
+  for (size_t i = 0; i < sizeof(small)/sizeof(small[0]); ++i) {
+    primes.push_back(mpz_class(small[i]));
+  }
+  for (size_t bits = 64; bits <= 1024; bits *= 2) {
+    primes.push_back(primeOfForm(rng, bits, 0, 3));
+    primes.push_back(primeOfForm(rng, bits, 0, 7));
+    primes.push_back(primeOfForm(rng, bits, 0, 5));
+    primes.push_back(primeOfForm(rng, bits, 3));
+    primes.push_back(primeOfForm(rng, bits, bits / 8));
+    primes.push_back(primeOfForm(rng, bits, bits / 2));
+  }
+
+  for (size_t i = 0; i < primes.size(); ++i) {
+    const mpz_class& gp = primes[i];
+    const MPInt mp(gp);
+    const unsigned long r8 = mpz_fdiv_ui(gp.get_mpz_t(), 8);
+    vector<SqrtModContext::Method> methods;
+    methods.push_back(SqrtModContext::Auto);
+    methods.push_back(r8 % 4 == 3 ? SqrtModContext::Mod4 : r8 == 5 ? SqrtModContext::Mod8 : SqrtModContext::Auto);
+    methods.push_back(SqrtModContext::TonelliShanks);
+    methods.push_back(SqrtModContext::Cipolla);
+
+    for (size_t m = 0; m < methods.size(); ++m) {
+      SqrtModContext ctx(mp, methods[m]);
+      TEST_EQ(mpz_legendre(mpz_class(ctx.nonResidue().toString()).get_mpz_t(), gp.get_mpz_t()), -1);
+      TEST_EQ(ctx.twoAdicity(), mpz_scan1(mpz_class(gp - 1).get_mpz_t(), 0));
+      for (int j = 0; j < 20; ++j) {
+        mpz_class ga = rng.get_z_range(gp);
+        if (j == 0) {
+          ga = 0;
+        } else if (j == 1) {
+          ga = 1;
+        } else if (j == 2) {
+          ga = gp - 1;
+        } else if (j == 3) {
+          ga = gp*5 + 4;
+        } else if (j & 1) {
+          ga -= gp*3;
+        }
+        const int legendre = mpz_legendre(ga.get_mpz_t(), gp.get_mpz_t());
+        MPInt mz(7);
+        const bool ok = ctx.sqrt(mz, MPInt(ga));
+        TEST_EQ(ok, legendre >= 0);
+        if (ok) {
+          const mpz_class gz(mz.toString());
+          TEST_ASSERT(gz >= 0 && gz <= (gp - 1) / 2);
+          TEST_EQ(mpz_class((gz*gz - ga) % gp), 0);
+        } else {
+          TEST_EQ(mz, MPInt(7));
+        }
+      }
+    }
+  }
+
+  {
+    MPInt z;
+    TEST_ASSERT(integer::impl::sqrtmod(z, MPInt(2), MPInt(7)));
+    TEST_EQ(z, MPInt(3));
+    TEST_ASSERT(! integer::impl::sqrtmod(z, MPInt(3), MPInt(7)));
+  }
+
+  {
+    const int64_t bad[][2] = {
+      { 2, SqrtModContext::Auto }, { 9, SqrtModContext::Auto }, { 91, SqrtModContext::Auto },
+      { -7, SqrtModContext::Auto }, { 13, SqrtModContext::Mod4 }, { 17, SqrtModContext::Mod8 },
+    };
+    for (size_t i = 0; i < sizeof(bad)/sizeof(bad[0]); ++i) {
+      TEST_THROW(SqrtModContext(MPInt(bad[i][0]), (SqrtModContext::Method)bad[i][1]), std::invalid_argument);
+    }
+  }
+}
+
+void bench_montgomery()
+{
+  printf("\n\n# %s\n", __func__);
+
+  using namespace std;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  const size_t numOfLoop = 16;
+  const size_t multOfLen = 256;
+  const size_t offsetLen = 256;
+  for (size_t i = 0; i < numOfLoop; ++i) {
+    const size_t len = multOfLen * i + offsetLen;
+#ifdef OUTPUT_GNUPLOT
+    /*
+      @note: Output is:
+      length gmp_mul_mod_timing mont_mul_timing mont_sqr_timing
+    */
+    cout << len << " ";
+#else
+    PUT(len);
+#endif
+
+    // @note: operands as mpz_powm sees them, odd modulus and reduced base.
+    mpz_class gm = rng_odd(rng, len);
+    mpz_setbit(gm.get_mpz_t(), len - 1);
+    mpz_class gx = rng.get_z_range(gm);
+    mpz_class gy = rng.get_z_range(gm);
+    mpz_class gz;
+
+    MontgomeryContext ctx((MPInt(gm)));
+    const size_t n = ctx.size();
+    vector<value_type> x(n), y(n), z(n);
+    ctx.toMont(&x[0], MPInt(gx));
+    ctx.toMont(&y[0], MPInt(gy));
+
+    double mpz_time;
+    {
+      Xbyak::util::Clock clk;
+      for (int j = 0; j < N; ++j) {
+        clk.begin();
+        mpz_mul(gz.get_mpz_t(), gx.get_mpz_t(), gy.get_mpz_t());
+        mpz_mod(gz.get_mpz_t(), gz.get_mpz_t(), gm.get_mpz_t());
+        clk.end();
+      }
+      mpz_time = (double)clk.getClock() / clk.getCount();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, mpz_time);
+#else
+      printf(BENCHF, "mpz_mul+mpz_mod", mpz_time);
+#endif
+    }
+
+    {
+      double mont_time;
+      Xbyak::util::Clock clk;
+      for (int j = 0; j < N; ++j) {
+        clk.begin();
+        ctx.mul(&z[0], &x[0], &y[0]);
+        clk.end();
+      }
+      mont_time = (double)clk.getClock() / clk.getCount();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, mont_time);
+#else
+      printf(BENCHF, "MontgomeryContext::mul", mont_time);
+      printf("ratio:\t%f\n", mont_time / mpz_time);
+#endif
+    }
+
+    {
+      double mont_time;
+      Xbyak::util::Clock clk;
+      for (int j = 0; j < N; ++j) {
+        clk.begin();
+        ctx.sqr(&z[0], &x[0]);
+        clk.end();
+      }
+      mont_time = (double)clk.getClock() / clk.getCount();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, mont_time);
+#else
+      printf(BENCHF, "MontgomeryContext::sqr", mont_time);
+      printf("ratio:\t%f\n", mont_time / mpz_time);
+#endif
+    }
+
+    {
+      ctx.mul(&z[0], &x[0], &y[0]);
+      MPInt mz;
+      ctx.fromMont(mz, &z[0]);
+      TEST_EQ(mz, MPInt(mpz_class(gx * gy % gm)));
+    }
+
+#ifdef OUTPUT_GNUPLOT
+    puts("");
+#endif
+  }
+}
+
+void bench_barrett()
+{
+  printf("\n\n# %s\n", __func__);
+
+  using namespace std;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  const size_t numOfLoop = 16;
+  const size_t multOfLen = 256;
+  const size_t offsetLen = 256;
+  for (size_t i = 0; i < numOfLoop; ++i) {
+    const size_t len = multOfLen * i + offsetLen;
+#ifdef OUTPUT_GNUPLOT
+    /*
+      @note: Output is:
+      length gmp_mod_timing barrett_reduce_timing
+    */
+    cout << len << " ";
+#else
+    PUT(len);
+#endif
+
+    mpz_class gm = rng.get_z_bits(len);
+    mpz_setbit(gm.get_mpz_t(), len - 1);
+    mpz_class gx = rng.get_z_range(gm * gm);
+    mpz_class gz;
+
+    BarrettContext ctx((MPInt(gm)));
+    const size_t n = ctx.size();
+    vector<value_type> x(2*n), r(n), work(ctx.workSize());
+    fromMpz(&x[0], 2*n, gx);
+
+    double mpz_time;
+    {
+      Xbyak::util::Clock clk;
+      for (int j = 0; j < N; ++j) {
+        clk.begin();
+        mpz_mod(gz.get_mpz_t(), gx.get_mpz_t(), gm.get_mpz_t());
+        clk.end();
+      }
+      mpz_time = (double)clk.getClock() / clk.getCount();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, mpz_time);
+#else
+      printf(BENCHF, "mpz_mod", mpz_time);
+#endif
+    }
+
+    {
+      double barrett_time;
+      Xbyak::util::Clock clk;
+      for (int j = 0; j < N; ++j) {
+        clk.begin();
+        ctx.reduce(&r[0], &x[0], 2*n, &work[0]);
+        clk.end();
+      }
+      barrett_time = (double)clk.getClock() / clk.getCount();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, barrett_time);
+#else
+      printf(BENCHF, "BarrettContext::reduce", barrett_time);
+      printf("ratio:\t%f\n", barrett_time / mpz_time);
+#endif
+    }
+
+    TEST_EQ(toMpz(&r[0], n), gz);
+
+#ifdef OUTPUT_GNUPLOT
+    puts("");
+#endif
+  }
+}
+
+namespace {
+
+template<size_t L, class Modulus>
+void bench_modint_(gmp_randclass& rng)
+{
+  using namespace std;
+  using namespace mpint;
+
+  typedef ModInt<L, Modulus> mod_t;
+
+#ifdef OUTPUT_GNUPLOT
+  /*
+    @note: Output is:
+    length gmp_mul_mod_timing mont_mul_timing modint_mul_timing modint_sqr_timing
+  */
+  cout << 64*L << " ";
+#else
+  PUT(64*L);
+#endif
+
+  mpz_class gm = toMpz(mod_t::m_.v, L);
+  mpz_class gx = rng.get_z_range(gm);
+  mpz_class gy = rng.get_z_range(gm);
+  mpz_class gz;
+
+  MontgomeryContext ctx((MPInt(gm)));
+  vector<value_type> x(L), y(L), z(L);
+  ctx.toMont(&x[0], MPInt(gx));
+  ctx.toMont(&y[0], MPInt(gy));
+
+  mod_t mx((MPInt(gx))), my((MPInt(gy))), mz;
+
+  double mpz_time;
+  {
+    Xbyak::util::Clock clk;
+    for (int j = 0; j < N; ++j) {
+      clk.begin();
+      mpz_mul(gz.get_mpz_t(), gx.get_mpz_t(), gy.get_mpz_t());
+      mpz_mod(gz.get_mpz_t(), gz.get_mpz_t(), gm.get_mpz_t());
+      clk.end();
+    }
+    mpz_time = (double)clk.getClock() / clk.getCount();
+#ifdef OUTPUT_GNUPLOT
+    printf(GNUPLOTF, mpz_time);
+#else
+    printf(BENCHF, "mpz_mul+mpz_mod", mpz_time);
+#endif
+  }
+
+  {
+    double mont_time;
+    Xbyak::util::Clock clk;
+    for (int j = 0; j < N; ++j) {
+      clk.begin();
+      ctx.mul(&z[0], &x[0], &y[0]);
+      clk.end();
+    }
+    mont_time = (double)clk.getClock() / clk.getCount();
+#ifdef OUTPUT_GNUPLOT
+    printf(GNUPLOTF, mont_time);
+#else
+    printf(BENCHF, "MontgomeryContext::mul", mont_time);
+    printf("ratio:\t%f\n", mont_time / mpz_time);
+#endif
+  }
+
+  {
+    double modint_time;
+    Xbyak::util::Clock clk;
+    for (int j = 0; j < N; ++j) {
+      clk.begin();
+      mod_t::mul(mz, mx, my);
+      clk.end();
+    }
+    modint_time = (double)clk.getClock() / clk.getCount();
+#ifdef OUTPUT_GNUPLOT
+    printf(GNUPLOTF, modint_time);
+#else
+    printf(BENCHF, "ModInt::mul", modint_time);
+    printf("ratio:\t%f\n", modint_time / mpz_time);
+#endif
+  }
+
+  {
+    double modint_time;
+    Xbyak::util::Clock clk;
+    for (int j = 0; j < N; ++j) {
+      clk.begin();
+      mod_t::sqr(mz, mx);
+      clk.end();
+    }
+    modint_time = (double)clk.getClock() / clk.getCount();
+#ifdef OUTPUT_GNUPLOT
+    printf(GNUPLOTF, modint_time);
+#else
+    printf(BENCHF, "ModInt::sqr", modint_time);
+    printf("ratio:\t%f\n", modint_time / mpz_time);
+#endif
+  }
+
+  {
+    MPInt mt;
+    (mx * my).get(mt);
+    TEST_EQ(mt, MPInt(mpz_class(gx * gy % gm)));
+  }
+
+#ifdef OUTPUT_GNUPLOT
+  puts("");
+#endif
+}
+
+} // namespace
+
+void bench_modint()
+{
+  printf("\n\n# %s\n", __func__);
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  bench_modint_<1, M61>(rng);
+  bench_modint_<2, M127>(rng);
+  bench_modint_<4, P256>(rng);
+  bench_modint_<6, P384>(rng);
+}
+
+void bench_powm()
+{
+  printf("\n\n# %s\n", __func__);
+
+  using namespace std;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  const int numOfSample = N / 100;
+  const size_t numOfLoop = 16;
+  const size_t multOfLen = 256;
+  const size_t offsetLen = 256;
+  for (size_t i = 0; i < numOfLoop; ++i) {
+    const size_t len = multOfLen * i + offsetLen;
+#ifdef OUTPUT_GNUPLOT
+    /*
+      @note: Output is:
+      length gmp_powm_timing powm_timing montgomery_powm_timing
+    */
+    cout << len << " ";
+#else
+    PUT(len);
+#endif
+
+    mpz_class gm = rng_odd(rng, len);
+    mpz_setbit(gm.get_mpz_t(), len - 1);
+    mpz_class gx = rng.get_z_range(gm);
+    mpz_class ge = rng.get_z_bits(len);
+    mpz_class gz;
+
+    MPInt mm(gm), mx(gx), me(ge), mz;
+    MontgomeryContext ctx(mm);
+    MontgomeryPowm p(ctx);
+    const size_t n = ctx.size();
+    vector<value_type> x(n), z(n);
+    ctx.toMont(&x[0], mx);
+
+    double mpz_time;
+    {
+      Xbyak::util::Clock clk;
+      for (int j = 0; j < numOfSample; ++j) {
+        clk.begin();
+        mpz_powm(gz.get_mpz_t(), gx.get_mpz_t(), ge.get_mpz_t(), gm.get_mpz_t());
+        clk.end();
+      }
+      mpz_time = (double)clk.getClock() / clk.getCount();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, mpz_time);
+#else
+      printf(BENCHF, "mpz_powm", mpz_time);
+#endif
+    }
+
+    {
+      double powm_time;
+      Xbyak::util::Clock clk;
+      for (int j = 0; j < numOfSample; ++j) {
+        clk.begin();
+        powm(mz, mx, me, mm);
+        clk.end();
+      }
+      powm_time = (double)clk.getClock() / clk.getCount();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, powm_time);
+#else
+      printf(BENCHF, "powm", powm_time);
+      printf("ratio:\t%f\n", powm_time / mpz_time);
+#endif
+    }
+    TEST_EQ(mz, MPInt(gz));
+
+    {
+      double powm_time;
+      Xbyak::util::Clock clk;
+      for (int j = 0; j < numOfSample; ++j) {
+        clk.begin();
+        p.pow(&z[0], &x[0], me.get(), me.size());
+        clk.end();
+      }
+      powm_time = (double)clk.getClock() / clk.getCount();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, powm_time);
+#else
+      printf(BENCHF, "MontgomeryPowm::pow", powm_time);
+      printf("ratio:\t%f\n", powm_time / mpz_time);
+#endif
+    }
+    ctx.fromMont(mz, &z[0]);
+    TEST_EQ(mz, MPInt(gz));
+
+#ifdef OUTPUT_GNUPLOT
+    puts("");
+#endif
+  }
+}
+
+void bench_fixedbase()
+{
+  printf("\n\n# %s\n", __func__);
+
+  using namespace std;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  const int numOfSample = N / 100;
+  const size_t numOfLoop = 8;
+  const size_t multOfLen = 512;
+  const size_t offsetLen = 512;
+  for (size_t i = 0; i < numOfLoop; ++i) {
+    const size_t len = multOfLen * i + offsetLen;
+#ifdef OUTPUT_GNUPLOT
+    /*
+      @note: Output is exponentiations per second:
+      length powm fixedbase_64KiB fixedbase_1MiB fixedbase_16MiB
+    */
+    cout << len << " ";
+#else
+    PUT(len);
+#endif
+
+    mpz_class gm = rng_odd(rng, len);
+    mpz_setbit(gm.get_mpz_t(), len - 1);
+    mpz_class gg = rng.get_z_range(gm);
+    vector<mpz_class> ges;
+    vector<MPInt> es;
+    for (int j = 0; j < numOfSample; ++j) {
+      ges.push_back(rng.get_z_bits(len));
+      es.push_back(MPInt(ges.back()));
+    }
+
+    MPInt mm(gm), mg(gg), mz;
+    MontgomeryContext ctx(mm);
+
+    {
+      MontgomeryPowm p(ctx);
+      const chrono::high_resolution_clock::time_point begin = chrono::high_resolution_clock::now();
+      for (int j = 0; j < numOfSample; ++j) {
+        p.pow(mz, mg, es[j]);
+      }
+      const chrono::duration<double> d = chrono::high_resolution_clock::now() - begin;
+      const double rate = numOfSample / d.count();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, rate);
+#else
+      printf("%s:\t% 10.2f exps/sec\n", "MontgomeryPowm::pow", rate);
+#endif
+    }
+
+    const size_t budgets[] = { 1 << 16, 1 << 20, 1 << 24 };
+    for (size_t k = 0; k < 3; ++k) {
+      FixedBasePowm fb(ctx, mg, len, budgets[k]);
+      const chrono::high_resolution_clock::time_point begin = chrono::high_resolution_clock::now();
+      for (int j = 0; j < numOfSample; ++j) {
+        fb.pow(mz, es[j]);
+      }
+      const chrono::duration<double> d = chrono::high_resolution_clock::now() - begin;
+      const double rate = numOfSample / d.count();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, rate);
+#else
+      printf("FixedBasePowm(h=%zu, v=%zu):\t% 10.2f exps/sec\n", fb.teeth(), fb.blocks(), rate);
+#endif
+      mpz_class gz;
+      mpz_powm(gz.get_mpz_t(), gg.get_mpz_t(), ges.back().get_mpz_t(), gm.get_mpz_t());
+      TEST_EQ(mz, MPInt(gz));
+    }
+
+#ifdef OUTPUT_GNUPLOT
+    puts("");
+#endif
+  }
+}
+
+void bench_multipowm()
+{
+  printf("\n\n# %s\n", __func__);
+
+  using namespace std;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  const int numOfSample = N / 1000;
+  const size_t len = 1024;
+  const size_t expLen = 256;
+  mpz_class gm = rng_odd(rng, len);
+  mpz_setbit(gm.get_mpz_t(), len - 1);
+  MontgomeryContext ctx((MPInt(gm)));
+  MontgomeryPowm single(ctx);
+  MultiPowm multi(ctx);
+
+  for (size_t k = 2; k <= 512; k *= 2) {
+#ifdef OUTPUT_GNUPLOT
+    /*
+      @note: Output is:
+      count separate_powm_timing straus_timing pippenger_timing auto_timing
+    */
+    cout << k << " ";
+#else
+    PUT(k);
+#endif
+
+    const size_t n = ctx.size();
+    vector<MPInt> me(k);
+    vector<value_type> xs(k*n), z(n), t(n);
+    vector<const value_type*> xp(k), ep(k);
+    vector<size_t> en(k);
+    for (size_t j = 0; j < k; ++j) {
+      ctx.toMont(&xs[j*n], MPInt(mpz_class(rng.get_z_range(gm))));
+      me[j] = MPInt(mpz_class(rng.get_z_bits(expLen)));
+      xp[j] = &xs[j*n];
+      ep[j] = me[j].get();
+      en[j] = me[j].size();
+    }
+    MPInt mz, expected;
+
+    {
+      Xbyak::util::Clock clk;
+      for (int j = 0; j < numOfSample; ++j) {
+        clk.begin();
+        single.pow(&z[0], xp[0], ep[0], en[0]);
+        for (size_t i = 1; i < k; ++i) {
+          single.pow(&t[0], xp[i], ep[i], en[i]);
+          ctx.mul(&z[0], &z[0], &t[0]);
+        }
+        clk.end();
+      }
+      const double time = (double)clk.getClock() / clk.getCount();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, time);
+#else
+      printf(BENCHF, "MontgomeryPowm::pow", time);
+#endif
+      ctx.fromMont(expected, &z[0]);
+    }
+
+    const MultiPowm::Method methods[] = { MultiPowm::Straus, MultiPowm::Pippenger, MultiPowm::Auto };
+    for (size_t m = 0; m < 3; ++m) {
+      Xbyak::util::Clock clk;
+      for (int j = 0; j < numOfSample; ++j) {
+        clk.begin();
+        multi.pow(&z[0], &xp[0], &ep[0], &en[0], k, methods[m]);
+        clk.end();
+      }
+      const double time = (double)clk.getClock() / clk.getCount();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, time);
+#else
+      printf(BENCHF, "MultiPowm::pow", time);
+#endif
+      ctx.fromMont(mz, &z[0]);
+      TEST_EQ(mz, expected);
+    }
+
+#ifdef OUTPUT_GNUPLOT
+    puts("");
+#endif
+  }
+}
+
+void bench_batchinv()
+{
+  printf("\n\n# %s\n", __func__);
+
+  using namespace std;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  const size_t k = 1000;
+  const size_t numOfLoop = 8;
+  const size_t multOfLen = 256;
+  const size_t offsetLen = 256;
+  for (size_t i = 0; i < numOfLoop; ++i) {
+    const size_t len = multOfLen * i + offsetLen;
+#ifdef OUTPUT_GNUPLOT
+    /*
+      @note: Output is inversions per second:
+      length mpz_invert invert batch_1thread batch_4threads
+    */
+    cout << len << " ";
+#else
+    PUT(len);
+#endif
+
+    // a prime modulus, so that all values are invertible.
+    mpz_class gm = rng.get_z_bits(len - 1);
+    mpz_setbit(gm.get_mpz_t(), len - 2);
+    mpz_nextprime(gm.get_mpz_t(), gm.get_mpz_t());
+    MPInt mm(gm);
+    MontgomeryContext ctx(mm);
+    const size_t n = ctx.size();
+
+    vector<mpz_class> gx(k);
+    vector<MPInt> mx(k);
+    vector<value_type> x(k*n), z(k*n);
+    for (size_t j = 0; j < k; ++j) {
+      gx[j] = rng.get_z_range(gm - 1) + 1;
+      mx[j] = MPInt(gx[j]);
+      ctx.toMont(&x[j*n], mx[j]);
+    }
+
+    mpz_class gz;
+    MPInt mz;
+    {
+      const chrono::high_resolution_clock::time_point begin = chrono::high_resolution_clock::now();
+      for (size_t j = 0; j < k; ++j) {
+        mpz_invert(gz.get_mpz_t(), gx[j].get_mpz_t(), gm.get_mpz_t());
+      }
+      const chrono::duration<double> d = chrono::high_resolution_clock::now() - begin;
+      const double rate = k / d.count();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, rate);
+#else
+      printf("%s:\t% 10.2f invs/sec\n", "mpz_invert", rate);
+#endif
+    }
+    {
+      const chrono::high_resolution_clock::time_point begin = chrono::high_resolution_clock::now();
+      for (size_t j = 0; j < k; ++j) {
+        integer::impl::invert(mz, mx[j], mm);
+      }
+      const chrono::duration<double> d = chrono::high_resolution_clock::now() - begin;
+      const double rate = k / d.count();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, rate);
+#else
+      printf("%s:\t% 10.2f invs/sec\n", "impl::invert", rate);
+#endif
+      TEST_EQ(mz, MPInt(gz));
+    }
+
+    const size_t threads[] = { 1, 4 };
+    for (size_t t = 0; t < 2; ++t) {
+      BatchInverse bi(ctx);
+      const chrono::high_resolution_clock::time_point begin = chrono::high_resolution_clock::now();
+      bi.invert(&z[0], &x[0], k, threads[t]);
+      const chrono::duration<double> d = chrono::high_resolution_clock::now() - begin;
+      const double rate = k / d.count();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, rate);
+#else
+      printf("BatchInverse(threads=%zu):\t% 10.2f invs/sec\n", threads[t], rate);
+#endif
+      ctx.fromMont(mz, &z[(k - 1)*n]);
+      TEST_EQ(mz, MPInt(gz));
+    }
+
+#ifdef OUTPUT_GNUPLOT
+    puts("");
+#endif
+  }
+}
+
+void bench_prodtree()
+{
+  printf("\n\n# %s\n", __func__);
+
+  using namespace std;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  for (size_t k = 250; k <= 4000; k *= 2) {
+#ifdef OUTPUT_GNUPLOT
+    /*
+      @note: Output is milliseconds:
+      number_of_moduli mpz_fdiv_r_each tree_build tree_1thread tree_4threads
+      for 64 bit moduli and x of 64k bits.
+    */
+    cout << k << " ";
+#else
+    PUT(k);
+#endif
+
+    vector<mpz_class> gm(k);
+    vector<MPInt> mm(k);
+    for (size_t j = 0; j < k; ++j) {
+      gm[j] = rng.get_z_bits(64);
+      mpz_setbit(gm[j].get_mpz_t(), 63);
+      mm[j] = MPInt(gm[j]);
+    }
+    const mpz_class gx = rng.get_z_bits(64*k);
+    const MPInt mx(gx);
+
+    double t[4];
+    mpz_class gr;
+    {
+      const chrono::high_resolution_clock::time_point begin = chrono::high_resolution_clock::now();
+      for (size_t j = 0; j < k; ++j) {
+        mpz_fdiv_r(gr.get_mpz_t(), gx.get_mpz_t(), gm[j].get_mpz_t());
+      }
+      const chrono::duration<double> d = chrono::high_resolution_clock::now() - begin;
+      t[0] = d.count() * 1000;
+    }
+    const chrono::high_resolution_clock::time_point begin = chrono::high_resolution_clock::now();
+    ProductTree tree(mm);
+    const chrono::duration<double> d = chrono::high_resolution_clock::now() - begin;
+    t[1] = d.count() * 1000;
+    const size_t threads[] = { 1, 4 };
+    for (size_t i = 0; i < 2; ++i) {
+      vector<MPInt> r;
+      const chrono::high_resolution_clock::time_point begin = chrono::high_resolution_clock::now();
+      tree.remainders(r, mx, threads[i]);
+      const chrono::duration<double> d = chrono::high_resolution_clock::now() - begin;
+      t[i + 2] = d.count() * 1000;
+      TEST_EQ(MPInt(gr), r[k - 1]);
+    }
+
+#ifdef OUTPUT_GNUPLOT
+    for (size_t i = 0; i < 4; ++i) {
+      printf(GNUPLOTF, t[i]);
+    }
+    puts("");
+#else
+    const char* names[] = { "mpz_fdiv_r", "ProductTree", "remainders", "remainders 4 threads" };
+    for (size_t i = 0; i < 4; ++i) {
+      printf("%s:\t% 10.2f ms\n", names[i], t[i]);
+    }
+#endif
+  }
+}
+
+void bench_sqrtmod()
+{
+  printf("\n\n# %s\n", __func__);
+
+  using namespace std;
+  using namespace mpint;
+  using namespace integer;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  for (size_t bits = 256; bits <= 2048; bits *= 2) {
+    const int numOfSample = std::max(N * 16 / (int)bits / (int)(bits / 256), 4);
+#ifdef OUTPUT_GNUPLOT
+    /*
+      @note: Output is:
+      bits mpz_powm mod4 mod8 ts_s=8 ts_s=bits/4 cipolla_s=bits/4
+    */
+    cout << bits << " ";
+#else
+    PUT(bits);
+#endif
+
+    {
+      const mpz_class gp = primeOfForm(rng, bits, 0, 3);
+      const mpz_class ge = (gp + 1) / 4;
+      const mpz_class ga = rng.get_z_range(gp);
+      mpz_class gz;
+      Xbyak::util::Clock clk;
+      for (int j = 0; j < numOfSample; ++j) {
+        clk.begin();
+        mpz_powm(gz.get_mpz_t(), ga.get_mpz_t(), ge.get_mpz_t(), gp.get_mpz_t());
+        clk.end();
+      }
+      const double t = (double)clk.getClock() / clk.getCount();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, t);
+#else
+      printf(BENCHF, "mpz_powm", t);
+#endif
+    }
+
+    // the same prime for both of the last two.
+    mpz_class gps[] = {
+      primeOfForm(rng, bits, 0, 3), primeOfForm(rng, bits, 0, 5), primeOfForm(rng, bits, 8),
+      primeOfForm(rng, bits, bits / 4), 0,
+    };
+    gps[4] = gps[3];
+    const SqrtModContext::Method methods[] = {
+      SqrtModContext::Mod4, SqrtModContext::Mod8, SqrtModContext::TonelliShanks,
+      SqrtModContext::TonelliShanks, SqrtModContext::Cipolla,
+    };
+#ifndef OUTPUT_GNUPLOT
+    const char* const names[] = {
+      "Mod4", "Mod8", "TonelliShanks(s=8)", "TonelliShanks(s=bits/4)", "Cipolla(s=bits/4)",
+    };
+#endif
+    for (size_t m = 0; m < 5; ++m) {
+      const mpz_class& gp = gps[m];
+      SqrtModContext ctx(MPInt(gp), methods[m]);
+      const size_t n = ctx.context().size();
+      // squares, so every call finds the root.
+      vector<value_type> x(n*numOfSample), z(n);
+      for (int j = 0; j < numOfSample; ++j) {
+        const mpz_class ga = rng.get_z_range(gp);
+        ctx.context().toMont(&x[n*j], MPInt(mpz_class(ga*ga % gp)));
+      }
+      bool ok = true;
+      Xbyak::util::Clock clk;
+      for (int j = 0; j < numOfSample; ++j) {
+        clk.begin();
+        ok &= ctx.sqrt(&z[0], &x[n*j]);
+        clk.end();
+      }
+      TEST_ASSERT(ok);
+      const double t = (double)clk.getClock() / clk.getCount();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, t);
+#else
+      printf(BENCHF, names[m], t);
+#endif
+    }
+
+#ifdef OUTPUT_GNUPLOT
+    puts("");
+#endif
+  }
+}
+
+void info_gmp()
+{
+  using namespace std;
+
+  cerr << "GMP Version is " << gmp_version << endl
+       << "number of bits in mp_limb is " << mp_bits_per_limb << endl;
+}
+
+void test_all()
+{
+  using namespace std;
+  using namespace mpint;
+
+  MontgomeryContext::codeGen(0);
+
+  test_montgomery();
+  test_powm();
+  test_fixedbase();
+  test_multipowm();
+  test_batchinv();
+
+  cout.flush();
+
+  MontgomeryContext::codeGen();
+
+  test_montgomery();
+  test_powm();
+  test_fixedbase();
+  test_multipowm();
+  test_batchinv();
+
+  cout.flush();
+
+  test_barrett();
+
+  cout.flush();
+
+  test_modint();
+
+  cout.flush();
+
+  test_prodtree();
+
+  cout.flush();
+
+  test_sqrtmod();
+
+  cout.flush();
+}
+
+void bench_for_gnuplot()
+{
+  using namespace std;
+  using namespace mpint;
+
+  MontgomeryContext::codeGen(0);
+  bench_montgomery();
+
+  MontgomeryContext::codeGen();
+  bench_montgomery();
+
+  bench_powm();
+
+  bench_fixedbase();
+
+  bench_multipowm();
+
+  bench_batchinv();
+
+  bench_barrett();
+
+  bench_modint();
+
+  bench_prodtree();
+
+  bench_sqrtmod();
+}
+
+int main()
+{
+  using namespace std;
+  using namespace mpint;
+
+#ifndef NDEBUG
+  cerr << "NDEBUG is undefined" << endl;
+#endif
+  cerr << "Number of sampling loop: " << N << endl;
+
+  info_gmp();
+  MPIntCodeGen();
+
+  test_all();
+
+  bench_for_gnuplot();
+
+  return testsAreSucceeded() ? 0 : 1;
+}
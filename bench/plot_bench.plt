@@ -44,6 +44,19 @@ plot datname ind 3 using 1:2 title "mpz\\_kronecker" with lines, \
      datname ind 7 using 1:3 title "kronecker using opt" with lines, \
      datname ind 11 using 1:3 title "kronecker using opt 4" with lines
 
+set output "kronecker-divsteps.eps"
+plot datname ind 3 using 1:2 title "mpz\\_kronecker" with lines, \
+     datname ind 3 using 1:3 title "kronecker" with lines, \
+     datname ind 3 using 1:4 title "kronecker divsteps" with lines, \
+     datname ind 3 using 1:5 title "kronecker divsteps constant-time" with lines
+
+set output "kronecker-kary.eps"
+plot datname ind 3 using 1:2 title "mpz\\_kronecker" with lines, \
+     datname ind 3 using 1:3 title "kronecker" with lines, \
+     datname ind 3 using 1:6 title "kronecker k-ary, k = 2^4" with lines, \
+     datname ind 3 using 1:7 title "kronecker k-ary, k = 2^8" with lines, \
+     datname ind 3 using 1:8 title "kronecker k-ary, k = 2^16" with lines
+
 ##
 
 # not yet
@@ -0,0 +1,758 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <xbyak/xbyak_util.h>
+
+#include <gmpxx.h>
+#define USE_GMP
+
+#include "util.hpp"
+#include "mpint.hpp"
+#include "montgomery.hpp"
+#include "prime.hpp"
+#include "primegen.hpp"
+#include "isqrt.hpp"
+
+using namespace ff_util;
+
+const int N = 1000;
+
+#define BENCHF "%s:\t% 10.2f clk\n"
+#define GNUPLOTF " % 15.2f"
+
+#define OUTPUT_GNUPLOT
+
+namespace {
+
+/*
+  impl::isProbablePrime against mpz_probab_prime_p,
+  which is BPSW after trial division for GMP 6.2.
+*/
+void check_prime(const mpz_class& gn)
+{
+  using namespace mpint;
+  using namespace integer;
+
+  const bool expected = mpz_probab_prime_p(gn.get_mpz_t(), 24) != 0;
+  const MPInt mn(gn);
+  TEST_EQ(impl::isProbablePrime(mn), expected);
+  TEST_EQ(impl::isProbablePrime(-mn), expected);
+}
+
+mpz_class randomPrime(gmp_randclass& rng, const size_t bits)
+{
+  mpz_class p = rng.get_z_bits(bits);
+  mpz_setbit(p.get_mpz_t(), bits - 1);
+  mpz_nextprime(p.get_mpz_t(), p.get_mpz_t());
+  return p;
+}
+
+/*
+  All sqrtrem variants against mpz_sqrtrem.
+*/
+void check_sqrtrem(const mpz_class& gx)
+{
+  using namespace mpint;
+  using namespace integer;
+
+  mpz_class gs, gr;
+  mpz_sqrtrem(gs.get_mpz_t(), gr.get_mpz_t(), gx.get_mpz_t());
+  const MPInt mx(gx), ms(gs), mr(gr);
+
+  void (*const funcs[])(MPInt&, MPInt&, const MPInt&) = {
+    impl::sqrtrem, impl::sqrtremNewton, impl::sqrtremKaratsuba
+  };
+  for (size_t f = 0; f < 3; ++f) {
+    MPInt s, r;
+    funcs[f](s, r, mx);
+    TEST_EQ(s, ms);
+    TEST_EQ(r, mr);
+  }
+  TEST_EQ(impl::isqrt(mx), ms);
+
+  const bool square = mpz_perfect_square_p(gx.get_mpz_t()) != 0;
+  MPInt root(-1);
+  TEST_EQ(impl::isSquare(mx), square);
+  TEST_EQ(impl::isSquare(root, mx), square);
+  TEST_EQ(root, square ? ms : MPInt(-1));
+}
+
+/*
+  rootrem and isPerfectPower against mpz_rootrem and mpz_perfect_power_p.
+*/
+void check_root(const mpz_class& gx, const size_t k)
+{
+  using namespace mpint;
+  using namespace integer;
+
+  mpz_class gs, gr;
+  mpz_rootrem(gs.get_mpz_t(), gr.get_mpz_t(), gx.get_mpz_t(), k);
+  MPInt s, r;
+  impl::rootrem(s, r, MPInt(gx), k);
+  TEST_EQ(s, MPInt(gs));
+  TEST_EQ(r, MPInt(gr));
+  TEST_EQ(impl::iroot(MPInt(gx), k), MPInt(gs));
+}
+
+void check_perfect_power(const mpz_class& gx)
+{
+  using namespace mpint;
+  using namespace integer;
+
+  const bool expected = mpz_perfect_power_p(gx.get_mpz_t()) != 0;
+  const MPInt mx(gx);
+  MPInt root(7);
+  size_t k = 1;
+  TEST_EQ(impl::isPerfectPower(mx), expected);
+  TEST_EQ(impl::isPerfectPower(root, k, mx), expected);
+  if (expected && ! (mx.abs() < 2)) {
+    mpz_class gz;
+    mpz_pow_ui(gz.get_mpz_t(), mpz_class(root.toString()).get_mpz_t(), k);
+    TEST_EQ(gz, gx);
+  } else {
+    TEST_EQ(root, MPInt(7));
+    TEST_EQ(k, (size_t)1);
+  }
+}
+
+} // namespace
+
+void test_bpsw()
+{
+  PUTSERR(__func__);
+
+  using namespace std;
+  using namespace integer;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  for (int64_t n = -100; n < 100000; ++n) {
+    check_prime(mpz_class((long)n));
+  }
+
+  {
+    // strong pseudoprimes to base 2.
+    const int64_t spsp2[] = {
+      2047, 3277, 4033, 4681, 8321, 15841, 29341, 42799, 49141, 52633,
+      65281, 74665, 80581, 85489, 88357, 90751, 3215031751LL,
+    };
+    for (size_t i = 0; i < sizeof(spsp2)/sizeof(spsp2[0]); ++i) {
+      const MPInt n(spsp2[i]);
+      TEST_ASSERT(impl::isStrongProbablePrime(n, MPInt(2)));
+      TEST_ASSERT(! impl::isProbablePrime(n));
+    }
+    // strong Lucas pseudoprimes with Selfridge's parameters.
+    const int64_t slpsp[] = {
+      5459, 5777, 10877, 16109, 18971, 22499, 24569, 25199, 40309, 58519,
+      75077, 97439,
+    };
+    for (size_t i = 0; i < sizeof(slpsp)/sizeof(slpsp[0]); ++i) {
+      const MPInt n(slpsp[i]);
+      TEST_ASSERT(impl::isStrongLucasProbablePrime(n));
+      TEST_ASSERT(! impl::isProbablePrime(n));
+    }
+  }
+
+  for (size_t bits = 20; bits <= 2048; bits = bits*3/2) {
+    for (int i = 0; i < 20; ++i) {
+      const mpz_class p = randomPrime(rng, bits);
+      check_prime(p);
+      // squares pass the Selfridge search slowly, and must be rejected.
+      check_prime(p*p);
+      TEST_ASSERT(! impl::isStrongLucasProbablePrime(MPInt(p*p)));
+      check_prime(p*randomPrime(rng, bits / 2 + 1));
+      mpz_class x = rng.get_z_bits(bits);
+      x |= 1;
+      check_prime(x);
+    }
+  }
+
+  {
+    // Carmichael numbers and a product of primes near 2^64.
+    const mpz_class carmichael[] = {
+      mpz_class("561"),
+      mpz_class("41041"),
+      mpz_class("3825123056546413051"),
+      mpz_class("318665857834031151167461"),
+      mpz_class("3317044064679887385961981"),
+    };
+    for (size_t i = 0; i < sizeof(carmichael)/sizeof(carmichael[0]); ++i) {
+      check_prime(carmichael[i]);
+    }
+    mpz_class p("4294967291"), q("4294967279");
+    check_prime(p*q);
+    check_prime(mpz_class("18446744073709551557"));
+    const mpz_class sq = mpz_class("18446744073709551557") * mpz_class("18446744073709551557");
+    TEST_ASSERT(! impl::isStrongLucasProbablePrime(MPInt(sq)));
+  }
+}
+
+void test_isqrt()
+{
+  PUTSERR(__func__);
+
+  using namespace std;
+  using namespace integer;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  for (long x = 0; x < 5000; ++x) {
+    check_sqrtrem(mpz_class(x));
+  }
+  for (size_t bits = 1; bits <= 8192; bits += 1 + bits / 4) {
+    for (int i = 0; i < 10; ++i) {
+      const mpz_class gx = rng.get_z_bits(bits);
+      check_sqrtrem(gx);
+      check_sqrtrem(gx*gx);
+      check_sqrtrem(gx*gx + 1);
+      if (gx > 0) {
+        check_sqrtrem(gx*gx - 1);
+      }
+      check_sqrtrem(gx*gx + 2*gx);
+    }
+    // 2^bits and 2^bits - 1.
+    mpz_class gx = 1;
+    gx <<= bits;
+    check_sqrtrem(gx);
+    check_sqrtrem(gx - 1);
+  }
+
+  {
+    MPInt s, r;
+    TEST_THROW(impl::sqrtrem(s, r, MPInt(-4)), std::invalid_argument);
+    TEST_ASSERT(! impl::isSquare(MPInt(-4)));
+  }
+}
+
+void test_perfect_power()
+{
+  PUTSERR(__func__);
+
+  using namespace std;
+  using namespace integer;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  for (long x = -3000; x < 3000; ++x) {
+    check_perfect_power(mpz_class(x));
+    for (size_t k = 1; k < 12; ++k) {
+      if (x >= 0 || k % 2 == 1) {
+        check_root(mpz_class(x), k);
+      }
+    }
+  }
+
+  for (size_t bits = 2; bits <= 4096; bits += 1 + bits / 3) {
+    for (int i = 0; i < 4; ++i) {
+      mpz_class gx = rng.get_z_bits(bits);
+      const size_t ks[] = { 2, 3, 4, 5, 7, 8, 15, 31, 64, 257, bits / 2 + 1, bits + 5 };
+      for (size_t j = 0; j < sizeof(ks)/sizeof(ks[0]); ++j) {
+        check_root(gx, ks[j]);
+        check_root(-gx, ks[j] | 1);
+      }
+      check_perfect_power(gx);
+    }
+  }
+
+  // powers, and the neighbors of them.
+  for (size_t k = 2; k <= 300; k += 1 + k / 8) {
+    for (size_t bits = 1; bits * k <= 4096; bits = bits * 2 + 1) {
+      const mpz_class ga = rng.get_z_bits(bits) + 2;
+      mpz_class gx;
+      mpz_pow_ui(gx.get_mpz_t(), ga.get_mpz_t(), k);
+      check_perfect_power(gx);
+      check_perfect_power(gx + 1);
+      check_perfect_power(gx - 1);
+      check_perfect_power(-gx);
+      check_perfect_power(gx << k);
+      check_root(gx, k);
+      check_root(gx - 1, k);
+    }
+  }
+  for (size_t n = 0; n < 200; ++n) {
+    mpz_class gx = 1;
+    gx <<= n;
+    check_perfect_power(gx);
+    check_perfect_power(-gx);
+    check_perfect_power(gx*3);
+  }
+
+  {
+    const long bad[][2] = { { 4, 0 }, { -4, 2 }, { -1, 4 } };
+    for (size_t i = 0; i < sizeof(bad)/sizeof(bad[0]); ++i) {
+      TEST_THROW(impl::iroot(MPInt(bad[i][0]), (size_t)bad[i][1]), std::invalid_argument);
+    }
+  }
+}
+
+void test_primegen()
+{
+  PUTSERR(__func__);
+
+  using namespace std;
+  using namespace integer;
+  using namespace mpint;
+
+  const size_t threads[] = { 1, 3 };
+  for (size_t t = 0; t < sizeof(threads)/sizeof(threads[0]); ++t) {
+    for (size_t bits = 32; bits <= 1024; bits *= 2) {
+      PrimeGenerator gen(bits, threads[t], 1 << 12, 1 << 10, 2);
+      vector<MPInt> primes;
+      gen.generate(primes, 8, bits);
+      gen.generate(primes, 4, bits + 1);
+      TEST_EQ(primes.size(), (size_t)12);
+      const PrimeGenerator::Stats& st = gen.stats();
+      TEST_EQ(st.primes, (size_t)4);
+      TEST_LESSEQ(st.primes, st.tested);
+      TEST_LESSEQ(st.tested, st.candidates);
+      for (size_t i = 0; i < primes.size(); ++i) {
+        const mpz_class gp(primes[i].toString());
+        TEST_ASSERT(mpz_probab_prime_p(gp.get_mpz_t(), 24) != 0);
+        TEST_EQ(mpz_sizeinbase(gp.get_mpz_t(), 2), bits);
+      }
+    }
+  }
+
+  {
+    // the same seed gives the same primes with one thread.
+    PrimeGenerator gen(256);
+    vector<MPInt> p, q;
+    gen.generate(p, 5, 7);
+    gen.generate(q, 5, 7);
+    TEST_ASSERT(p == q);
+    gen.generate(q, 0, 8);
+    TEST_EQ(q.size(), (size_t)5);
+  }
+
+  {
+    const size_t bad[][3] = {
+      { 31, 1, 1 << 16 }, { 64, 0, 1 << 16 }, { 64, 1, 2 }, { 64, 1, (1 << 16) + 1 },
+    };
+    for (size_t i = 0; i < sizeof(bad)/sizeof(bad[0]); ++i) {
+      TEST_THROW(PrimeGenerator(bad[i][0], bad[i][1], (uint32_t)bad[i][2]), std::invalid_argument);
+    }
+    TEST_THROW(PrimeGenerator(64, 1, 1 << 16, 100), std::invalid_argument);
+  }
+}
+
+void bench_bpsw()
+{
+  printf("\n\n# %s\n", __func__);
+
+  using namespace std;
+  using namespace integer;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  for (size_t bits = 512; bits <= 4096; bits *= 2) {
+    const int numOfSample = std::max(N * 512 / (int)bits / (int)(bits / 512), 4);
+#ifdef OUTPUT_GNUPLOT
+    /*
+      @note: Output is:
+      bits gmp_prime_timing bpsw_prime_timing
+    */
+    cout << bits << " ";
+#else
+    PUT(bits);
+#endif
+
+    // primes take every step of the test.
+    const mpz_class gp = randomPrime(rng, bits);
+    const MPInt mp(gp);
+    bool r = false;
+
+    {
+      Xbyak::util::Clock clk;
+      for (int j = 0; j < numOfSample; ++j) {
+        clk.begin();
+        r = mpz_probab_prime_p(gp.get_mpz_t(), 1) != 0;
+        clk.end();
+      }
+      const double t = (double)clk.getClock() / clk.getCount();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, t);
+#else
+      printf(BENCHF, "mpz_probab_prime_p", t);
+#endif
+      TEST_ASSERT(r);
+    }
+
+    {
+      Xbyak::util::Clock clk;
+      for (int j = 0; j < numOfSample; ++j) {
+        clk.begin();
+        r = impl::isProbablePrime(mp);
+        clk.end();
+      }
+      const double t = (double)clk.getClock() / clk.getCount();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, t);
+#else
+      printf(BENCHF, "impl::isProbablePrime", t);
+#endif
+      TEST_ASSERT(r);
+    }
+
+#ifdef OUTPUT_GNUPLOT
+    puts("");
+#endif
+  }
+}
+
+void bench_primegen()
+{
+  printf("\n\n# %s\n", __func__);
+
+  using namespace std;
+  using namespace integer;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+  const size_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+
+  for (size_t bits = 512; bits <= 2048; bits *= 2) {
+    const size_t count = std::max((size_t)N * 16 / bits / (bits / 512), (size_t)4);
+#ifdef OUTPUT_GNUPLOT
+    /*
+      @note: Output is primes per second per core:
+      bits gmp_nextprime primegen_1_thread primegen_all_cores
+    */
+    cout << bits << " ";
+#else
+    PUT(bits);
+#endif
+
+    {
+      const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      for (size_t j = 0; j < count; ++j) {
+        mpz_class p = randomPrime(rng, bits);
+        TEST_EQ(mpz_sizeinbase(p.get_mpz_t(), 2), bits);
+      }
+      const double t = (double)count / chrono::duration<double>(chrono::steady_clock::now() - start).count();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, t);
+#else
+      printf(BENCHF, "mpz_nextprime", t);
+#endif
+    }
+
+    const size_t threads[] = { 1, cores };
+    for (size_t i = 0; i < 2; ++i) {
+      const size_t t = threads[i];
+      PrimeGenerator gen(bits, t);
+      vector<MPInt> primes;
+      gen.generate(primes, count*t, bits);
+      TEST_EQ(primes.size(), count*t);
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, gen.stats().primesPerSecondPerCore());
+#else
+      printf(BENCHF, i == 0 ? "PrimeGenerator(1)" : "PrimeGenerator(cores)", gen.stats().primesPerSecondPerCore());
+#endif
+    }
+#ifdef OUTPUT_GNUPLOT
+    puts("");
+#endif
+  }
+}
+
+void bench_isqrt()
+{
+  printf("\n\n# %s\n", __func__);
+
+  using namespace std;
+  using namespace integer;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  for (size_t n = 1; n <= 1024; n *= 2) {
+    const size_t len = 64*n;
+    const int numOfSample = std::max(N * 10 / (int)n, 10);
+#ifdef OUTPUT_GNUPLOT
+    /*
+      @note: Output is:
+      digits gmp_timing sqrtrem_timing newton_timing karatsuba_timing
+      gmp_perfect_square_timing is_square_timing
+      for random x, most of which are rejected by the filters.
+    */
+    cout << n << " ";
+#else
+    PUT(len);
+#endif
+
+    const mpz_class gx = rng.get_z_bits(len);
+    mpz_class gs, gr;
+    const MPInt mx(gx);
+    MPInt ms, mr;
+
+    {
+      Xbyak::util::Clock clk;
+      for (int j = 0; j < numOfSample; ++j) {
+        clk.begin();
+        mpz_sqrtrem(gs.get_mpz_t(), gr.get_mpz_t(), gx.get_mpz_t());
+        clk.end();
+      }
+      const double t = (double)clk.getClock() / clk.getCount();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, t);
+#else
+      printf(BENCHF, "mpz_sqrtrem", t);
+#endif
+    }
+
+    void (*const funcs[])(MPInt&, MPInt&, const MPInt&) = {
+      impl::sqrtrem, impl::sqrtremNewton, impl::sqrtremKaratsuba
+    };
+#ifndef OUTPUT_GNUPLOT
+    const char* const names[] = {
+      "impl::sqrtrem", "impl::sqrtremNewton", "impl::sqrtremKaratsuba"
+    };
+#endif
+    for (size_t f = 0; f < 3; ++f) {
+      // Newton's iteration is quadratic in the number of digits.
+      const int samples = f == 1 && n > 64 ? std::max(numOfSample / 16, 2) : numOfSample;
+      Xbyak::util::Clock clk;
+      for (int j = 0; j < samples; ++j) {
+        clk.begin();
+        funcs[f](ms, mr, mx);
+        clk.end();
+      }
+      const double t = (double)clk.getClock() / clk.getCount();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, t);
+#else
+      printf(BENCHF, names[f], t);
+#endif
+      TEST_EQ(ms, MPInt(gs));
+    }
+
+    {
+      vector<mpz_class> gy(256);
+      vector<MPInt> my(256);
+      for (size_t j = 0; j < gy.size(); ++j) {
+        gy[j] = rng.get_z_bits(len);
+        my[j] = MPInt(gy[j]);
+      }
+      int c0 = 0, c1 = 0;
+      Xbyak::util::Clock clk0, clk1;
+      for (int j = 0; j < numOfSample; ++j) {
+        const size_t k = (size_t)j % gy.size();
+        clk0.begin();
+        c0 += mpz_perfect_square_p(gy[k].get_mpz_t());
+        clk0.end();
+        clk1.begin();
+        c1 += impl::isSquare(my[k]);
+        clk1.end();
+      }
+      TEST_EQ(c0, c1);
+      const double t0 = (double)clk0.getClock() / clk0.getCount();
+      const double t1 = (double)clk1.getClock() / clk1.getCount();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, t0);
+      printf(GNUPLOTF, t1);
+#else
+      printf(BENCHF, "mpz_perfect_square_p", t0);
+      printf(BENCHF, "impl::isSquare", t1);
+#endif
+    }
+
+#ifdef OUTPUT_GNUPLOT
+    puts("");
+#endif
+  }
+}
+
+void bench_perfect_power()
+{
+  printf("\n\n# %s\n", __func__);
+
+  using namespace std;
+  using namespace integer;
+  using namespace mpint;
+
+  const unsigned long test_seed = 0;
+  gmp_randclass rng(gmp_randinit_default);
+  rng.seed(test_seed);
+
+  for (size_t n = 1; n <= 64; n *= 2) {
+    const size_t len = 64*n;
+    const int numOfSample = std::max(N * 4 / (int)n, 10);
+#ifdef OUTPUT_GNUPLOT
+    /*
+      @note: Output is:
+      digits gmp_timing gmp_with_conversion_timing is_perfect_power_timing
+      gmp_cube_timing is_perfect_power_cube_timing
+      for random x, and for cubes of random numbers.
+    */
+    cout << n << " ";
+#else
+    PUT(len);
+#endif
+
+    for (size_t c = 0; c < 2; ++c) {
+      vector<mpz_class> gx(64);
+      vector<MPInt> mx(gx.size());
+      for (size_t j = 0; j < gx.size(); ++j) {
+        if (c == 0) {
+          gx[j] = rng.get_z_bits(len);
+        } else {
+          gx[j] = rng.get_z_bits(len / 3 + 1);
+          mpz_pow_ui(gx[j].get_mpz_t(), gx[j].get_mpz_t(), 3);
+        }
+        mx[j] = MPInt(gx[j]);
+      }
+      int c0 = 0, c1 = 0, c2 = 0;
+      Xbyak::util::Clock clk0, clk1, clk2;
+      for (int j = 0; j < numOfSample; ++j) {
+        const size_t k = (size_t)j % gx.size();
+        clk0.begin();
+        c0 += mpz_perfect_power_p(gx[k].get_mpz_t());
+        clk0.end();
+        if (c == 0) {
+          // MPInt to mpz_class by the string, as a caller without mpz would do.
+          clk1.begin();
+          const mpz_class gy(mx[k].toString());
+          c1 += mpz_perfect_power_p(gy.get_mpz_t());
+          clk1.end();
+        }
+        clk2.begin();
+        c2 += impl::isPerfectPower(mx[k]);
+        clk2.end();
+      }
+      TEST_EQ(c0, c2);
+      const double t0 = (double)clk0.getClock() / clk0.getCount();
+      const double t2 = (double)clk2.getClock() / clk2.getCount();
+#ifdef OUTPUT_GNUPLOT
+      printf(GNUPLOTF, t0);
+      if (c == 0) {
+        printf(GNUPLOTF, (double)clk1.getClock() / clk1.getCount());
+      }
+      printf(GNUPLOTF, t2);
+#else
+      printf(BENCHF, c == 0 ? "mpz_perfect_power_p" : "mpz_perfect_power_p(cube)", t0);
+      if (c == 0) {
+        printf(BENCHF, "mpz_perfect_power_p(conversion)", (double)clk1.getClock() / clk1.getCount());
+      }
+      printf(BENCHF, c == 0 ? "impl::isPerfectPower" : "impl::isPerfectPower(cube)", t2);
+#endif
+    }
+
+#ifdef OUTPUT_GNUPLOT
+    puts("");
+#endif
+  }
+}
+
+void info_gmp()
+{
+  using namespace std;
+
+  cerr << "GMP Version is " << gmp_version << endl
+       << "number of bits in mp_limb is " << mp_bits_per_limb << endl;
+}
+
+void test_all()
+{
+  using namespace std;
+  using namespace mpint;
+
+  MontgomeryContext::codeGen(0);
+
+  test_bpsw();
+  test_primegen();
+  test_isqrt();
+  test_perfect_power();
+
+  cout.flush();
+
+  MontgomeryContext::codeGen();
+
+  test_bpsw();
+  test_primegen();
+  test_isqrt();
+  test_perfect_power();
+
+  cout.flush();
+}
+
+void bench_for_gnuplot()
+{
+  using namespace std;
+  using namespace mpint;
+
+  bench_bpsw();
+
+  bench_primegen();
+
+  bench_isqrt();
+
+  bench_perfect_power();
+}
+
+int main()
+{
+  using namespace std;
+  using namespace mpint;
+
+#ifndef NDEBUG
+  cerr << "NDEBUG is undefined" << endl;
+#endif
+  cerr << "Number of sampling loop: " << N << endl;
+
+  info_gmp();
+  MPIntCodeGen();
+
+  test_all();
+
+  bench_for_gnuplot();
+
+  return testsAreSucceeded() ? 0 : 1;
+}
@@ -0,0 +1,95 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#ifndef BARRETT_HPP
+#define BARRETT_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "mpint.hpp"
+
+namespace mpint {
+
+/*
+  Barrett reduction modulo a fixed MPInt m > 0 (m may be even).
+
+  Let k = m.size() and B = 2^64, mu = floor(B^(2k)/m) is precomputed.
+  A context is not modified after construction, so one context can be
+  shared by threads; each thread gives its own work space.
+*/
+class BarrettContext {
+public:
+  typedef MPInt::value_type value_type;
+
+  /*
+    @require: m > 0.
+  */
+  explicit BarrettContext(const MPInt& m);
+
+  size_t size() const { return k_; }
+  const MPInt& modulus() const { return m_; }
+  const MPInt& mu() const { return mu_; }
+
+  /*
+    Number of digits of work space for reduce().
+  */
+  size_t workSize() const { return 4*k_ + 4; }
+
+  /*
+    r[0..k) = x[0..xn) mod m.
+
+    @require:
+    xn <= 2k, i.e. x < B^(2k).
+    work has workSize() digits.
+    r may be the same as x.
+  */
+  void reduce(value_type* r, const value_type* x, const size_t xn, value_type* work) const;
+
+  /*
+    MPInt interfaces, work space is allocated in each call.
+    @note: r is in [0, m) for any x.
+  */
+  void reduce(MPInt& r, const MPInt& x) const;
+
+  /*
+    z = x*y mod m.
+  */
+  void mul(MPInt& z, const MPInt& x, const MPInt& y) const;
+
+private:
+  size_t k_;
+  MPInt m_;
+  MPInt mu_;
+  std::vector<value_type> mdigits_;  // m with k digits.
+  std::vector<value_type> mudigits_; // mu with k + 1 digits.
+};
+
+} // namespace mpint
+
+#endif // BARRETT_HPP
@@ -0,0 +1,89 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#ifndef BATCHINV_HPP
+#define BATCHINV_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "mpint.hpp"
+#include "montgomery.hpp"
+
+namespace mpint {
+
+/*
+  Inverses of many values modulo the same odd m by Montgomery's trick:
+  one inversion and 3(k - 1) multiplications for k values.
+
+  The prefix products are kept in one contiguous buffer, which only grows,
+  so no memory is allocated by repeated calls of the same or smaller size.
+  An object is used by one thread at a time, a context can be shared.
+*/
+class BatchInverse {
+public:
+  typedef MPInt::value_type value_type;
+
+  explicit BatchInverse(const MontgomeryContext& ctx);
+
+  const MontgomeryContext& context() const { return ctx_; }
+
+  /*
+    z[i] = x[i]^(-1) for i < k, x[i] and z[i] are in Montgomery form,
+    and the i-th value is stored at digits [i*n, (i + 1)*n).
+
+    The work is split into threads chunks, each of them is done by
+    its own thread, and still only one inversion is computed.
+
+    @require: x[i] < m, threads >= 1, z may be the same as x.
+    @return: whether all x[i] are invertible,
+    z is not specified if not.
+  */
+  bool invert(value_type* z, const value_type* x, const size_t k, const size_t threads = 1);
+
+  /*
+    z[i] = x[i]^(-1) mod m, x[i] may be any integers.
+  */
+  bool invert(std::vector<MPInt>& z, const std::vector<MPInt>& x, const size_t threads = 1);
+
+private:
+  BatchInverse(const BatchInverse&);
+  void operator=(const BatchInverse&);
+
+  /*
+    z = x^(-1) for one value in Montgomery form.
+  */
+  bool invertOne_(value_type* z, const value_type* x) const;
+
+  const MontgomeryContext& ctx_;
+  std::vector<value_type> work_;
+};
+
+} // namespace mpint
+
+#endif // BATCHINV_HPP
@@ -0,0 +1,205 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#ifndef DIVSTEPS_HPP
+#define DIVSTEPS_HPP
+
+#include <cassert>
+#include <cstdint>
+#include <utility>
+
+#include "mpint.hpp"
+
+namespace integer {
+
+namespace impl {
+
+/*
+  Batches of 62 posdivsteps on the low digits and their application
+  to the full numbers, shared by kroneckerDivsteps and JacobiBatch.
+*/
+namespace divsteps {
+
+typedef mpint::MPInt::value_type value_type;
+typedef mpint::MPInt::dvalue_type dvalue_type;
+
+/*
+  2^62 (f', g') = (u f + v g, q f + r g), the entries are in [0, 2^62].
+*/
+struct Trans {
+  value_type u, v, q, r;
+};
+
+/*
+  62 posdivsteps on the low 64 bits of f and g, f is odd.
+  A posdivstep is a divstep of Bernstein and Yang which adds f to g
+  instead of subtracting, so f and g are never negative and
+  the Jacobi symbol (g/f) is tracked in the bit 0 of jac from their low bits:
+  halving g flips it if f = 3, 5 mod 8, and swapping f and g flips it
+  if both are 3 mod 4.
+  The zeros of g are removed at once, and up to 6 bits of g are cancelled
+  by one multiple of f.
+
+  @return: new eta, eta = -delta.
+*/
+inline int64_t posdivsteps(int64_t eta, value_type f, value_type g, Trans& t, unsigned& jac)
+{
+  value_type u = 1, v = 0, q = 0, r = 1;
+  int i = 62;
+
+  for (;;) {
+    // a sentinel bit counts zeros only up to i.
+    const int zeros = __builtin_ctzll(g | (~value_type(0) << i));
+    g >>= zeros;
+    u <<= zeros;
+    v <<= zeros;
+    eta -= zeros;
+    i -= zeros;
+    jac ^= (unsigned)(zeros & ((f >> 1) ^ (f >> 2)));
+    if (i == 0) {
+      break;
+    }
+
+    value_type w, m;
+    int limit;
+    if (eta < 0) {
+      eta = -eta;
+      std::swap(f, g);
+      std::swap(u, q);
+      std::swap(v, r);
+      jac ^= (unsigned)((f & g) >> 1);
+      limit = (int)eta + 1 > i ? i : (int)eta + 1;
+      m = (~value_type(0) >> (64 - limit)) & 63;
+      // w = -g/f mod 64.
+      w = (f*g*(f*f - 2)) & m;
+    } else {
+      limit = (int)eta + 1 > i ? i : (int)eta + 1;
+      m = (~value_type(0) >> (64 - limit)) & 15;
+      // w = -g/f mod 16.
+      w = f + (((f + 1) & 4) << 1);
+      w = (-w*g) & m;
+    }
+    g += f*w;
+    q += u*w;
+    r += v*w;
+    assert((g & m) == 0);
+  }
+
+  t.u = u;
+  t.v = v;
+  t.q = q;
+  t.r = r;
+  return eta;
+}
+
+/*
+  Same as posdivsteps, one step at a time with masks.
+*/
+inline int64_t posdivstepsConstTime(int64_t eta, value_type f, value_type g, Trans& t, unsigned& jac)
+{
+  value_type u = 1, v = 0, q = 0, r = 1;
+  value_type j = jac;
+
+  for (int i = 0; i < 62; ++i) {
+    const value_type odd = -(g & 1);
+    const value_type sw = odd & (value_type)(eta >> 63);
+    value_type d;
+    d = (f ^ g) & sw; f ^= d; g ^= d;
+    d = (u ^ q) & sw; u ^= d; q ^= d;
+    d = (v ^ r) & sw; v ^= d; r ^= d;
+    eta = (int64_t)(((value_type)eta ^ sw) - sw);
+    j ^= sw & ((f & g) >> 1);
+
+    g += f & odd;
+    q += u & odd;
+    r += v & odd;
+
+    g >>= 1;
+    u <<= 1;
+    v <<= 1;
+    --eta;
+    j ^= (f >> 1) ^ (f >> 2);
+  }
+
+  jac = (unsigned)(j & 1);
+  t.u = u;
+  t.v = v;
+  t.q = q;
+  t.r = r;
+  return eta;
+}
+
+/*
+  (f, g) = (u f + v g, q f + r g) / 2^62 on n digits.
+  @require: tf and tg have n + 1 digits.
+*/
+inline void apply(value_type* f, value_type* g, value_type* tf, value_type* tg, const size_t n, const Trans& t)
+{
+  dvalue_type cf = 0, cg = 0;
+  for (size_t i = 0; i < n; ++i) {
+    cf += (dvalue_type)t.u*f[i] + (dvalue_type)t.v*g[i];
+    cg += (dvalue_type)t.q*f[i] + (dvalue_type)t.r*g[i];
+    tf[i] = (value_type)cf;
+    tg[i] = (value_type)cg;
+    cf >>= 64;
+    cg >>= 64;
+  }
+  tf[n] = (value_type)cf;
+  tg[n] = (value_type)cg;
+  assert((tf[0] & ((value_type(1) << 62) - 1)) == 0);
+  assert((tg[0] & ((value_type(1) << 62) - 1)) == 0);
+  for (size_t i = 0; i < n; ++i) {
+    f[i] = (tf[i] >> 62) | (tf[i + 1] << 2);
+    g[i] = (tg[i] >> 62) | (tg[i + 1] << 2);
+  }
+}
+
+inline bool equal(const value_type* f, const value_type* g, const size_t n)
+{
+  value_type d = 0;
+  for (size_t i = 0; i < n; ++i) {
+    d |= f[i] ^ g[i];
+  }
+  return d == 0;
+}
+
+inline size_t normalized(const value_type* x, size_t n)
+{
+  while (n > 0 && x[n - 1] == 0) {
+    --n;
+  }
+  return n;
+}
+
+} // namespace divsteps
+
+} // namespace impl
+
+} // namespace integer
+
+#endif // DIVSTEPS_HPP
@@ -0,0 +1,82 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#ifndef GCD_HPP
+#define GCD_HPP
+
+#include <cstdint>
+
+#include "mpint.hpp"
+
+namespace integer {
+
+namespace impl {
+
+/*
+  Size crossovers in digits, tuned by bench/gcd.
+  Below gcdLehmerThreshold the binary algorithm is used,
+  and above gcdHalfThreshold the subquadratic half-GCD is used.
+*/
+extern size_t gcdLehmerThreshold;
+extern size_t gcdHalfThreshold;
+
+/*
+  @return: gcd(|x|, |y|), gcd(0, 0) = 0.
+*/
+mpint::MPInt gcd(const mpint::MPInt& x, const mpint::MPInt& y);
+
+/*
+  gcd by one algorithm down to the smallest sizes, for tests and tuning.
+*/
+mpint::MPInt gcdBinary(const mpint::MPInt& x, const mpint::MPInt& y);
+mpint::MPInt gcdLehmer(const mpint::MPInt& x, const mpint::MPInt& y);
+mpint::MPInt gcdHalf(const mpint::MPInt& x, const mpint::MPInt& y);
+
+/*
+  z = a^(-1) mod |m|, 0 <= z < |m|.
+
+  For odd m, the inverse is computed by Pornin's optimized binary GCD
+  without division, even m is reduced to an inverse modulo odd a.
+  If constantTime is true, the running time of the inversion depends
+  only on the size of m, a should be reduced by the caller then.
+
+  @require: m != 0, m is odd if constantTime is true.
+  @return: whether the inverse exists, z is not modified if not.
+*/
+bool invert(mpint::MPInt& z, const mpint::MPInt& a, const mpint::MPInt& m, const bool constantTime = false);
+
+/*
+  @return: g = gcd(|x|, |y|), and s, t such that g = s x + t y.
+*/
+mpint::MPInt gcdext(mpint::MPInt& s, mpint::MPInt& t, const mpint::MPInt& x, const mpint::MPInt& y);
+
+} // namespace impl
+
+} // namespace integer
+
+#endif // GCD_HPP
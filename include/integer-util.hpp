@@ -0,0 +1,172 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#ifndef INTEGER_UTIL_HPP
+#define INTEGER_UTIL_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "mpint.hpp"
+#include "kronecker-jacobi.hpp"
+
+namespace integer {
+
+namespace impl {
+
+/*
+  Small helpers shared by the implementations, not a public interface.
+*/
+
+/*
+  x^(-1) mod 2^64 by Newton iteration, k steps from 3 correct bits
+  since x*x = 1 mod 8, each step doubles the number of correct bits.
+  @require: x is odd.
+*/
+constexpr uint64_t inverse64(uint64_t x, uint64_t y = 0, int k = -1)
+{ return k == -1 ? inverse64(x, x, 5) : k == 0 ? y : inverse64(x, y*(2 - x*y), k - 1); }
+
+/*
+  @require: x != 0.
+  @return: the number of bits of |x|.
+*/
+inline size_t bitLength(const mpint::MPInt& x)
+{
+  return x.size()*64 - (size_t)__builtin_clzll(x[x.size() - 1]);
+}
+
+inline bool isZero(const mpint::MPInt::value_type* x, const size_t n)
+{
+  mpint::MPInt::value_type d = 0;
+  for (size_t i = 0; i < n; ++i) {
+    d |= x[i];
+  }
+  return d == 0;
+}
+
+/*
+  @require: 0 < p < 2^32.
+  @return: b^e mod p.
+*/
+inline uint32_t powmod32(uint64_t b, uint64_t e, const uint32_t p)
+{
+  uint64_t r = 1;
+  b %= p;
+  while (e) {
+    if (e & 1) {
+      r = r*b % p;
+    }
+    b = b*b % p;
+    e >>= 1;
+  }
+  return (uint32_t)r;
+}
+
+/*
+  @require: gcd(a, p) = 1.
+  @return: a^(-1) mod p.
+*/
+inline uint32_t invmod32(const uint32_t a, const uint32_t p)
+{
+  int64_t r0 = p, r1 = a % p, t0 = 0, t1 = 1;
+  while (r1 != 0) {
+    const int64_t q = r0 / r1;
+    int64_t t = r0 - q*r1;
+    r0 = r1;
+    r1 = t;
+    t = t0 - q*t1;
+    t0 = t1;
+    t1 = t;
+  }
+  return (uint32_t)(t0 < 0 ? t0 + p : t0);
+}
+
+/*
+  t^2 = a mod p by Tonelli-Shanks.
+  @require: p is an odd prime and (a/p) = 1.
+*/
+inline uint32_t sqrtmod32(const uint32_t a, const uint32_t p)
+{
+  if ((p & 3) == 3) {
+    return powmod32(a, (p + 1) / 4, p);
+  }
+  uint32_t q = p - 1;
+  size_t s = 0;
+  while ((q & 1) == 0) {
+    q >>= 1;
+    ++s;
+  }
+  uint32_t z = 2;
+  while (integer::kronecker((int64_t)z, (int64_t)p) != -1) {
+    ++z;
+  }
+  uint64_t c = powmod32(z, q, p);
+  uint64_t t = powmod32(a, q, p);
+  uint64_t r = powmod32(a, (q + 1) / 2, p);
+  size_t m = s;
+  while (t != 1) {
+    size_t i = 0;
+    for (uint64_t u = t; u != 1; u = u*u % p) {
+      ++i;
+    }
+    uint64_t b = c;
+    for (size_t j = i + 1; j < m; ++j) {
+      b = b*b % p;
+    }
+    r = r*b % p;
+    c = b*b % p;
+    t = t*c % p;
+    m = i;
+  }
+  return (uint32_t)r;
+}
+
+/*
+  Odd primes less than limit by the sieve of Eratosthenes.
+*/
+inline std::vector<uint32_t> oddPrimes(const uint32_t limit)
+{
+  std::vector<bool> composite(limit, false);
+  std::vector<uint32_t> p;
+  for (uint32_t i = 3; i < limit; i += 2) {
+    if (composite[i]) {
+      continue;
+    }
+    p.push_back(i);
+    for (uint64_t j = (uint64_t)i*i; j < limit; j += 2*i) {
+      composite[(size_t)j] = true;
+    }
+  }
+  return p;
+}
+
+} // namespace impl
+
+} // namespace integer
+
+#endif // INTEGER_UTIL_HPP
@@ -0,0 +1,115 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#ifndef ISQRT_HPP
+#define ISQRT_HPP
+
+#include <cstdint>
+
+#include "mpint.hpp"
+
+namespace integer {
+
+namespace impl {
+
+/*
+  Size crossover in digits, tuned by bench/prime.
+  Below isqrtKaratsubaThreshold Newton's iteration is used,
+  and above it Zimmermann's Karatsuba square root.
+*/
+extern size_t isqrtKaratsubaThreshold;
+
+/*
+  s = floor(sqrt(x)), r = x - s^2.
+  @require: x >= 0, otherwise std::invalid_argument is thrown.
+*/
+void sqrtrem(mpint::MPInt& s, mpint::MPInt& r, const mpint::MPInt& x);
+
+/*
+  @return: floor(sqrt(x)).
+  @require: x >= 0, otherwise std::invalid_argument is thrown.
+*/
+mpint::MPInt isqrt(const mpint::MPInt& x);
+
+/*
+  sqrtrem by one algorithm down to the smallest sizes, for tests and tuning.
+*/
+void sqrtremNewton(mpint::MPInt& s, mpint::MPInt& r, const mpint::MPInt& x);
+void sqrtremKaratsuba(mpint::MPInt& s, mpint::MPInt& r, const mpint::MPInt& x);
+
+/*
+  Whether x is a perfect square, 0 is, negative x are not.
+  x mod 64 and x mod 63*65*11 (by one divrem_1) are checked against
+  squares64, squares63, squares65 and squares11 before the root is extracted,
+  which rejects all but about 1/119 of non-squares.
+*/
+bool isSquare(const mpint::MPInt& x);
+
+/*
+  Same as above, and root = sqrt(x) if x is a square.
+  root is not modified if not.
+*/
+bool isSquare(mpint::MPInt& root, const mpint::MPInt& x);
+
+/*
+  s = x^(1/k) rounded toward zero, r = x - s^k.
+  Newton's iteration from above, started from the root of x/2^(k h)
+  for about half of the bits of s, computed in the same way,
+  so the precision doubles at each level.
+  @require: k >= 1, x >= 0 if k is even,
+  otherwise std::invalid_argument is thrown.
+*/
+void rootrem(mpint::MPInt& s, mpint::MPInt& r, const mpint::MPInt& x, const size_t k);
+
+/*
+  @return: x^(1/k) rounded toward zero.
+  @require: same as rootrem.
+*/
+mpint::MPInt iroot(const mpint::MPInt& x, const size_t k);
+
+/*
+  Whether x = a^k for some integer a and k >= 2, 0, 1 and -1 are.
+  Only prime k are tried, odd ones for negative x, and k must divide
+  the number of trailing zeros of x.
+  Before a root is extracted, x mod q for primes q = 1 mod k below 2^16
+  are checked to be k-th power residues, each of them passes a random x
+  with probability about 1/k.
+*/
+bool isPerfectPower(const mpint::MPInt& x);
+
+/*
+  Same as above, and x = root^k with a prime k if x is a perfect power
+  other than 0, 1 and -1, root and k are not modified otherwise.
+*/
+bool isPerfectPower(mpint::MPInt& root, size_t& k, const mpint::MPInt& x);
+
+} // namespace impl
+
+} // namespace integer
+
+#endif // ISQRT_HPP
@@ -0,0 +1,96 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#ifndef JACOBI_BATCH_HPP
+#define JACOBI_BATCH_HPP
+
+#include <cstdint>
+
+#include "mpint.hpp"
+
+namespace integer {
+
+/*
+  Jacobi symbols (x/m) of many x for a fixed odd modulus m.
+
+  The symbols are computed by posdivsteps as kroneckerDivsteps does.
+  The AVX2 kernel runs the 62 steps of a batch for 4 values at once,
+  one value in each 64 bit lane, by the branch free steps of the constant
+  time variant, and the transition matrices are applied to the full
+  numbers lane by lane. The portable kernel takes one value at a time
+  by the variable time steps.
+  Nothing is allocated for each value, and an object may be shared by threads.
+*/
+class JacobiBatch {
+public:
+  typedef mpint::MPInt::value_type value_type;
+
+  /*
+    s[i] = (x_i/m) of x_i = x[i*n .. i*n + n), n = m.size().
+  */
+  typedef void (*symbols_op)(int8_t* s, const value_type* x, const size_t count, const value_type* m, const size_t n);
+
+  /*
+    @require: m is odd and m > 1.
+  */
+  explicit JacobiBatch(const mpint::MPInt& m);
+
+  const mpint::MPInt& modulus() const { return m_; }
+
+  /*
+    Number of digits of each value.
+  */
+  size_t size() const { return m_.size(); }
+
+  /*
+    s[i] = (x_i/m) in {-1, 0, 1}.
+    @require: x has count*size() digits, x_i is the i-th size() digits.
+  */
+  void symbols(int8_t* s, const value_type* x, const size_t count) const
+  { symbols_(s, x, count, m_.get(), m_.size()); }
+
+  /*
+    Select the kernel for objects constructed after this call.
+    -1: AVX2 if the CPU supports it,
+     0: portable C++.
+  */
+  static void codeGen(const int version = -1);
+
+private:
+  JacobiBatch(const JacobiBatch&);
+  void operator=(const JacobiBatch&);
+
+  mpint::MPInt m_;
+  symbols_op symbols_;
+
+  static int version_;
+};
+
+} // namespace integer
+
+#endif // JACOBI_BATCH_HPP
@@ -0,0 +1,191 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#ifndef KRONECKER_CONSTEXPR_HPP
+#define KRONECKER_CONSTEXPR_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace integer {
+
+/*
+  Compile time versions of kronecker(int64_t, int64_t) and tbl1,
+  and tables of squares modulo small m generated from them.
+  They are written as single return constexpr functions of C++0x,
+  so the recursion depth is O(log y).
+*/
+
+/*
+  (2/x) = tbl1Const[x & 7], same as tbl1.
+*/
+constexpr int tbl1Const[] = {
+  0,  1,  0, -1,  0, -1,  0,  1,
+};
+
+namespace constexpr_impl {
+
+/*
+  @require: y != 0.
+*/
+constexpr int64_t NTZ(const int64_t y)
+{
+  return (y & 0x1) ? 0 : 1 + NTZ(y / 2);
+}
+
+/*
+  k * (a/n) for a >= 0 and odd n > 0.
+*/
+constexpr int jacobi(const int64_t a, const int64_t n, const int k)
+{
+  return a == 0 ? (n == 1 ? k : 0)
+    : ! (a & 0x1) ? jacobi(a / 2, n, tbl1Const[n & 0x7] * k)
+    : jacobi(n % a, a, (a & n & 0x2) ? -k : k);
+}
+
+/*
+  k * (x/y) for odd y > 0.
+*/
+constexpr int kroneckerPos(const int64_t x, const int64_t y, const int k)
+{
+  return x < 0 ? jacobi(-x % y, y, (y & 0x3) == 0x3 ? -k : k)
+    : jacobi(x % y, y, k);
+}
+
+/*
+  k * (x/y) for odd y.
+*/
+constexpr int kroneckerOdd(const int64_t x, const int64_t y, const int k)
+{
+  return y < 0 ? kroneckerPos(x, -y, x < 0 ? -k : k)
+    : kroneckerPos(x, y, k);
+}
+
+} // namespace constexpr_impl
+
+/*
+  Same as kronecker(int64_t, int64_t).
+*/
+constexpr int kroneckerConst(const int64_t x, const int64_t y)
+{
+  return y == 0 ? ((x == 1 || x == -1) ? 1 : 0)
+    : ! ((x | y) & 0x1) ? 0
+    : constexpr_impl::kroneckerOdd(x, y / (int64_t(1) << constexpr_impl::NTZ(y)),
+                                   (constexpr_impl::NTZ(y) & 0x1) ? tbl1Const[x & 0x7] : 1);
+}
+
+/*
+  t[r] is true iff r is a square modulo M, including 0.
+*/
+template<size_t M>
+struct SquareTable {
+  bool t[M];
+
+  constexpr bool operator[](const size_t r) const { return t[r]; }
+  static constexpr size_t modulus() { return M; }
+};
+
+namespace constexpr_impl {
+
+template<size_t... I>
+struct Seq {};
+
+template<size_t N, size_t... I>
+struct MakeSeq : MakeSeq<N - 1, N - 1, I...> {};
+
+template<size_t... I>
+struct MakeSeq<0, I...> {
+  typedef Seq<I...> type;
+};
+
+/*
+  Whether y^2 = r mod m for some y in [i, m/2],
+  (m - y)^2 = y^2 covers the others.
+*/
+constexpr bool isSquareMod(const size_t r, const size_t m, const size_t i = 0)
+{
+  return i > m / 2 ? false
+    : i*i % m == r || isSquareMod(r, m, i + 1);
+}
+
+template<size_t M, size_t... I>
+constexpr SquareTable<M> makeSquareTable(Seq<I...>)
+{
+  return SquareTable<M>{{ isSquareMod(I, M)... }};
+}
+
+template<size_t M>
+constexpr size_t countSquares(const SquareTable<M>& t, const size_t r = 0)
+{
+  return r == M ? 0 : (t[r] ? 1 : 0) + countSquares(t, r + 1);
+}
+
+/*
+  Whether t[r] agrees with (r/p) != -1 for all odd primes p of the list,
+  i.e. r is a square modulo the product iff it is modulo each p.
+*/
+template<size_t M>
+constexpr bool agreesWithKronecker(const SquareTable<M>& t, const int64_t p, const int64_t q, const size_t r = 0)
+{
+  return r == M ? true
+    : t[r] == (kroneckerConst((int64_t)r, p) != -1 && kroneckerConst((int64_t)r, q) != -1)
+      && agreesWithKronecker(t, p, q, r + 1);
+}
+
+} // namespace constexpr_impl
+
+template<size_t M>
+constexpr SquareTable<M> makeSquareTable()
+{
+  return constexpr_impl::makeSquareTable<M>(typename constexpr_impl::MakeSeq<M>::type());
+}
+
+/*
+  Tables for the filters of square detection, in .rodata.
+  A square modulo 64, 63 = 7 * 9, 65 = 5 * 13 and 11 passes all of them,
+  and a non-square passes with probability about 1/119.
+*/
+constexpr SquareTable<64> squares64 = makeSquareTable<64>();
+constexpr SquareTable<63> squares63 = makeSquareTable<63>();
+constexpr SquareTable<65> squares65 = makeSquareTable<65>();
+constexpr SquareTable<11> squares11 = makeSquareTable<11>();
+
+static_assert(kroneckerConst(2, 7) == 1 && kroneckerConst(-1, 7) == -1
+              && kroneckerConst(5, -3) == -1 && kroneckerConst(-5, -3) == -1
+              && kroneckerConst(3, 12) == 0 && kroneckerConst(5, 12) == -1
+              && kroneckerConst(-1, 0) == 1 && kroneckerConst(2, 0) == 0
+              && kroneckerConst(1000000007, 998244353) == kroneckerConst(998244353, 1000000007),
+              "kroneckerConst");
+static_assert(constexpr_impl::countSquares(squares64) == 12, "squares64");
+static_assert(constexpr_impl::countSquares(squares63) == 16, "squares63");
+static_assert(constexpr_impl::agreesWithKronecker(squares65, 5, 13), "squares65");
+static_assert(constexpr_impl::agreesWithKronecker(squares11, 11, 11), "squares11");
+
+} // namespace integer
+
+#endif // KRONECKER_CONSTEXPR_HPP
@@ -38,6 +38,26 @@ int kronecker(int64_t, int64_t);
 
 namespace impl {
 int kronecker(const mpint::MPInt&, const mpint::MPInt&);
+
+/*
+  Kronecker symbol by batches of 62 posdivsteps (safegcd) on the low bits,
+  each batch is applied to the full numbers by one 2x2 matrix.
+  If constantTime is true, a fixed number of branch free batches, 6 steps
+  per bit of the sizes, runs first. This is best effort and not constant
+  time: the bound is a heuristic, not proven, and an input beyond it is
+  finished by the variable time batches. The removal of the factors of 2 and
+  the signs before the batches, and the shrinking length after them, depend
+  on the values.
+*/
+int kroneckerDivsteps(const mpint::MPInt&, const mpint::MPInt&, const bool constantTime = false);
+
+/*
+  Kronecker symbol by Sorenson's k-ary reduction with k = 2^logK,
+  the larger one of u and v is replaced by (a u + b v)/2^e for small a, b
+  from a table, which removes about logK/2 - 1 bits for each pass.
+  @require: logK is even and 4 <= logK <= 16.
+*/
+int kroneckerKary(const mpint::MPInt&, const mpint::MPInt&, const size_t logK = 8);
 }
 
 } // namespace integer
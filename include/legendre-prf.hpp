@@ -0,0 +1,89 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#ifndef LEGENDRE_PRF_HPP
+#define LEGENDRE_PRF_HPP
+
+#include <cstdint>
+
+#include "mpint.hpp"
+#include "jacobi-batch.hpp"
+
+namespace integer {
+
+/*
+  Legendre PRF over a fixed odd prime p,
+  L_k(i) = 1 if ((k + i)/p) = -1, and 0 otherwise,
+  so that L_k(i) = 0 for k + i = 0 mod p.
+
+  Consecutive inputs k + i mod p are made by incrementing the digits
+  in place, and blocks of them are given to a JacobiBatch of p.
+  An object may be shared by threads.
+*/
+class LegendrePRF {
+public:
+  /*
+    Number of inputs given to the JacobiBatch at once.
+  */
+  static const size_t blockSize = 256;
+
+  /*
+    @require: p is an odd prime, only p odd and p > 1 is checked.
+  */
+  explicit LegendrePRF(const mpint::MPInt& p);
+
+  const mpint::MPInt& prime() const { return batch_.modulus(); }
+
+  /*
+    @return: L_k(i).
+  */
+  int bit(const mpint::MPInt& k, const uint64_t i) const;
+
+  /*
+    The bit j % 8 of out[j/8] is L_k(j) for 0 <= j < count,
+    and the rest of the last byte is 0.
+    The inputs are split among threads on byte boundaries.
+    @require: out has (count + 7)/8 bytes, 1 <= threads.
+  */
+  void evaluate(uint8_t* out, const mpint::MPInt& k, const uint64_t count, const size_t threads = 1) const;
+
+private:
+  LegendrePRF(const LegendrePRF&);
+  void operator=(const LegendrePRF&);
+
+  /*
+    evaluate of count inputs from k.
+  */
+  void evaluate_(uint8_t* out, const mpint::MPInt& k, const uint64_t count) const;
+
+  JacobiBatch batch_;
+};
+
+} // namespace integer
+
+#endif // LEGENDRE_PRF_HPP
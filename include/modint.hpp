@@ -0,0 +1,451 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#ifndef MODINT_HPP
+#define MODINT_HPP
+
+#include <cstdint>
+
+#include "mpint.hpp"
+#include "integer-util.hpp"
+
+namespace mpint {
+
+namespace impl {
+
+template<uint64_t D0, uint64_t... Ds>
+struct pack_at {
+  static constexpr uint64_t get(size_t i)
+  { return i == 0 ? D0 : pack_at<Ds...>::get(i - 1); }
+};
+
+template<uint64_t D0>
+struct pack_at<D0> {
+  static constexpr uint64_t get(size_t i)
+  { return i == 0 ? D0 : 0; }
+};
+
+template<size_t... I>
+struct index_seq {};
+
+template<size_t N, size_t... I>
+struct make_index_seq : make_index_seq<N - 1, N - 1, I...> {};
+
+template<size_t... I>
+struct make_index_seq<0, I...> { typedef index_seq<I...> type; };
+
+/*
+  N-digit value usable in constant expressions.
+*/
+template<size_t N>
+struct digits {
+  uint64_t v[N];
+};
+
+template<size_t N, class Modulus, size_t... I>
+constexpr digits<N> load_digits(index_seq<I...>)
+{ return digits<N>{{ Modulus::digit(I)... }}; }
+
+/*
+  @return: borrow into digit i of x - y.
+*/
+template<size_t N>
+constexpr bool borrow_at(const digits<N>& x, const digits<N>& y, size_t i)
+{
+  return i == 0 ? false
+    : (x.v[i - 1] < y.v[i - 1] || (x.v[i - 1] == y.v[i - 1] && borrow_at(x, y, i - 1)));
+}
+
+template<size_t N>
+constexpr bool less_than(const digits<N>& x, const digits<N>& y)
+{ return borrow_at(x, y, N); }
+
+template<size_t N, size_t... I>
+constexpr digits<N> sub_digits(const digits<N>& x, const digits<N>& y, index_seq<I...>)
+{ return digits<N>{{ (x.v[I] - y.v[I] - (borrow_at(x, y, I) ? 1 : 0))... }}; }
+
+template<size_t N>
+constexpr uint64_t shl1_at(const digits<N>& x, size_t i)
+{ return (x.v[i] << 1) | (i == 0 ? 0 : x.v[i - 1] >> 63); }
+
+template<size_t N, size_t... I>
+constexpr digits<N> shl1_digits(const digits<N>& x, index_seq<I...>)
+{ return digits<N>{{ shl1_at(x, I)... }}; }
+
+/*
+  t - m if c or t >= m, otherwise t.
+*/
+template<size_t N>
+constexpr digits<N> select_sub(const digits<N>& t, bool c, const digits<N>& m)
+{
+  return (c || ! less_than(t, m))
+    ? sub_digits(t, m, typename make_index_seq<N>::type()) : t;
+}
+
+/*
+  2x mod m.
+  @require: x < m.
+*/
+template<size_t N>
+constexpr digits<N> dbl_mod(const digits<N>& x, const digits<N>& m)
+{ return select_sub(shl1_digits(x, typename make_index_seq<N>::type()), (x.v[N - 1] >> 63) != 0, m); }
+
+/*
+  2^k x mod m.
+  @note: recursion depth is O(log k).
+*/
+template<size_t N>
+constexpr digits<N> dbl_mod_n(const digits<N>& x, const digits<N>& m, size_t k)
+{
+  return k == 0 ? x
+    : k == 1 ? dbl_mod(x, m)
+    : dbl_mod_n(dbl_mod_n(x, m, k/2), m, k - k/2);
+}
+
+template<size_t N, size_t... I>
+constexpr digits<N> one_digits(index_seq<I...>)
+{ return digits<N>{{ (I == 0 ? 1 : 0)... }}; }
+
+template<size_t N>
+constexpr bool greater_than_one(const digits<N>& x, size_t i = 1)
+{ return i == N ? x.v[0] > 1 : (x.v[i] != 0 || greater_than_one(x, i + 1)); }
+
+/*
+  f(0), f(1), ..., f(N - 1) are expanded at compile time.
+*/
+template<size_t I, size_t N>
+struct unroll {
+  template<class F>
+  __attribute__((always_inline)) static void run(F& f) { f(I); unroll<I + 1, N>::run(f); }
+};
+
+template<size_t N>
+struct unroll<N, N> {
+  template<class F>
+  static void run(F&) {}
+};
+
+} // namespace impl
+
+/*
+  Modulus for ModInt, digits are little endian.
+  e.g. Modulus<0xffffffffffffffff, 0xffffffff, 0, 0xffffffff00000001> is the NIST P-256 prime.
+*/
+template<uint64_t... D>
+struct Modulus {
+  static const size_t size = sizeof...(D);
+  static constexpr uint64_t digit(size_t i) { return impl::pack_at<D...>::get(i); }
+};
+
+/*
+  Integers modulo a modulus fixed at compile time, in N digits.
+
+  Values are kept in Montgomery form x*R mod m with R = 2^(64*N),
+  all constants are computed at compile time,
+  and loops of the arithmetic are unrolled for N.
+
+  @require: m is odd, m > 1 and m < R.
+*/
+template<size_t N, class Modulus_>
+class ModInt {
+public:
+  typedef MPInt::value_type value_type;
+  typedef MPInt::dvalue_type dvalue_type;
+  typedef impl::digits<N> digits_type;
+
+  static const size_t size = N;
+
+  static_assert(N > 0, "ModInt: N must be positive");
+  static_assert(Modulus_::size <= N, "ModInt: modulus does not fit in N digits");
+
+  static constexpr digits_type m_ = impl::load_digits<N, Modulus_>(typename impl::make_index_seq<N>::type());
+
+  static_assert((m_.v[0] & 1) == 1, "ModInt: modulus must be odd");
+  static_assert(impl::greater_than_one(m_), "ModInt: modulus must be greater than 1");
+
+  /*
+    rp = -m^(-1) mod 2^64.
+  */
+  static constexpr value_type rp_ = 0 - integer::impl::inverse64(m_.v[0]);
+
+  /*
+    R mod m and R^2 mod m.
+  */
+  static constexpr digits_type r1_ = impl::dbl_mod_n(impl::one_digits<N>(typename impl::make_index_seq<N>::type()), m_, 64*N);
+  static constexpr digits_type r2_ = impl::dbl_mod_n(r1_, m_, 64*N);
+
+  static_assert(rp_ * m_.v[0] == ~value_type(0), "ModInt: wrong rp");
+  static_assert(impl::less_than(r1_, m_) && impl::less_than(r2_, m_), "ModInt: wrong R mod m");
+
+  /*
+    Zero.
+  */
+  ModInt() : v_() {}
+
+  /*
+    x mod m, x may be negative.
+  */
+  explicit ModInt(const MPInt& x) : v_()
+  {
+    MPInt r;
+    MPInt::mod(r, x, modulus());
+    std::copy(r.get(), r.get() + r.size(), v_);
+    mul_(v_, v_, r2_.v);
+  }
+
+  static ModInt one()
+  {
+    ModInt z;
+    std::copy(r1_.v, r1_.v + N, z.v_);
+    return z;
+  }
+
+  static MPInt modulus()
+  {
+    MPInt m;
+    m.set(m_.v);
+    return m;
+  }
+
+  /*
+    z = x in [0, m).
+  */
+  void get(MPInt& z) const
+  {
+    value_type one[N] = { 1 }, t[N];
+    mul_(t, one, v_);
+    z.set(t);
+  }
+
+  /*
+    Digits in Montgomery form.
+  */
+  const value_type* raw() const { return v_; }
+
+  bool isZero() const
+  {
+    value_type t = 0;
+    auto f = [&](size_t i) { t |= v_[i]; };
+    impl::unroll<0, N>::run(f);
+    return t == 0;
+  }
+
+  static void add(ModInt& z, const ModInt& x, const ModInt& y) { add_(z.v_, x.v_, y.v_); }
+  static void sub(ModInt& z, const ModInt& x, const ModInt& y) { sub_(z.v_, x.v_, y.v_); }
+  static void mul(ModInt& z, const ModInt& x, const ModInt& y) { mul_(z.v_, x.v_, y.v_); }
+  static void sqr(ModInt& z, const ModInt& x) { sqr_(z.v_, x.v_); }
+
+  ModInt& operator+=(const ModInt& rhs) { add(*this, *this, rhs); return *this; }
+  ModInt& operator-=(const ModInt& rhs) { sub(*this, *this, rhs); return *this; }
+  ModInt& operator*=(const ModInt& rhs) { mul(*this, *this, rhs); return *this; }
+
+  friend ModInt operator+(const ModInt& x, const ModInt& y) { ModInt z; add(z, x, y); return z; }
+  friend ModInt operator-(const ModInt& x, const ModInt& y) { ModInt z; sub(z, x, y); return z; }
+  friend ModInt operator*(const ModInt& x, const ModInt& y) { ModInt z; mul(z, x, y); return z; }
+  ModInt operator-() const { ModInt z; sub(z, z, *this); return z; }
+
+  friend bool operator==(const ModInt& x, const ModInt& y)
+  {
+    value_type t = 0;
+    auto f = [&](size_t i) { t |= x.v_[i] ^ y.v_[i]; };
+    impl::unroll<0, N>::run(f);
+    return t == 0;
+  }
+
+  friend bool operator!=(const ModInt& x, const ModInt& y) { return ! (x == y); }
+
+private:
+  /*
+    z = t - m if c or t >= m, otherwise z = t.
+    @note: branch free.
+  */
+  static void cond_sub_(value_type* z, const value_type* t, const value_type c)
+  {
+    value_type s[N], b = 0;
+    auto f = [&](size_t i) {
+      const dvalue_type u = (dvalue_type)t[i] - m_.v[i] - b;
+      s[i] = (value_type)u;
+      b = (value_type)(u >> 64) & 1;
+    };
+    impl::unroll<0, N>::run(f);
+    const value_type mask = 0 - (c | (b ^ 1));
+    auto g = [&](size_t i) { z[i] = (s[i] & mask) | (t[i] & ~mask); };
+    impl::unroll<0, N>::run(g);
+  }
+
+  static void add_(value_type* z, const value_type* x, const value_type* y)
+  {
+    value_type t[N], c = 0;
+    auto f = [&](size_t i) {
+      const dvalue_type u = (dvalue_type)x[i] + y[i] + c;
+      t[i] = (value_type)u;
+      c = (value_type)(u >> 64);
+    };
+    impl::unroll<0, N>::run(f);
+    cond_sub_(z, t, c);
+  }
+
+  static void sub_(value_type* z, const value_type* x, const value_type* y)
+  {
+    value_type t[N], b = 0;
+    auto f = [&](size_t i) {
+      const dvalue_type u = (dvalue_type)x[i] - y[i] - b;
+      t[i] = (value_type)u;
+      b = (value_type)(u >> 64) & 1;
+    };
+    impl::unroll<0, N>::run(f);
+    const value_type mask = 0 - b;
+    value_type c = 0;
+    auto g = [&](size_t i) {
+      const dvalue_type u = (dvalue_type)t[i] + (m_.v[i] & mask) + c;
+      z[i] = (value_type)u;
+      c = (value_type)(u >> 64);
+    };
+    impl::unroll<0, N>::run(g);
+  }
+
+  /*
+    z = x*y/R mod m, CIOS.
+  */
+  static void mul_(value_type* z, const value_type* x, const value_type* y)
+  {
+    value_type t[N + 2] = {};
+    auto row = [&](size_t i) {
+      const value_type yi = y[i];
+      value_type c = 0;
+      auto f = [&](size_t j) {
+        const dvalue_type u = (dvalue_type)x[j]*yi + t[j] + c;
+        t[j] = (value_type)u;
+        c = (value_type)(u >> 64);
+      };
+      impl::unroll<0, N>::run(f);
+      dvalue_type u = (dvalue_type)t[N] + c;
+      t[N] = (value_type)u;
+      t[N + 1] = (value_type)(u >> 64);
+
+      const value_type q = t[0]*rp_;
+      u = (dvalue_type)q*m_.v[0] + t[0];
+      c = (value_type)(u >> 64);
+      auto g = [&](size_t j) {
+        if (j == 0) {
+          return;
+        }
+        const dvalue_type w = (dvalue_type)q*m_.v[j] + t[j] + c;
+        t[j - 1] = (value_type)w;
+        c = (value_type)(w >> 64);
+      };
+      impl::unroll<0, N>::run(g);
+      u = (dvalue_type)t[N] + c;
+      t[N - 1] = (value_type)u;
+      t[N] = t[N + 1] + (value_type)(u >> 64);
+    };
+    impl::unroll<0, N>::run(row);
+    cond_sub_(z, t, t[N]);
+  }
+
+  /*
+    z = x*x/R mod m.
+    Cross products are computed once and doubled, then reduced.
+
+    @note: for N > 4, 2N digits of t do not fit in registers
+    and CIOS mul_ is faster.
+  */
+  static void sqr_(value_type* z, const value_type* x)
+  {
+    if (N > 4) {
+      mul_(z, x, x);
+      return;
+    }
+
+    value_type t[N*2] = {};
+    auto row = [&](size_t i) {
+      value_type c = 0;
+      auto f = [&](size_t j) {
+        if (j <= i) {
+          return;
+        }
+        const dvalue_type u = (dvalue_type)x[i]*x[j] + t[i + j] + c;
+        t[i + j] = (value_type)u;
+        c = (value_type)(u >> 64);
+      };
+      impl::unroll<0, N>::run(f);
+      t[i + N] = c;
+    };
+    impl::unroll<0, N>::run(row);
+
+    // t = 2t + diagonal; 2t does not overflow since t < R^2/2.
+    value_type c = 0, hi = 0;
+    auto diag = [&](size_t i) {
+      const dvalue_type d = (dvalue_type)x[i]*x[i];
+      dvalue_type u = (dvalue_type)((t[i*2] << 1) | hi) + (value_type)d + c;
+      hi = t[i*2] >> 63;
+      t[i*2] = (value_type)u;
+      u = (dvalue_type)((t[i*2 + 1] << 1) | hi) + (value_type)(d >> 64) + (value_type)(u >> 64);
+      hi = t[i*2 + 1] >> 63;
+      t[i*2 + 1] = (value_type)u;
+      c = (value_type)(u >> 64);
+    };
+    impl::unroll<0, N>::run(diag);
+
+    // REDC, cc is the carry into t[i + N].
+    value_type cc = 0;
+    auto redc = [&](size_t i) {
+      const value_type q = t[i]*rp_;
+      value_type c1 = 0;
+      auto f = [&](size_t j) {
+        const dvalue_type u = (dvalue_type)q*m_.v[j] + t[i + j] + c1;
+        t[i + j] = (value_type)u;
+        c1 = (value_type)(u >> 64);
+      };
+      impl::unroll<0, N>::run(f);
+      const dvalue_type u = (dvalue_type)t[i + N] + c1 + cc;
+      t[i + N] = (value_type)u;
+      cc = (value_type)(u >> 64);
+    };
+    impl::unroll<0, N>::run(redc);
+    cond_sub_(z, t + N, cc);
+  }
+
+  value_type v_[N];
+};
+
+template<size_t N, class Modulus_>
+constexpr typename ModInt<N, Modulus_>::digits_type ModInt<N, Modulus_>::m_;
+
+template<size_t N, class Modulus_>
+constexpr typename ModInt<N, Modulus_>::value_type ModInt<N, Modulus_>::rp_;
+
+template<size_t N, class Modulus_>
+constexpr typename ModInt<N, Modulus_>::digits_type ModInt<N, Modulus_>::r1_;
+
+template<size_t N, class Modulus_>
+constexpr typename ModInt<N, Modulus_>::digits_type ModInt<N, Modulus_>::r2_;
+
+} // namespace mpint
+
+#endif // MODINT_HPP
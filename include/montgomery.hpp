@@ -0,0 +1,153 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+#ifndef MONTGOMERY_HPP
+#define MONTGOMERY_HPP
+
+#include <cstdint>
+
+#include "mpint.hpp"
+
+namespace mpint {
+
+/*
+  Montgomery arithmetic modulo a fixed odd MPInt m.
+
+  Let n = m.size() and R = 2^(64*n).
+  Values in Montgomery form (x*R mod m) are n-limb buffers,
+  i.e. the upper limbs are always stored even if they are zero.
+*/
+class MontgomeryContext {
+public:
+  typedef MPInt::value_type value_type;
+
+  /*
+    z = x*y/R mod m.
+
+    @require:
+    x < R, y < m.
+    z may be the same as x or y.
+  */
+  typedef void (*in_mont_op)(value_type* z, const value_type* x, const value_type* y, const value_type* p, const value_type rp, const size_t n);
+
+  /*
+    z = x*x/R mod m.
+
+    @require:
+    x < m.
+    z may be the same as x.
+  */
+  typedef void (*in_mont_sqr_op)(value_type* z, const value_type* x, const value_type* p, const value_type rp, const size_t n);
+
+  /*
+    Largest number of limbs which has the JIT generated kernels,
+    i.e. up to 4096 bit moduli.
+  */
+  static const size_t maxCodeSize = 64;
+
+  /*
+    @require: m is odd and m > 1.
+  */
+  explicit MontgomeryContext(const MPInt& m);
+
+  size_t size() const { return n_; }
+  const value_type* modulus() const { return p_.get(); }
+
+  /*
+    rp = -m^(-1) mod 2^64.
+  */
+  value_type rp() const { return rp_; }
+
+  /*
+    Montgomery form of 1, i.e. R mod m.
+  */
+  const value_type* one() const { return r1_.get(); }
+
+  /*
+    R^2 mod m.
+  */
+  const value_type* R2() const { return r2_.get(); }
+
+  void mul(value_type* z, const value_type* x, const value_type* y) const
+  { in_mul_(z, x, y, p_.get(), rp_, n_); }
+
+  void sqr(value_type* z, const value_type* x) const
+  { in_sqr_(z, x, p_.get(), rp_, n_); }
+
+  /*
+    z = x + y mod m, z = x - y mod m.
+    @note: these are same in both forms.
+  */
+  void add(value_type* z, const value_type* x, const value_type* y) const;
+  void sub(value_type* z, const value_type* x, const value_type* y) const;
+
+  /*
+    z = x*R mod m.
+    @require: 0 <= x < R.
+  */
+  void toMont(value_type* z, const MPInt& x) const;
+
+  /*
+    z = x/R mod m.
+  */
+  void fromMont(MPInt& z, const value_type* x) const;
+
+  /*
+    MPInt interfaces, convenient but not fast.
+  */
+  void toMont(MPInt& z, const MPInt& x) const;
+  void fromMont(MPInt& z, const MPInt& x) const;
+  void mul(MPInt& z, const MPInt& x, const MPInt& y) const;
+  void sqr(MPInt& z, const MPInt& x) const;
+
+  /*
+    Select kernels for contexts constructed after this call.
+    -1: JIT generated kernels (fully unrolled for each limb count),
+     0: emulated kernels.
+  */
+  static void codeGen(const int version = -1);
+
+private:
+  MontgomeryContext(const MontgomeryContext&);
+  void operator=(const MontgomeryContext&);
+
+  void load_(value_type* z, const MPInt& x) const;
+
+  size_t n_;
+  value_type rp_;
+  MPInt::buffer_ptr p_;
+  MPInt::buffer_ptr r1_;
+  MPInt::buffer_ptr r2_;
+  in_mont_op in_mul_;
+  in_mont_sqr_op in_sqr_;
+
+  static int version_;
+};
+
+} // namespace mpint
+
+#endif // MONTGOMERY_HPP
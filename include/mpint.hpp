@@ -3,7 +3,9 @@
 #ifndef MPINT_HPP
 #define MPINT_HPP
 
+#include <cassert>
 #include <cstdint>
+#include <stdexcept>
 #include <vector>
 #include <iomanip>
 #include <string>
@@ -67,21 +69,21 @@ struct addsubmul
   inline T& operator+=(const T& rhs)
   {
     T& ref = static_cast<T&>(*this);
-    T::add(ref, ref, static_cast<T&>(rhs));
+    T::add(ref, ref, rhs);
     return ref;
   }
 
   inline T& operator-=(const T& rhs)
   {
     T& ref = static_cast<T&>(*this);
-    T::sub(ref, ref, static_cast<T&>(rhs));
+    T::sub(ref, ref, rhs);
     return ref;
   }
 
   inline T& operator*=(const T& rhs)
   {
     T& ref = static_cast<T&>(*this);
-    T::mul(ref, ref, static_cast<T&>(rhs));
+    T::mul(ref, ref, rhs);
     return ref;
   }
 };
@@ -108,6 +110,7 @@ public:
   typedef int sign_t;
 
   typedef uint64_t value_type;
+  __extension__ typedef unsigned __int128 dvalue_type;
   typedef std::unique_ptr<value_type[]> buffer_ptr;
   //typedef std::unique_ptr<ALIGN_(16) value_type[]> buffer_ptr;
 
@@ -521,6 +524,113 @@ public:
   */
   static void sub(MPInt& z, const MPInt& in_x, const MPInt& in_y);
 
+  /*
+    z = x + y
+  */
+  static void add(MPInt& z, const MPInt& x, const MPInt& y);
+
+  /*
+    z = x * y
+  */
+  static void mul(MPInt& z, const MPInt& x, const MPInt& y);
+
+  /*
+    q = x / y, r = x - q*y.
+    q is rounded toward zero, so r has the same sign as x.
+    @note: q and r must be different objects.
+  */
+  static void divmod(MPInt& q, MPInt& r, const MPInt& x, const MPInt& y);
+
+  /*
+    r = x mod |y|, i.e. 0 <= r < |y|.
+  */
+  static void mod(MPInt& r, const MPInt& x, const MPInt& y);
+
+  static void shl(MPInt& z, const MPInt& x, const size_t n);
+
+  /*
+    Set size from digits in [0, n).
+  */
+  void normalize(size_t n, bool setNegative = false)
+  {
+    while (n > 0 && d_ptr_[n - 1] == 0) {
+      --n;
+    }
+    sign_size_ = setNegative ? -(sign_size_t)n : (sign_size_t)n;
+  }
+
+  /*
+    Low level functions on digit arrays.
+    Digits are little endian, and sizes are given by the number of digits.
+  */
+
+  /*
+    z[0..n) = x[0..n) + y[0..n).
+    @return: carry.
+  */
+  static value_type add_n(value_type* z, const value_type* x, const value_type* y, const size_t n);
+
+  /*
+    z[0..n) = x[0..n) + y.
+    @return: carry.
+  */
+  static value_type add_1(value_type* z, const value_type* x, const size_t n, const value_type y);
+
+  /*
+    z[0..n) = x[0..n) - y[0..n).
+    @return: borrow.
+  */
+  static value_type sub_n(value_type* z, const value_type* x, const value_type* y, const size_t n);
+
+  /*
+    z[0..n) = x[0..n) - y.
+    @return: borrow.
+  */
+  static value_type sub_1(value_type* z, const value_type* x, const size_t n, const value_type y);
+
+  /*
+    z[0..n) = x[0..n) * y.
+    @return: most significant digit.
+  */
+  static value_type mul_1(value_type* z, const value_type* x, const size_t n, const value_type y);
+
+  /*
+    z[0..n) += x[0..n) * y.
+    @return: carry digit.
+  */
+  static value_type addmul_1(value_type* z, const value_type* x, const size_t n, const value_type y);
+
+  /*
+    z[0..n) -= x[0..n) * y.
+    @return: borrow digit.
+  */
+  static value_type submul_1(value_type* z, const value_type* x, const size_t n, const value_type y);
+
+  /*
+    z[0..xn+yn) = x * y.
+    @require: xn >= yn > 0, z does not overlap x and y.
+  */
+  static void mul_n(value_type* z, const value_type* x, const size_t xn, const value_type* y, const size_t yn);
+
+  /*
+    q[0..n) = x / y if q is not null.
+    @return: x mod y.
+    @require: y != 0.
+  */
+  static value_type divrem_1(value_type* q, const value_type* x, const size_t n, const value_type y);
+
+  /*
+    q[0..xn-yn] = x / y if q is not null, r[0..yn) = x mod y.
+    @require: xn >= yn > 0, y[yn - 1] != 0,
+    q and r do not overlap x and y.
+  */
+  static void divrem_n(value_type* q, value_type* r, const value_type* x, const size_t xn, const value_type* y, const size_t yn);
+
+  /*
+    @return: sign of x[0..n) - y[0..n).
+  */
+  static sign_t cmp_n(const value_type* x, const value_type* y, const size_t n);
+
   /*
     Call code generator.
   */
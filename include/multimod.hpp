@@ -0,0 +1,94 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#ifndef MULTIMOD_HPP
+#define MULTIMOD_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "mpint.hpp"
+
+namespace integer {
+
+/*
+  x mod p for many small odd moduli p at once, e.g. a factor base.
+
+  The digits of x are read once from the top, and the residues of all
+  moduli are updated for each 16 bit chunk by a Barrett reduction
+  in 32 bit lanes, 8 moduli in one AVX2 register if the CPU has it.
+  An object is used by one thread at a time.
+*/
+class MultiModulus {
+public:
+  /*
+    @require: each modulus is odd, 3 <= p < 2^16.
+  */
+  explicit MultiModulus(const std::vector<uint32_t>& moduli);
+
+  size_t size() const { return k_; }
+  const uint32_t* moduli() const { return p_.data(); }
+
+  /*
+    r[i] = x mod p_i, 0 <= r[i] < p_i for negative x too.
+  */
+  void residues(uint32_t* r, const mpint::MPInt& x) const;
+
+  /*
+    s[i] = (x/p_i) by kronecker(int64_t, int64_t) of the residues,
+    the Legendre symbols if p_i are primes.
+  */
+  void kronecker(int* s, const mpint::MPInt& x) const;
+
+  /*
+    Select the kernel for objects constructed after this call.
+    -1: AVX2 if the CPU supports it,
+     0: portable C++.
+  */
+  static void codeGen(const int version = -1);
+
+  typedef void (*residues_op)(uint32_t* r, const mpint::MPInt::value_type* x, const size_t n, const uint32_t* p, const uint32_t* m, const size_t k);
+
+private:
+  MultiModulus(const MultiModulus&);
+  void operator=(const MultiModulus&);
+
+  size_t k_;
+  // padded to a multiple of 8 by 3.
+  std::vector<uint32_t> p_;
+  // floor(2^32 / p).
+  std::vector<uint32_t> m_;
+  mutable std::vector<uint32_t> work_;
+  residues_op residues_;
+
+  static int version_;
+};
+
+} // namespace integer
+
+#endif // MULTIMOD_HPP
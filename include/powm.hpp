@@ -0,0 +1,237 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#ifndef POWM_HPP
+#define POWM_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "mpint.hpp"
+#include "montgomery.hpp"
+
+namespace mpint {
+
+/*
+  Left-to-right sliding window exponentiation on a MontgomeryContext.
+
+  Odd powers x, x^3, ..., x^(2^w - 1) are kept in one contiguous
+  cache aligned buffer, which is allocated when the object is constructed
+  (or when a larger window is needed), so no memory is allocated while
+  exponentiating.
+  An object is used by one thread at a time, a context can be shared.
+*/
+class MontgomeryPowm {
+public:
+  typedef MPInt::value_type value_type;
+
+  static const size_t maxWindow = 10;
+
+  /*
+    @require: window <= maxWindow.
+    @note: window == 0 selects the window size from the exponent size in each call.
+  */
+  explicit MontgomeryPowm(const MontgomeryContext& ctx, const size_t window = 0);
+
+  const MontgomeryContext& context() const { return ctx_; }
+
+  /*
+    z = x^e, x and z are in Montgomery form.
+
+    @require:
+    x < m, n digits.
+    e has en digits, upper zero digits are allowed.
+    z may be the same as x.
+  */
+  void pow(value_type* z, const value_type* x, const value_type* e, const size_t en);
+
+  /*
+    z = x^e mod m, x may be any integer.
+    @require: e >= 0.
+  */
+  void pow(MPInt& z, const MPInt& x, const MPInt& e);
+
+  /*
+    Window size for an exponent of the given bits.
+  */
+  static size_t window(const size_t bits);
+
+private:
+  MontgomeryPowm(const MontgomeryPowm&);
+  void operator=(const MontgomeryPowm&);
+
+  void reserve_(const size_t w);
+
+  const MontgomeryContext& ctx_;
+  size_t window_;
+  size_t reserved_;
+  std::vector<value_type> buf_;
+  value_type* table_;
+  value_type* t_;
+};
+
+/*
+  Fixed base exponentiation by the Lim-Lee comb method.
+
+  An exponent of up to maxBits bits is split into h rows of a = ceil(maxBits/h) bits,
+  and each row into v blocks of b = ceil(a/v) bits.
+  The table holds g^(sum of 2^(i*a + j*b) for i in u) for each block j
+  and non-empty row set u, i.e. v*(2^h - 1) entries,
+  and pow() takes b - 1 squarings and at most v*b multiplications.
+  h and v are chosen to minimize the cost within the memory budget.
+
+  The table is not modified after construction, so an object can be
+  shared by threads.
+*/
+class FixedBasePowm {
+public:
+  typedef MPInt::value_type value_type;
+
+  static const size_t defaultBudget = 1 << 20;
+  static const size_t maxTeeth = 16;
+
+  /*
+    @require: 0 < maxBits.
+    @note: budget is in bytes, at least one entry is always allocated.
+  */
+  FixedBasePowm(const MontgomeryContext& ctx, const MPInt& g, const size_t maxBits, const size_t budget = defaultBudget);
+
+  const MontgomeryContext& context() const { return ctx_; }
+  size_t maxBits() const { return maxBits_; }
+  size_t teeth() const { return h_; }
+  size_t blocks() const { return v_; }
+  size_t tableBytes() const { return table_.size()*sizeof(value_type); }
+
+  /*
+    z = g^e in Montgomery form.
+
+    @require: e has en digits, upper zero digits are allowed.
+    @note: exponents longer than maxBits fall back to MontgomeryPowm.
+  */
+  void pow(value_type* z, const value_type* e, const size_t en) const;
+
+  /*
+    z = g^e mod m.
+    @require: e >= 0.
+  */
+  void pow(MPInt& z, const MPInt& e) const;
+
+private:
+  FixedBasePowm(const FixedBasePowm&);
+  void operator=(const FixedBasePowm&);
+
+  const MontgomeryContext& ctx_;
+  size_t maxBits_;
+  size_t h_;
+  size_t v_;
+  size_t a_;
+  size_t b_;
+  std::vector<value_type> g_;
+  std::vector<value_type> table_;
+};
+
+/*
+  Simultaneous exponentiation z = x[0]^e[0] * ... * x[k-1]^e[k-1] on a MontgomeryContext.
+
+  Straus: one sliding window table for each base, and the squarings are shared.
+  Pippenger: digits of c bits are collected into 2^c - 1 buckets for each
+  window, and the buckets are combined by running products.
+  Auto selects the method with smaller estimated cost from k and the exponent size.
+
+  Scratch buffers are kept in the object and only grow,
+  an object is used by one thread at a time.
+*/
+class MultiPowm {
+public:
+  typedef MPInt::value_type value_type;
+
+  enum Method {
+    Auto,
+    Straus,
+    Pippenger
+  };
+
+  explicit MultiPowm(const MontgomeryContext& ctx);
+
+  const MontgomeryContext& context() const { return ctx_; }
+
+  /*
+    z = prod x[i]^e[i] in Montgomery form.
+
+    @require:
+    x[i] < m, n digits.
+    e[i] has en[i] digits, upper zero digits are allowed.
+    z is not any of x[i].
+  */
+  void pow(value_type* z, const value_type* const* x, const value_type* const* e, const size_t* en,
+           const size_t k, const Method method = Auto);
+
+  /*
+    z = prod x[i]^e[i] mod m, x[i] may be any integer.
+    @require: x.size() == e.size(), e[i] >= 0.
+  */
+  void pow(MPInt& z, const std::vector<MPInt>& x, const std::vector<MPInt>& e, const Method method = Auto);
+
+  /*
+    Method selected by Auto for k exponents of the given bits.
+  */
+  static Method select(const size_t k, const size_t bits);
+
+private:
+  MultiPowm(const MultiPowm&);
+  void operator=(const MultiPowm&);
+
+  void straus_(value_type* z, const value_type* const* x, const value_type* const* e, const size_t* en,
+               const size_t k, const size_t bits);
+  void pippenger_(value_type* z, const value_type* const* x, const value_type* const* e, const size_t* en,
+                  const size_t k, const size_t bits);
+
+  const MontgomeryContext& ctx_;
+  std::vector<value_type> table_;
+  std::vector<uint16_t> digits_;
+};
+
+/*
+  z = prod g[i]^e[i] mod mod.
+  @require: g.size() == e.size(), e[i] >= 0, mod > 0.
+*/
+void multiPowm(MPInt& z, const std::vector<MPInt>& g, const std::vector<MPInt>& e, const MPInt& mod);
+
+/*
+  z = base^exp mod mod.
+
+  @require: exp >= 0, mod > 0.
+  @return: z in [0, mod).
+  @note: Montgomery form is used for odd mod, Barrett reduction for even mod.
+  window == 0 selects the window size from the exponent size.
+*/
+void powm(MPInt& z, const MPInt& base, const MPInt& exp, const MPInt& mod, const size_t window = 0);
+
+} // namespace mpint
+
+#endif // POWM_HPP
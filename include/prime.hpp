@@ -0,0 +1,79 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#ifndef PRIME_HPP
+#define PRIME_HPP
+
+#include <cstdint>
+
+#include "mpint.hpp"
+
+namespace integer {
+
+namespace impl {
+
+/*
+  Odd primes less than smallPrimeBound are tried by division
+  before the probable prime tests.
+*/
+const uint32_t smallPrimeBound = 1000;
+
+/*
+  Strong probable prime test to base a (Miller-Rabin),
+  a^d = 1 or a^(d 2^r) = -1 mod n for some r < s, where n - 1 = d 2^s.
+  The powers are computed by MontgomeryPowm.
+  @require: n is odd and n > 1.
+*/
+bool isStrongProbablePrime(const mpint::MPInt& n, const mpint::MPInt& a);
+
+/*
+  Strong Lucas probable prime test with Selfridge's parameters,
+  D is the first of 5, -7, 9, -11, ... with (D/n) = -1 by impl::kronecker,
+  P = 1 and Q = (1 - D)/4.
+  U_d = 0 or V_(d 2^r) = 0 mod n for some r < s, where n + 1 = d 2^s.
+  The Lucas chain of V_k is computed in Montgomery form.
+  @require: n is odd and n > 1.
+  @return: false if n is a perfect square.
+*/
+bool isStrongLucasProbablePrime(const mpint::MPInt& n);
+
+/*
+  Baillie-PSW probable prime test of |n|:
+  trial division, isStrongProbablePrime to base 2
+  and isStrongLucasProbablePrime.
+  @return: false if |n| is composite, true if |n| is a prime,
+  or a BPSW pseudoprime which is not known to exist.
+  The result is exact for |n| < 2^64.
+*/
+bool isProbablePrime(const mpint::MPInt& n);
+
+} // namespace impl
+
+} // namespace integer
+
+#endif // PRIME_HPP
@@ -0,0 +1,126 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#ifndef PRIMEGEN_HPP
+#define PRIMEGEN_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "mpint.hpp"
+#include "multimod.hpp"
+
+namespace integer {
+
+/*
+  Random prime generation in two stages.
+
+  The sieve stage draws a random odd base x and sieves the odd numbers
+  x, x + 2, ..., x + 2(segments*segmentBits - 1) by the odd primes
+  below sieveLimit, one bit-packed segment of segmentBits numbers at a time.
+  The residues x mod p come from MultiModulus, and the next multiple of p
+  is carried from a segment to the next one.
+  The test stage runs impl::isStrongProbablePrime to base 2 and
+  impl::isStrongLucasProbablePrime on the survivors.
+
+  With threads == 1 both stages run in the calling thread and the result
+  depends only on the seed.
+  Otherwise the calling thread sieves and threads workers test batches
+  of survivors from a bounded queue, so the order of the primes may vary.
+  An object is used by one thread at a time.
+*/
+class PrimeGenerator {
+public:
+  struct Stats {
+    // odd numbers sieved, survivors tested, and primes found.
+    size_t candidates;
+    size_t tested;
+    size_t primes;
+    size_t threads;
+    double seconds;
+
+    double primesPerSecondPerCore() const
+    { return seconds > 0 ? (double)primes / seconds / (double)threads : 0; }
+  };
+
+  /*
+    4 KiB of bits fit in L1 with the residues.
+  */
+  static const size_t defaultSegmentBits = 1 << 15;
+  static const size_t defaultSegments = 4;
+
+  /*
+    @require:
+    32 <= bits, 1 <= threads, 3 <= sieveLimit <= 2^16,
+    segmentBits is a positive multiple of 64, 1 <= segments.
+  */
+  explicit PrimeGenerator(const size_t bits, const size_t threads = 1, const uint32_t sieveLimit = 1 << 16,
+                          const size_t segmentBits = defaultSegmentBits, const size_t segments = defaultSegments);
+
+  size_t bits() const { return bits_; }
+  size_t threads() const { return threads_; }
+
+  /*
+    Odd primes used by the sieve.
+  */
+  const std::vector<uint32_t>& sievePrimes() const { return primes_; }
+
+  /*
+    Append count probable primes of exactly bits bits to primes.
+  */
+  void generate(std::vector<mpint::MPInt>& primes, const size_t count, const uint64_t seed);
+
+  /*
+    Statistics of the last generate().
+  */
+  const Stats& stats() const { return stats_; }
+
+private:
+  PrimeGenerator(const PrimeGenerator&);
+  void operator=(const PrimeGenerator&);
+
+  template<class F>
+  void sieve_(const mpint::MPInt& base, F& survivor);
+
+  size_t bits_;
+  size_t threads_;
+  size_t segmentBits_;
+  size_t segments_;
+  std::vector<uint32_t> primes_;
+  // 2^(-1) mod p, i.e. (p + 1)/2.
+  std::vector<uint32_t> half_;
+  MultiModulus mm_;
+  // index of the next multiple of p in the current segment.
+  std::vector<uint32_t> next_;
+  std::vector<uint64_t> segment_;
+  Stats stats_;
+};
+
+} // namespace integer
+
+#endif // PRIMEGEN_HPP
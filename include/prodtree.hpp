@@ -0,0 +1,103 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#ifndef PRODTREE_HPP
+#define PRODTREE_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "mpint.hpp"
+
+namespace mpint {
+
+/*
+  Product tree of moduli m_0, ..., m_{k-1} and the remainder tree on it,
+  which gives x mod m_i for all i in quasi-linear time.
+
+  The node at level l + 1 is the product of two nodes at level l,
+  the last node of a level with odd length is carried up as it is.
+  All the nodes, and floor(B^(2n)/v) of each node v with n digits
+  for the Barrett reduction, are kept in one arena, B = 2^64.
+  Nodes of a level are computed in parallel by threads.
+  An object is used by one thread at a time.
+*/
+class ProductTree {
+public:
+  typedef MPInt::value_type value_type;
+
+  /*
+    Nodes with less digits are reduced by the schoolbook division.
+  */
+  static const size_t barrettThreshold = 16;
+
+  /*
+    @require: moduli is not empty, each of them is positive.
+  */
+  explicit ProductTree(const std::vector<MPInt>& moduli, const size_t threads = 1);
+
+  size_t size() const { return level_[1]; }
+  size_t depth() const { return level_.size() - 1; }
+
+  /*
+    z = m_0 * ... * m_{k-1}.
+  */
+  void product(MPInt& z) const;
+
+  /*
+    r[i] = x mod m_i, 0 <= r[i] < m_i for negative x too.
+  */
+  void remainders(std::vector<MPInt>& r, const MPInt& x, const size_t threads = 1);
+
+private:
+  ProductTree(const ProductTree&);
+  void operator=(const ProductTree&);
+
+  struct Node {
+    // the value at arena_[off, off + n), and its capacity.
+    size_t off, n, cap;
+    // the reciprocal at arena_[muOff, muOff + n + 2) if n >= barrettThreshold.
+    size_t muOff;
+  };
+
+  /*
+    r = u mod node, r has node.n digits.
+  */
+  void reduce_(value_type* r, const value_type* u, const size_t un, const Node& node, std::vector<value_type>& tmp) const;
+
+  std::vector<Node> node_;
+  // nodes of the level l are node_[level_[l], level_[l + 1]).
+  std::vector<size_t> level_;
+  std::vector<value_type> arena_;
+  // remainders, with the same offsets as the nodes.
+  std::vector<value_type> work_;
+};
+
+} // namespace mpint
+
+#endif // PRODTREE_HPP
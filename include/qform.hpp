@@ -0,0 +1,161 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#ifndef QFORM_HPP
+#define QFORM_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "mpint.hpp"
+
+namespace integer {
+
+/*
+  Binary quadratic form a x^2 + b x y + c y^2.
+*/
+struct QuadraticForm {
+  mpint::MPInt a;
+  mpint::MPInt b;
+  mpint::MPInt c;
+
+  QuadraticForm() : a(), b(), c() {}
+  QuadraticForm(const mpint::MPInt& a_, const mpint::MPInt& b_, const mpint::MPInt& c_)
+    : a(a_), b(b_), c(c_) {}
+
+  bool operator==(const QuadraticForm& x) const
+  { return a == x.a && b == x.b && c == x.c; }
+  bool operator!=(const QuadraticForm& x) const
+  { return ! (*this == x); }
+
+  /*
+    @return: b^2 - 4ac.
+  */
+  mpint::MPInt discriminant() const;
+
+  /*
+    @return: whether |b| <= a <= c, and b >= 0 if |b| = a or a = c.
+  */
+  bool isReduced() const;
+
+  std::string toString() const;
+
+  friend std::ostream& operator<<(std::ostream& os, const QuadraticForm& f)
+  {
+    return os << f.toString();
+  }
+};
+
+/*
+  Form class group of a negative discriminant D.
+
+  Forms are primitive and positive definite of discriminant D,
+  and results are always reduced, so that equal classes are equal forms.
+  compose and square are Shanks' NUCOMP and NUDUPL,
+  the composite is reduced halfway by a partial extended Euclid
+  with Lehmer steps before it is made, which keeps the operands
+  about |D|^(1/2) instead of |D|.
+*/
+class ClassGroup {
+public:
+  /*
+    @require: D < 0, D = 0, 1 mod 4.
+  */
+  explicit ClassGroup(const mpint::MPInt& D);
+
+  const mpint::MPInt& discriminant() const { return D_; }
+
+  /*
+    floor(|D/4|^(1/4)), where the partial reduction stops.
+  */
+  const mpint::MPInt& bound() const { return L_; }
+
+  /*
+    (1, b, c) with b = D mod 2.
+  */
+  QuadraticForm identity() const;
+
+  /*
+    Reduced form of (p, b, c) with b^2 = D mod 4p.
+    @require: p is a prime.
+    @return: false if (D/p) = -1 or the form is not primitive,
+    i.e. p^2 divides D, f is not modified then.
+  */
+  bool primeForm(QuadraticForm& f, const uint32_t p) const;
+
+  /*
+    @return: whether f is a positive definite form of discriminant D.
+  */
+  bool isForm(const QuadraticForm& f) const;
+
+  /*
+    Reduce f in place by the normalization and (a, b, c) -> (c, -b, a).
+    @require: f is positive definite.
+  */
+  static void reduce(QuadraticForm& f);
+
+  /*
+    z = x^(-1), i.e. (a, -b, c) reduced.
+  */
+  void inverse(QuadraticForm& z, const QuadraticForm& x) const;
+
+  /*
+    z = x y by NUCOMP.
+    @require: x and y are primitive forms of discriminant D.
+    z may be the same as x or y.
+  */
+  void compose(QuadraticForm& z, const QuadraticForm& x, const QuadraticForm& y) const;
+
+  /*
+    z = x^2 by NUDUPL.
+    @require: same as compose.
+  */
+  void square(QuadraticForm& z, const QuadraticForm& x) const;
+
+  /*
+    z = x^e by left-to-right squaring, x^(-e) is (x^(-1))^e.
+    @require: same as compose.
+  */
+  void pow(QuadraticForm& z, const QuadraticForm& x, const mpint::MPInt& e) const;
+
+  /*
+    z = x y by Gauss-Shanks composition followed by a full reduction,
+    for tests and benchmarks.
+    @require: same as compose.
+  */
+  void composeClassic(QuadraticForm& z, const QuadraticForm& x, const QuadraticForm& y) const;
+
+private:
+  mpint::MPInt D_;
+  mpint::MPInt L_;
+};
+
+} // namespace integer
+
+#endif // QFORM_HPP
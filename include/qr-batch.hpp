@@ -0,0 +1,118 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#ifndef QR_BATCH_HPP
+#define QR_BATCH_HPP
+
+#include <cstdint>
+#include <memory>
+
+#include "mpint.hpp"
+#include "jacobi-batch.hpp"
+
+namespace integer {
+
+/*
+  Quadratic residuosity of many ciphertexts modulo a fixed N = p q,
+  as in the decryption of Goldwasser-Micali.
+
+  Without the factors, only the Jacobi symbols modulo N are given.
+  With the factors, a ciphertext is reduced modulo p and q by Barrett
+  reduction and (c/p), (c/q) are computed by JacobiBatch of half size,
+  and the bit of c is 1 iff (c/p) = -1, where p is the larger factor.
+  Ciphertexts are read as digits and nothing is allocated for each one.
+  An object may be shared by threads.
+*/
+class QRBatch {
+public:
+  typedef mpint::MPInt::value_type value_type;
+
+  /*
+    Number of ciphertexts reduced at once.
+  */
+  static const size_t blockSize = 256;
+
+  /*
+    Public N only.
+    @require: N is odd and N > 1.
+  */
+  explicit QRBatch(const mpint::MPInt& N);
+
+  /*
+    N = p q with the secret factors.
+    @require: p, q are distinct odd primes, only p, q odd, > 1 and p != q
+    are checked.
+  */
+  QRBatch(const mpint::MPInt& p, const mpint::MPInt& q);
+
+  ~QRBatch();
+
+  const mpint::MPInt& modulus() const { return batch_.modulus(); }
+
+  /*
+    Number of digits of each ciphertext.
+  */
+  size_t size() const { return batch_.size(); }
+
+  bool hasFactors() const { return p_.get() != 0; }
+
+  /*
+    s[i] = (c_i/N) in {-1, 0, 1}.
+    @require: c has count*size() digits, c_i is the i-th size() digits,
+    0 <= c_i < N, 1 <= threads.
+  */
+  void jacobi(int8_t* s, const value_type* c, const size_t count, const size_t threads = 1) const;
+
+  /*
+    The bit i % 8 of out[i/8] is 1 iff (c_i/p) = -1 for 0 <= i < count,
+    and the rest of the last byte is 0.
+    @require: hasFactors(), out has (count + 7)/8 bytes,
+    the other requirements are same as jacobi().
+  */
+  void decrypt(uint8_t* out, const value_type* c, const size_t count, const size_t threads = 1) const;
+
+private:
+  QRBatch(const QRBatch&);
+  void operator=(const QRBatch&);
+
+  /*
+    Reduction and symbols modulo one factor.
+  */
+  struct Factor;
+
+  void jacobi_(int8_t* s, const value_type* c, const size_t count) const;
+  void decrypt_(uint8_t* out, const value_type* c, const size_t count) const;
+
+  JacobiBatch batch_;
+  std::unique_ptr<const Factor> p_;
+  std::unique_ptr<const Factor> q_;
+};
+
+} // namespace integer
+
+#endif // QR_BATCH_HPP
@@ -0,0 +1,145 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#ifndef QRCACHE_HPP
+#define QRCACHE_HPP
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "mpint.hpp"
+
+namespace integer {
+
+/*
+  Quadratic residuosity bitmap of an odd prime p < 2^16,
+  the bit r is set iff r is a non-zero square modulo p.
+
+  A bitmap is not modified after the construction,
+  so it is read by many threads without locks.
+*/
+class QRBitmap {
+public:
+  /*
+    @require: p is an odd prime, p < 2^16.
+  */
+  explicit QRBitmap(const uint32_t p);
+
+  uint32_t prime() const { return p_; }
+
+  /*
+    Size of the bitmap in bytes.
+  */
+  size_t bytes() const { return bits_.size() * sizeof(uint64_t); }
+
+  /*
+    Legendre symbol (r/p).
+    @require: 0 <= r < p.
+  */
+  int legendre(const uint32_t r) const
+  {
+    if (r == 0) {
+      return 0;
+    }
+    return (bits_[r >> 6] >> (r & 63)) & 0x1 ? 1 : -1;
+  }
+
+  /*
+    Kronecker symbol (x/p), which is the Legendre symbol.
+  */
+  int kronecker(const int64_t x) const;
+  int kronecker(const mpint::MPInt& x) const;
+
+private:
+  QRBitmap(const QRBitmap&);
+  void operator=(const QRBitmap&);
+
+  uint32_t p_;
+  std::vector<uint64_t> bits_;
+};
+
+/*
+  Cache of QRBitmap, which are built when they are used first.
+
+  The total size of bitmaps is bounded by maxBytes,
+  the least recently used ones are dropped beyond it.
+  A bitmap_ptr stays valid after it is dropped from the cache.
+  get takes a lock shared by all threads, so the symbols are taken from
+  a held bitmap_ptr, which needs no lock, instead of calling get for each value.
+*/
+class QRCache {
+public:
+  typedef std::shared_ptr<const QRBitmap> bitmap_ptr;
+
+  /*
+    8 KiB for each prime close to 2^16.
+  */
+  static const size_t defaultMaxBytes = 1 << 20;
+
+  explicit QRCache(const size_t maxBytes = defaultMaxBytes);
+
+  /*
+    @require: p is an odd prime, p < 2^16.
+  */
+  bitmap_ptr get(const uint32_t p);
+
+  /*
+    Number of cached bitmaps and their total size in bytes.
+  */
+  size_t size() const;
+  size_t bytes() const;
+  size_t maxBytes() const { return maxBytes_; }
+
+  void clear();
+
+  /*
+    The cache shared in the process.
+  */
+  static QRCache& shared();
+
+private:
+  QRCache(const QRCache&);
+  void operator=(const QRCache&);
+
+  typedef std::list<bitmap_ptr> lru_type;
+
+  const size_t maxBytes_;
+  mutable std::mutex mutex_;
+  size_t bytes_;
+  // the most recently used one is the front.
+  lru_type lru_;
+  std::unordered_map<uint32_t, lru_type::iterator> index_;
+};
+
+} // namespace integer
+
+#endif // QRCACHE_HPP
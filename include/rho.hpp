@@ -0,0 +1,81 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#ifndef RHO_HPP
+#define RHO_HPP
+
+#include <atomic>
+#include <cstdint>
+
+#include "mpint.hpp"
+
+namespace integer {
+
+namespace impl {
+
+/*
+  Steps of a rho sequence between two gcds, tuned by bench/factor.
+  The differences of a batch are multiplied in Montgomery form,
+  and the batch is walked again one gcd per step when the gcd is n.
+*/
+extern size_t rhoBatchSize;
+
+/*
+  Default number of steps of one sequence.
+*/
+const uint64_t rhoMaxSteps = (uint64_t)1 << 26;
+
+/*
+  Pollard rho with Brent's cycle detection on x -> x^2 + c mod n
+  from x = x0, by MontgomeryContext arithmetic.
+  The sequence stops when cancel is set, which is checked once per
+  rhoBatchSize steps, while y runs ahead as well as in the batches.
+  @require: n is odd and n > 1, 0 < c < n - 2, x0 < n.
+  @return: false if d is not a proper factor of n,
+  i.e. the sequence is cancelled, takes maxSteps steps, or its cycle modulo
+  every factor of n closes in the same batch.
+*/
+bool pollardBrent(mpint::MPInt& d, const mpint::MPInt& n, const uint64_t c, const uint64_t x0,
+                  const uint64_t maxSteps = rhoMaxSteps, const std::atomic<bool>* cancel = 0);
+
+/*
+  pollardBrent with c = 1, 2, ... and x0 = 2 in threads threads,
+  each of which takes the next c when a sequence fails.
+  The other sequences are cancelled when a factor is found.
+  @require: n is odd and n > 1, 1 <= threads.
+  @return: false if no proper factor is found by sequences
+  of maxSteps steps with c < maxSequences, e.g. n is a prime.
+*/
+bool pollardRho(mpint::MPInt& d, const mpint::MPInt& n, const size_t threads = 1,
+                const uint64_t maxSteps = rhoMaxSteps, const uint64_t maxSequences = 16);
+
+} // namespace impl
+
+} // namespace integer
+
+#endif // RHO_HPP
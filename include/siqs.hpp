@@ -0,0 +1,166 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#ifndef SIQS_HPP
+#define SIQS_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "mpint.hpp"
+
+namespace integer {
+
+/*
+  Self-initializing quadratic sieve.
+
+  The multiplier k is chosen by the Knuth-Schroeppel function,
+  and the factor base is -1, 2 and the odd primes p with (kn/p) = 1
+  by the int64 kronecker(), with t_p^2 = kn mod p by Tonelli-Shanks.
+  A polynomial is Q(x) = (Ax + B)^2 - kn = A (Ax^2 + 2Bx + C),
+  where A is a product of s primes of the factor base near
+  (sqrt(2kn)/M)^(1/s), and the 2^(s-1) values of B for an A are
+  switched in Gray code order, so that the roots of a new polynomial
+  cost one subtraction per prime.
+  Ax^2 + 2Bx + C is sieved on [-M, M) in blocks of blockSize bytes,
+  which should fit in L1, and the primes larger than a block
+  are put into buckets of their hits per block before the blocks are sieved.
+  Each thread sieves the polynomials of its own A.
+  A value which is smooth but a single prime less than
+  largePrimeMultiplier * (largest prime of the factor base) is kept as a
+  partial relation, and two partials with the same large prime make a relation.
+  The dependencies are found by Gaussian elimination over GF(2)
+  after the singleton columns are removed.
+
+  An object is used by one thread at a time.
+*/
+class QuadraticSieve {
+public:
+  struct Params {
+    size_t factorBase;
+    size_t blockSize;
+    // M = blocks * blockSize.
+    size_t blocks;
+    size_t largePrimeMultiplier;
+    size_t threads;
+    uint64_t seed;
+  };
+
+  struct Stats {
+    uint32_t multiplier;
+    size_t factorBase;
+    size_t polynomials;
+    // relations from smooth values and from pairs of partials.
+    size_t full;
+    size_t combined;
+    size_t partial;
+    size_t dependencies;
+    double sieveSeconds;
+    double linearSeconds;
+  };
+
+  /*
+    Parameters for n of the digits, with blockSize = 32 KiB.
+  */
+  static Params defaultParams(const size_t digits, const size_t threads = 1);
+
+  /*
+    @require: n is odd, composite by impl::isProbablePrime,
+    not a perfect power and n >= 2^64.
+    Params: 16 <= factorBase, blockSize is a power of 2 in [2^6, 2^24],
+    1 <= blocks, 1 <= largePrimeMultiplier, 1 <= threads.
+  */
+  explicit QuadraticSieve(const mpint::MPInt& n, const size_t threads = 1);
+  QuadraticSieve(const mpint::MPInt& n, const Params& params);
+
+  const mpint::MPInt& modulus() const { return n_; }
+  const Params& params() const { return params_; }
+  uint32_t multiplier() const { return k_; }
+
+  /*
+    Primes of the factor base, primes()[0] = 2.
+  */
+  const std::vector<uint32_t>& primes() const { return primes_; }
+
+  /*
+    d is a proper factor of n.
+    @return: false if no dependency gives a proper factor.
+  */
+  bool factor(mpint::MPInt& d);
+
+  /*
+    Statistics of the last factor().
+  */
+  const Stats& stats() const { return stats_; }
+
+private:
+  QuadraticSieve(const QuadraticSieve&);
+  void operator=(const QuadraticSieve&);
+
+  /*
+    y^2 = (-1)^e0 prod primes_[i - 1]^(e_i) * prod large^2 mod n,
+    where factors holds the column index i once per exponent, 0 for -1.
+  */
+  struct Relation {
+    mpint::MPInt y;
+    std::vector<uint32_t> factors;
+    std::vector<uint64_t> large;
+  };
+
+  class Collector;
+  class Sieve;
+
+  void init_();
+  size_t solve_(std::vector<std::vector<uint32_t> >& deps) const;
+  bool sqrt_(mpint::MPInt& d, const std::vector<uint32_t>& dep) const;
+
+  mpint::MPInt n_;
+  mpint::MPInt kn_;
+  uint32_t k_;
+  Params params_;
+  std::vector<uint32_t> primes_;
+  std::vector<uint32_t> roots_;
+  std::vector<uint8_t> logp_;
+  // index of the first sieved prime, the smaller ones are only trial divided.
+  size_t firstSieved_;
+  // factor of n found while building the factor base, or 0.
+  uint32_t smallFactor_;
+  uint64_t largeBound_;
+  uint8_t threshold_;
+  // range of indexes of the primes of A and the target log2(A).
+  size_t aLow_;
+  size_t aHigh_;
+  size_t s_;
+  double logA_;
+  std::vector<Relation> relations_;
+  Stats stats_;
+};
+
+} // namespace integer
+
+#endif // SIQS_HPP
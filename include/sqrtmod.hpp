@@ -0,0 +1,137 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#ifndef SQRTMOD_HPP
+#define SQRTMOD_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "mpint.hpp"
+#include "montgomery.hpp"
+#include "powm.hpp"
+
+namespace integer {
+
+/*
+  Square roots modulo a fixed odd prime p, in Montgomery form.
+
+  Let p - 1 = q 2^s with odd q.
+  p = 3 mod 4: x^((p+1)/4).
+  p = 5 mod 8: Atkin's method, one exponentiation by (p-5)/8.
+  Otherwise Tonelli-Shanks with the non-residue z found by impl::kronecker,
+  and z^q, when the context is constructed,
+  or Cipolla in F_p[w]/(w^2 - (t^2 - x)) when s^2 > cipollaRatio * bits(p),
+  since the walk of Tonelli-Shanks takes O(s^2) multiplications.
+
+  Scratch buffers are kept in the object, which is used by one thread at a time.
+*/
+class SqrtModContext {
+public:
+  typedef mpint::MPInt::value_type value_type;
+
+  enum Method {
+    Auto,
+    Mod4,
+    Mod8,
+    TonelliShanks,
+    Cipolla
+  };
+
+  static const size_t cipollaRatio = 16;
+
+  /*
+    @require: p is an odd prime by impl::isProbablePrime,
+    Mod4 and Mod8 also need p = 3 mod 4 and p = 5 mod 8.
+    @note: method is for tests and benchmarks, Auto selects it as above.
+  */
+  explicit SqrtModContext(const mpint::MPInt& p, const Method method = Auto);
+
+  const mpint::MontgomeryContext& context() const { return ctx_; }
+  const mpint::MPInt& modulus() const { return p_; }
+  Method method() const { return method_; }
+
+  /*
+    s of p - 1 = q 2^s.
+  */
+  size_t twoAdicity() const { return s_; }
+
+  /*
+    The smallest positive quadratic non-residue.
+  */
+  const mpint::MPInt& nonResidue() const { return z_; }
+
+  /*
+    z^2 = x, x and z are in Montgomery form.
+    @require: x < p, z may be the same as x.
+    @return: whether x is a square, z is not specified if not.
+  */
+  bool sqrt(value_type* z, const value_type* x);
+
+  /*
+    z^2 = x mod p, 0 <= z <= (p-1)/2, x may be any integer.
+    @return: whether x is a square mod p, z is not modified if not.
+  */
+  bool sqrt(mpint::MPInt& z, const mpint::MPInt& x);
+
+private:
+  SqrtModContext(const SqrtModContext&);
+  void operator=(const SqrtModContext&);
+
+  bool sqrtMod4_(value_type* z, const value_type* x);
+  bool sqrtMod8_(value_type* z, const value_type* x);
+  bool sqrtTonelliShanks_(value_type* z, const value_type* x);
+  bool sqrtCipolla_(value_type* z, const value_type* x);
+
+  mpint::MPInt p_;
+  mpint::MontgomeryContext ctx_;
+  mpint::MontgomeryPowm powm_;
+  Method method_;
+  size_t s_;
+  mpint::MPInt z_;
+  // exponent of the method.
+  mpint::MPInt e_;
+  // z^q in Montgomery form for Tonelli-Shanks.
+  std::vector<value_type> c_;
+  std::vector<value_type> work_;
+};
+
+namespace impl {
+
+/*
+  z^2 = a mod p, 0 <= z <= (p-1)/2, by a SqrtModContext for p.
+  @require: p is an odd prime.
+  @return: whether a is a square mod p, z is not modified if not.
+*/
+bool sqrtmod(mpint::MPInt& z, const mpint::MPInt& a, const mpint::MPInt& p);
+
+} // namespace impl
+
+} // namespace integer
+
+#endif // SQRTMOD_HPP
@@ -85,6 +85,21 @@ bool testsAreSucceeded()
     }                                                          \
   } while (0)
 
+#define TEST_THROW(e,ex) do {                               \
+    ++ctrTest;                                              \
+    bool thrown_ = false;                                   \
+    try {                                                   \
+      (void)(e);                                            \
+    } catch (ex&) {                                         \
+      thrown_ = true;                                       \
+    }                                                       \
+    if (! thrown_) {                                        \
+      ++ctrErr;                                             \
+      printf("%s:%d: error: %s does not throw %s\n",        \
+             __FILE__, __LINE__, #e, #ex);                  \
+    }                                                       \
+  } while (0)
+
 namespace ff_util {
 
 #ifdef USE_GMP
@@ -0,0 +1,159 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <stdexcept>
+#include <vector>
+
+#include "barrett.hpp"
+
+namespace mpint {
+
+typedef BarrettContext::value_type value_type;
+
+BarrettContext::BarrettContext(const MPInt& m)
+  : k_(m.size()), m_(m), mu_(), mdigits_(m.get(), m.get() + m.size()), mudigits_(m.size() + 1, 0)
+{
+  if (! m.isPos()) {
+    throw std::invalid_argument("BarrettContext: modulus must be positive");
+  }
+
+  const size_t k = k_;
+  const size_t nbits = sizeof(value_type) * CHAR_BIT;
+
+  MPInt b2k(1), r;
+  MPInt::shl(b2k, b2k, nbits*k*2);
+  MPInt::divmod(mu_, r, b2k, m);
+
+  if (mu_.size() > k + 1) {
+    /*
+      @note: m = B^(k-1), saturate mu to B^(k+1) - 1.
+      q3 may become one smaller, and it is corrected at the end of reduce().
+    */
+    std::fill(mudigits_.begin(), mudigits_.end(), ~value_type(0));
+  } else {
+    std::copy(mu_.get(), mu_.get() + mu_.size(), mudigits_.begin());
+  }
+}
+
+/*
+  HAC, Algorithm 14.42.
+  q2 and r2 are computed partially.
+*/
+void BarrettContext::reduce(value_type* r, const value_type* x, const size_t xn, value_type* work) const
+{
+  const size_t k = k_;
+  const value_type* m = &mdigits_[0];
+  const value_type* mu = &mudigits_[0];
+  const size_t mun = k + 1;
+
+  assert(xn <= k*2);
+
+  if (xn < k) {
+    // x < B^(k-1) <= m.
+    std::copy(x, x + xn, r);
+    std::fill(r + xn, r + k, 0);
+    return;
+  }
+
+  value_type* q2 = work;
+  value_type* r2 = q2 + (k + 1)*2;
+  value_type* rr = r2 + (k + 1);
+
+  /*
+    q1 = floor(x / B^(k-1)),
+    q3 = floor(q1*mu / B^(k+1)).
+
+    Columns of q1*mu less than k - 1 are not computed.
+    The dropped part is less than B^(k+1), so q3 is at most 1 smaller.
+  */
+  const value_type* q1 = x + (k - 1);
+  const size_t l1 = xn - (k - 1);
+  std::fill(q2, q2 + l1 + mun, 0);
+  for (size_t i = 0; i < l1; ++i) {
+    const size_t j0 = i >= k - 1 ? 0 : k - 1 - i;
+    q2[i + mun] = MPInt::addmul_1(q2 + i + j0, mu + j0, mun - j0, q1[i]);
+  }
+  const value_type* q3 = q2 + (k + 1);
+  const size_t l3 = l1 + mun - (k + 1);
+
+  /*
+    r2 = q3*m mod B^(k+1).
+  */
+  std::fill(r2, r2 + (k + 1), 0);
+  for (size_t i = 0; i < l3 && i < k + 1; ++i) {
+    const size_t len = std::min(k, k + 1 - i);
+    const value_type c = MPInt::addmul_1(r2 + i, m, len, q3[i]);
+    if (i + len < k + 1) {
+      r2[i + len] += c;
+    }
+  }
+
+  /*
+    r = x mod B^(k+1) - r2, and the borrow is ignored.
+  */
+  const size_t xl = std::min(xn, k + 1);
+  std::copy(x, x + xl, rr);
+  std::fill(rr + xl, rr + (k + 1), 0);
+  MPInt::sub_n(rr, rr, r2, k + 1);
+
+  while (rr[k] != 0 || MPInt::cmp_n(rr, m, k) >= 0) {
+    rr[k] -= MPInt::sub_n(rr, rr, m, k);
+  }
+
+  std::copy(rr, rr + k, r);
+}
+
+void BarrettContext::reduce(MPInt& r, const MPInt& x) const
+{
+  const size_t k = k_;
+  const size_t xn = x.size();
+
+  if (x.isNeg() || xn > k*2) {
+    MPInt::mod(r, x, m_);
+    return;
+  }
+
+  std::vector<value_type> work(workSize());
+  MPInt t;
+  t.reserve(k);
+  reduce(t.get(), x.get(), xn, &work[0]);
+  t.normalize(k);
+  r.swap(t);
+}
+
+void BarrettContext::mul(MPInt& z, const MPInt& x, const MPInt& y) const
+{
+  MPInt t;
+  MPInt::mul(t, x, y);
+  reduce(z, t);
+}
+
+} // namespace mpint
@@ -0,0 +1,191 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "batchinv.hpp"
+#include "gcd.hpp"
+
+namespace mpint {
+
+typedef MPInt::value_type value_type;
+
+namespace {
+
+/*
+  p[i] = x[b]*...*x[i] for b <= i < e.
+*/
+void prefix(const MontgomeryContext& ctx, value_type* p, const value_type* x,
+            const size_t b, const size_t e)
+{
+  const size_t n = ctx.size();
+  std::copy(x + b*n, x + (b + 1)*n, p + b*n);
+  for (size_t i = b + 1; i < e; ++i) {
+    ctx.mul(p + i*n, p + (i - 1)*n, x + i*n);
+  }
+}
+
+/*
+  z[i] = x[i]^(-1) for b <= i < e from the prefix products p
+  and inv = (x[b]*...*x[e - 1])^(-1).
+
+  @require: inv and t have n digits, they are destroyed.
+  z may be the same as x or p.
+*/
+void backward(const MontgomeryContext& ctx, value_type* z, const value_type* x, const value_type* p,
+              const size_t b, const size_t e, value_type* inv, value_type* t)
+{
+  const size_t n = ctx.size();
+  for (size_t i = e - 1; i > b; --i) {
+    ctx.mul(t, inv, x + i*n);
+    ctx.mul(z + i*n, inv, p + (i - 1)*n);
+    std::copy(t, t + n, inv);
+  }
+  std::copy(inv, inv + n, z + b*n);
+}
+
+} // namespace
+
+BatchInverse::BatchInverse(const MontgomeryContext& ctx)
+  : ctx_(ctx), work_()
+{
+}
+
+bool BatchInverse::invertOne_(value_type* z, const value_type* x) const
+{
+  const size_t n = ctx_.size();
+  MPInt m, y, yi;
+  m.set(ctx_.modulus(), n);
+  y.set(x, n);
+  if (! integer::impl::invert(yi, y, m)) {
+    return false;
+  }
+
+  // (x R)^(-1) R^3 / R = x^(-1) R.
+  std::vector<value_type> t(n, 0), r3(n);
+  std::copy(yi.get(), yi.get() + yi.size(), t.begin());
+  ctx_.mul(&r3[0], ctx_.R2(), ctx_.R2());
+  ctx_.mul(z, &t[0], &r3[0]);
+  return true;
+}
+
+bool BatchInverse::invert(value_type* z, const value_type* x, const size_t k, const size_t threads)
+{
+  if (k == 0) {
+    return true;
+  }
+
+  const size_t n = ctx_.size();
+  const size_t nt = std::max(std::min(threads, k), (size_t)1);
+
+  // prefix products, products of chunks, and their inverses, temporaries.
+  const size_t need = (k + 2*nt + 2*nt)*n;
+  if (work_.size() < need) {
+    work_.resize(need);
+  }
+  value_type* p = &work_[0];
+  value_type* cp = p + k*n;
+  value_type* ci = cp + nt*n;
+  value_type* tmp = ci + nt*n;
+
+  std::vector<size_t> bound(nt + 1);
+  for (size_t c = 0; c <= nt; ++c) {
+    bound[c] = k*c / nt;
+  }
+
+  if (nt == 1) {
+    prefix(ctx_, p, x, 0, k);
+    if (! invertOne_(tmp, p + (k - 1)*n)) {
+      return false;
+    }
+    backward(ctx_, z, x, p, 0, k, tmp, tmp + n);
+    return true;
+  }
+
+  {
+    std::vector<std::thread> th;
+    for (size_t c = 1; c < nt; ++c) {
+      th.push_back(std::thread(prefix, std::cref(ctx_), p, x, bound[c], bound[c + 1]));
+    }
+    prefix(ctx_, p, x, bound[0], bound[1]);
+    for (size_t c = 0; c < th.size(); ++c) {
+      th[c].join();
+    }
+  }
+
+  // inverses of the chunk products by the same trick.
+  for (size_t c = 0; c < nt; ++c) {
+    std::copy(p + (bound[c + 1] - 1)*n, p + bound[c + 1]*n, cp + c*n);
+  }
+  prefix(ctx_, ci, cp, 0, nt);
+  if (! invertOne_(tmp, ci + (nt - 1)*n)) {
+    return false;
+  }
+  backward(ctx_, ci, cp, ci, 0, nt, tmp, tmp + n);
+
+  {
+    std::vector<std::thread> th;
+    for (size_t c = 1; c < nt; ++c) {
+      th.push_back(std::thread(backward, std::cref(ctx_), z, x, p, bound[c], bound[c + 1],
+                               ci + c*n, tmp + 2*c*n));
+    }
+    backward(ctx_, z, x, p, bound[0], bound[1], ci, tmp);
+    for (size_t c = 0; c < th.size(); ++c) {
+      th[c].join();
+    }
+  }
+  return true;
+}
+
+bool BatchInverse::invert(std::vector<MPInt>& z, const std::vector<MPInt>& x, const size_t threads)
+{
+  const size_t n = ctx_.size();
+  const size_t k = x.size();
+  MPInt m, r;
+  m.set(ctx_.modulus(), n);
+
+  std::vector<value_type> t(k*n);
+  for (size_t i = 0; i < k; ++i) {
+    MPInt::mod(r, x[i], m);
+    ctx_.toMont(&t[i*n], r);
+  }
+  if (! invert(&t[0], &t[0], k, threads)) {
+    return false;
+  }
+  z.resize(k);
+  for (size_t i = 0; i < k; ++i) {
+    ctx_.fromMont(z[i], &t[i*n]);
+  }
+  return true;
+}
+
+} // namespace mpint
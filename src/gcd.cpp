@@ -0,0 +1,874 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <vector>
+
+#include "gcd.hpp"
+#include "integer-util.hpp"
+
+namespace integer {
+
+namespace impl {
+
+size_t gcdLehmerThreshold = 4;
+size_t gcdHalfThreshold = 4096;
+
+namespace {
+
+using mpint::MPInt;
+typedef MPInt::value_type value_type;
+typedef MPInt::dvalue_type dvalue_type;
+__extension__ typedef __int128 sdvalue_type;
+
+const size_t noThreshold = ~size_t(0);
+
+/*
+  Below this size, the half-GCD reduces by division steps.
+*/
+const size_t hgcdBaseSize = 24;
+
+inline size_t normalized(const value_type* x, size_t n)
+{
+  while (n > 0 && x[n - 1] == 0) {
+    --n;
+  }
+  return n;
+}
+
+inline size_t bits(const value_type* x, const size_t n)
+{
+  return n == 0 ? 0 : n*64 - (size_t)__builtin_clzll(x[n - 1]);
+}
+
+inline size_t bits(const MPInt& x)
+{
+  return bits(x.get(), x.size());
+}
+
+/*
+  x[0..n) >>= NTZ(x).
+  @require: x != 0.
+  @return: new size.
+*/
+size_t stripTwos(value_type* x, size_t n)
+{
+  size_t q = 0;
+  while (x[q] == 0) {
+    ++q;
+  }
+  if (q > 0) {
+    std::copy(x + q, x + n, x);
+    std::fill(x + n - q, x + n, 0);
+    n -= q;
+  }
+  const size_t r = MPInt::in_NumTrailZero1(x[0]);
+  if (r > 0) {
+    MPInt::in_shr_shift(x, x, n, r);
+  }
+  return normalized(x, n);
+}
+
+value_type gcd1(value_type a, value_type b)
+{
+  assert(a & b & 1);
+
+  while (a != b) {
+    if (a > b) {
+      a -= b;
+      a >>= __builtin_ctzll(a);
+    } else {
+      b -= a;
+      b >>= __builtin_ctzll(b);
+    }
+  }
+  return a;
+}
+
+/*
+  Working state: a >= b, digits above the sizes are zero.
+*/
+class Gcd {
+public:
+  Gcd(const MPInt& x, const MPInt& y)
+    : an_(x.size()), bn_(y.size())
+  {
+    const size_t n = std::max(an_, bn_) + 1;
+    a_.assign(n, 0);
+    b_.assign(n, 0);
+    t_.assign(n, 0);
+    u_.assign(n, 0);
+    std::copy(x.get(), x.get() + an_, a_.begin());
+    std::copy(y.get(), y.get() + bn_, b_.begin());
+    order();
+  }
+
+  size_t asize() const { return an_; }
+  size_t bsize() const { return bn_; }
+
+  void order()
+  {
+    if (an_ < bn_ || (an_ == bn_ && MPInt::cmp_n(&a_[0], &b_[0], an_) < 0)) {
+      a_.swap(b_);
+      std::swap(an_, bn_);
+    }
+  }
+
+  /*
+    @return: number of common trailing zero bits, both are made odd.
+    @require: a, b != 0.
+  */
+  size_t stripCommonTwos()
+  {
+    const size_t ka = ntz(&a_[0]);
+    const size_t kb = ntz(&b_[0]);
+    an_ = stripTwos(&a_[0], an_);
+    bn_ = stripTwos(&b_[0], bn_);
+    order();
+    return std::min(ka, kb);
+  }
+
+  /*
+    (a, b) = (b, a mod b).
+  */
+  void divStep()
+  {
+    MPInt::divrem_n(nullptr, &t_[0], &a_[0], an_, &b_[0], bn_);
+    std::fill(a_.begin(), a_.end(), 0);
+    std::copy(t_.begin(), t_.begin() + bn_, a_.begin());
+    std::fill(t_.begin(), t_.begin() + bn_, 0);
+    const size_t rn = normalized(&a_[0], bn_);
+    a_.swap(b_);
+    an_ = bn_;
+    bn_ = rn;
+  }
+
+  /*
+    One Lehmer step with 63 leading bits, Knuth Algorithm L.
+    @require: b != 0.
+  */
+  void lehmerStep()
+  {
+    if (an_ < 2 || bn_ + 1 < an_) {
+      divStep();
+      return;
+    }
+
+    const value_type* a = &a_[0];
+    const value_type* b = &b_[0];
+    const size_t s = (size_t)__builtin_clzll(a[an_ - 1]);
+    const value_type ah0 = s == 0 ? a[an_ - 1] : (a[an_ - 1] << s) | (a[an_ - 2] >> (64 - s));
+    const value_type bh0 = s == 0 ? b[an_ - 1] : (b[an_ - 1] << s) | (b[an_ - 2] >> (64 - s));
+    sdvalue_type ah = (sdvalue_type)(ah0 >> 1);
+    sdvalue_type bh = (sdvalue_type)(bh0 >> 1);
+
+    // (a', b') = (A a + B b, C a + D b).
+    sdvalue_type A = 1, B = 0, C = 0, D = 1;
+    for (;;) {
+      if (bh + C == 0 || bh + D == 0) {
+        break;
+      }
+      const sdvalue_type q = (ah + A) / (bh + C);
+      if (q != (ah + B) / (bh + D)) {
+        break;
+      }
+      sdvalue_type t;
+      t = A - q*C; A = C; C = t;
+      t = B - q*D; B = D; D = t;
+      t = ah - q*bh; ah = bh; bh = t;
+    }
+
+    if (B == 0) {
+      divStep();
+      return;
+    }
+
+    const size_t tn = lincomb(&t_[0], (int64_t)A, (int64_t)B);
+    const size_t un = lincomb(&u_[0], (int64_t)C, (int64_t)D);
+    std::fill(a_.begin(), a_.begin() + an_, 0);
+    std::fill(b_.begin(), b_.begin() + an_, 0);
+    a_.swap(t_);
+    b_.swap(u_);
+    an_ = tn;
+    bn_ = un;
+    order();
+  }
+
+  /*
+    gcd of odd a and b by the binary algorithm, the result is in a.
+  */
+  void binary()
+  {
+    while (bn_ > 0) {
+      if (an_ == 1) {
+        a_[0] = gcd1(a_[0], b_[0]);
+        b_[0] = 0;
+        bn_ = 0;
+        break;
+      }
+      if (an_ == bn_ && MPInt::cmp_n(&a_[0], &b_[0], an_) == 0) {
+        std::fill(b_.begin(), b_.begin() + bn_, 0);
+        bn_ = 0;
+        break;
+      }
+      MPInt::in_sub_nc(&a_[0], &a_[0], an_, &b_[0], bn_);
+      an_ = stripTwos(&a_[0], normalized(&a_[0], an_));
+      order();
+    }
+  }
+
+  void get(MPInt& z) const
+  {
+    z.set(&a_[0], an_);
+  }
+
+  void getb(MPInt& z) const
+  {
+    z.set(&b_[0], std::max(bn_, (size_t)1));
+  }
+
+  void set(const MPInt& x, const MPInt& y)
+  {
+    an_ = x.size();
+    bn_ = y.size();
+    std::fill(a_.begin(), a_.end(), 0);
+    std::fill(b_.begin(), b_.end(), 0);
+    std::copy(x.get(), x.get() + an_, a_.begin());
+    std::copy(y.get(), y.get() + bn_, b_.begin());
+    order();
+  }
+
+private:
+  static size_t ntz(const value_type* x)
+  {
+    size_t q = 0;
+    while (x[q] == 0) {
+      ++q;
+    }
+    return q*64 + MPInt::in_NumTrailZero1(x[q]);
+  }
+
+  /*
+    r = x a + y b, x and y have opposite signs and the result is not negative.
+    @return: size of r.
+  */
+  size_t lincomb(value_type* r, const int64_t x, const int64_t y) const
+  {
+    const value_type* a = &a_[0];
+    const value_type* b = &b_[0];
+    const size_t an = an_;
+    const size_t bn = bn_;
+    value_type c;
+
+    if (y <= 0) {
+      assert(x >= 0);
+      c = MPInt::mul_1(r, a, an, (value_type)x);
+      value_type borrow = MPInt::submul_1(r, b, bn, (value_type)(-y));
+      if (an > bn) {
+        borrow = MPInt::sub_1(r + bn, r + bn, an - bn, borrow);
+      }
+      c -= borrow;
+    } else {
+      assert(x <= 0);
+      c = MPInt::mul_1(r, b, bn, (value_type)y);
+      if (an > bn) {
+        r[bn] = c;
+        std::fill(r + bn + 1, r + an, 0);
+        c = 0;
+      }
+      c -= MPInt::submul_1(r, a, an, (value_type)(-x));
+    }
+    assert(c == 0);
+    (void)c;
+    return normalized(r, an);
+  }
+
+  std::vector<value_type> a_;
+  std::vector<value_type> b_;
+  std::vector<value_type> t_;
+  std::vector<value_type> u_;
+  size_t an_;
+  size_t bn_;
+};
+
+/*
+  2x2 matrix with (a0; b0) = M (a; b), det = +-1.
+*/
+struct Matrix {
+  MPInt m00, m01, m10, m11;
+  int det;
+
+  Matrix() : m00(1), m01(0), m10(0), m11(1), det(1) {}
+
+  bool isIdentity() const
+  { return m01.isZero() && m10.isZero(); }
+
+  /*
+    this = this * N.
+  */
+  void mul(const Matrix& N)
+  {
+    MPInt t0, t1, r00, r01, r10, r11;
+    MPInt::mul(t0, m00, N.m00); MPInt::mul(t1, m01, N.m10); MPInt::add(r00, t0, t1);
+    MPInt::mul(t0, m00, N.m01); MPInt::mul(t1, m01, N.m11); MPInt::add(r01, t0, t1);
+    MPInt::mul(t0, m10, N.m00); MPInt::mul(t1, m11, N.m10); MPInt::add(r10, t0, t1);
+    MPInt::mul(t0, m10, N.m01); MPInt::mul(t1, m11, N.m11); MPInt::add(r11, t0, t1);
+    m00.swap(r00);
+    m01.swap(r01);
+    m10.swap(r10);
+    m11.swap(r11);
+    det *= N.det;
+  }
+
+  /*
+    this = this * [[q, 1], [1, 0]].
+  */
+  void mulQuotient(const MPInt& q)
+  {
+    MPInt t;
+    MPInt::mul(t, m00, q);
+    MPInt::add(t, t, m01);
+    m01.swap(m00);
+    m00.swap(t);
+    MPInt::mul(t, m10, q);
+    MPInt::add(t, t, m11);
+    m11.swap(m10);
+    m10.swap(t);
+    det = -det;
+  }
+};
+
+/*
+  (a, b) = M^(-1) (a, b), then a >= b >= 0 is restored.
+  acc = acc * M with the sign and order changes if acc is not null.
+*/
+void applyInverse(Matrix* acc, const Matrix& M, MPInt& a, MPInt& b)
+{
+  MPInt t0, t1, na, nb;
+  MPInt::mul(t0, M.m11, a);
+  MPInt::mul(t1, M.m01, b);
+  MPInt::sub(na, t0, t1);
+  MPInt::mul(t0, M.m00, b);
+  MPInt::mul(t1, M.m10, a);
+  MPInt::sub(nb, t0, t1);
+  if (M.det < 0) {
+    MPInt::negation(na, na);
+    MPInt::negation(nb, nb);
+  }
+
+  if (acc) {
+    acc->mul(M);
+  }
+  if (na.isNeg()) {
+    MPInt::negation(na, na);
+    if (acc) {
+      MPInt::negation(acc->m00, acc->m00);
+      MPInt::negation(acc->m10, acc->m10);
+      acc->det = -acc->det;
+    }
+  }
+  if (nb.isNeg()) {
+    MPInt::negation(nb, nb);
+    if (acc) {
+      MPInt::negation(acc->m01, acc->m01);
+      MPInt::negation(acc->m11, acc->m11);
+      acc->det = -acc->det;
+    }
+  }
+  if (na < nb) {
+    na.swap(nb);
+    if (acc) {
+      acc->m00.swap(acc->m01);
+      acc->m10.swap(acc->m11);
+      acc->det = -acc->det;
+    }
+  }
+  a.swap(na);
+  b.swap(nb);
+}
+
+/*
+  Division steps while b >= 2^s.
+*/
+void divSteps(Matrix& M, MPInt& a, MPInt& b, const size_t s)
+{
+  MPInt q, r;
+  while (bits(b) > s) {
+    MPInt::divmod(q, r, a, b);
+    M.mulQuotient(q);
+    a.swap(b);
+    b.swap(r);
+  }
+}
+
+/*
+  Half-GCD: a >= b >= 0 are reduced to about half of the bits of a,
+  and (a0; b0) = M (a; b).
+  @note: the reduction from the leading parts is not exact,
+  but M is always unimodular, so gcd is kept.
+*/
+void hgcd(Matrix& M, MPInt& a, MPInt& b)
+{
+  const size_t n = bits(a);
+  const size_t s = n/2 + 1;
+
+  M = Matrix();
+  if (bits(b) <= s) {
+    return;
+  }
+  if (a.size() < hgcdBaseSize) {
+    divSteps(M, a, b, s);
+    return;
+  }
+
+  // reduce the upper half to a quarter.
+  {
+    const size_t p = n/2;
+    MPInt ta, tb;
+    MPInt::shr(ta, a, p);
+    MPInt::shr(tb, b, p);
+    Matrix M1;
+    hgcd(M1, ta, tb);
+    if (! M1.isIdentity()) {
+      applyInverse(&M, M1, a, b);
+    }
+  }
+
+  if (bits(b) <= s) {
+    return;
+  }
+  {
+    MPInt q, r;
+    MPInt::divmod(q, r, a, b);
+    M.mulQuotient(q);
+    a.swap(b);
+    b.swap(r);
+  }
+  if (bits(b) <= s) {
+    return;
+  }
+
+  // the upper part of 2(bits(a) - s) bits is reduced to its half.
+  const size_t n2 = bits(a);
+  if (n2 < 2*s && n2 - (2*s - n2) > 128) {
+    const size_t p = 2*s - n2;
+    MPInt ta, tb;
+    MPInt::shr(ta, a, p);
+    MPInt::shr(tb, b, p);
+    Matrix M2;
+    hgcd(M2, ta, tb);
+    if (! M2.isIdentity()) {
+      applyInverse(&M, M2, a, b);
+    }
+  }
+
+  divSteps(M, a, b, s);
+}
+
+MPInt gcdImpl(const MPInt& x, const MPInt& y, const size_t lehmerThreshold, const size_t halfThreshold)
+{
+  if (x.isZero()) {
+    return y.abs();
+  }
+  if (y.isZero()) {
+    return x.abs();
+  }
+
+  Gcd g(x, y);
+  const size_t k = g.stripCommonTwos();
+
+  if (g.bsize() > halfThreshold) {
+    MPInt a, b;
+    g.get(a);
+    g.getb(b);
+    while (b.size() > halfThreshold) {
+      // the upper 2/3 are reduced to 1/3.
+      const size_t p = bits(a) / 3;
+      MPInt ta, tb;
+      MPInt::shr(ta, a, p);
+      MPInt::shr(tb, b, p);
+      Matrix M1;
+      hgcd(M1, ta, tb);
+      if (! M1.isIdentity()) {
+        applyInverse(nullptr, M1, a, b);
+      }
+      if (b.isZero()) {
+        break;
+      }
+      MPInt q, r;
+      MPInt::divmod(q, r, a, b);
+      a.swap(b);
+      b.swap(r);
+    }
+    g.set(a, b);
+  }
+
+  while (g.bsize() > 0 && g.bsize() >= lehmerThreshold) {
+    g.lehmerStep();
+  }
+
+  if (g.bsize() > 0) {
+    // the gcd is odd.
+    g.stripCommonTwos();
+    g.binary();
+  }
+
+  MPInt z;
+  g.get(z);
+  MPInt::shl(z, z, k);
+  return z;
+}
+
+/*
+  r[0..n] = x f + y g in two's complement.
+*/
+void linComb(value_type* r, const value_type* x, const value_type* y, const int64_t f, const int64_t g, const size_t n)
+{
+  sdvalue_type acc = 0;
+  for (size_t j = 0; j < n; ++j) {
+    acc += (sdvalue_type)x[j]*f + (sdvalue_type)y[j]*g;
+    r[j] = (value_type)acc;
+    acc >>= 64;
+  }
+  r[n] = (value_type)acc;
+}
+
+/*
+  r[0..n] >>= 31, arithmetic shift.
+*/
+void shr31(value_type* r, const size_t n)
+{
+  for (size_t j = 0; j < n; ++j) {
+    r[j] = (r[j] >> 31) | (r[j + 1] << 33);
+  }
+  r[n] = (value_type)((int64_t)r[n] >> 31);
+}
+
+/*
+  r[0..n] = -r[0..n] if mask is all ones, r is kept if mask is zero.
+*/
+void negateIf(value_type* r, const size_t n, const value_type mask)
+{
+  value_type c = mask & 1;
+  for (size_t j = 0; j <= n; ++j) {
+    const value_type t = (r[j] ^ mask) + c;
+    c = t < c;
+    r[j] = t;
+  }
+}
+
+/*
+  r[0..n] += m & mask.
+*/
+void addMasked(value_type* r, const value_type* m, const size_t n, const value_type mask)
+{
+  dvalue_type c = 0;
+  for (size_t j = 0; j < n; ++j) {
+    c += (dvalue_type)r[j] + (m[j] & mask);
+    r[j] = (value_type)c;
+    c >>= 64;
+  }
+  r[n] += (value_type)c;
+}
+
+/*
+  z = a^(-1) mod m, Pornin's optimized binary GCD.
+  Each outer step runs 31 binary steps on 64-bit approximations of a and b,
+  which are built from their low 31 bits and their leading 33 bits,
+  and then applies the update factors to the full numbers.
+  If constantTime is true, everything is done by masks in a fixed number
+  of steps, otherwise it stops as soon as a = 0.
+
+  @require: m is odd, m > 1, a < m, z has n digits.
+  @return: whether gcd(a, m) = 1.
+*/
+bool inverseBatched(value_type* z, const value_type* in_a, const value_type* m, const size_t n, const bool constantTime)
+{
+  const value_type rp = -inverse64(m[0]);
+  const size_t w = n + 1;
+  std::vector<value_type> buf(6*w, 0);
+  value_type* a = &buf[0];
+  value_type* b = a + w;
+  value_type* u = b + w;
+  value_type* v = u + w;
+  value_type* t0 = v + w;
+  value_type* t1 = t0 + w;
+
+  std::copy(in_a, in_a + n, a);
+  std::copy(m, m + n, b);
+  u[0] = 1;
+
+  const value_type low31 = (value_type(1) << 31) - 1;
+  // each outer step reduces len(a) + len(b) by 30 bits at least.
+  const size_t steps = (128*n + 29) / 30;
+  // length of a and b, shrinks in the variable-time mode.
+  size_t ln = n;
+  for (size_t i = 0; i < steps; ++i) {
+    // leading 64 bits at the same position of a and b.
+    value_type ah = 0, al = 0, bh = 0, bl = 0, top = 0;
+    for (size_t j = 0; j < ln; ++j) {
+      const value_type nz = -(value_type)((a[j] | b[j]) != 0);
+      top = (j & nz) | (top & ~nz);
+      ah = (a[j] & nz) | (ah & ~nz);
+      bh = (b[j] & nz) | (bh & ~nz);
+      const value_type la = j == 0 ? 0 : a[j - 1];
+      const value_type lb = j == 0 ? 0 : b[j - 1];
+      al = (la & nz) | (al & ~nz);
+      bl = (lb & nz) | (bl & ~nz);
+    }
+    const unsigned s = (unsigned)__builtin_clzll(ah | bh | 1);
+    ah = (ah << s) | ((al >> 1) >> (63 - s));
+    bh = (bh << s) | ((bl >> 1) >> (63 - s));
+    // 33 leading bits and 31 low bits, exact values for one digit.
+    const value_type exact = -(value_type)(top == 0);
+    value_type at = (((ah >> 31) << 31) | (a[0] & low31)) & ~exact;
+    value_type bt = (((bh >> 31) << 31) | (b[0] & low31)) & ~exact;
+    at |= a[0] & exact;
+    bt |= b[0] & exact;
+
+    // a~ 2^j = f0 a + g0 b, b~ 2^j = f1 a + g1 b.
+    value_type f0 = 1, g0 = 0, f1 = 0, g1 = 1;
+    for (int j = 0; j < 31; ++j) {
+      const value_type odd = -(at & 1);
+      const value_type lt = (at ^ ((at ^ bt) | ((at - bt) ^ bt))) >> 63;
+      const value_type sw = odd & -lt;
+      value_type d;
+      d = (at ^ bt) & sw; at ^= d; bt ^= d;
+      d = (f0 ^ f1) & sw; f0 ^= d; f1 ^= d;
+      d = (g0 ^ g1) & sw; g0 ^= d; g1 ^= d;
+      at -= bt & odd;
+      f0 -= f1 & odd;
+      g0 -= g1 & odd;
+      at >>= 1;
+      f1 <<= 1;
+      g1 <<= 1;
+    }
+
+    // (a, b) = (f0 a + g0 b, f1 a + g1 b)/2^31, made non negative.
+    linComb(t0, a, b, (int64_t)f0, (int64_t)g0, ln);
+    linComb(t1, a, b, (int64_t)f1, (int64_t)g1, ln);
+    shr31(t0, ln);
+    shr31(t1, ln);
+    const value_type na = -(t0[ln] >> 63);
+    const value_type nb = -(t1[ln] >> 63);
+    negateIf(t0, ln, na);
+    negateIf(t1, ln, nb);
+    std::copy(t0, t0 + ln + 1, a);
+    std::copy(t1, t1 + ln + 1, b);
+    f0 = (f0 ^ na) - na;
+    g0 = (g0 ^ na) - na;
+    f1 = (f1 ^ nb) - nb;
+    g1 = (g1 ^ nb) - nb;
+
+    // (u, v) = (f0 u + g0 v, f1 u + g1 v)/2^31 mod m.
+    value_type* const uv[] = { u, v };
+    value_type* const tt[] = { t0, t1 };
+    const value_type fs[] = { f0, f1 };
+    const value_type gs[] = { g0, g1 };
+    for (int k = 0; k < 2; ++k) {
+      linComb(tt[k], u, v, (int64_t)fs[k], (int64_t)gs[k], n);
+    }
+    for (int k = 0; k < 2; ++k) {
+      value_type* r = tt[k];
+      const value_type q = (r[0]*rp) & ((value_type(1) << 31) - 1);
+      r[n] += MPInt::addmul_1(r, m, n, q);
+      shr31(r, n);
+      // -m < r < 2m.
+      addMasked(r, m, n, -(r[n] >> 63));
+      value_type borrow = 0;
+      for (size_t j = 0; j < n; ++j) {
+        const dvalue_type d = (dvalue_type)r[j] - m[j] - borrow;
+        uv[k][j] = (value_type)d;
+        borrow = (value_type)(d >> 64) & 1;
+      }
+      const value_type keep = -(value_type)(r[n] < borrow);
+      for (size_t j = 0; j < n; ++j) {
+        uv[k][j] = (r[j] & keep) | (uv[k][j] & ~keep);
+      }
+    }
+
+    if (! constantTime) {
+      if (normalized(a, ln) == 0) {
+        break;
+      }
+      ln = std::max(normalized(a, ln), normalized(b, ln));
+    }
+  }
+
+  // b = gcd(a0, m).
+  value_type notOne = b[0] ^ 1;
+  for (size_t j = 1; j < n; ++j) {
+    notOne |= b[j];
+  }
+  std::copy(v, v + n, z);
+  return notOne == 0;
+}
+
+/*
+  z = x^(-1) mod m.
+  @require: m is odd, m > 1, 0 <= x < m.
+*/
+bool inverseOdd(MPInt& z, const MPInt& x, const MPInt& m, const bool constantTime)
+{
+  const size_t n = m.size();
+  std::vector<value_type> a(n, 0);
+  std::vector<value_type> r(n, 0);
+  std::copy(x.get(), x.get() + x.size(), a.begin());
+  const bool ok = inverseBatched(&r[0], &a[0], m.get(), n, constantTime);
+  if (ok) {
+    z.set(&r[0], n);
+  }
+  return ok;
+}
+
+} // namespace
+
+MPInt gcd(const MPInt& x, const MPInt& y)
+{
+  return gcdImpl(x, y, std::max(gcdLehmerThreshold, (size_t)2), gcdHalfThreshold);
+}
+
+MPInt gcdBinary(const MPInt& x, const MPInt& y)
+{
+  return gcdImpl(x, y, noThreshold, noThreshold);
+}
+
+MPInt gcdLehmer(const MPInt& x, const MPInt& y)
+{
+  return gcdImpl(x, y, 2, noThreshold);
+}
+
+MPInt gcdHalf(const MPInt& x, const MPInt& y)
+{
+  return gcdImpl(x, y, 2, hgcdBaseSize);
+}
+
+bool invert(MPInt& z, const MPInt& a, const MPInt& m, const bool constantTime)
+{
+  if (m.isZero()) {
+    throw std::invalid_argument("invert: m must not be zero");
+  }
+  MPInt am, x;
+  MPInt::absolute(am, m);
+  if (constantTime && ! am.isOdd()) {
+    throw std::invalid_argument("invert: the constant-time mode requires odd m");
+  }
+  if (am == 1) {
+    z = MPInt(0);
+    return true;
+  }
+  if (a.isNeg() || ! (a < am)) {
+    MPInt::mod(x, a, am);
+  } else {
+    x = a;
+  }
+
+  if (am.isOdd()) {
+    return inverseOdd(z, x, am, constantTime);
+  }
+
+  // m is even, so x has to be odd: t = m^(-1) mod x and z = (1 - t m)/x.
+  if (! x.isOdd()) {
+    return false;
+  }
+  if (x == 1) {
+    z = x;
+    return true;
+  }
+  MPInt w, t, q, r;
+  MPInt::mod(w, am, x);
+  if (! inverseOdd(t, w, x, false)) {
+    return false;
+  }
+  MPInt::mul(t, t, am);
+  MPInt::sub(t, MPInt(1), t);
+  MPInt::divmod(q, r, t, x);
+  assert(r.isZero());
+  MPInt::mod(z, q, am);
+  return true;
+}
+
+MPInt gcdext(MPInt& s, MPInt& t, const MPInt& x, const MPInt& y)
+{
+  MPInt ax, ay;
+  MPInt::absolute(ax, x);
+  MPInt::absolute(ay, y);
+
+  if (ay.isZero()) {
+    s = MPInt(x.sign());
+    t = MPInt(0);
+    return ax;
+  }
+  if (ax.isZero()) {
+    s = MPInt(0);
+    t = MPInt(y.sign());
+    return ay;
+  }
+
+  // g = s x + t y with x/g, y/g coprime, and one of them is odd.
+  const MPInt g = gcd(ax, ay);
+  MPInt xr, yr, w, r;
+  MPInt::divmod(xr, r, ax, g);
+  MPInt::divmod(yr, r, ay, g);
+
+  if (yr == 1) {
+    s = MPInt(0);
+    t = MPInt(1);
+  } else if (xr == 1) {
+    s = MPInt(1);
+    t = MPInt(0);
+  } else if (yr.isOdd()) {
+    MPInt::mod(w, xr, yr);
+    inverseOdd(s, w, yr, false);
+    MPInt::mul(w, s, ax);
+    MPInt::sub(w, g, w);
+    MPInt::divmod(t, r, w, ay);
+    assert(r.isZero());
+  } else {
+    MPInt::mod(w, yr, xr);
+    inverseOdd(t, w, xr, false);
+    MPInt::mul(w, t, ay);
+    MPInt::sub(w, g, w);
+    MPInt::divmod(s, r, w, ax);
+    assert(r.isZero());
+  }
+
+  if (x.isNeg()) {
+    MPInt::negation(s, s);
+  }
+  if (y.isNeg()) {
+    MPInt::negation(t, t);
+  }
+  return g;
+}
+
+} // namespace impl
+
+} // namespace integer
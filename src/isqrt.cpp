@@ -0,0 +1,779 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "isqrt.hpp"
+#include "kronecker-constexpr.hpp"
+#include "integer-util.hpp"
+
+namespace integer {
+
+namespace impl {
+
+size_t isqrtKaratsubaThreshold = 16;
+
+namespace {
+
+using mpint::MPInt;
+typedef MPInt::value_type value_type;
+typedef MPInt::dvalue_type dvalue_type;
+
+/*
+  floor(sqrt(x)) for a digit.
+*/
+value_type isqrt1(const value_type x)
+{
+  value_type s = (value_type)std::sqrt((double)x);
+  while ((dvalue_type)s * s > x) {
+    --s;
+  }
+  while ((dvalue_type)(s + 1) * (s + 1) <= x) {
+    ++s;
+  }
+  return s;
+}
+
+/*
+  z = x mod 2^k.
+*/
+void lowBits(MPInt& z, const MPInt& x, const size_t k)
+{
+  const size_t n = std::min(x.size(), (k + 63) / 64);
+  if (n == 0) {
+    z = MPInt(0);
+    return;
+  }
+  std::vector<value_type> d(x.get(), x.get() + n);
+  if (k % 64 != 0 && n == (k + 63) / 64) {
+    d[n - 1] &= ((value_type)1 << (k % 64)) - 1;
+  }
+  z.set(&d[0], n);
+}
+
+void checkNonNegative(const MPInt& x)
+{
+  if (x.isNeg()) {
+    throw std::invalid_argument("sqrtrem: x must be non-negative");
+  }
+}
+
+/*
+  Newton's iteration from above, starting at
+  (floor(sqrt(t)) + 1) 2^(e/2) >= sqrt(x) for the top digit t = floor(x/2^e) with even e,
+  so it has 32 correct bits.
+  @require: x > 0.
+*/
+void sqrtremNewton_(MPInt& s, MPInt& r, const MPInt& x)
+{
+  const size_t bits = bitLength(x);
+  if (bits <= 64) {
+    const value_type v = x[0];
+    const value_type t = isqrt1(v);
+    s = MPInt((int64_t)t);
+    r = MPInt((int64_t)(v - t*t));
+    return;
+  }
+  const size_t e = (bits - 64 + 1) & ~(size_t)1;
+  MPInt t, y, q;
+  MPInt::shr(t, x, e);
+  t = MPInt((int64_t)(isqrt1(t[0]) + 1));
+  MPInt::shl(s, t, e / 2);
+  for (;;) {
+    // y = (s + x/s)/2.
+    MPInt::divmod(q, r, x, s);
+    MPInt::add(y, s, q);
+    y >>= 1;
+    if (! (y < s)) {
+      break;
+    }
+    s.swap(y);
+  }
+  MPInt::mul(y, s, s);
+  MPInt::sub(r, x, y);
+}
+
+/*
+  Zimmermann's Karatsuba square root, Algorithm 1.12 of Brent and Zimmermann,
+  Modern Computer Arithmetic, on x = a3 b^3 + a2 b^2 + a1 b + a0 with b = 2^k:
+  (s', r') = sqrtrem(a3 b + a2), (q, u) = divmod(r' b + a1, 2 s'),
+  s = s' b + q, r = u b + a0 - q^2, and one correction if r < 0.
+  @require: x > 0.
+*/
+void sqrtremKaratsuba_(MPInt& s, MPInt& r, const MPInt& in_x, const size_t threshold)
+{
+  if (in_x.size() <= threshold) {
+    sqrtremNewton_(s, r, in_x);
+    return;
+  }
+
+  // a3 >= b/4 needs 4k - 1 <= bits <= 4k, otherwise x is multiplied by 4.
+  size_t bits = bitLength(in_x);
+  const size_t shift = (bits % 4 == 1 || bits % 4 == 2) ? 2 : 0;
+  MPInt x;
+  MPInt::shl(x, in_x, shift);
+  bits += shift;
+  const size_t k = (bits + 1) / 4;
+
+  MPInt a32, a1, a0, sp, rp, q, u, t, d;
+  MPInt::shr(a32, x, 2*k);
+  MPInt::shr(t, x, k);
+  lowBits(a1, t, k);
+  lowBits(a0, x, k);
+
+  sqrtremKaratsuba_(sp, rp, a32, threshold);
+
+  MPInt::shl(t, rp, k);
+  MPInt::add(t, t, a1);
+  MPInt::shl(d, sp, 1);
+  MPInt::divmod(q, u, t, d);
+  MPInt::shl(s, sp, k);
+  MPInt::add(s, s, q);
+  MPInt::shl(r, u, k);
+  MPInt::add(r, r, a0);
+  MPInt::mul(t, q, q);
+  MPInt::sub(r, r, t);
+  if (r.isNeg()) {
+    // r = r + 2s - 1, s = s - 1.
+    MPInt::add(r, r, s);
+    MPInt::add(r, r, s);
+    MPInt::sub(r, r, MPInt(1));
+    MPInt::sub(s, s, MPInt(1));
+  }
+
+  if (shift) {
+    // s = 2 s0 + e for the root s0 of x/4, x/4 - s0^2 = (r + e (2 s - 1))/4.
+    if (s.isOdd()) {
+      MPInt::add(r, r, s);
+      MPInt::add(r, r, s);
+      MPInt::sub(r, r, MPInt(1));
+    }
+    r >>= 2;
+    s >>= 1;
+  }
+}
+
+} // namespace
+
+void sqrtremNewton(MPInt& s, MPInt& r, const MPInt& x)
+{
+  checkNonNegative(x);
+  if (x.isZero()) {
+    s = MPInt(0);
+    r = MPInt(0);
+    return;
+  }
+  sqrtremNewton_(s, r, x);
+}
+
+void sqrtremKaratsuba(MPInt& s, MPInt& r, const MPInt& x)
+{
+  checkNonNegative(x);
+  if (x.isZero()) {
+    s = MPInt(0);
+    r = MPInt(0);
+    return;
+  }
+  sqrtremKaratsuba_(s, r, x, 2);
+}
+
+void sqrtrem(MPInt& s, MPInt& r, const MPInt& x)
+{
+  checkNonNegative(x);
+  if (x.isZero()) {
+    s = MPInt(0);
+    r = MPInt(0);
+    return;
+  }
+  sqrtremKaratsuba_(s, r, x, std::max(isqrtKaratsubaThreshold, (size_t)2));
+}
+
+MPInt isqrt(const MPInt& x)
+{
+  MPInt s, r;
+  sqrtrem(s, r, x);
+  return s;
+}
+
+bool isSquare(const MPInt& x)
+{
+  MPInt root;
+  return isSquare(root, x);
+}
+
+bool isSquare(MPInt& root, const MPInt& x)
+{
+  if (x.isNeg()) {
+    return false;
+  }
+  if (x.isZero()) {
+    root = MPInt(0);
+    return true;
+  }
+  if (! squares64[x[0] & 63]) {
+    return false;
+  }
+  const value_type m = 63*65*11;
+  const value_type r = MPInt::divrem_1(0, x.get(), x.size(), m);
+  if (! squares63[r % 63] || ! squares65[r % 65] || ! squares11[r % 11]) {
+    return false;
+  }
+  MPInt s, rem;
+  sqrtrem(s, rem, x);
+  if (! rem.isZero()) {
+    return false;
+  }
+  root.swap(s);
+  return true;
+}
+
+namespace {
+
+/*
+  z = y^e, e >= 1.
+*/
+void power(MPInt& z, const MPInt& y, size_t e)
+{
+  MPInt b(y), t;
+  z = MPInt(1);
+  for (;;) {
+    if (e & 1) {
+      MPInt::mul(t, z, b);
+      z.swap(t);
+    }
+    e >>= 1;
+    if (e == 0) {
+      break;
+    }
+    MPInt::mul(t, b, b);
+    b.swap(t);
+  }
+}
+
+/*
+  s = floor(x^(1/k)).
+  @require: x > 0, k >= 2.
+*/
+void irootNewton_(MPInt& s, const MPInt& x, const size_t k)
+{
+  const size_t bits = bitLength(x);
+  // the root has at most m bits.
+  const size_t m = (bits + k - 1) / k;
+  MPInt t, u, q, r;
+  if (m <= 32) {
+    // from log2(x) of the top digit, which is off by at most one.
+    double lg;
+    if (bits <= 64) {
+      lg = std::log2((double)x[0]);
+    } else {
+      MPInt::shr(t, x, bits - 64);
+      lg = std::log2((double)t[0]) + (double)(bits - 64);
+    }
+    int64_t y = (int64_t)std::exp2(lg / (double)k);
+    y = std::max(y, (int64_t)1);
+    power(t, MPInt(y), k);
+    while (x < t) {
+      --y;
+      power(t, MPInt(y), k);
+    }
+    for (;;) {
+      power(t, MPInt(y + 1), k);
+      if (x < t) {
+        break;
+      }
+      ++y;
+    }
+    s = MPInt(y);
+    return;
+  }
+
+  // (root of x/2^(k h) + 1) 2^h >= x^(1/k), and about h bits of it are correct.
+  const size_t h = m / 2;
+  MPInt::shr(t, x, k*h);
+  irootNewton_(u, t, k);
+  MPInt::add(u, u, MPInt(1));
+  MPInt::shl(s, u, h);
+  const MPInt k1((int64_t)(k - 1)), kk((int64_t)k);
+  for (;;) {
+    // u = ((k - 1) s + x/s^(k-1))/k.
+    power(t, s, k - 1);
+    MPInt::divmod(q, r, x, t);
+    MPInt::mul(t, s, k1);
+    MPInt::add(t, t, q);
+    MPInt::divmod(u, r, t, kk);
+    if (! (u < s)) {
+      break;
+    }
+    s.swap(u);
+  }
+}
+
+/*
+  Miller-Rabin to the bases 2, 7 and 61, exact below 2^32.
+*/
+bool isPrime32(const uint32_t n)
+{
+  if (n < 2) {
+    return false;
+  }
+  const uint32_t small[] = { 2, 3, 5, 7, 11, 13, 61 };
+  for (size_t i = 0; i < sizeof(small)/sizeof(small[0]); ++i) {
+    if (n % small[i] == 0) {
+      return n == small[i];
+    }
+  }
+  uint32_t d = n - 1;
+  int s = 0;
+  while (! (d & 1)) {
+    d >>= 1;
+    ++s;
+  }
+  const uint32_t bases[] = { 2, 7, 61 };
+  for (size_t i = 0; i < sizeof(bases)/sizeof(bases[0]); ++i) {
+    uint64_t y = powmod32(bases[i], d, n);
+    if (y == 1 || y == n - 1) {
+      continue;
+    }
+    int r = 1;
+    for (; r < s; ++r) {
+      y = y*y % n;
+      if (y == n - 1) {
+        break;
+      }
+    }
+    if (r == s) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+  x mod m by the division with a precomputed reciprocal of
+  Moller and Granlund, Improved division by invariant integers,
+  with 4 independent moduli in one pass over the digits of x,
+  which is several times faster than divrem_1 for each of them.
+*/
+struct Divisor {
+  // m << shift, which has the top bit set.
+  value_type d;
+  // floor((B^2 - 1)/d) - B.
+  value_type v;
+  unsigned shift;
+
+  Divisor() : d(0), v(0), shift(0) {}
+
+  explicit Divisor(const value_type m)
+    : d(0), v(0), shift((unsigned)__builtin_clzll(m))
+  {
+    d = m << shift;
+    v = (value_type)((((dvalue_type)~d << 64) | ~(value_type)0) / d);
+  }
+};
+
+/*
+  (u1 B + u0) mod d, u1 < d.
+*/
+inline value_type remPreinv(const value_type u1, const value_type u0, const Divisor& dv)
+{
+  const dvalue_type q = (dvalue_type)dv.v * u1 + (((dvalue_type)(u1 + 1) << 64) | u0);
+  value_type r = u0 - (value_type)(q >> 64) * dv.d;
+  if (r > (value_type)q) {
+    r += dv.d;
+  }
+  if (r >= dv.d) {
+    r -= dv.d;
+  }
+  return r;
+}
+
+/*
+  r[j] = x mod m[j] for j < 4, where dv[j] = Divisor(m[j]).
+*/
+void residues4(value_type* r, const value_type* x, const size_t n, const Divisor* dv)
+{
+  value_type t[4];
+  for (size_t j = 0; j < 4; ++j) {
+    // the digit shifted out of x << shift.
+    t[j] = dv[j].shift ? x[n - 1] >> (64 - dv[j].shift) : 0;
+  }
+  for (size_t i = n; i > 0; --i) {
+    for (size_t j = 0; j < 4; ++j) {
+      const unsigned s = dv[j].shift;
+      const value_type u0 = (x[i - 1] << s) | (s && i > 1 ? x[i - 2] >> (64 - s) : 0);
+      t[j] = remPreinv(t[j], u0, dv[j]);
+    }
+  }
+  for (size_t j = 0; j < 4; ++j) {
+    r[j] = t[j] >> dv[j].shift;
+  }
+}
+
+/*
+  Odd primes p < trialBound are divided out before the roots,
+  since k must divide the multiplicity of each of them.
+  The first group is the product of p^2 for p <= 29, so it also tells
+  whether the multiplicity is 1 for them.
+*/
+const uint32_t trialBound = 256;
+
+/*
+  Moduli q = 1 mod k of the k-th power residue tests for the odd primes
+  k < powerFilterBound.
+  Below smallPowerBound, q < 2^16 and a test passes a random x with
+  probability about 1/k, so about 24/log2(k) of them are used for each k.
+  Above it, one q < 2^32 is enough.
+  Moduli are grouped in the order of k, so that the product of each
+  group fits in a digit, and residues are computed for 4 groups at once.
+*/
+const uint32_t powerFilterBound = 1 << 16;
+const uint32_t smallPowerBound = 256;
+
+struct PowerFilter {
+  struct Test {
+    uint32_t q;
+    // x is a k-th power residue iff x^e = 1 mod q, e = (q - 1)/k.
+    uint32_t e;
+    size_t group;
+  };
+  // odd primes k, and the tests of k[i] are tests[first[i], first[i + 1]).
+  std::vector<uint32_t> k;
+  std::vector<size_t> first;
+  std::vector<Test> tests;
+  // a multiple of 4 groups.
+  std::vector<Divisor> group;
+
+  // odd primes below trialBound, and the groups of them.
+  std::vector<uint32_t> trial;
+  std::vector<size_t> trialGroup;
+  std::vector<Divisor> trialDivisor;
+
+  PowerFilter()
+  {
+    first.push_back(0);
+    for (uint32_t p = 3; p < powerFilterBound; p += 2) {
+      if (! isPrime32(p)) {
+        continue;
+      }
+      if (p < trialBound) {
+        trial.push_back(p);
+      }
+      k.push_back(p);
+      const size_t count = p < smallPowerBound ? (size_t)std::ceil(24 / std::log2((double)p)) : 1;
+      const uint32_t limit = p < smallPowerBound ? 1 << 16 : 0xffffffff;
+      for (uint32_t c = 2*p + 1; c < limit - 2*p && tests.size() - first.back() < count; c += 2*p) {
+        if (isPrime32(c)) {
+          const Test t = { c, (c - 1) / p, 0 };
+          tests.push_back(t);
+        }
+      }
+      first.push_back(tests.size());
+    }
+
+    std::vector<std::pair<uint32_t, size_t> > seen;
+    value_type prod = 1;
+    for (size_t i = 0; i < tests.size(); ++i) {
+      const uint32_t q = tests[i].q;
+      size_t j = 0;
+      while (j < seen.size() && seen[j].first != q) {
+        ++j;
+      }
+      if (j < seen.size()) {
+        tests[i].group = seen[j].second;
+        continue;
+      }
+      if ((dvalue_type)prod * q >> 64) {
+        group.push_back(Divisor(prod));
+        prod = 1;
+      }
+      prod *= q;
+      tests[i].group = group.size();
+      seen.push_back(std::make_pair(q, group.size()));
+      // only recent moduli are shared, between the small k.
+      if (seen.size() > 512) {
+        seen.erase(seen.begin());
+      }
+    }
+    group.push_back(Divisor(prod));
+    while (group.size() % 4 != 0) {
+      group.push_back(Divisor(3));
+    }
+
+    prod = 1;
+    for (size_t i = 0; i < trial.size(); ++i) {
+      const value_type p = trial[i] <= 29 ? trial[i]*trial[i] : trial[i];
+      if ((dvalue_type)prod * p >> 64) {
+        trialDivisor.push_back(Divisor(prod));
+        prod = 1;
+      }
+      prod *= p;
+      trialGroup.push_back(trialDivisor.size());
+    }
+    trialDivisor.push_back(Divisor(prod));
+    while (trialDivisor.size() % 4 != 0) {
+      trialDivisor.push_back(Divisor(3));
+    }
+  }
+};
+
+const PowerFilter& powerFilter()
+{
+  static const PowerFilter f;
+  return f;
+}
+
+/*
+  Residues of x modulo the groups of the filter, computed when they are needed.
+*/
+class GroupResidues {
+public:
+  GroupResidues(const MPInt& x, const PowerFilter& f)
+    : x_(x), f_(f), r_(f.group.size()), known_(f.group.size() / 4, false) {}
+
+  uint32_t operator()(const PowerFilter::Test& t)
+  {
+    const size_t g = t.group / 4;
+    if (! known_[g]) {
+      residues4(&r_[4*g], x_.get(), x_.size(), &f_.group[4*g]);
+      known_[g] = true;
+    }
+    return (uint32_t)(r_[t.group] % t.q);
+  }
+
+private:
+  const MPInt& x_;
+  const PowerFilter& f_;
+  std::vector<value_type> r_;
+  std::vector<bool> known_;
+};
+
+/*
+  Whether x passes the k-th power residue tests modulo q = 1 mod k.
+*/
+bool passesResidueTest(const uint32_t r, const uint32_t q, const uint32_t e)
+{
+  return r == 0 || powmod32(r, e, q) == 1;
+}
+
+/*
+  x = root^k for k >= 3.
+*/
+bool isPower(MPInt& root, const MPInt& x, const size_t k)
+{
+  MPInt s, t;
+  irootNewton_(s, x, k);
+  power(t, s, k);
+  if (! (t == x)) {
+    return false;
+  }
+  root.swap(s);
+  return true;
+}
+
+/*
+  The multiplicity of p in x, p | x.
+*/
+size_t multiplicity(const MPInt& x, const value_type p)
+{
+  std::vector<value_type> q(x.get(), x.get() + x.size());
+  size_t n = q.size();
+  size_t v = 0;
+  while (MPInt::divrem_1(&q[0], &q[0], n, p) == 0) {
+    ++v;
+    while (n > 0 && q[n - 1] == 0) {
+      --n;
+    }
+  }
+  return v;
+}
+
+size_t gcd(size_t a, size_t b)
+{
+  while (b) {
+    const size_t t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+} // namespace
+
+void rootrem(MPInt& s, MPInt& r, const MPInt& x, const size_t k)
+{
+  if (k == 0 || (k % 2 == 0 && x.isNeg())) {
+    throw std::invalid_argument("rootrem: k must be positive, and x must be non-negative for even k");
+  }
+  MPInt a, t;
+  MPInt::absolute(a, x);
+  if (k == 1) {
+    s = x;
+    r = MPInt(0);
+    return;
+  }
+  if (a.isZero()) {
+    s = MPInt(0);
+    r = MPInt(0);
+    return;
+  }
+  if (k == 2) {
+    sqrtrem(s, r, a);
+    return;
+  }
+  irootNewton_(s, a, k);
+  power(t, s, k);
+  MPInt::sub(r, a, t);
+  if (x.isNeg()) {
+    MPInt::sub(s, MPInt(0), s);
+    MPInt::sub(r, MPInt(0), r);
+  }
+}
+
+MPInt iroot(const MPInt& x, const size_t k)
+{
+  MPInt s, r;
+  rootrem(s, r, x, k);
+  return s;
+}
+
+bool isPerfectPower(const MPInt& x)
+{
+  MPInt root;
+  size_t k;
+  return isPerfectPower(root, k, x);
+}
+
+bool isPerfectPower(MPInt& root, size_t& k, const MPInt& x)
+{
+  MPInt a;
+  MPInt::absolute(a, x);
+  if (a < 2) {
+    return true;
+  }
+  const bool neg = x.isNeg();
+  const size_t bits = bitLength(a);
+
+  // g is the gcd of the multiplicities of the primes below trialBound,
+  // 0 if none of them divides a.
+  size_t g = a.NTZ();
+  if (g == 1) {
+    return false;
+  }
+  const PowerFilter& f = powerFilter();
+  {
+    // 4 groups at a time, most of random a are rejected by the first of them.
+    value_type r[4];
+    for (size_t i = 0; i < f.trial.size(); ++i) {
+      const size_t group = f.trialGroup[i];
+      if (i == 0 || group != f.trialGroup[i - 1]) {
+        if (group % 4 == 0) {
+          residues4(r, a.get(), a.size(), &f.trialDivisor[group]);
+        }
+      }
+      const value_type p = f.trial[i];
+      const value_type ri = r[group % 4];
+      if (ri % p != 0) {
+        continue;
+      }
+      if (p <= 29 && ri % (p*p) != 0) {
+        return false;
+      }
+      g = gcd(g, multiplicity(a, p));
+      if (g == 1) {
+        return false;
+      }
+    }
+  }
+
+  MPInt s;
+  if (! neg && g % 2 == 0 && isSquare(s, a)) {
+    root.swap(s);
+    k = 2;
+    return true;
+  }
+
+  /*
+    k must divide g, or the root has no prime factor below trialBound,
+    and then k <= log(a)/log(trialBound) < bits/7.
+  */
+  const size_t kmax = g ? g : bits / 7;
+  GroupResidues residues(a, f);
+  for (size_t i = 0; i < f.k.size() && f.k[i] <= kmax; ++i) {
+    const uint32_t p = f.k[i];
+    if (g != 0 && g % p != 0) {
+      continue;
+    }
+    bool pass = true;
+    for (size_t j = f.first[i]; pass && j < f.first[i + 1]; ++j) {
+      const PowerFilter::Test& t = f.tests[j];
+      pass = passesResidueTest(residues(t), t.q, t.e);
+    }
+    if (pass && isPower(s, a, p)) {
+      if (neg) {
+        MPInt::sub(s, MPInt(0), s);
+      }
+      root.swap(s);
+      k = p;
+      return true;
+    }
+  }
+
+  // larger primes for more than 2^16 * 7 bits, with a modulus found here.
+  for (uint32_t p = powerFilterBound + 1; p <= kmax; p += 2) {
+    if (! isPrime32(p) || (g != 0 && g % p != 0)) {
+      continue;
+    }
+    uint64_t q = 2*(uint64_t)p + 1;
+    while (q < ((uint64_t)1 << 32) && ! isPrime32((uint32_t)q)) {
+      q += 2*p;
+    }
+    if (q < ((uint64_t)1 << 32)) {
+      const uint32_t r = (uint32_t)MPInt::divrem_1(0, a.get(), a.size(), q);
+      if (! passesResidueTest(r, (uint32_t)q, (uint32_t)((q - 1) / p))) {
+        continue;
+      }
+    }
+    if (isPower(s, a, p)) {
+      if (neg) {
+        MPInt::sub(s, MPInt(0), s);
+      }
+      root.swap(s);
+      k = p;
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace impl
+
+} // namespace integer
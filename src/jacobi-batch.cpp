@@ -0,0 +1,320 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <vector>
+#include <immintrin.h>
+
+#include "jacobi-batch.hpp"
+#include "divsteps.hpp"
+
+namespace integer {
+
+namespace {
+
+using mpint::MPInt;
+using impl::divsteps::Trans;
+using impl::divsteps::posdivsteps;
+using impl::divsteps::apply;
+using impl::divsteps::equal;
+using impl::divsteps::normalized;
+typedef MPInt::value_type value_type;
+
+/*
+  Number of values of the AVX2 kernel at once.
+*/
+const size_t lanes = 4;
+
+/*
+  (g/f) when f = g = gcd of the inputs.
+*/
+inline int8_t result(const value_type* f, const size_t len, const unsigned jac)
+{
+  if (normalized(f, len) != 1 || f[0] != 1) {
+    return 0;
+  }
+  return (jac & 1) ? -1 : 1;
+}
+
+void symbolsPortable(int8_t* s, const value_type* x, const size_t count, const value_type* m, const size_t n)
+{
+  std::vector<value_type> buf(4*n + 2);
+  value_type* f = &buf[0];
+  value_type* g = f + n;
+  value_type* tf = g + n;
+  value_type* tg = tf + n + 1;
+
+  for (size_t i = 0; i < count; ++i) {
+    const value_type* xi = x + i*n;
+    if (normalized(xi, n) == 0) {
+      s[i] = 0;
+      continue;
+    }
+    std::copy(m, m + n, f);
+    std::copy(xi, xi + n, g);
+    int64_t eta = -1;
+    unsigned jac = 0;
+    Trans t;
+    size_t len = n;
+    while (! equal(f, g, len)) {
+      eta = posdivsteps(eta, f[0], g[0], t, jac);
+      apply(f, g, tf, tg, len, t);
+      len = std::max(normalized(f, len), normalized(g, len));
+    }
+    s[i] = result(f, len, jac);
+  }
+}
+
+/*
+  62 posdivsteps of posdivstepsConstTime in divsteps.hpp
+  for the low digits of 4 lanes.
+*/
+__attribute__((target("avx2")))
+void posdivstepsAvx2(int64_t* eta, const value_type* f0, const value_type* g0, Trans* t, unsigned* jac)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i one = _mm256_set1_epi64x(1);
+  __m256i f = _mm256_loadu_si256((const __m256i*)f0);
+  __m256i g = _mm256_loadu_si256((const __m256i*)g0);
+  __m256i e = _mm256_loadu_si256((const __m256i*)eta);
+  __m256i u = one, v = zero, q = zero, r = one;
+  __m256i j = _mm256_set_epi64x(jac[3], jac[2], jac[1], jac[0]);
+
+  for (int i = 0; i < 62; ++i) {
+    const __m256i odd = _mm256_sub_epi64(zero, _mm256_and_si256(g, one));
+    const __m256i sw = _mm256_and_si256(odd, _mm256_cmpgt_epi64(zero, e));
+    __m256i d;
+    d = _mm256_and_si256(_mm256_xor_si256(f, g), sw);
+    f = _mm256_xor_si256(f, d);
+    g = _mm256_xor_si256(g, d);
+    d = _mm256_and_si256(_mm256_xor_si256(u, q), sw);
+    u = _mm256_xor_si256(u, d);
+    q = _mm256_xor_si256(q, d);
+    d = _mm256_and_si256(_mm256_xor_si256(v, r), sw);
+    v = _mm256_xor_si256(v, d);
+    r = _mm256_xor_si256(r, d);
+    e = _mm256_sub_epi64(_mm256_xor_si256(e, sw), sw);
+    j = _mm256_xor_si256(j, _mm256_and_si256(sw, _mm256_srli_epi64(_mm256_and_si256(f, g), 1)));
+
+    g = _mm256_add_epi64(g, _mm256_and_si256(f, odd));
+    q = _mm256_add_epi64(q, _mm256_and_si256(u, odd));
+    r = _mm256_add_epi64(r, _mm256_and_si256(v, odd));
+
+    g = _mm256_srli_epi64(g, 1);
+    u = _mm256_slli_epi64(u, 1);
+    v = _mm256_slli_epi64(v, 1);
+    e = _mm256_sub_epi64(e, one);
+    j = _mm256_xor_si256(j, _mm256_xor_si256(_mm256_srli_epi64(f, 1), _mm256_srli_epi64(f, 2)));
+  }
+
+  _mm256_storeu_si256((__m256i*)eta, e);
+  value_type a[lanes];
+  _mm256_storeu_si256((__m256i*)a, j);
+  for (size_t l = 0; l < lanes; ++l) {
+    jac[l] = (unsigned)(a[l] & 1);
+  }
+  value_type b[4][lanes];
+  _mm256_storeu_si256((__m256i*)b[0], u);
+  _mm256_storeu_si256((__m256i*)b[1], v);
+  _mm256_storeu_si256((__m256i*)b[2], q);
+  _mm256_storeu_si256((__m256i*)b[3], r);
+  for (size_t l = 0; l < lanes; ++l) {
+    t[l].u = b[0][l];
+    t[l].v = b[1][l];
+    t[l].q = b[2][l];
+    t[l].r = b[3][l];
+  }
+}
+
+/*
+  symbolsAvx2 for n = 1, the steps are done on the values themselves.
+  (g + f)/2 is (g >> 1) + (f >> 1) + 1 for odd f and g not to overflow.
+  A lane which has finished is refilled with the next value,
+  and a lane without values stays f = g = m.
+*/
+__attribute__((target("avx2")))
+void symbolsAvx2Digit(int8_t* s, const value_type* x, const size_t count, const value_type m)
+{
+  const size_t none = ~size_t(0);
+  value_type f[lanes], g[lanes], j[lanes];
+  int64_t eta[lanes];
+  size_t idx[lanes];
+  size_t next = 0;
+  size_t active = 0;
+
+  for (size_t l = 0; l < lanes; ++l) {
+    idx[l] = none;
+  }
+  for (;;) {
+    // results of the finished lanes and refill.
+    for (size_t l = 0; l < lanes; ++l) {
+      if (idx[l] != none && f[l] == g[l]) {
+        s[idx[l]] = f[l] != 1 ? 0 : (j[l] & 1) ? -1 : 1;
+        idx[l] = none;
+        --active;
+      }
+      if (idx[l] == none) {
+        while (next < count && x[next] == 0) {
+          s[next++] = 0;
+        }
+        f[l] = m;
+        if (next < count) {
+          idx[l] = next;
+          g[l] = x[next++];
+          ++active;
+        } else {
+          g[l] = m;
+        }
+        eta[l] = -1;
+        j[l] = 0;
+      }
+    }
+    if (active == 0) {
+      break;
+    }
+
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi64x(1);
+    __m256i vf = _mm256_loadu_si256((const __m256i*)f);
+    __m256i vg = _mm256_loadu_si256((const __m256i*)g);
+    __m256i ve = _mm256_loadu_si256((const __m256i*)eta);
+    __m256i vj = _mm256_loadu_si256((const __m256i*)j);
+    int done;
+    do {
+      for (int i = 0; i < 8; ++i) {
+        const __m256i odd = _mm256_sub_epi64(zero, _mm256_and_si256(vg, one));
+        const __m256i sw = _mm256_and_si256(odd, _mm256_cmpgt_epi64(zero, ve));
+        const __m256i d = _mm256_and_si256(_mm256_xor_si256(vf, vg), sw);
+        vf = _mm256_xor_si256(vf, d);
+        vg = _mm256_xor_si256(vg, d);
+        ve = _mm256_sub_epi64(_mm256_xor_si256(ve, sw), sw);
+        vj = _mm256_xor_si256(vj, _mm256_and_si256(sw, _mm256_srli_epi64(_mm256_and_si256(vf, vg), 1)));
+
+        const __m256i h = _mm256_add_epi64(_mm256_srli_epi64(vf, 1), one);
+        vg = _mm256_add_epi64(_mm256_srli_epi64(vg, 1), _mm256_and_si256(h, odd));
+        ve = _mm256_sub_epi64(ve, one);
+        vj = _mm256_xor_si256(vj, _mm256_xor_si256(_mm256_srli_epi64(vf, 1), _mm256_srli_epi64(vf, 2)));
+      }
+      done = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(vf, vg)));
+    } while (done == 0);
+    _mm256_storeu_si256((__m256i*)f, vf);
+    _mm256_storeu_si256((__m256i*)g, vg);
+    _mm256_storeu_si256((__m256i*)eta, ve);
+    _mm256_storeu_si256((__m256i*)j, vj);
+  }
+}
+
+/*
+  A lane which has finished stays f = g, and an unused lane starts at f = g = m.
+*/
+__attribute__((target("avx2")))
+void symbolsAvx2(int8_t* s, const value_type* x, const size_t count, const value_type* m, const size_t n)
+{
+  if (n == 1) {
+    symbolsAvx2Digit(s, x, count, m[0]);
+    return;
+  }
+
+  const size_t stride = 4*n + 2;
+  std::vector<value_type> buf(lanes*stride);
+  value_type* f[lanes];
+  value_type* g[lanes];
+  value_type* tf[lanes];
+  value_type* tg[lanes];
+  for (size_t l = 0; l < lanes; ++l) {
+    f[l] = &buf[l*stride];
+    g[l] = f[l] + n;
+    tf[l] = g[l] + n;
+    tg[l] = tf[l] + n + 1;
+  }
+
+  for (size_t i = 0; i < count; i += lanes) {
+    int64_t eta[lanes];
+    unsigned jac[lanes];
+    for (size_t l = 0; l < lanes; ++l) {
+      std::copy(m, m + n, f[l]);
+      if (i + l < count && normalized(x + (i + l)*n, n) != 0) {
+        std::copy(x + (i + l)*n, x + (i + l + 1)*n, g[l]);
+      } else {
+        std::copy(m, m + n, g[l]);
+      }
+      eta[l] = -1;
+      jac[l] = 0;
+    }
+
+    size_t len = n;
+    for (;;) {
+      bool done = true;
+      for (size_t l = 0; l < lanes; ++l) {
+        done = done && equal(f[l], g[l], len);
+      }
+      if (done) {
+        break;
+      }
+      value_type f0[lanes], g0[lanes];
+      for (size_t l = 0; l < lanes; ++l) {
+        f0[l] = f[l][0];
+        g0[l] = g[l][0];
+      }
+      Trans t[lanes];
+      posdivstepsAvx2(eta, f0, g0, t, jac);
+      size_t next = 0;
+      for (size_t l = 0; l < lanes; ++l) {
+        apply(f[l], g[l], tf[l], tg[l], len, t[l]);
+        next = std::max(next, std::max(normalized(f[l], len), normalized(g[l], len)));
+      }
+      len = next;
+    }
+
+    for (size_t l = 0; l < lanes && i + l < count; ++l) {
+      s[i + l] = result(f[l], len, jac[l]);
+    }
+  }
+}
+
+} // namespace
+
+int JacobiBatch::version_ = -1;
+
+JacobiBatch::JacobiBatch(const MPInt& m)
+  : m_(m),
+    symbols_(version_ != 0 && __builtin_cpu_supports("avx2") ? symbolsAvx2 : symbolsPortable)
+{
+  if (! m.isOdd() || ! (m > 1)) {
+    throw std::invalid_argument("JacobiBatch: m must be odd and greater than 1");
+  }
+}
+
+void JacobiBatch::codeGen(const int version)
+{
+  version_ = version;
+}
+
+} // namespace integer
@@ -0,0 +1,132 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+#include "mpint.hpp"
+#include "kronecker-jacobi.hpp"
+#include "divsteps.hpp"
+
+namespace integer {
+
+extern int tbl1[];
+
+namespace impl {
+
+using mpint::MPInt;
+
+/*
+  Kronecker-divsteps
+*/
+int kroneckerDivsteps(const mpint::MPInt& in_x, const mpint::MPInt& in_y, const bool constantTime)
+{
+  using namespace divsteps;
+
+  MPInt x(in_x), y(in_y);
+
+  // #1
+  if (y.isZero()) {
+    return x.size() == 1 && x[0] == 1 ? 1 : 0;
+  }
+
+  // #2
+  if (! ((x[0] | y[0]) & 0x1)) {
+    return 0;
+  }
+  size_t v = y.NTZ();
+  y >>= v;
+  int k; // return value.
+  if (! (v & 0x1)) {
+    k = 1;
+  } else {
+    k = tbl1[x[0] & 0x7];
+  }
+  // @note: the shift above drops the sign of y.
+  if (in_y.isNeg() && x.isNeg()) {
+    k = -k;
+  }
+  MPInt::absolute(y, y);
+
+  // #3
+  if (x < 0) {
+    if ((y[0] & 0x3) == 0x3) {
+      k = -k;
+    }
+  }
+  MPInt::absolute(x, x);
+
+  if (x.isZero()) {
+    return y == 1 ? k : 0;
+  }
+
+  // #4: (g/f) with f = y, g = x, both are not negative.
+  const size_t n = std::max(x.size(), y.size());
+  std::vector<value_type> buf(4*n + 2, 0);
+  value_type* f = &buf[0];
+  value_type* g = f + n;
+  value_type* tf = g + n;
+  value_type* tg = tf + n + 1;
+  std::copy(y.get(), y.get() + y.size(), f);
+  std::copy(x.get(), x.get() + x.size(), g);
+
+  int64_t eta = -1;
+  unsigned jac = 0;
+  Trans t;
+  if (constantTime) {
+    /*
+      @note: no bound of posdivsteps is proven, 3.6 steps per bit are
+      needed at most for random inputs and 6 steps per bit are done.
+      An input beyond the bound is finished by the variable time loop below,
+      so this is a best effort fixed batch count, not constant time.
+    */
+    const size_t batches = (6*64*n + 61) / 62;
+    for (size_t i = 0; i < batches; ++i) {
+      eta = posdivstepsConstTime(eta, f[0], g[0], t, jac);
+      apply(f, g, tf, tg, n, t);
+    }
+  }
+
+  // #5: until f = g = gcd(x, y).
+  size_t len = n;
+  while (! equal(f, g, len)) {
+    eta = posdivsteps(eta, f[0], g[0], t, jac);
+    apply(f, g, tf, tg, len, t);
+    len = std::max(normalized(f, len), normalized(g, len));
+  }
+
+  if (normalized(f, len) != 1 || f[0] != 1) {
+    return 0;
+  }
+  return (jac & 1) ? -k : k;
+}
+
+} // namespace impl
+
+} // namespace integer
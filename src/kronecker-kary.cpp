@@ -0,0 +1,346 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "mpint.hpp"
+#include "kronecker-jacobi.hpp"
+
+namespace integer {
+
+extern int tbl1[];
+
+namespace impl {
+
+namespace {
+
+using mpint::MPInt;
+typedef MPInt::value_type value_type;
+
+/*
+  For each odd x < k = 2^logK, (a, b) such that a x + b = 0 mod k,
+  0 < a <= sqrt(k) and |b| <= sqrt(k), indexed by x/2.
+  Such a pair exists by the pigeonhole principle (Sorenson).
+*/
+struct KaryTable {
+  std::vector<uint16_t> a;
+  std::vector<int16_t> b;
+
+  void build(const size_t logK);
+};
+
+void KaryTable::build(const size_t logK)
+{
+  const int64_t k = int64_t(1) << logK;
+  const int64_t s = int64_t(1) << (logK / 2);
+  a.resize(k / 2);
+  b.resize(k / 2);
+  for (int64_t x = 1; x < k; x += 2) {
+    int64_t bestA = 0, bestB = 0, best = k;
+    for (int64_t i = 1; i <= s; ++i) {
+      int64_t j = (-i*x) & (k - 1);
+      if (j > k / 2) {
+        j -= k;
+      }
+      const int64_t m = std::max(i, j < 0 ? -j : j);
+      if (m < best) {
+        best = m;
+        bestA = i;
+        bestB = j;
+      }
+    }
+    assert(best <= s);
+    a[x / 2] = (uint16_t)bestA;
+    b[x / 2] = (int16_t)bestB;
+  }
+}
+
+const KaryTable& karyTable(const size_t logK)
+{
+  static KaryTable tables[9];
+  static std::once_flag flags[9];
+  std::call_once(flags[logK / 2], &KaryTable::build, &tables[logK / 2], logK);
+  return tables[logK / 2];
+}
+
+/*
+  (r/a) for odd a < 256 and r < a.
+*/
+struct SmallJacobi {
+  std::vector<signed char> t;
+
+  SmallJacobi()
+    : t(128 * 256, 0)
+  {
+    for (int64_t a = 1; a < 256; a += 2) {
+      for (int64_t r = 0; r < a; ++r) {
+        t[(a / 2) * 256 + r] = (signed char)integer::kronecker(r, a);
+      }
+    }
+  }
+
+  int operator()(const value_type r, const value_type a) const
+  { return t[(a / 2) * 256 + r]; }
+};
+
+/*
+  Jacobi symbol (x/y) of single digits.
+  @require: y is odd.
+*/
+int jacobi1(value_type x, value_type y)
+{
+  int k = 1;
+  x %= y;
+  while (x != 0) {
+    const int z = __builtin_ctzll(x);
+    x >>= z;
+    if (z & 0x1) {
+      k *= tbl1[y & 0x7];
+    }
+    if (x & y & 0x2) {
+      k = -k;
+    }
+    std::swap(x, y);
+    x %= y;
+  }
+  return y == 1 ? k : 0;
+}
+
+/*
+  (a/v), 0 if gcd(a, v) > 1.
+  @require: v[0..n) is odd, 0 < a <= 256.
+*/
+int jacobiSmall(const SmallJacobi& tbl, const value_type a, const value_type* v, const size_t n)
+{
+  const int z = __builtin_ctzll(a);
+  const value_type oa = a >> z;
+  int k = (z & 0x1) ? tbl1[v[0] & 0x7] : 1;
+  if (oa == 1) {
+    return k;
+  }
+  k *= tbl(MPInt::divrem_1(0, v, n, oa), oa);
+  if (oa & v[0] & 0x2) {
+    k = -k;
+  }
+  return k;
+}
+
+inline size_t normalized(const value_type* x, size_t n)
+{
+  while (n > 0 && x[n - 1] == 0) {
+    --n;
+  }
+  return n;
+}
+
+inline bool less(const value_type* x, const size_t xn, const value_type* y, const size_t yn)
+{
+  return xn != yn ? xn < yn : MPInt::cmp_n(x, y, xn) < 0;
+}
+
+/*
+  Remove the factors 2 of w[0..n) and multiply k by (2/v)
+  for each of them.
+  @require: w[0..n) != 0, n = normalized(w, n).
+  @return: new size of w.
+*/
+size_t shiftOut(value_type* w, size_t n, const value_type v0, int& k)
+{
+  size_t d = 0;
+  while (w[d] == 0) {
+    ++d;
+  }
+  const int s = __builtin_ctzll(w[d]);
+  if (s & 0x1) {
+    k *= tbl1[v0 & 0x7];
+  }
+  n -= d;
+  if (s == 0) {
+    std::copy(w + d, w + d + n, w);
+  } else {
+    for (size_t i = 0; i + 1 < n; ++i) {
+      w[i] = (w[i + d] >> s) | (w[i + d + 1] << (64 - s));
+    }
+    w[n - 1] = w[n - 1 + d] >> s;
+  }
+  return normalized(w, n);
+}
+
+} // namespace
+
+/*
+  Kronecker-kary
+*/
+int kroneckerKary(const mpint::MPInt& in_x, const mpint::MPInt& in_y, const size_t logK)
+{
+  if (logK < 4 || logK > 16 || (logK & 0x1)) {
+    throw std::invalid_argument("kroneckerKary: logK must be even and in [4, 16]");
+  }
+  const KaryTable& kary = karyTable(logK);
+  static const SmallJacobi small;
+
+  MPInt x(in_x), y(in_y);
+
+  // #1
+  if (y.isZero()) {
+    return x.size() == 1 && x[0] == 1 ? 1 : 0;
+  }
+
+  // #2
+  if (! ((x[0] | y[0]) & 0x1)) {
+    return 0;
+  }
+  const size_t e = y.NTZ();
+  y >>= e;
+  int k; // return value.
+  if (! (e & 0x1)) {
+    k = 1;
+  } else {
+    k = tbl1[x[0] & 0x7];
+  }
+  // @note: the shift above drops the sign of y.
+  if (in_y.isNeg() && x.isNeg()) {
+    k = -k;
+  }
+  MPInt::absolute(y, y);
+
+  // #3
+  if (x < 0) {
+    if ((y[0] & 0x3) == 0x3) {
+      k = -k;
+    }
+  }
+  MPInt::absolute(x, x);
+
+  if (x.isZero()) {
+    return y == 1 ? k : 0;
+  }
+
+  // #4: (u/v) with odd u >= v > 0.
+  const size_t n = std::max(x.size(), y.size());
+  std::vector<value_type> buf(3*(n + 2), 0);
+  value_type* u = &buf[0];
+  value_type* w = u + n + 2;
+  value_type* v = w + n + 2;
+  std::copy(y.get(), y.get() + y.size(), v);
+  std::copy(x.get(), x.get() + x.size(), u);
+  size_t un = shiftOut(u, x.size(), v[0], k);
+  size_t vn = y.size();
+  if (less(u, un, v, vn)) {
+    std::swap(u, v);
+    std::swap(un, vn);
+    if (u[0] & v[0] & 0x2) {
+      k = -k;
+    }
+  }
+
+  const value_type mask = (value_type(1) << logK) - 1;
+  for (;;) {
+    assert(un >= vn && (u[0] & v[0] & 0x1));
+
+    // #5
+    if (vn == 1) {
+      const value_type r = MPInt::divrem_1(0, u, un, v[0]);
+      return k * jacobi1(r, v[0]);
+    }
+
+    size_t wn;
+    if (un > vn + 1) {
+      // #6: w = u mod v for the unbalanced sizes.
+      MPInt::divrem_n(0, w, u, un, v, vn);
+      wn = normalized(w, vn);
+    } else {
+      // #7: w = a u + b v with a u + b v = 0 mod 2^logK.
+      value_type inv = v[0]; // 3 bits.
+      inv *= 2 - v[0]*inv;
+      inv *= 2 - v[0]*inv;
+      inv *= 2 - v[0]*inv; // 24 bits.
+      const size_t i = ((u[0]*inv) & mask) >> 1;
+      const value_type a = kary.a[i];
+      const int b = kary.b[i];
+
+      // (a u / v) = (w / v), and (a/v) = 0 if gcd(a, v) > 1.
+      const int s = jacobiSmall(small, a, v, vn);
+      if (s == 0) {
+        // one binary step instead.
+        const value_type c = MPInt::sub_n(w, u, v, vn);
+        MPInt::sub_1(w + vn, u + vn, un - vn, c);
+        w[un] = 0;
+      } else {
+        k *= s;
+        w[un] = MPInt::mul_1(w, u, un, a);
+        if (b >= 0) {
+          const value_type c = MPInt::addmul_1(w, v, vn, (value_type)b);
+          MPInt::add_1(w + vn, w + vn, un + 1 - vn, c);
+        } else {
+          value_type c = MPInt::submul_1(w, v, vn, (value_type)-b);
+          c = MPInt::sub_1(w + vn, w + vn, un + 1 - vn, c);
+          if (c) {
+            // w = -w.
+            value_type carry = 1;
+            for (size_t j = 0; j <= un; ++j) {
+              w[j] = ~w[j] + carry;
+              carry = carry && w[j] == 0;
+            }
+            if (v[0] & 0x2) {
+              k = -k;
+            }
+          }
+        }
+      }
+      wn = normalized(w, un + 1);
+    }
+
+    // gcd(u, v) > 1 if w = 0 since v > 2^64.
+    if (wn == 0) {
+      return 0;
+    }
+    wn = shiftOut(w, wn, v[0], k);
+    assert(! less(u, un, w, wn));
+
+    // #8: u = w, then keep u >= v.
+    std::swap(u, w);
+    un = wn;
+    if (less(u, un, v, vn)) {
+      std::swap(u, v);
+      std::swap(un, vn);
+      if (u[0] & v[0] & 0x2) {
+        k = -k;
+      }
+    }
+  }
+}
+
+} // namespace impl
+
+} // namespace integer
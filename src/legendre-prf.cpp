@@ -0,0 +1,127 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "legendre-prf.hpp"
+#include "kronecker-jacobi.hpp"
+
+namespace integer {
+
+using mpint::MPInt;
+typedef MPInt::value_type value_type;
+
+namespace {
+
+/*
+  @return: k + i.
+*/
+MPInt offset(const MPInt& k, const uint64_t i)
+{
+  MPInt t;
+  t.set(&i, 1);
+  return k + t;
+}
+
+} // namespace
+
+LegendrePRF::LegendrePRF(const MPInt& p)
+  : batch_(p)
+{
+}
+
+int LegendrePRF::bit(const MPInt& k, const uint64_t i) const
+{
+  const MPInt& p = prime();
+  MPInt a;
+  MPInt::mod(a, offset(k, i), p);
+  return impl::kronecker(a, p) == -1 ? 1 : 0;
+}
+
+void LegendrePRF::evaluate(uint8_t* out, const MPInt& k, const uint64_t count, const size_t threads) const
+{
+  if (threads < 1) {
+    throw std::invalid_argument("LegendrePRF: threads must be at least 1");
+  }
+  const uint64_t bytes = (count + 7) / 8;
+  const uint64_t chunk = (bytes + threads - 1) / threads * 8;
+  if (threads == 1 || count <= chunk) {
+    evaluate_(out, k, count);
+    return;
+  }
+
+  std::vector<std::thread> workers;
+  for (uint64_t j = 0; j < count; j += chunk) {
+    const uint64_t n = std::min(chunk, count - j);
+    const MPInt kj = offset(k, j);
+    workers.push_back(std::thread([this, out, kj, j, n]() {
+          evaluate_(out + j / 8, kj, n);
+        }));
+  }
+  for (size_t t = 0; t < workers.size(); ++t) {
+    workers[t].join();
+  }
+}
+
+void LegendrePRF::evaluate_(uint8_t* out, const MPInt& k, const uint64_t count) const
+{
+  const MPInt& p = prime();
+  const size_t n = p.size();
+  const value_type* pd = p.get();
+
+  // a = k mod p on n digits.
+  MPInt t;
+  MPInt::mod(t, k, p);
+  std::vector<value_type> a(n, 0);
+  std::copy(t.get(), t.get() + t.size(), a.begin());
+
+  std::vector<value_type> x(blockSize*n);
+  int8_t s[blockSize];
+  std::fill(out, out + (count + 7) / 8, 0);
+  for (uint64_t j = 0; j < count; j += blockSize) {
+    const size_t m = (size_t)std::min((uint64_t)blockSize, count - j);
+    for (size_t i = 0; i < m; ++i) {
+      std::copy(a.begin(), a.end(), x.begin() + i*n);
+      // a = a + 1 mod p, a + 1 <= p.
+      MPInt::add_1(&a[0], &a[0], n, 1);
+      if (MPInt::cmp_n(&a[0], pd, n) == 0) {
+        std::fill(a.begin(), a.end(), 0);
+      }
+    }
+    batch_.symbols(s, &x[0], m);
+    for (size_t i = 0; i < m; ++i) {
+      const uint64_t b = j + i;
+      out[b / 8] |= (uint8_t)((s[i] < 0) << (b % 8));
+    }
+  }
+}
+
+} // namespace integer
@@ -0,0 +1,626 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+#include <cassert>
+#include <climits>
+#include <stdexcept>
+#include <vector>
+#include <mutex>
+
+#include <xbyak/xbyak.h>
+
+#include "montgomery.hpp"
+#include "integer-util.hpp"
+
+namespace mpint {
+
+typedef MontgomeryContext::value_type value_type;
+typedef MPInt::dvalue_type dvalue_type;
+
+/*
+  Work space of the emulated kernels is on the stack up to this size.
+*/
+static const size_t maxStackSize = 128;
+
+/*
+  z = (c, t) - p if (c, t) >= p, otherwise z = t.
+
+  @note: branch free, and z may be the same as t.
+*/
+static inline void cond_sub_p(value_type* z, const value_type* t, const value_type c, const value_type* p, const size_t n)
+{
+  value_type b = 0;
+  for (size_t j = 0; j < n; ++j) {
+    const dvalue_type d = (dvalue_type)t[j] - p[j] - b;
+    b = (value_type)(d >> 64) & 1;
+  }
+  // (c, t) < p iff borrow remains.
+  const value_type mask = (value_type)(b > c) - 1;
+  b = 0;
+  for (size_t j = 0; j < n; ++j) {
+    const dvalue_type d = (dvalue_type)t[j] - (p[j] & mask) - b;
+    z[j] = (value_type)d;
+    b = (value_type)(d >> 64) & 1;
+  }
+}
+
+/*
+  CIOS (coarsely integrated operand scanning).
+*/
+static void emu_in_mont_mul(value_type* z, const value_type* x, const value_type* y, const value_type* p, const value_type rp, const size_t n)
+{
+  value_type stack[maxStackSize + 2];
+  std::vector<value_type> heap;
+  value_type* t = stack;
+  if (n > maxStackSize) {
+    heap.resize(n + 2);
+    t = &heap[0];
+  }
+
+  for (size_t j = 0; j < n + 2; ++j) {
+    t[j] = 0;
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+    value_type c = 0;
+    for (size_t j = 0; j < n; ++j) {
+      const dvalue_type uv = (dvalue_type)x[j] * y[i] + t[j] + c;
+      t[j] = (value_type)uv;
+      c = (value_type)(uv >> 64);
+    }
+    {
+      const dvalue_type uv = (dvalue_type)t[n] + c;
+      t[n] = (value_type)uv;
+      t[n + 1] = (value_type)(uv >> 64);
+    }
+
+    const value_type m = t[0] * rp;
+    c = (value_type)(((dvalue_type)m * p[0] + t[0]) >> 64);
+    for (size_t j = 1; j < n; ++j) {
+      const dvalue_type uv = (dvalue_type)m * p[j] + t[j] + c;
+      t[j - 1] = (value_type)uv;
+      c = (value_type)(uv >> 64);
+    }
+    {
+      const dvalue_type uv = (dvalue_type)t[n] + c;
+      t[n - 1] = (value_type)uv;
+      t[n] = t[n + 1] + (value_type)(uv >> 64);
+    }
+  }
+
+  cond_sub_p(z, t, t[n], p, n);
+}
+
+/*
+  Square by symmetric product, then reduce it.
+*/
+static void emu_in_mont_sqr(value_type* z, const value_type* x, const value_type* p, const value_type rp, const size_t n)
+{
+  value_type stack[maxStackSize*2];
+  std::vector<value_type> heap;
+  value_type* s = stack;
+  if (n > maxStackSize) {
+    heap.resize(n*2);
+    s = &heap[0];
+  }
+
+  for (size_t j = 0; j < n*2; ++j) {
+    s[j] = 0;
+  }
+
+  // cross products.
+  for (size_t i = 0; i + 1 < n; ++i) {
+    value_type c = 0;
+    for (size_t j = i + 1; j < n; ++j) {
+      const dvalue_type uv = (dvalue_type)x[i] * x[j] + s[i + j] + c;
+      s[i + j] = (value_type)uv;
+      c = (value_type)(uv >> 64);
+    }
+    s[i + n] = c;
+  }
+
+  // doubling.
+  {
+    value_type c = 0;
+    for (size_t j = 0; j < n*2; ++j) {
+      const value_type t = s[j];
+      s[j] = (t << 1) | c;
+      c = t >> (sizeof(value_type) * CHAR_BIT - 1);
+    }
+    assert(c == 0);
+  }
+
+  // diagonal.
+  {
+    value_type c = 0;
+    for (size_t i = 0; i < n; ++i) {
+      const dvalue_type sq = (dvalue_type)x[i] * x[i];
+      dvalue_type uv = (dvalue_type)s[i*2] + (value_type)sq + c;
+      s[i*2] = (value_type)uv;
+      uv = (dvalue_type)s[i*2 + 1] + (value_type)(sq >> 64) + (value_type)(uv >> 64);
+      s[i*2 + 1] = (value_type)uv;
+      c = (value_type)(uv >> 64);
+    }
+    assert(c == 0);
+  }
+
+  // reduction.
+  value_type cc = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const value_type m = s[i] * rp;
+    value_type c = (value_type)(((dvalue_type)m * p[0] + s[i]) >> 64);
+    for (size_t j = 1; j < n; ++j) {
+      const dvalue_type uv = (dvalue_type)m * p[j] + s[i + j] + c;
+      s[i + j] = (value_type)uv;
+      c = (value_type)(uv >> 64);
+    }
+    const dvalue_type uv = (dvalue_type)s[i + n] + c + cc;
+    s[i + n] = (value_type)uv;
+    cc = (value_type)(uv >> 64);
+  }
+
+  cond_sub_p(z, s + n, cc, p, n);
+}
+
+class MontgomeryCode : public Xbyak::CodeGenerator {
+public:
+  typedef Xbyak::Reg64 Reg64;
+
+private:
+
+  /*
+    Fully unrolled CIOS for n limbs.
+
+    (z, x, y, p, rp, n) = (rdi, rsi, rdx, rcx, r8, r9).
+    n is ignored.
+
+    @note: t[0..n+1] is on the stack.
+  */
+  void genEntry_in_mont_mul(const size_t n)
+  {
+    const int bytes = sizeof(value_type);
+    assert(bytes == 8);
+
+    const Reg64& pz = rdi;
+    const Reg64& px = rsi;
+    const Reg64& pp = rcx;
+    const Reg64& rp = r8;
+    const Reg64& py = r10; // @note: rdx is used by mul.
+
+    // working registers.
+    const Reg64& m = r9;
+    const Reg64& c = r11;
+    const Reg64& t = rsp;
+
+    const int tn = int(n) * bytes;
+
+    mov(py, rdx);
+    sub(rsp, tn + bytes*2);
+
+    for (size_t i = 0; i < n; ++i) {
+      const int yi = int(i) * bytes;
+
+      // t += x*y[i].
+      mov(m, ptr [py + yi]);
+      for (size_t j = 0; j < n; ++j) {
+        const int xj = int(j) * bytes;
+        mov(rax, ptr [px + xj]);
+        mul(m);
+        if (i > 0) {
+          add(rax, ptr [t + xj]);
+          adc(rdx, 0);
+        }
+        if (j > 0) {
+          add(rax, c);
+          adc(rdx, 0);
+        }
+        mov(ptr [t + xj], rax);
+        mov(c, rdx);
+      }
+      if (i == 0) {
+        mov(ptr [t + tn], c);
+        mov(qword [t + tn + bytes], 0);
+      } else {
+        add(ptr [t + tn], c);
+        mov(rax, 0);
+        adc(rax, 0);
+        mov(ptr [t + tn + bytes], rax);
+      }
+
+      // t = (t + m*p)/2^64, where m = t[0]*rp.
+      mov(m, ptr [t]);
+      imul(m, rp);
+      mov(rax, ptr [pp]);
+      mul(m);
+      add(rax, ptr [t]);
+      adc(rdx, 0);
+      mov(c, rdx);
+      for (size_t j = 1; j < n; ++j) {
+        const int pj = int(j) * bytes;
+        mov(rax, ptr [pp + pj]);
+        mul(m);
+        add(rax, ptr [t + pj]);
+        adc(rdx, 0);
+        add(rax, c);
+        adc(rdx, 0);
+        mov(ptr [t + pj - bytes], rax);
+        mov(c, rdx);
+      }
+      mov(rax, ptr [t + tn]);
+      add(rax, c);
+      mov(ptr [t + tn - bytes], rax);
+      mov(rax, ptr [t + tn + bytes]);
+      adc(rax, 0);
+      mov(ptr [t + tn], rax);
+    }
+
+    // z = t - p, or t if t < p.
+    for (size_t j = 0; j < n; ++j) {
+      const int pj = int(j) * bytes;
+      mov(rax, ptr [t + pj]);
+      if (j == 0) {
+        sub(rax, ptr [pp + pj]);
+      } else {
+        sbb(rax, ptr [pp + pj]);
+      }
+      mov(ptr [pz + pj], rax);
+    }
+    mov(rax, ptr [t + tn]);
+    sbb(rax, 0);
+    // CF is set iff t < p, and mov does not modify flags.
+    for (size_t j = 0; j < n; ++j) {
+      const int pj = int(j) * bytes;
+      mov(rax, ptr [pz + pj]);
+      mov(rdx, ptr [t + pj]);
+      cmovc(rax, rdx);
+      mov(ptr [pz + pj], rax);
+    }
+
+    add(rsp, tn + bytes*2);
+    ret();
+  }
+
+  /*
+    Fully unrolled square and reduction for n limbs.
+
+    (z, x, p, rp, n) = (rdi, rsi, rdx, rcx, r8).
+    n is ignored.
+
+    @note: s[0..2n-1] is on the stack.
+  */
+  void genEntry_in_mont_sqr(const size_t n)
+  {
+    const int bytes = sizeof(value_type);
+    assert(bytes == 8);
+
+    const Reg64& pz = rdi;
+    const Reg64& px = rsi;
+    const Reg64& rp = rcx;
+    const Reg64& pp = r10; // @note: rdx is used by mul.
+
+    // working registers.
+    const Reg64& m = r9;
+    const Reg64& c = r11;
+    const Reg64& cc = r8;
+    const Reg64& s = rsp;
+
+    const int sn = int(n) * bytes;
+
+    mov(pp, rdx);
+    sub(rsp, sn*2);
+
+    mov(qword [s], 0);
+    mov(qword [s + sn*2 - bytes], 0);
+
+    // cross products.
+    for (size_t i = 0; i + 1 < n; ++i) {
+      mov(m, ptr [px + int(i) * bytes]);
+      for (size_t j = i + 1; j < n; ++j) {
+        const int xj = int(j) * bytes;
+        const int sij = int(i + j) * bytes;
+        mov(rax, ptr [px + xj]);
+        mul(m);
+        if (i > 0) {
+          add(rax, ptr [s + sij]);
+          adc(rdx, 0);
+        }
+        if (j > i + 1) {
+          add(rax, c);
+          adc(rdx, 0);
+        }
+        mov(ptr [s + sij], rax);
+        mov(c, rdx);
+      }
+      mov(ptr [s + int(i + n) * bytes], c);
+    }
+
+    // doubling.
+    for (size_t j = 0; j < n*2; ++j) {
+      const int sj = int(j) * bytes;
+      mov(rax, ptr [s + sj]);
+      if (j == 0) {
+        add(rax, rax);
+      } else {
+        adc(rax, rax);
+      }
+      mov(ptr [s + sj], rax);
+    }
+
+    // diagonal.
+    // @note: mul modifies CF, so the carry is kept in c.
+    xor(c, c);
+    for (size_t i = 0; i < n; ++i) {
+      const int s2i = int(i*2) * bytes;
+      mov(rax, ptr [px + int(i) * bytes]);
+      mul(rax);
+      add(rax, c);
+      adc(rdx, 0);
+      add(ptr [s + s2i], rax);
+      adc(ptr [s + s2i + bytes], rdx);
+      mov(c, 0);
+      adc(c, 0);
+    }
+
+    // reduction.
+    xor(cc, cc);
+    for (size_t i = 0; i < n; ++i) {
+      const int si = int(i) * bytes;
+      mov(m, ptr [s + si]);
+      imul(m, rp);
+      mov(rax, ptr [pp]);
+      mul(m);
+      add(rax, ptr [s + si]);
+      adc(rdx, 0);
+      mov(c, rdx);
+      for (size_t j = 1; j < n; ++j) {
+        const int pj = int(j) * bytes;
+        mov(rax, ptr [pp + pj]);
+        mul(m);
+        add(rax, ptr [s + si + pj]);
+        adc(rdx, 0);
+        add(rax, c);
+        adc(rdx, 0);
+        mov(ptr [s + si + pj], rax);
+        mov(c, rdx);
+      }
+      // s[i + n] += c + cc.
+      mov(rdx, cc);
+      mov(rax, ptr [s + si + sn]);
+      add(rax, c);
+      mov(cc, 0);
+      adc(cc, 0);
+      add(rax, rdx);
+      adc(cc, 0);
+      mov(ptr [s + si + sn], rax);
+    }
+
+    // z = s[n..2n-1] - p, or s[n..2n-1] if it is less than p.
+    for (size_t j = 0; j < n; ++j) {
+      const int pj = int(j) * bytes;
+      mov(rax, ptr [s + sn + pj]);
+      if (j == 0) {
+        sub(rax, ptr [pp + pj]);
+      } else {
+        sbb(rax, ptr [pp + pj]);
+      }
+      mov(ptr [pz + pj], rax);
+    }
+    sbb(cc, 0);
+    for (size_t j = 0; j < n; ++j) {
+      const int pj = int(j) * bytes;
+      mov(rax, ptr [pz + pj]);
+      mov(rdx, ptr [s + sn + pj]);
+      cmovc(rax, rdx);
+      mov(ptr [pz + pj], rax);
+    }
+
+    add(rsp, sn*2);
+    ret();
+  }
+
+public:
+  MontgomeryContext::in_mont_op code_mul_;
+  MontgomeryContext::in_mont_sqr_op code_sqr_;
+
+  /*
+    @note: about 100 bytes per limb product of each kernel.
+  */
+  explicit MontgomeryCode(const size_t n)
+    : Xbyak::CodeGenerator(4096 + n*n*256)
+  {
+    assert((uintptr_t(getCurr()) & 0xf) == 0);
+
+    code_mul_ = (MontgomeryContext::in_mont_op) getCurr();
+    genEntry_in_mont_mul(n);
+    align(16);
+    assert((uintptr_t(getCurr()) & 0xf) == 0);
+
+    code_sqr_ = (MontgomeryContext::in_mont_sqr_op) getCurr();
+    genEntry_in_mont_sqr(n);
+    align(16);
+    assert((uintptr_t(getCurr()) & 0xf) == 0);
+  }
+};
+
+/*
+  Kernels are generated once for each limb count, and shared.
+*/
+static const MontgomeryCode* makeMontgomeryCode(const size_t n)
+{
+  static std::mutex mutex;
+  static const MontgomeryCode* codes[MontgomeryContext::maxCodeSize + 1];
+
+  assert(0 < n && n <= MontgomeryContext::maxCodeSize);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (codes[n] == nullptr) {
+    try {
+      codes[n] = new MontgomeryCode(n);
+    } catch (Xbyak::Error err) {
+      fprintf(stderr, "Xbyak ERROR: %s (%d)\n", Xbyak::ConvertErrorToString(err), err);
+    }
+  }
+  return codes[n];
+}
+
+int MontgomeryContext::version_ = 0;
+
+void MontgomeryContext::codeGen(const int version)
+{
+  version_ = version;
+}
+
+MontgomeryContext::MontgomeryContext(const MPInt& m)
+  : n_(m.size()), rp_(0),
+    p_(new value_type[m.size()]),
+    r1_(new value_type[m.size()]),
+    r2_(new value_type[m.size()]),
+    in_mul_(emu_in_mont_mul),
+    in_sqr_(emu_in_mont_sqr)
+{
+  if (! m.isPos() || ! m.isOdd() || m == 1) {
+    throw std::invalid_argument("MontgomeryContext: modulus must be odd and greater than 1");
+  }
+
+  const size_t n = n_;
+  value_type* p = p_.get();
+  std::copy(m.get(), m.get() + n, p);
+  rp_ = -integer::impl::inverse64(p[0]);
+
+  /*
+    R mod m and R^2 mod m, by one division each.
+  */
+  const size_t nbits = sizeof(value_type) * CHAR_BIT;
+  MPInt e, r;
+  MPInt::shl(e, MPInt(1), nbits*n);
+  MPInt::mod(r, e, m);
+  std::fill(r1_.get(), r1_.get() + n, 0);
+  std::copy(r.get(), r.get() + r.size(), r1_.get());
+  MPInt::shl(e, MPInt(1), nbits*n*2);
+  MPInt::mod(r, e, m);
+  std::fill(r2_.get(), r2_.get() + n, 0);
+  std::copy(r.get(), r.get() + r.size(), r2_.get());
+
+  if (version_ != 0 && n <= maxCodeSize) {
+    const MontgomeryCode* code = makeMontgomeryCode(n);
+    if (code) {
+      in_mul_ = code->code_mul_;
+      in_sqr_ = code->code_sqr_;
+    }
+  }
+}
+
+void MontgomeryContext::add(value_type* z, const value_type* x, const value_type* y) const
+{
+  const size_t n = n_;
+  value_type c = 0;
+  for (size_t j = 0; j < n; ++j) {
+    const dvalue_type uv = (dvalue_type)x[j] + y[j] + c;
+    z[j] = (value_type)uv;
+    c = (value_type)(uv >> 64);
+  }
+  cond_sub_p(z, z, c, p_.get(), n);
+}
+
+void MontgomeryContext::sub(value_type* z, const value_type* x, const value_type* y) const
+{
+  const size_t n = n_;
+  const value_type* p = p_.get();
+  value_type b = 0;
+  for (size_t j = 0; j < n; ++j) {
+    const dvalue_type d = (dvalue_type)x[j] - y[j] - b;
+    z[j] = (value_type)d;
+    b = (value_type)(d >> 64) & 1;
+  }
+  // add m if borrowed.
+  const value_type mask = -b;
+  value_type c = 0;
+  for (size_t j = 0; j < n; ++j) {
+    const dvalue_type uv = (dvalue_type)z[j] + (p[j] & mask) + c;
+    z[j] = (value_type)uv;
+    c = (value_type)(uv >> 64);
+  }
+}
+
+void MontgomeryContext::load_(value_type* z, const MPInt& x) const
+{
+  if (x.isNeg() || x.size() > n_) {
+    throw std::invalid_argument("MontgomeryContext: operand must be in [0, R)");
+  }
+  const size_t xn = x.size();
+  std::copy(x.get(), x.get() + xn, z);
+  std::fill(z + xn, z + n_, 0);
+}
+
+void MontgomeryContext::toMont(value_type* z, const MPInt& x) const
+{
+  std::vector<value_type> t(n_);
+  load_(&t[0], x);
+  mul(z, &t[0], r2_.get());
+}
+
+void MontgomeryContext::fromMont(MPInt& z, const value_type* x) const
+{
+  std::vector<value_type> one(n_, 0), t(n_);
+  one[0] = 1;
+  // @note: x*1/R, the operands are swapped to satisfy the requirement.
+  mul(&t[0], &one[0], x);
+  z.set(&t[0], n_);
+}
+
+void MontgomeryContext::toMont(MPInt& z, const MPInt& x) const
+{
+  std::vector<value_type> t(n_);
+  toMont(&t[0], x);
+  z.set(&t[0], n_);
+}
+
+void MontgomeryContext::fromMont(MPInt& z, const MPInt& x) const
+{
+  std::vector<value_type> t(n_);
+  load_(&t[0], x);
+  fromMont(z, &t[0]);
+}
+
+void MontgomeryContext::mul(MPInt& z, const MPInt& x, const MPInt& y) const
+{
+  std::vector<value_type> tx(n_), ty(n_);
+  load_(&tx[0], x);
+  load_(&ty[0], y);
+  mul(&tx[0], &tx[0], &ty[0]);
+  z.set(&tx[0], n_);
+}
+
+void MontgomeryContext::sqr(MPInt& z, const MPInt& x) const
+{
+  std::vector<value_type> t(n_);
+  load_(&t[0], x);
+  sqr(&t[0], &t[0]);
+  z.set(&t[0], n_);
+}
+
+} // namespace mpint
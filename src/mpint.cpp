@@ -26,6 +26,7 @@
 */
 
 #include <climits>
+#include <vector>
 #include <x86intrin.h>
 
 #include <xbyak/xbyak.h>
@@ -279,8 +280,12 @@ void MPInt::sub(MPInt& z, const MPInt& in_x, const MPInt& in_y)
     }
 
     // @note: Check size must be changed or not.
+    // cancellation may clear more than one upper digit.
     if (z.sign_size_ > 0 && lastIsZero) {
       --z.sign_size_;
+      while (z.sign_size_ > 0 && z.d_ptr_[z.sign_size_ - 1] == 0) {
+        --z.sign_size_;
+      }
     }
 
     if (isNeg) {
@@ -290,9 +295,443 @@ void MPInt::sub(MPInt& z, const MPInt& in_x, const MPInt& in_y)
 
   } else {
     assert(in_x.sign() != in_y.sign());
-    throw std::invalid_argument("not implemented for different sign sub");
+    // x - y = x + (-y), where x and -y have same sign.
+    MPInt t;
+    negation(t, in_y);
+    add(z, in_x, t);
+    return;
+  }
+}
+
+/*
+  z = x + y
+*/
+void MPInt::add(MPInt& z, const MPInt& x, const MPInt& y)
+{
+  if (x.isZero()) {
+    z = y;
+    return;
+  }
+  if (y.isZero()) {
+    z = x;
+    return;
+  }
+  if ((x.sign_size_ ^ y.sign_size_) < 0) {
+    // x + y = x - (-y), where x and -y have same sign.
+    MPInt t;
+    negation(t, y);
+    sub(z, x, t);
+    return;
+  }
+
+  const MPInt& a = x.size() >= y.size() ? x : y;
+  const MPInt& b = x.size() >= y.size() ? y : x;
+  const size_t an = a.size();
+  const size_t bn = b.size();
+
+  MPInt t;
+  t.reserve(an + 1);
+  value_type c = add_n(t.get(), a.get(), b.get(), bn);
+  c = add_1(t.get() + bn, a.get() + bn, an - bn, c);
+  t[an] = c;
+  t.normalize(an + 1, x.isNeg());
+  z.swap(t);
+}
+
+/*
+  z = x * y
+*/
+void MPInt::mul(MPInt& z, const MPInt& x, const MPInt& y)
+{
+  if (x.isZero() || y.isZero()) {
+    z.set(0);
+    return;
+  }
+
+  const MPInt& a = x.size() >= y.size() ? x : y;
+  const MPInt& b = x.size() >= y.size() ? y : x;
+  const size_t an = a.size();
+  const size_t bn = b.size();
+
+  MPInt t;
+  t.reserve(an + bn);
+  mul_n(t.get(), a.get(), an, b.get(), bn);
+  t.normalize(an + bn, x.isNeg() != y.isNeg());
+  z.swap(t);
+}
+
+void MPInt::divmod(MPInt& q, MPInt& r, const MPInt& x, const MPInt& y)
+{
+  assert(&q != &r);
+
+  if (y.isZero()) {
+    throw std::invalid_argument("division by zero");
+  }
+
+  const size_t xn = x.size();
+  const size_t yn = y.size();
+  if (xn < yn || (xn == yn && cmp_n(x.get(), y.get(), xn) < 0)) {
+    r = x;
+    q.set(0);
+    return;
+  }
+
+  MPInt tq, tr;
+  tq.reserve(xn - yn + 1);
+  tr.reserve(yn);
+  divrem_n(tq.get(), tr.get(), x.get(), xn, y.get(), yn);
+  tq.normalize(xn - yn + 1, x.isNeg() != y.isNeg());
+  tr.normalize(yn, x.isNeg());
+  q.swap(tq);
+  r.swap(tr);
+}
+
+void MPInt::mod(MPInt& r, const MPInt& x, const MPInt& y)
+{
+  MPInt q;
+  divmod(q, r, x, y);
+  if (r.isNeg()) {
+    if (y.isNeg()) {
+      sub(r, r, y);
+    } else {
+      add(r, r, y);
+    }
+  }
+}
+
+void MPInt::shl(MPInt& z, const MPInt& x, const size_t n)
+{
+  const size_t bit_w = sizeof(value_type) * CHAR_BIT;
+  const size_t move_d = n / bit_w;
+  const size_t move_shift = n % bit_w;
+  const size_t x_size = x.size();
+
+  if (x_size == 0) {
+    z.set(0);
+    return;
+  }
+
+  MPInt t;
+  t.reserve(x_size + move_d + 1);
+  value_type* pt = t.get() + move_d;
+  if (move_shift == 0) {
+    std::copy(x.get(), x.get() + x_size, pt);
+  } else {
+    pt[x_size] = x[x_size - 1] >> (bit_w - move_shift);
+    for (size_t i = x_size - 1; i > 0; --i) {
+      pt[i] = (x[i] << move_shift) | (x[i - 1] >> (bit_w - move_shift));
+    }
+    pt[0] = x[0] << move_shift;
+  }
+  t.normalize(x_size + move_d + 1, x.isNeg());
+  z.swap(t);
+}
+
+/*
+  Low level functions on digit arrays.
+*/
+
+MPInt::value_type MPInt::add_n(value_type* z, const value_type* x, const value_type* y, const size_t n)
+{
+  value_type c = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const dvalue_type t = (dvalue_type)x[i] + y[i] + c;
+    z[i] = (value_type)t;
+    c = (value_type)(t >> 64);
+  }
+  return c;
+}
+
+MPInt::value_type MPInt::add_1(value_type* z, const value_type* x, const size_t n, const value_type y)
+{
+  value_type c = y;
+  for (size_t i = 0; i < n; ++i) {
+    const value_type t = x[i] + c;
+    c = t < c ? 1 : 0;
+    z[i] = t;
+  }
+  return c;
+}
+
+MPInt::value_type MPInt::sub_n(value_type* z, const value_type* x, const value_type* y, const size_t n)
+{
+  value_type b = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const dvalue_type t = (dvalue_type)x[i] - y[i] - b;
+    z[i] = (value_type)t;
+    b = (value_type)(t >> 64) & 1;
+  }
+  return b;
+}
+
+MPInt::value_type MPInt::sub_1(value_type* z, const value_type* x, const size_t n, const value_type y)
+{
+  value_type b = y;
+  for (size_t i = 0; i < n; ++i) {
+    const value_type t = x[i];
+    z[i] = t - b;
+    b = t < b ? 1 : 0;
+  }
+  return b;
+}
+
+MPInt::value_type MPInt::mul_1(value_type* z, const value_type* x, const size_t n, const value_type y)
+{
+  value_type c = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const dvalue_type t = (dvalue_type)x[i] * y + c;
+    z[i] = (value_type)t;
+    c = (value_type)(t >> 64);
+  }
+  return c;
+}
+
+MPInt::value_type MPInt::addmul_1(value_type* z, const value_type* x, const size_t n, const value_type y)
+{
+  value_type c = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const dvalue_type t = (dvalue_type)x[i] * y + z[i] + c;
+    z[i] = (value_type)t;
+    c = (value_type)(t >> 64);
+  }
+  return c;
+}
+
+MPInt::value_type MPInt::submul_1(value_type* z, const value_type* x, const size_t n, const value_type y)
+{
+  value_type b = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const dvalue_type t = (dvalue_type)x[i] * y + b;
+    const value_type lo = (value_type)t;
+    b = (value_type)(t >> 64) + (z[i] < lo ? 1 : 0);
+    z[i] -= lo;
+  }
+  return b;
+}
+
+namespace {
+
+const size_t karatsubaThreshold = 32;
+
+void mul_basecase(MPInt::value_type* z, const MPInt::value_type* x, const size_t xn, const MPInt::value_type* y, const size_t yn)
+{
+  z[xn] = MPInt::mul_1(z, x, xn, y[0]);
+  for (size_t j = 1; j < yn; ++j) {
+    z[xn + j] = MPInt::addmul_1(z + j, x, xn, y[j]);
+  }
+}
+
+/*
+  z[0..2n) = x[0..n) * y[0..n), Karatsuba.
+  x = x1 B^h + x0, y = y1 B^h + y0,
+  x*y = x1 y1 B^2h + ((x0 + x1)(y0 + y1) - x0 y0 - x1 y1) B^h + x0 y0.
+*/
+void mul_karatsuba(MPInt::value_type* z, const MPInt::value_type* x, const MPInt::value_type* y, const size_t n)
+{
+  typedef MPInt::value_type value_type;
+
+  const size_t h = n / 2;
+  const size_t l = n - h; // l >= h
+
+  // z0 = x0 y0 in z[0..2h), z2 = x1 y1 in z[2h..2n).
+  MPInt::mul_n(z, x, h, y, h);
+  MPInt::mul_n(z + h*2, x + h, l, y + h, l);
+
+  // sx = x0 + x1, sy = y0 + y1 in l + 1 digits.
+  std::vector<value_type> t((l + 1)*4);
+  value_type* sx = &t[0];
+  value_type* sy = sx + (l + 1);
+  value_type* p = sy + (l + 1);
+
+  std::copy(x + h, x + n, sx);
+  std::copy(y + h, y + n, sy);
+  value_type cx = MPInt::add_n(sx, sx, x, h);
+  value_type cy = MPInt::add_n(sy, sy, y, h);
+  if (l > h) {
+    cx = MPInt::add_1(sx + h, sx + h, l - h, cx);
+    cy = MPInt::add_1(sy + h, sy + h, l - h, cy);
+  }
+  sx[l] = cx;
+  sy[l] = cy;
+
+  const size_t sn = (sx[l] | sy[l]) ? l + 1 : l;
+  MPInt::mul_n(p, sx, sn, sy, sn);
+  std::fill(p + sn*2, p + (l + 1)*2, 0);
+
+  // p -= z0 + z2, then z += p B^h.
+  value_type b = MPInt::sub_n(p, p, z, h*2);
+  MPInt::sub_1(p + h*2, p + h*2, (l + 1)*2 - h*2, b);
+  b = MPInt::sub_n(p, p, z + h*2, l*2);
+  MPInt::sub_1(p + l*2, p + l*2, 2, b);
+
+  const size_t pn = std::min((l + 1)*2, n*2 - h);
+  const value_type c = MPInt::add_n(z + h, z + h, p, pn);
+  if (h + pn < n*2) {
+    MPInt::add_1(z + h + pn, z + h + pn, n*2 - h - pn, c);
+  }
+}
+
+} // namespace
+
+void MPInt::mul_n(value_type* z, const value_type* x, const size_t xn, const value_type* y, const size_t yn)
+{
+  assert(xn >= yn && yn > 0);
+
+  if (yn < karatsubaThreshold) {
+    mul_basecase(z, x, xn, y, yn);
+    return;
+  }
+
+  if (xn == yn) {
+    mul_karatsuba(z, x, y, yn);
+    return;
+  }
+
+  // unbalanced, x is cut into pieces of yn digits.
+  std::vector<value_type> t(yn*2);
+  mul_karatsuba(z, x, y, yn);
+  std::fill(z + yn*2, z + xn + yn, 0);
+  for (size_t i = yn; i < xn; i += yn) {
+    const size_t len = std::min(yn, xn - i);
+    if (len == yn) {
+      mul_karatsuba(&t[0], x + i, y, yn);
+    } else {
+      mul_n(&t[0], y, yn, x + i, len);
+    }
+    const value_type c = add_n(z + i, z + i, &t[0], len + yn);
+    if (i + len + yn < xn + yn) {
+      add_1(z + i + len + yn, z + i + len + yn, xn + yn - (i + len + yn), c);
+    }
+  }
+}
+
+/*
+  (nh, nl) = q*d + r.
+  @require: nh < d.
+*/
+static inline MPInt::value_type udiv_qrnnd(MPInt::value_type& r, const MPInt::value_type nh, const MPInt::value_type nl, const MPInt::value_type d)
+{
+  MPInt::value_type q;
+  __asm__("divq %4" : "=a"(q), "=d"(r) : "a"(nl), "d"(nh), "rm"(d));
+  return q;
+}
+
+MPInt::value_type MPInt::divrem_1(value_type* q, const value_type* x, const size_t n, const value_type y)
+{
+  assert(y != 0);
+
+  value_type r = 0;
+  for (size_t i = n; i > 0; --i) {
+    const value_type t = udiv_qrnnd(r, r, x[i - 1], y);
+    if (q) {
+      q[i - 1] = t;
+    }
+  }
+  return r;
+}
+
+/*
+  z[0..n) = x[0..n) << s.
+  @return: shifted out digit.
+  @require: 0 <= s < 64.
+*/
+static inline MPInt::value_type emu_shl_n(MPInt::value_type* z, const MPInt::value_type* x, const size_t n, const size_t s)
+{
+  typedef MPInt::value_type value_type;
+  const size_t bit_w = sizeof(value_type) * CHAR_BIT;
+
+  if (s == 0) {
+    std::copy(x, x + n, z);
+    return 0;
+  }
+  const value_type c = x[n - 1] >> (bit_w - s);
+  for (size_t i = n - 1; i > 0; --i) {
+    z[i] = (x[i] << s) | (x[i - 1] >> (bit_w - s));
+  }
+  z[0] = x[0] << s;
+  return c;
+}
+
+/*
+  Knuth, TAOCP vol.2, 4.3.1, Algorithm D.
+*/
+void MPInt::divrem_n(value_type* q, value_type* r, const value_type* x, const size_t xn, const value_type* y, const size_t yn)
+{
+  assert(xn >= yn && yn > 0);
+  assert(y[yn - 1] != 0);
+
+  if (yn == 1) {
+    r[0] = divrem_1(q, x, xn, y[0]);
     return;
   }
+
+  // D1: normalize.
+  const size_t s = __builtin_clzll(y[yn - 1]);
+  std::vector<value_type> buf(xn + 1 + yn);
+  value_type* u = &buf[0];
+  value_type* v = &buf[xn + 1];
+  emu_shl_n(v, y, yn, s);
+  u[xn] = emu_shl_n(u, x, xn, s);
+
+  const value_type vh = v[yn - 1];
+  const value_type vl = v[yn - 2];
+  for (size_t j = xn - yn + 1; j > 0; --j) {
+    value_type* uj = u + j - 1;
+
+    // D3: estimate qhat from the top two digits.
+    value_type qhat, rhat;
+    bool rhatOverflow = false;
+    if (uj[yn] >= vh) {
+      assert(uj[yn] == vh);
+      qhat = ~value_type(0);
+      rhat = uj[yn - 1] + vh;
+      rhatOverflow = rhat < vh;
+    } else {
+      qhat = udiv_qrnnd(rhat, uj[yn], uj[yn - 1], vh);
+    }
+    while (! rhatOverflow
+           && (dvalue_type)qhat * vl > (((dvalue_type)rhat << 64) | uj[yn - 2])) {
+      --qhat;
+      rhat += vh;
+      rhatOverflow = rhat < vh;
+    }
+
+    // D4: multiply and subtract.
+    const value_type b = submul_1(uj, v, yn, qhat);
+    const value_type top = uj[yn];
+    uj[yn] = top - b;
+
+    // D6: add back.
+    if (top < b) {
+      --qhat;
+      uj[yn] += add_n(uj, uj, v, yn);
+    }
+
+    if (q) {
+      q[j - 1] = qhat;
+    }
+  }
+
+  // D8: unnormalize.
+  if (s == 0) {
+    std::copy(u, u + yn, r);
+  } else {
+    const size_t bit_w = sizeof(value_type) * CHAR_BIT;
+    for (size_t i = 0; i + 1 < yn; ++i) {
+      r[i] = (u[i] >> s) | (u[i + 1] << (bit_w - s));
+    }
+    r[yn - 1] = u[yn - 1] >> s;
+  }
+}
+
+MPInt::sign_t MPInt::cmp_n(const value_type* x, const value_type* y, const size_t n)
+{
+  for (size_t i = n; i > 0; --i) {
+    if (x[i - 1] != y[i - 1]) {
+      return x[i - 1] < y[i - 1] ? -1 : 1;
+    }
+  }
+  return 0;
 }
 
 /*
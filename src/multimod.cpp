@@ -0,0 +1,165 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#include <cassert>
+#include <stdexcept>
+#include <immintrin.h>
+
+#include "multimod.hpp"
+#include "kronecker-jacobi.hpp"
+
+namespace integer {
+
+namespace {
+
+typedef mpint::MPInt::value_type value_type;
+
+/*
+  r = (r*2^16 + c) mod p, with q = floor(v*m/2^32) which is
+  floor(v/p) or one less than it.
+*/
+inline uint32_t step(const uint32_t r, const uint32_t c, const uint32_t p, const uint32_t m)
+{
+  const uint32_t v = (r << 16) | c;
+  const uint32_t q = (uint32_t)(((uint64_t)v * m) >> 32);
+  const uint32_t t = v - q*p;
+  return t >= p ? t - p : t;
+}
+
+/*
+  r[0..k) = x[0..n) mod p[0..k).
+*/
+void residuesPortable(uint32_t* r, const value_type* x, const size_t n, const uint32_t* p, const uint32_t* m, const size_t k)
+{
+  for (size_t j = 0; j < k; ++j) {
+    r[j] = 0;
+  }
+  for (size_t i = n; i > 0; --i) {
+    const value_type d = x[i - 1];
+    for (size_t j = 0; j < k; ++j) {
+      uint32_t t = r[j];
+      t = step(t, (uint32_t)(d >> 48), p[j], m[j]);
+      t = step(t, (uint32_t)(d >> 32) & 0xffff, p[j], m[j]);
+      t = step(t, (uint32_t)(d >> 16) & 0xffff, p[j], m[j]);
+      t = step(t, (uint32_t)d & 0xffff, p[j], m[j]);
+      r[j] = t;
+    }
+  }
+}
+
+__attribute__((target("avx2")))
+inline __m256i stepAvx2(const __m256i r, const __m256i c, const __m256i p, const __m256i m)
+{
+  const __m256i v = _mm256_or_si256(_mm256_slli_epi32(r, 16), c);
+  // the high halves of v*m, for the even lanes and the odd lanes.
+  const __m256i qe = _mm256_srli_epi64(_mm256_mul_epu32(v, m), 32);
+  const __m256i qo = _mm256_mul_epu32(_mm256_srli_epi64(v, 32), _mm256_srli_epi64(m, 32));
+  const __m256i q = _mm256_blend_epi32(qe, qo, 0xaa);
+  const __m256i t = _mm256_sub_epi32(v, _mm256_mullo_epi32(q, p));
+  // t - p wraps around if t < p.
+  return _mm256_min_epu32(t, _mm256_sub_epi32(t, p));
+}
+
+/*
+  @require: k is a multiple of 8.
+*/
+__attribute__((target("avx2")))
+void residuesAvx2(uint32_t* r, const value_type* x, const size_t n, const uint32_t* p, const uint32_t* m, const size_t k)
+{
+  assert(k % 8 == 0);
+  for (size_t j = 0; j < k; j += 8) {
+    _mm256_storeu_si256((__m256i*)(r + j), _mm256_setzero_si256());
+  }
+  for (size_t i = n; i > 0; --i) {
+    const value_type d = x[i - 1];
+    const __m256i c3 = _mm256_set1_epi32((int)(d >> 48));
+    const __m256i c2 = _mm256_set1_epi32((int)(d >> 32) & 0xffff);
+    const __m256i c1 = _mm256_set1_epi32((int)(d >> 16) & 0xffff);
+    const __m256i c0 = _mm256_set1_epi32((int)d & 0xffff);
+    for (size_t j = 0; j < k; j += 8) {
+      const __m256i pv = _mm256_loadu_si256((const __m256i*)(p + j));
+      const __m256i mv = _mm256_loadu_si256((const __m256i*)(m + j));
+      __m256i t = _mm256_loadu_si256((const __m256i*)(r + j));
+      t = stepAvx2(t, c3, pv, mv);
+      t = stepAvx2(t, c2, pv, mv);
+      t = stepAvx2(t, c1, pv, mv);
+      t = stepAvx2(t, c0, pv, mv);
+      _mm256_storeu_si256((__m256i*)(r + j), t);
+    }
+  }
+}
+
+} // namespace
+
+int MultiModulus::version_ = -1;
+
+MultiModulus::MultiModulus(const std::vector<uint32_t>& moduli)
+  : k_(moduli.size()), p_((moduli.size() + 7) / 8 * 8, 3), m_(p_.size()), work_(p_.size()),
+    residues_(version_ != 0 && __builtin_cpu_supports("avx2") ? residuesAvx2 : residuesPortable)
+{
+  for (size_t i = 0; i < k_; ++i) {
+    const uint32_t p = moduli[i];
+    if (p < 3 || p >= (1u << 16) || ! (p & 0x1)) {
+      throw std::invalid_argument("MultiModulus: moduli must be odd and in [3, 2^16)");
+    }
+    p_[i] = p;
+  }
+  for (size_t i = 0; i < p_.size(); ++i) {
+    m_[i] = (uint32_t)((uint64_t(1) << 32) / p_[i]);
+  }
+}
+
+void MultiModulus::residues(uint32_t* r, const mpint::MPInt& x) const
+{
+  uint32_t* t = work_.data();
+  residues_(t, x.get(), x.size(), p_.data(), m_.data(), p_.size());
+  if (x.isNeg()) {
+    for (size_t i = 0; i < k_; ++i) {
+      r[i] = t[i] == 0 ? 0 : p_[i] - t[i];
+    }
+  } else {
+    std::copy(t, t + k_, r);
+  }
+}
+
+void MultiModulus::kronecker(int* s, const mpint::MPInt& x) const
+{
+  const uint32_t* t = work_.data();
+  residues_(work_.data(), x.get(), x.size(), p_.data(), m_.data(), p_.size());
+  for (size_t i = 0; i < k_; ++i) {
+    const uint32_t r = x.isNeg() && t[i] != 0 ? p_[i] - t[i] : t[i];
+    s[i] = integer::kronecker((int64_t)r, (int64_t)p_[i]);
+  }
+}
+
+void MultiModulus::codeGen(const int version)
+{
+  version_ = version;
+}
+
+} // namespace integer
@@ -0,0 +1,706 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "powm.hpp"
+#include "barrett.hpp"
+
+namespace mpint {
+
+typedef MPInt::value_type value_type;
+
+namespace {
+
+const size_t cacheLineDigits = 64 / sizeof(value_type);
+
+inline value_type bit(const value_type* e, const size_t i)
+{
+  return (e[i / 64] >> (i % 64)) & 1;
+}
+
+/*
+  z = x^e by the sliding window method.
+  Ops gives size(), one(z), mul(z, x, y) and sqr(z, x) on n digits.
+
+  @require:
+  table has 2^(w-1)*n digits, t has n digits.
+  z may be the same as x, but not in table or t.
+*/
+template<class Ops>
+void slidingWindow(const Ops& ops, value_type* z, const value_type* x,
+                   const value_type* e, size_t en, const size_t w,
+                   value_type* table, value_type* t)
+{
+  const size_t n = ops.size();
+
+  while (en > 0 && e[en - 1] == 0) {
+    --en;
+  }
+  if (en == 0) {
+    ops.one(z);
+    return;
+  }
+  const size_t bits = en*64 - (size_t)__builtin_clzll(e[en - 1]);
+
+  // table[i] = x^(2i + 1).
+  std::copy(x, x + n, table);
+  if (w > 1) {
+    ops.sqr(t, x);
+    const size_t tsize = (size_t)1 << (w - 1);
+    for (size_t i = 1; i < tsize; ++i) {
+      ops.mul(table + i*n, table + (i - 1)*n, t);
+    }
+  }
+
+  bool first = true;
+  size_t i = bits;
+  while (i > 0) {
+    if (! bit(e, i - 1)) {
+      ops.sqr(z, z);
+      --i;
+      continue;
+    }
+
+    // window is bits [j, i), bit j is the lowest set bit in it.
+    size_t j = i > w ? i - w : 0;
+    while (! bit(e, j)) {
+      ++j;
+    }
+    size_t u = 0;
+    for (size_t k = i; k > j; --k) {
+      u = (u << 1) | bit(e, k - 1);
+    }
+
+    const value_type* p = table + (u >> 1)*n;
+    if (first) {
+      std::copy(p, p + n, z);
+      first = false;
+    } else {
+      for (size_t k = j; k < i; ++k) {
+        ops.sqr(z, z);
+      }
+      ops.mul(z, z, p);
+    }
+    i = j;
+  }
+}
+
+struct MontgomeryOps {
+  const MontgomeryContext& ctx;
+
+  explicit MontgomeryOps(const MontgomeryContext& c) : ctx(c) {}
+
+  size_t size() const { return ctx.size(); }
+  void one(value_type* z) const { std::copy(ctx.one(), ctx.one() + ctx.size(), z); }
+  void mul(value_type* z, const value_type* x, const value_type* y) const { ctx.mul(z, x, y); }
+  void sqr(value_type* z, const value_type* x) const { ctx.sqr(z, x); }
+};
+
+/*
+  Plain residues modulo an even m.
+  @note: product and work are scratch given by the caller.
+*/
+struct BarrettOps {
+  const BarrettContext& ctx;
+  value_type* product;
+  value_type* work;
+
+  BarrettOps(const BarrettContext& c, value_type* p, value_type* w) : ctx(c), product(p), work(w) {}
+
+  size_t size() const { return ctx.size(); }
+
+  void one(value_type* z) const
+  {
+    std::fill(z, z + ctx.size(), 0);
+    z[0] = 1;
+    ctx.reduce(z, z, ctx.size(), work);
+  }
+
+  void mul(value_type* z, const value_type* x, const value_type* y) const
+  {
+    const size_t k = ctx.size();
+    MPInt::mul_n(product, x, k, y, k);
+    ctx.reduce(z, product, k*2, work);
+  }
+
+  void sqr(value_type* z, const value_type* x) const { mul(z, x, x); }
+};
+
+/*
+  c <= 16 bits of e from bit pos.
+*/
+inline size_t getBits(const value_type* e, const size_t en, const size_t pos, const size_t c)
+{
+  const size_t q = pos / 64;
+  const size_t r = pos % 64;
+  if (q >= en) {
+    return 0;
+  }
+  value_type v = e[q] >> r;
+  if (r + c > 64 && q + 1 < en) {
+    v |= e[q + 1] << (64 - r);
+  }
+  return (size_t)(v & (((value_type)1 << c) - 1));
+}
+
+inline size_t bitLength(const value_type* e, size_t en)
+{
+  while (en > 0 && e[en - 1] == 0) {
+    --en;
+  }
+  return en == 0 ? 0 : en*64 - (size_t)__builtin_clzll(e[en - 1]);
+}
+
+const size_t maxStrausWindow = 8;
+const size_t maxPippengerWindow = 16;
+
+/*
+  Estimated number of multiplications, a squaring is counted as a multiplication.
+*/
+double strausCost(const size_t k, const size_t bits, size_t* window)
+{
+  double best = -1;
+  for (size_t w = 1; w <= maxStrausWindow; ++w) {
+    const double cost = (double)bits + (double)k*((double)bits/(double)(w + 1) + (double)((size_t)1 << (w - 1)));
+    if (best < 0 || cost < best) {
+      best = cost;
+      *window = w;
+    }
+  }
+  return best;
+}
+
+double pippengerCost(const size_t k, const size_t bits, size_t* window)
+{
+  double best = -1;
+  for (size_t c = 1; c <= maxPippengerWindow; ++c) {
+    // @note: the first digit put into each bucket is a copy.
+    const size_t nb = ((size_t)1 << c) - 1;
+    const double windows = (double)((bits + c - 1) / c);
+    const double cost = (double)bits + windows*((double)(k - std::min(k, nb)) + (double)(nb*2));
+    if (best < 0 || cost < best) {
+      best = cost;
+      *window = c;
+    }
+  }
+  return best;
+}
+
+} // namespace
+
+MontgomeryPowm::MontgomeryPowm(const MontgomeryContext& ctx, const size_t window)
+  : ctx_(ctx), window_(window), reserved_(0), buf_(), table_(nullptr), t_(nullptr)
+{
+  if (window > maxWindow) {
+    throw std::invalid_argument("MontgomeryPowm: window is too large");
+  }
+  reserve_(window == 0 ? 1 : window);
+}
+
+void MontgomeryPowm::reserve_(const size_t w)
+{
+  if (w <= reserved_) {
+    return;
+  }
+
+  const size_t n = ctx_.size();
+  const size_t tableSize = ((size_t)1 << (w - 1))*n;
+  buf_.assign(tableSize + n + cacheLineDigits, 0);
+
+  // @note: vector<value_type> is 8 byte aligned at least.
+  const uintptr_t addr = reinterpret_cast<uintptr_t>(&buf_[0]);
+  const size_t offset = (size_t)((64 - addr % 64) % 64) / sizeof(value_type);
+  table_ = &buf_[offset];
+  t_ = table_ + tableSize;
+  reserved_ = w;
+}
+
+size_t MontgomeryPowm::window(const size_t bits)
+{
+  static const size_t thresholds[] = { 7, 25, 81, 241, 673, 1793, 4609, 11521, 27649 };
+  size_t w = 1;
+  while (w < maxWindow && bits > thresholds[w - 1]) {
+    ++w;
+  }
+  return w;
+}
+
+void MontgomeryPowm::pow(value_type* z, const value_type* x, const value_type* e, const size_t en)
+{
+  size_t w = window_;
+  if (w == 0) {
+    size_t bits = en*64;
+    for (size_t i = en; i > 0 && e[i - 1] == 0; --i) {
+      bits -= 64;
+    }
+    w = window(bits);
+  }
+  reserve_(w);
+  slidingWindow(MontgomeryOps(ctx_), z, x, e, en, w, table_, t_);
+}
+
+void MontgomeryPowm::pow(MPInt& z, const MPInt& x, const MPInt& e)
+{
+  if (e.isNeg()) {
+    throw std::invalid_argument("MontgomeryPowm: exponent must be non-negative");
+  }
+
+  const size_t n = ctx_.size();
+  MPInt m, r;
+  m.set(ctx_.modulus(), n);
+  MPInt::mod(r, x, m);
+
+  std::vector<value_type> t(n);
+  ctx_.toMont(&t[0], r);
+  pow(&t[0], &t[0], e.get(), e.size());
+  ctx_.fromMont(z, &t[0]);
+}
+
+FixedBasePowm::FixedBasePowm(const MontgomeryContext& ctx, const MPInt& g, const size_t maxBits, const size_t budget)
+  : ctx_(ctx), maxBits_(maxBits), h_(1), v_(1), a_(maxBits), b_(maxBits), g_(ctx.size()), table_()
+{
+  if (maxBits == 0) {
+    throw std::invalid_argument("FixedBasePowm: maxBits must be positive");
+  }
+
+  const size_t n = ctx.size();
+  const size_t entryBytes = n*sizeof(value_type);
+
+  /*
+    cost = squarings + multiplications on average,
+    a column of h bits is zero with probability 2^(-h).
+  */
+  double best = -1;
+  for (size_t h = 1; h <= maxTeeth && h <= maxBits; ++h) {
+    const size_t entries = ((size_t)1 << h) - 1;
+    const size_t a = (maxBits + h - 1) / h;
+    for (size_t v = 1; v <= a; ++v) {
+      if (v*entries*entryBytes > budget && ! (h == 1 && v == 1)) {
+        break;
+      }
+      const size_t b = (a + v - 1) / v;
+      const double cost = (double)(b - 1) + (double)(v*b)*(1.0 - 1.0/(double)(entries + 1));
+      if (best < 0 || cost < best) {
+        best = cost;
+        h_ = h;
+        v_ = v;
+        a_ = a;
+        b_ = b;
+      }
+    }
+  }
+
+  MPInt m, r;
+  m.set(ctx.modulus(), n);
+  MPInt::mod(r, g, m);
+  ctx.toMont(&g_[0], r);
+
+  const size_t entries = ((size_t)1 << h_) - 1;
+  table_.resize(v_*entries*n);
+
+  // basis[i] = g^(2^(i*a + j*b)) for the current block j.
+  std::vector<value_type> basis(h_*n);
+  std::copy(g_.begin(), g_.end(), basis.begin());
+  for (size_t i = 1; i < h_; ++i) {
+    value_type* p = &basis[i*n];
+    std::copy(p - n, p, p);
+    for (size_t k = 0; k < a_; ++k) {
+      ctx.sqr(p, p);
+    }
+  }
+
+  for (size_t j = 0; j < v_; ++j) {
+    if (j > 0) {
+      for (size_t i = 0; i < h_; ++i) {
+        value_type* p = &basis[i*n];
+        for (size_t k = 0; k < b_; ++k) {
+          ctx.sqr(p, p);
+        }
+      }
+    }
+
+    // entry u - 1 is for the row set u.
+    value_type* block = &table_[j*entries*n];
+    for (size_t u = 1; u <= entries; ++u) {
+      const size_t low = u & (0 - u);
+      const size_t i = (size_t)__builtin_ctzll(u);
+      value_type* p = block + (u - 1)*n;
+      if (u == low) {
+        std::copy(&basis[i*n], &basis[i*n] + n, p);
+      } else {
+        ctx.mul(p, block + ((u ^ low) - 1)*n, &basis[i*n]);
+      }
+    }
+  }
+}
+
+void FixedBasePowm::pow(value_type* z, const value_type* e, size_t en) const
+{
+  const size_t n = ctx_.size();
+
+  while (en > 0 && e[en - 1] == 0) {
+    --en;
+  }
+  if (en == 0) {
+    std::copy(ctx_.one(), ctx_.one() + n, z);
+    return;
+  }
+  const size_t bits = en*64 - (size_t)__builtin_clzll(e[en - 1]);
+  if (bits > maxBits_) {
+    MontgomeryPowm p(ctx_);
+    p.pow(z, &g_[0], e, en);
+    return;
+  }
+
+  const size_t entries = ((size_t)1 << h_) - 1;
+  bool first = true;
+  for (size_t k = b_; k > 0; --k) {
+    if (! first) {
+      ctx_.sqr(z, z);
+    }
+    for (size_t j = v_; j > 0; --j) {
+      const size_t col = (j - 1)*b_ + (k - 1);
+      if (col >= a_) {
+        continue;
+      }
+      size_t u = 0;
+      for (size_t i = h_; i > 0; --i) {
+        const size_t pos = (i - 1)*a_ + col;
+        u = (u << 1) | (pos < bits ? (size_t)bit(e, pos) : 0);
+      }
+      if (u == 0) {
+        continue;
+      }
+      const value_type* p = &table_[((j - 1)*entries + (u - 1))*n];
+      if (first) {
+        std::copy(p, p + n, z);
+        first = false;
+      } else {
+        ctx_.mul(z, z, p);
+      }
+    }
+  }
+  assert(! first);
+}
+
+void FixedBasePowm::pow(MPInt& z, const MPInt& e) const
+{
+  if (e.isNeg()) {
+    throw std::invalid_argument("FixedBasePowm: exponent must be non-negative");
+  }
+
+  std::vector<value_type> t(ctx_.size());
+  pow(&t[0], e.get(), e.size());
+  ctx_.fromMont(z, &t[0]);
+}
+
+MultiPowm::MultiPowm(const MontgomeryContext& ctx)
+  : ctx_(ctx), table_(), digits_()
+{
+}
+
+MultiPowm::Method MultiPowm::select(const size_t k, const size_t bits)
+{
+  size_t w, c;
+  return strausCost(k, bits, &w) <= pippengerCost(k, bits, &c) ? Straus : Pippenger;
+}
+
+void MultiPowm::pow(value_type* z, const value_type* const* x, const value_type* const* e, const size_t* en,
+                    const size_t k, const Method method)
+{
+  size_t bits = 0;
+  for (size_t i = 0; i < k; ++i) {
+    bits = std::max(bits, bitLength(e[i], en[i]));
+  }
+  if (bits == 0) {
+    std::copy(ctx_.one(), ctx_.one() + ctx_.size(), z);
+    return;
+  }
+
+  const Method m = method == Auto ? select(k, bits) : method;
+  if (m == Straus) {
+    straus_(z, x, e, en, k, bits);
+  } else {
+    pippenger_(z, x, e, en, k, bits);
+  }
+}
+
+void MultiPowm::straus_(value_type* z, const value_type* const* x, const value_type* const* e, const size_t* en,
+                        const size_t k, const size_t bits)
+{
+  const size_t n = ctx_.size();
+  size_t w;
+  strausCost(k, bits, &w);
+  const size_t tsize = (size_t)1 << (w - 1);
+
+  if (table_.size() < (k*tsize + 1)*n) {
+    table_.resize((k*tsize + 1)*n);
+  }
+  digits_.assign(k*bits, 0);
+  value_type* t = &table_[k*tsize*n];
+
+  for (size_t i = 0; i < k; ++i) {
+    // table of x[i]^(2j + 1).
+    value_type* table = &table_[i*tsize*n];
+    std::copy(x[i], x[i] + n, table);
+    if (tsize > 1) {
+      ctx_.sqr(t, x[i]);
+      for (size_t j = 1; j < tsize; ++j) {
+        ctx_.mul(table + j*n, table + (j - 1)*n, t);
+      }
+    }
+
+    // digits at the lowest bit of each sliding window.
+    uint16_t* digits = &digits_[i*bits];
+    size_t pos = bitLength(e[i], en[i]);
+    while (pos > 0) {
+      if (! bit(e[i], pos - 1)) {
+        --pos;
+        continue;
+      }
+      size_t j = pos > w ? pos - w : 0;
+      while (! bit(e[i], j)) {
+        ++j;
+      }
+      digits[j] = (uint16_t)getBits(e[i], en[i], j, pos - j);
+      pos = j;
+    }
+  }
+
+  bool first = true;
+  for (size_t pos = bits; pos > 0; --pos) {
+    if (! first) {
+      ctx_.sqr(z, z);
+    }
+    for (size_t i = 0; i < k; ++i) {
+      const size_t d = digits_[i*bits + pos - 1];
+      if (d == 0) {
+        continue;
+      }
+      const value_type* p = &table_[(i*tsize + (d >> 1))*n];
+      if (first) {
+        std::copy(p, p + n, z);
+        first = false;
+      } else {
+        ctx_.mul(z, z, p);
+      }
+    }
+  }
+  assert(! first);
+}
+
+void MultiPowm::pippenger_(value_type* z, const value_type* const* x, const value_type* const* e, const size_t* en,
+                           const size_t k, const size_t bits)
+{
+  const size_t n = ctx_.size();
+  size_t c;
+  pippengerCost(k, bits, &c);
+  const size_t nb = ((size_t)1 << c) - 1;
+
+  // buckets 1..nb, then the running products s and t.
+  if (table_.size() < (nb + 3)*n) {
+    table_.resize((nb + 3)*n);
+  }
+  value_type* s = &table_[(nb + 1)*n];
+  value_type* t = s + n;
+
+  bool first = true;
+  for (size_t wi = (bits + c - 1) / c; wi > 0; --wi) {
+    if (! first) {
+      for (size_t j = 0; j < c; ++j) {
+        ctx_.sqr(z, z);
+      }
+    }
+
+    digits_.assign(nb + 1, 0);
+    for (size_t i = 0; i < k; ++i) {
+      const size_t d = getBits(e[i], en[i], (wi - 1)*c, c);
+      if (d == 0) {
+        continue;
+      }
+      value_type* b = &table_[d*n];
+      if (digits_[d]) {
+        ctx_.mul(b, b, x[i]);
+      } else {
+        std::copy(x[i], x[i] + n, b);
+        digits_[d] = 1;
+      }
+    }
+
+    // t = prod b[d]^d = prod_d (prod_{d' >= d} b[d']).
+    bool sEmpty = true, tEmpty = true;
+    for (size_t d = nb; d > 0; --d) {
+      if (digits_[d]) {
+        const value_type* b = &table_[d*n];
+        if (sEmpty) {
+          std::copy(b, b + n, s);
+          sEmpty = false;
+        } else {
+          ctx_.mul(s, s, b);
+        }
+      }
+      if (! sEmpty) {
+        if (tEmpty) {
+          std::copy(s, s + n, t);
+          tEmpty = false;
+        } else {
+          ctx_.mul(t, t, s);
+        }
+      }
+    }
+
+    if (! tEmpty) {
+      if (first) {
+        std::copy(t, t + n, z);
+        first = false;
+      } else {
+        ctx_.mul(z, z, t);
+      }
+    }
+  }
+  assert(! first);
+}
+
+void MultiPowm::pow(MPInt& z, const std::vector<MPInt>& x, const std::vector<MPInt>& e, const Method method)
+{
+  if (x.size() != e.size()) {
+    throw std::invalid_argument("MultiPowm: numbers of bases and exponents are different");
+  }
+
+  const size_t n = ctx_.size();
+  const size_t k = x.size();
+  MPInt m, r;
+  m.set(ctx_.modulus(), n);
+
+  std::vector<value_type> xs(k*n + n);
+  std::vector<const value_type*> xp(k), ep(k);
+  std::vector<size_t> en(k);
+  for (size_t i = 0; i < k; ++i) {
+    if (e[i].isNeg()) {
+      throw std::invalid_argument("MultiPowm: exponent must be non-negative");
+    }
+    MPInt::mod(r, x[i], m);
+    ctx_.toMont(&xs[i*n], r);
+    xp[i] = &xs[i*n];
+    ep[i] = e[i].get();
+    en[i] = e[i].size();
+  }
+
+  value_type* t = &xs[k*n];
+  pow(t, k == 0 ? nullptr : &xp[0], k == 0 ? nullptr : &ep[0], k == 0 ? nullptr : &en[0], k, method);
+  ctx_.fromMont(z, t);
+}
+
+void multiPowm(MPInt& z, const std::vector<MPInt>& g, const std::vector<MPInt>& e, const MPInt& mod)
+{
+  if (! mod.isPos()) {
+    throw std::invalid_argument("multiPowm: modulus must be positive");
+  }
+  if (g.size() != e.size()) {
+    throw std::invalid_argument("multiPowm: numbers of bases and exponents are different");
+  }
+
+  if (mod == 1) {
+    for (size_t i = 0; i < e.size(); ++i) {
+      if (e[i].isNeg()) {
+        throw std::invalid_argument("multiPowm: exponent must be non-negative");
+      }
+    }
+    z.set(0);
+    return;
+  }
+
+  if (mod[0] & 1) {
+    MontgomeryContext ctx(mod);
+    MultiPowm p(ctx);
+    p.pow(z, g, e);
+    return;
+  }
+
+  // @note: even moduli are not the target, each power is computed separately.
+  MPInt r(1), t;
+  for (size_t i = 0; i < g.size(); ++i) {
+    powm(t, g[i], e[i], mod);
+    MPInt::mul(r, r, t);
+    MPInt::mod(r, r, mod);
+  }
+  MPInt::mod(z, r, mod);
+}
+
+void powm(MPInt& z, const MPInt& base, const MPInt& exp, const MPInt& mod, const size_t window)
+{
+  if (! mod.isPos()) {
+    throw std::invalid_argument("powm: modulus must be positive");
+  }
+  if (exp.isNeg()) {
+    throw std::invalid_argument("powm: exponent must be non-negative");
+  }
+  if (window > MontgomeryPowm::maxWindow) {
+    throw std::invalid_argument("powm: window is too large");
+  }
+
+  if (mod == 1) {
+    z.set(0);
+    return;
+  }
+
+  if (mod[0] & 1) {
+    MontgomeryContext ctx(mod);
+    MontgomeryPowm p(ctx, window);
+    p.pow(z, base, exp);
+    return;
+  }
+
+  BarrettContext ctx(mod);
+  const size_t k = ctx.size();
+  const size_t w = window == 0 ? MontgomeryPowm::window(exp.size()*64) : window;
+  const size_t tableSize = ((size_t)1 << (w - 1))*k;
+
+  // table, t, x, z, product and work are allocated at once.
+  std::vector<value_type> buf(tableSize + k*5 + ctx.workSize());
+  value_type* table = &buf[0];
+  value_type* t = table + tableSize;
+  value_type* x = t + k;
+  value_type* zd = x + k;
+  value_type* product = zd + k;
+  value_type* work = product + k*2;
+
+  MPInt r;
+  MPInt::mod(r, base, mod);
+  std::copy(r.get(), r.get() + r.size(), x);
+
+  slidingWindow(BarrettOps(ctx, product, work), zd, x, exp.get(), exp.size(), w, table, t);
+  z.set(zd, k);
+}
+
+} // namespace mpint
@@ -0,0 +1,265 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+#include "prime.hpp"
+#include "montgomery.hpp"
+#include "powm.hpp"
+#include "kronecker-jacobi.hpp"
+#include "isqrt.hpp"
+#include "integer-util.hpp"
+
+namespace integer {
+
+namespace impl {
+
+namespace {
+
+using mpint::MPInt;
+using mpint::MontgomeryContext;
+typedef MPInt::value_type value_type;
+typedef MPInt::dvalue_type dvalue_type;
+
+/*
+  Odd primes less than smallPrimeBound, grouped so that the product of
+  each group fits in a digit.
+*/
+struct SmallPrimes {
+  std::vector<uint32_t> primes;
+  // group i is primes[first[i], first[i + 1]), and its product is product[i].
+  std::vector<size_t> first;
+  std::vector<value_type> product;
+
+  SmallPrimes()
+  {
+    for (uint32_t p = 3; p < smallPrimeBound; p += 2) {
+      bool prime = true;
+      for (uint32_t d = 3; prime && d*d <= p; d += 2) {
+        prime = p % d != 0;
+      }
+      if (prime) {
+        primes.push_back(p);
+      }
+    }
+    value_type q = 1;
+    first.push_back(0);
+    for (size_t i = 0; i < primes.size(); ++i) {
+      if ((dvalue_type)q * primes[i] >> 64) {
+        product.push_back(q);
+        first.push_back(i);
+        q = 1;
+      }
+      q *= primes[i];
+    }
+    product.push_back(q);
+    first.push_back(primes.size());
+  }
+};
+
+const SmallPrimes& smallPrimes()
+{
+  static const SmallPrimes sp;
+  return sp;
+}
+
+/*
+  x mod m for small signed x, in Montgomery form.
+*/
+void toMontSmall(const MontgomeryContext& ctx, value_type* z, const int64_t x, const MPInt& m)
+{
+  MPInt r;
+  MPInt::mod(r, MPInt(x), m);
+  ctx.toMont(z, r);
+}
+
+} // namespace
+
+bool isStrongProbablePrime(const mpint::MPInt& n, const mpint::MPInt& a)
+{
+  assert(n.isOdd() && n > 1);
+
+  // n - 1 = d 2^s.
+  MPInt nm1, d;
+  MPInt::sub(nm1, n, MPInt(1));
+  const size_t s = nm1.NTZ();
+  MPInt::shr(d, nm1, s);
+
+  MontgomeryContext ctx(n);
+  const size_t len = ctx.size();
+  std::vector<value_type> buf(len*3);
+  value_type* x = &buf[0];
+  value_type* minusOne = x + len;
+  value_type* zero = minusOne + len;
+  MPInt ar;
+  MPInt::mod(ar, a, n);
+  if (ar.isZero()) {
+    return false;
+  }
+  ctx.toMont(x, ar);
+  ctx.sub(minusOne, zero, ctx.one());
+
+  mpint::MontgomeryPowm pw(ctx);
+  pw.pow(x, x, d.get(), d.size());
+  if (std::equal(x, x + len, ctx.one()) || std::equal(x, x + len, minusOne)) {
+    return true;
+  }
+  for (size_t r = 1; r < s; ++r) {
+    ctx.sqr(x, x);
+    if (std::equal(x, x + len, minusOne)) {
+      return true;
+    }
+    if (std::equal(x, x + len, ctx.one())) {
+      return false;
+    }
+  }
+  return false;
+}
+
+bool isStrongLucasProbablePrime(const mpint::MPInt& n)
+{
+  assert(n.isOdd() && n > 1);
+
+  // Selfridge's D, a square n has no D with (D/n) = -1.
+  int64_t D = 5;
+  for (;;) {
+    const int j = kronecker(MPInt(D), n);
+    if (j == -1) {
+      break;
+    }
+    if (j == 0 && ! (n == (D < 0 ? -D : D))) {
+      return false;
+    }
+    D = D < 0 ? -D + 2 : -(D + 2);
+    // the search does not end for a square n, look for it after some tries.
+    if ((D < 0 ? -D : D) == 61 && isSquare(n)) {
+      return false;
+    }
+  }
+  const int64_t Q = (1 - D) / 4;
+
+  // n + 1 = d 2^s.
+  MPInt np1, d;
+  MPInt::add(np1, n, MPInt(1));
+  const size_t s = np1.NTZ();
+  MPInt::shr(d, np1, s);
+
+  MontgomeryContext ctx(n);
+  const size_t len = ctx.size();
+  std::vector<value_type> buf(len*5);
+  value_type* V0 = &buf[0];
+  value_type* V1 = V0 + len;
+  value_type* Qk = V1 + len;
+  value_type* Qm = Qk + len;
+  value_type* t = Qm + len;
+  toMontSmall(ctx, Qm, Q, n);
+
+  /*
+    Ladder on (V_k, V_k+1, Q^k) with P = 1,
+    V_2k = V_k^2 - 2 Q^k, V_2k+1 = V_k V_k+1 - Q^k, V_2k+2 = V_k+1^2 - 2 Q^(k+1).
+    U_k is not computed since D U_k = 2 V_k+1 - V_k,
+    it saves a multiplication for each bit of d.
+    Start from k = 1: V_1 = 1, V_2 = 1 - 2 Q.
+  */
+  std::copy(ctx.one(), ctx.one() + len, V0);
+  ctx.sub(V1, V0, Qm);
+  ctx.sub(V1, V1, Qm);
+  std::copy(Qm, Qm + len, Qk);
+  const size_t bits = d.size()*64 - __builtin_clzll(d[d.size() - 1]);
+  for (size_t i = bits - 1; i > 0; --i) {
+    if ((d[(i - 1) / 64] >> ((i - 1) % 64)) & 0x1) {
+      // k = 2k + 1.
+      ctx.mul(V0, V0, V1);
+      ctx.sub(V0, V0, Qk);
+      ctx.mul(t, Qk, Qm);
+      ctx.sqr(V1, V1);
+      ctx.sub(V1, V1, t);
+      ctx.sub(V1, V1, t);
+      ctx.mul(Qk, Qk, t);
+    } else {
+      // k = 2k.
+      ctx.mul(V1, V0, V1);
+      ctx.sub(V1, V1, Qk);
+      ctx.sqr(V0, V0);
+      ctx.sub(V0, V0, Qk);
+      ctx.sub(V0, V0, Qk);
+      ctx.sqr(Qk, Qk);
+    }
+  }
+
+  // U_d = 0 iff 2 V_d+1 = V_d, because gcd(D, n) = 1.
+  ctx.add(t, V1, V1);
+  if (std::equal(t, t + len, V0) || isZero(V0, len)) {
+    return true;
+  }
+  for (size_t r = 1; r < s; ++r) {
+    // V_2k = V_k^2 - 2 Q^k.
+    ctx.sqr(V0, V0);
+    ctx.sub(V0, V0, Qk);
+    ctx.sub(V0, V0, Qk);
+    if (isZero(V0, len)) {
+      return true;
+    }
+    ctx.sqr(Qk, Qk);
+  }
+  return false;
+}
+
+bool isProbablePrime(const mpint::MPInt& in_n)
+{
+  MPInt n;
+  MPInt::absolute(n, in_n);
+  if (n < 2) {
+    return false;
+  }
+  if (! n.isOdd()) {
+    return n == 2;
+  }
+
+  // trial division.
+  const SmallPrimes& sp = smallPrimes();
+  for (size_t g = 0; g < sp.product.size(); ++g) {
+    const value_type r = MPInt::divrem_1(0, n.get(), n.size(), sp.product[g]);
+    for (size_t i = sp.first[g]; i < sp.first[g + 1]; ++i) {
+      if (r % sp.primes[i] == 0) {
+        return n == (int64_t)sp.primes[i];
+      }
+    }
+  }
+  if (n < (int64_t)smallPrimeBound * smallPrimeBound) {
+    return true;
+  }
+
+  return isStrongProbablePrime(n, MPInt(2)) && isStrongLucasProbablePrime(n);
+}
+
+} // namespace impl
+
+} // namespace integer
@@ -0,0 +1,257 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+#include "primegen.hpp"
+#include "prime.hpp"
+#include "integer-util.hpp"
+
+namespace integer {
+
+namespace {
+
+using mpint::MPInt;
+using impl::bitLength;
+using impl::oddPrimes;
+typedef MPInt::value_type value_type;
+
+std::vector<uint32_t> checkedPrimes(const size_t bits, const size_t threads, const uint32_t sieveLimit,
+                                    const size_t segmentBits, const size_t segments)
+{
+  if (bits < 32 || threads < 1 || sieveLimit < 3 || sieveLimit > (1 << 16)
+      || segmentBits == 0 || segmentBits % 64 != 0 || segments < 1) {
+    throw std::invalid_argument("PrimeGenerator: invalid parameters");
+  }
+  std::vector<uint32_t> p = oddPrimes(sieveLimit);
+  if (p.empty()) {
+    // sieveLimit == 3, MultiModulus needs a modulus.
+    p.push_back(3);
+  }
+  return p;
+}
+
+/*
+  Random odd x with exactly bits bits.
+*/
+void randomBase(MPInt& x, const size_t bits, std::mt19937_64& rng)
+{
+  const size_t n = (bits + 63) / 64;
+  std::vector<value_type> d(n);
+  for (size_t i = 0; i < n; ++i) {
+    d[i] = rng();
+  }
+  const size_t top = (bits - 1) % 64;
+  if (top < 63) {
+    d[n - 1] &= ((value_type)1 << (top + 1)) - 1;
+  }
+  d[n - 1] |= (value_type)1 << top;
+  d[0] |= 1;
+  x.set(&d[0], n);
+}
+
+inline bool isPrimeCandidate(const MPInt& n)
+{
+  return impl::isStrongProbablePrime(n, MPInt(2)) && impl::isStrongLucasProbablePrime(n);
+}
+
+} // namespace
+
+PrimeGenerator::PrimeGenerator(const size_t bits, const size_t threads, const uint32_t sieveLimit,
+                               const size_t segmentBits, const size_t segments)
+  : bits_(bits), threads_(threads), segmentBits_(segmentBits), segments_(segments),
+    primes_(checkedPrimes(bits, threads, sieveLimit, segmentBits, segments)),
+    half_(), mm_(primes_), next_(primes_.size()), segment_(segmentBits / 64), stats_()
+{
+  half_.resize(primes_.size());
+  for (size_t j = 0; j < primes_.size(); ++j) {
+    half_[j] = (primes_[j] + 1) / 2;
+  }
+}
+
+/*
+  survivor(c) for each odd c = base + 2i which has no factor in primes_,
+  until a candidate has more than bits_ bits or survivor returns false.
+*/
+template<class F>
+void PrimeGenerator::sieve_(const MPInt& base, F& survivor)
+{
+  const size_t k = primes_.size();
+  uint32_t* r = &next_[0];
+  mm_.residues(r, base);
+  // base + 2i = 0 mod p iff i = -r/2 mod p.
+  for (size_t j = 0; j < k; ++j) {
+    const uint32_t p = primes_[j];
+    r[j] = (uint32_t)((uint64_t)(p - r[j]) * half_[j] % p);
+  }
+
+  const size_t words = segment_.size();
+  uint64_t* s = &segment_[0];
+  MPInt c;
+  for (size_t seg = 0; seg < segments_; ++seg) {
+    std::fill(s, s + words, 0);
+    for (size_t j = 0; j < k; ++j) {
+      const uint32_t p = primes_[j];
+      size_t i = r[j];
+      for (; i < segmentBits_; i += p) {
+        s[i / 64] |= (uint64_t)1 << (i % 64);
+      }
+      r[j] = (uint32_t)(i - segmentBits_);
+    }
+    stats_.candidates += segmentBits_;
+    for (size_t w = 0; w < words; ++w) {
+      uint64_t v = ~s[w];
+      while (v) {
+        const size_t i = seg*segmentBits_ + w*64 + (size_t)__builtin_ctzll(v);
+        v &= v - 1;
+        MPInt::add(c, base, MPInt((int64_t)(2*i)));
+        // the following candidates are longer too.
+        if (bitLength(c) > bits_) {
+          return;
+        }
+        if (! survivor(c)) {
+          return;
+        }
+      }
+    }
+  }
+}
+
+void PrimeGenerator::generate(std::vector<MPInt>& primes, const size_t count, const uint64_t seed)
+{
+  stats_ = Stats();
+  stats_.threads = threads_;
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::mt19937_64 rng(seed);
+  MPInt base;
+  size_t found = 0;
+
+  if (threads_ == 1) {
+    auto test = [&](const MPInt& c) -> bool {
+      ++stats_.tested;
+      if (isPrimeCandidate(c)) {
+        primes.push_back(c);
+        ++found;
+      }
+      return found < count;
+    };
+    while (found < count) {
+      randomBase(base, bits_, rng);
+      sieve_(base, test);
+    }
+  } else {
+    /*
+      Survivors go to the workers in batches of batchSize,
+      and at most maxBatches batches wait in the queue.
+    */
+    const size_t batchSize = 16;
+    const size_t maxBatches = 4*threads_;
+    std::mutex mtx;
+    std::condition_variable notEmpty, notFull;
+    std::deque<std::vector<MPInt> > queue;
+    bool closed = false;
+    std::atomic<bool> done(count == 0);
+    std::atomic<size_t> tested(0);
+
+    auto worker = [&]() {
+      for (;;) {
+        std::vector<MPInt> batch;
+        {
+          std::unique_lock<std::mutex> lock(mtx);
+          notEmpty.wait(lock, [&]() { return ! queue.empty() || closed; });
+          if (queue.empty()) {
+            return;
+          }
+          batch.swap(queue.front());
+          queue.pop_front();
+          notFull.notify_one();
+        }
+        for (size_t i = 0; i < batch.size() && ! done; ++i) {
+          ++tested;
+          if (isPrimeCandidate(batch[i])) {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (found < count) {
+              primes.push_back(batch[i]);
+              if (++found == count) {
+                done = true;
+                notFull.notify_all();
+              }
+            }
+          }
+        }
+      }
+    };
+    std::vector<std::thread> th;
+    for (size_t t = 0; t < threads_; ++t) {
+      th.push_back(std::thread(worker));
+    }
+
+    std::vector<MPInt> batch;
+    auto push = [&](const MPInt& c) -> bool {
+      batch.push_back(c);
+      if (batch.size() < batchSize) {
+        return ! done;
+      }
+      std::unique_lock<std::mutex> lock(mtx);
+      notFull.wait(lock, [&]() { return queue.size() < maxBatches || done; });
+      if (done) {
+        return false;
+      }
+      queue.push_back(std::vector<MPInt>());
+      queue.back().swap(batch);
+      notEmpty.notify_one();
+      return true;
+    };
+    while (! done) {
+      randomBase(base, bits_, rng);
+      sieve_(base, push);
+    }
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      closed = true;
+      queue.clear();
+    }
+    notEmpty.notify_all();
+    for (size_t t = 0; t < th.size(); ++t) {
+      th[t].join();
+    }
+    stats_.tested = tested;
+  }
+
+  stats_.primes = found;
+  stats_.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace integer
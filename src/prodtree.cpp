@@ -0,0 +1,345 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "prodtree.hpp"
+
+namespace mpint {
+
+namespace {
+
+typedef MPInt::value_type value_type;
+
+const size_t reciprocalBaseSize = 32;
+
+inline size_t normalized(const value_type* x, size_t n)
+{
+  while (n > 0 && x[n - 1] == 0) {
+    --n;
+  }
+  return n;
+}
+
+/*
+  z[0..xn+yn) = x * y for any sizes, zero if one of them is zero.
+*/
+void mul(value_type* z, const value_type* x, const size_t xn, const value_type* y, const size_t yn)
+{
+  if (xn == 0 || yn == 0) {
+    std::fill(z, z + xn + yn, 0);
+  } else if (xn >= yn) {
+    MPInt::mul_n(z, x, xn, y, yn);
+  } else {
+    MPInt::mul_n(z, y, yn, x, xn);
+  }
+}
+
+/*
+  v[0..n+2) = floor(B^(2n) / m) by Newton's iteration
+  v' = 2v - floor(v^2 m / B^(2n)) from the reciprocal of the top digits,
+  then a few corrections.
+  @require: m[n - 1] != 0.
+*/
+void reciprocal(value_type* v, const value_type* m, const size_t n)
+{
+  if (n <= reciprocalBaseSize) {
+    std::vector<value_type> u(2*n + 1, 0), q(n + 2), r(n);
+    u[2*n] = 1;
+    MPInt::divrem_n(&q[0], &r[0], &u[0], 2*n + 1, m, n);
+    std::copy(q.begin(), q.end(), v);
+    return;
+  }
+
+  // the top h digits with 2 guard digits, then the relative error of
+  // v0 is less than B^(-h+1), and the one of v1 is less than B^(-n-1).
+  const size_t h = (n + 1) / 2 + 2;
+  const size_t l = n - h;
+  std::fill(v, v + l, 0);
+  reciprocal(v + l, m + l, h);
+
+  const size_t vn = normalized(v, n + 2);
+  std::vector<value_type> t(vn*2 + vn*2 + n);
+  value_type* sq = &t[0];
+  value_type* s = sq + vn*2;
+  mul(sq, v, vn, v, vn);
+  const size_t sqn = normalized(sq, vn*2);
+  mul(s, sq, sqn, m, n);
+  const size_t sn = normalized(s, sqn + n);
+
+  // v = 2v - floor(s / B^(2n)).
+  const value_type c = MPInt::add_n(v, v, v, n + 2);
+  assert(c == 0);
+  (void)c;
+  if (sn > 2*n) {
+    const value_type b = MPInt::sub_n(v, v, s + 2*n, sn - 2*n);
+    if (sn - 2*n < n + 2) {
+      MPInt::sub_1(v + sn - 2*n, v + sn - 2*n, n + 2 - (sn - 2*n), b);
+    }
+  }
+
+  // p = v m, then v - 1 while p > B^(2n), v + 1 while B^(2n) - p >= m.
+  std::vector<value_type> p(3*n + 2), e(2*n + 2, 0);
+  e[2*n] = 1;
+  mul(&p[0], v, n + 2, m, n);
+  while (MPInt::cmp_n(&p[0], &e[0], 2*n + 2) > 0) {
+    MPInt::sub_1(v, v, n + 2, 1);
+    const value_type b = MPInt::sub_n(&p[0], &p[0], m, n);
+    MPInt::sub_1(&p[n], &p[n], n + 2, b);
+  }
+  MPInt::sub_n(&e[0], &e[0], &p[0], 2*n + 2);
+  for (;;) {
+    const size_t en = normalized(&e[0], 2*n + 2);
+    if (en < n || (en == n && MPInt::cmp_n(&e[0], m, n) < 0)) {
+      break;
+    }
+    MPInt::add_1(v, v, n + 2, 1);
+    const value_type b = MPInt::sub_n(&e[0], &e[0], m, n);
+    MPInt::sub_1(&e[n], &e[n], n + 2, b);
+  }
+}
+
+/*
+  r[0..n) = u mod m for n <= un <= 2n, mu = floor(B^(2n)/m) of n + 2 digits.
+  The quotient is under estimated by at most 2 (HAC 14.42).
+  @require: tmp has 5n + 6 digits.
+*/
+void barrett(value_type* r, const value_type* u, const size_t un, const value_type* m, const size_t n, const value_type* mu, value_type* tmp)
+{
+  assert(n <= un && un <= 2*n);
+  const size_t mun = normalized(mu, n + 2);
+  value_type* q2 = tmp;
+  value_type* p = q2 + (n + 1) + (n + 2);
+  value_type* w = p + (n + 2) + n;
+
+  // q3 = floor(floor(u / B^(n-1)) mu / B^(n+1)).
+  const size_t q1n = un - n + 1;
+  mul(q2, u + n - 1, q1n, mu, mun);
+  const size_t q2n = q1n + mun;
+  const size_t q3n = q2n > n + 1 ? q2n - (n + 1) : 0;
+  const value_type* q3 = q2 + n + 1;
+
+  // w = u - q3 m mod B^(n+1).
+  const size_t pn = normalized(q3, q3n) + n;
+  mul(p, q3, pn - n, m, n);
+  std::fill(p + pn, p + std::max(pn, n + 1), 0);
+  const size_t wn = std::min(un, n + 1);
+  std::copy(u, u + wn, w);
+  std::fill(w + wn, w + n + 1, 0);
+  MPInt::sub_n(w, w, p, n + 1);
+  while (w[n] != 0 || MPInt::cmp_n(w, m, n) >= 0) {
+    const value_type b = MPInt::sub_n(w, w, m, n);
+    w[n] -= b;
+  }
+  std::copy(w, w + n, r);
+}
+
+/*
+  f(i) for i in [begin, end), split into threads chunks.
+*/
+template<class F>
+void parallelFor(const size_t begin, const size_t end, const size_t threads, F f)
+{
+  const size_t len = end - begin;
+  const size_t nt = std::max(std::min(threads, len), (size_t)1);
+  if (nt == 1) {
+    for (size_t i = begin; i < end; ++i) {
+      f(i);
+    }
+    return;
+  }
+  std::vector<std::thread> th;
+  for (size_t c = 0; c < nt; ++c) {
+    const size_t b = begin + len*c / nt;
+    const size_t e = begin + len*(c + 1) / nt;
+    th.push_back(std::thread([b, e, &f]() {
+          for (size_t i = b; i < e; ++i) {
+            f(i);
+          }
+        }));
+  }
+  for (size_t c = 0; c < th.size(); ++c) {
+    th[c].join();
+  }
+}
+
+} // namespace
+
+ProductTree::ProductTree(const std::vector<MPInt>& moduli, const size_t threads)
+  : node_(), level_(), arena_(), work_()
+{
+  const size_t k = moduli.size();
+  if (k == 0) {
+    throw std::invalid_argument("ProductTree: no moduli");
+  }
+  for (size_t i = 0; i < k; ++i) {
+    if (! moduli[i].isPos()) {
+      throw std::invalid_argument("ProductTree: moduli must be positive");
+    }
+  }
+
+  // layout, the capacity of a node is the sum of the ones of its children.
+  level_.push_back(0);
+  for (size_t i = 0; i < k; ++i) {
+    Node node = { 0, moduli[i].size(), moduli[i].size(), 0 };
+    node_.push_back(node);
+  }
+  level_.push_back(k);
+  while (level_.back() - level_[level_.size() - 2] > 1) {
+    const size_t b = level_[level_.size() - 2];
+    const size_t e = level_.back();
+    for (size_t i = b; i < e; i += 2) {
+      const size_t cap = node_[i].cap + (i + 1 < e ? node_[i + 1].cap : 0);
+      Node node = { 0, 0, cap, 0 };
+      node_.push_back(node);
+    }
+    level_.push_back(node_.size());
+  }
+  size_t total = 0;
+  for (size_t i = 0; i < node_.size(); ++i) {
+    node_[i].off = total;
+    total += node_[i].cap;
+  }
+  work_.resize(total);
+  for (size_t i = 0; i < node_.size(); ++i) {
+    if (node_[i].cap >= barrettThreshold) {
+      node_[i].muOff = total;
+      total += node_[i].cap + 2;
+    }
+  }
+  arena_.resize(total);
+
+  for (size_t i = 0; i < k; ++i) {
+    std::copy(moduli[i].get(), moduli[i].get() + moduli[i].size(), &arena_[node_[i].off]);
+  }
+  for (size_t l = 0; l + 1 < level_.size(); ++l) {
+    const size_t b = level_[l];
+    const size_t e = level_[l + 1];
+    parallelFor(b, e, threads, [this, l, b](const size_t i) {
+        Node& node = node_[i];
+        if (l > 0) {
+          const size_t c = level_[l - 1] + (i - b)*2;
+          const Node& x = node_[c];
+          value_type* z = &arena_[node.off];
+          if (c + 1 < b) {
+            const Node& y = node_[c + 1];
+            mul(z, &arena_[x.off], x.n, &arena_[y.off], y.n);
+            node.n = normalized(z, x.n + y.n);
+          } else {
+            std::copy(&arena_[x.off], &arena_[x.off] + x.n, z);
+            node.n = x.n;
+          }
+        }
+        if (node.n >= barrettThreshold) {
+          reciprocal(&arena_[node.muOff], &arena_[node.off], node.n);
+        }
+      });
+  }
+}
+
+void ProductTree::product(MPInt& z) const
+{
+  const Node& root = node_.back();
+  z.set(&arena_[root.off], root.n);
+}
+
+void ProductTree::reduce_(value_type* r, const value_type* u, const size_t un, const Node& node, std::vector<value_type>& tmp) const
+{
+  const size_t n = node.n;
+  const value_type* m = &arena_[node.off];
+  if (un < n) {
+    std::copy(u, u + un, r);
+    std::fill(r + un, r + n, 0);
+    return;
+  }
+  if (n < barrettThreshold) {
+    MPInt::divrem_n(0, r, u, un, m, n);
+    return;
+  }
+
+  const value_type* mu = &arena_[node.muOff];
+  if (tmp.size() < 7*n + 6) {
+    tmp.resize(7*n + 6);
+  }
+  if (un <= 2*n) {
+    barrett(r, u, un, m, n, mu, &tmp[0]);
+    return;
+  }
+
+  // the top 2n digits, then n digits at a time.
+  value_type* c = &tmp[5*n + 6];
+  size_t pos = un - 2*n;
+  barrett(r, u + pos, 2*n, m, n, mu, &tmp[0]);
+  while (pos > 0) {
+    const size_t len = std::min(pos, n);
+    pos -= len;
+    std::copy(u + pos, u + pos + len, c);
+    std::copy(r, r + n, c + len);
+    barrett(r, c, n + len, m, n, mu, &tmp[0]);
+  }
+}
+
+void ProductTree::remainders(std::vector<MPInt>& r, const MPInt& x, const size_t threads)
+{
+  const size_t k = size();
+  r.resize(k);
+
+  {
+    std::vector<value_type> tmp;
+    const Node& root = node_.back();
+    reduce_(&work_[root.off], x.get(), x.size(), root, tmp);
+  }
+  for (size_t l = level_.size() - 2; l > 0; --l) {
+    const size_t b = level_[l - 1];
+    const size_t e = level_[l];
+    const size_t pb = e;
+    parallelFor(b, e, threads, [this, b, pb](const size_t i) {
+        std::vector<value_type> tmp;
+        const Node& node = node_[i];
+        const Node& parent = node_[pb + (i - b) / 2];
+        const value_type* u = &work_[parent.off];
+        reduce_(&work_[node.off], u, normalized(u, parent.n), node, tmp);
+      });
+  }
+
+  for (size_t i = 0; i < k; ++i) {
+    const Node& node = node_[i];
+    r[i].set(&work_[node.off], node.n);
+    if (x.isNeg() && ! r[i].isZero()) {
+      MPInt m;
+      m.set(&arena_[node.off], node.n);
+      MPInt::sub(r[i], m, r[i]);
+    }
+  }
+}
+
+} // namespace mpint
@@ -0,0 +1,633 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <vector>
+
+#include "qform.hpp"
+#include "gcd.hpp"
+#include "isqrt.hpp"
+#include "kronecker-jacobi.hpp"
+#include "sqrtmod.hpp"
+
+namespace integer {
+
+namespace {
+
+using mpint::MPInt;
+typedef MPInt::value_type value_type;
+__extension__ typedef __int128 sdvalue_type;
+
+inline size_t normalized(const value_type* x, size_t n)
+{
+  while (n > 0 && x[n - 1] == 0) {
+    --n;
+  }
+  return n;
+}
+
+/*
+  q = x/y.
+  @require: y divides x.
+*/
+void divexact(MPInt& q, const MPInt& x, const MPInt& y)
+{
+  MPInt r;
+  MPInt::divmod(q, r, x, y);
+  assert(r.isZero());
+}
+
+/*
+  Extended Euclid on (x, y), 0 <= y < x, which stops at a given remainder.
+
+  The state is two consecutive remainders Rp > R
+  and the cofactors yp, y of y such that Rp = yp y mod x and R = y y mod x.
+  The cofactors alternate in sign, y = (-1)^k |y| after k steps,
+  and their magnitudes are kept, which only grow by additions.
+  Quotients are taken by Lehmer steps on 63 leading bits (Knuth Algorithm L)
+  as in gcd, and a Lehmer step stops before the leading bits of a remainder
+  go below the bound.
+*/
+class PartialEuclid {
+public:
+  PartialEuclid(const MPInt& x, const MPInt& y)
+    : n_(x.size() + 4),
+      a_(n_), b_(n_), p_(n_), q_(n_), t_(n_), u_(n_),
+      an_(x.size()), bn_(y.size()), pn_(0), qn_(1), steps_(0)
+  {
+    assert(y < x && ! y.isNeg());
+    std::copy(x.get(), x.get() + an_, a_.begin());
+    std::copy(y.get(), y.get() + bn_, b_.begin());
+    q_[0] = 1;
+  }
+
+  /*
+    Steps while R > L.
+  */
+  void run(const MPInt& L)
+  {
+    const size_t ln = L.size();
+    const size_t lbits = ln == 0 ? 0 : ln*64 - (size_t)__builtin_clzll(L[ln - 1]);
+    while (bn_ > ln || (bn_ == ln && ln > 0 && MPInt::cmp_n(&b_[0], L.get(), ln) > 0)) {
+      lehmerStep(lbits);
+    }
+  }
+
+  /*
+    @return: x yp' - xp y' for the cofactors xp, x of x, i.e. (-1)^(k + 1).
+  */
+  int det() const { return (steps_ & 1) ? 1 : -1; }
+
+  void get(MPInt& Rp, MPInt& R, MPInt& yp, MPInt& y) const
+  {
+    assign(Rp, a_, an_, false);
+    assign(R, b_, bn_, false);
+    assign(yp, p_, pn_, (steps_ & 1) == 0);
+    assign(y, q_, qn_, (steps_ & 1) != 0);
+  }
+
+private:
+  static void assign(MPInt& z, const std::vector<value_type>& x, const size_t n, const bool neg)
+  {
+    if (n == 0) {
+      z = MPInt(0);
+    } else {
+      z.set(&x[0], n, neg);
+    }
+  }
+
+  /*
+    (Rp, R) = (R, Rp mod R), (yp, y) = (y, yp - (Rp/R) y).
+  */
+  void divStep()
+  {
+    size_t wn;
+    if (an_ == 1) {
+      u_[0] = a_[0] / b_[0];
+      t_[0] = a_[0] % b_[0];
+      wn = 1;
+    } else {
+      MPInt::divrem_n(&u_[0], &t_[0], &a_[0], an_, &b_[0], bn_);
+      wn = normalized(&u_[0], an_ - bn_ + 1);
+    }
+    const size_t rn = normalized(&t_[0], bn_);
+    a_.swap(b_);
+    an_ = bn_;
+    b_.swap(t_);
+    bn_ = rn;
+
+    // |y'| = |yp| + w |y|.
+    value_type* r = &t_[0];
+    size_t zn;
+    if (wn == 1) {
+      r[qn_] = MPInt::mul_1(r, &q_[0], qn_, u_[0]);
+      zn = qn_ + 1;
+    } else {
+      if (wn >= qn_) {
+        MPInt::mul_n(r, &u_[0], wn, &q_[0], qn_);
+      } else {
+        MPInt::mul_n(r, &q_[0], qn_, &u_[0], wn);
+      }
+      zn = wn + qn_;
+    }
+    addTo(r, zn, &p_[0], pn_);
+    p_.swap(q_);
+    pn_ = qn_;
+    q_.swap(t_);
+    qn_ = normalized(r, zn);
+    ++steps_;
+  }
+
+  /*
+    One Lehmer step, or divStep if no quotient is found.
+    @require: R > 0.
+  */
+  void lehmerStep(const size_t lbits)
+  {
+    const size_t an = an_;
+    if (an < 2 || bn_ + 1 < an) {
+      divStep();
+      return;
+    }
+
+    const value_type* a = &a_[0];
+    const value_type b1 = bn_ >= an ? b_[an - 1] : 0;
+    const value_type b2 = b_[an - 2];
+    const size_t s = (size_t)__builtin_clzll(a[an - 1]);
+    const value_type ah0 = s == 0 ? a[an - 1] : (a[an - 1] << s) | (a[an - 2] >> (64 - s));
+    const value_type bh0 = s == 0 ? b1 : (b1 << s) | (b2 >> (64 - s));
+    sdvalue_type ah = (sdvalue_type)(ah0 >> 1);
+    sdvalue_type bh = (sdvalue_type)(bh0 >> 1);
+
+    // ah = Rp/2^e, remainders below 2^(lbits + 2) are not taken.
+    const size_t e = an*64 - s - 63;
+    const sdvalue_type low = lbits + 2 > e ? (sdvalue_type)1 << (lbits + 2 - e) : 0;
+
+    sdvalue_type A = 1, B = 0, C = 0, D = 1;
+    size_t k = 0;
+    for (;;) {
+      if (bh + C == 0 || bh + D == 0) {
+        break;
+      }
+      const sdvalue_type q = (ah + A) / (bh + C);
+      if (q != (ah + B) / (bh + D) || ah - q*bh < low) {
+        break;
+      }
+      sdvalue_type t;
+      t = A - q*C; A = C; C = t;
+      t = B - q*D; B = D; D = t;
+      t = ah - q*bh; ah = bh; bh = t;
+      ++k;
+    }
+
+    if (B == 0) {
+      divStep();
+      return;
+    }
+
+    const size_t tn = lincomb(&t_[0], (int64_t)A, (int64_t)B);
+    const size_t un = lincomb(&u_[0], (int64_t)C, (int64_t)D);
+    a_.swap(t_);
+    b_.swap(u_);
+    an_ = tn;
+    bn_ = un;
+
+    const size_t tpn = addmul(&t_[0], absolute(A), absolute(B));
+    const size_t tqn = addmul(&u_[0], absolute(C), absolute(D));
+    p_.swap(t_);
+    q_.swap(u_);
+    pn_ = tpn;
+    qn_ = tqn;
+    steps_ += k;
+  }
+
+  static value_type absolute(const sdvalue_type x)
+  {
+    return (value_type)(x < 0 ? -x : x);
+  }
+
+  /*
+    r[0..rn) += x[0..xn).
+    @require: xn <= rn, no carry out of r.
+  */
+  static void addTo(value_type* r, const size_t rn, const value_type* x, const size_t xn)
+  {
+    if (xn == 0) {
+      return;
+    }
+    value_type c = MPInt::add_n(r, r, x, xn);
+    if (rn > xn) {
+      c = MPInt::add_1(r + xn, r + xn, rn - xn, c);
+    }
+    assert(c == 0);
+    (void)c;
+  }
+
+  /*
+    r = x Rp + y R for x, y of opposite signs with r >= 0.
+    @return: size of r.
+  */
+  size_t lincomb(value_type* r, const int64_t x, const int64_t y) const
+  {
+    const value_type* a = &a_[0];
+    const value_type* b = &b_[0];
+    const size_t an = an_;
+    const size_t bn = bn_;
+    value_type c;
+
+    if (y <= 0) {
+      assert(x >= 0);
+      c = MPInt::mul_1(r, a, an, (value_type)x);
+      value_type borrow = MPInt::submul_1(r, b, bn, (value_type)(-y));
+      if (an > bn) {
+        borrow = MPInt::sub_1(r + bn, r + bn, an - bn, borrow);
+      }
+      c -= borrow;
+    } else {
+      assert(x <= 0);
+      c = MPInt::mul_1(r, b, bn, (value_type)y);
+      if (an > bn) {
+        r[bn] = c;
+        std::fill(r + bn + 1, r + an, 0);
+        c = 0;
+      }
+      c -= MPInt::submul_1(r, a, an, (value_type)(-x));
+    }
+    assert(c == 0);
+    (void)c;
+    return normalized(r, an);
+  }
+
+  /*
+    r = x |yp| + y |y|.
+    @return: size of r.
+  */
+  size_t addmul(value_type* r, const value_type x, const value_type y) const
+  {
+    r[qn_] = MPInt::mul_1(r, &q_[0], qn_, y);
+    if (pn_ > 0) {
+      const value_type c = MPInt::addmul_1(r, &p_[0], pn_, x);
+      addTo(r + pn_, qn_ + 1 - pn_, &c, 1);
+    }
+    return normalized(r, qn_ + 1);
+  }
+
+  const size_t n_;
+  std::vector<value_type> a_;
+  std::vector<value_type> b_;
+  std::vector<value_type> p_;
+  std::vector<value_type> q_;
+  std::vector<value_type> t_;
+  std::vector<value_type> u_;
+  size_t an_;
+  size_t bn_;
+  size_t pn_;
+  size_t qn_;
+  size_t steps_;
+};
+
+/*
+  Euclid on (x, y mod x) to the end.
+  @require: x > 0.
+  @return: d = gcd(x, y), and u such that u y = d mod x.
+*/
+MPInt gcdCofactor(MPInt& u, const MPInt& x, const MPInt& y)
+{
+  MPInt r;
+  MPInt::mod(r, y, x);
+  PartialEuclid euclid(x, r);
+  euclid.run(MPInt());
+  MPInt d, t;
+  euclid.get(d, r, u, t);
+  return d;
+}
+
+/*
+  Common part of the compositions (Cohen, Algorithm 5.4.7):
+  d1 = gcd(a1, a2, s) for s = (b1 + b2)/2, v1 = a1/d1, v2 = a2/d1,
+  and 0 <= r < v1 such that the composite is (v1 v2, b2 + 2 v2 r, *), i.e.
+  v2 r = -n and s r = -d1 c2 mod v1 for n = b2 - s.
+*/
+void unite(MPInt& s, MPInt& n, MPInt& d1, MPInt& v1, MPInt& v2, MPInt& r,
+           const QuadraticForm& f1, const QuadraticForm& f2)
+{
+  divexact(s, f1.b + f2.b, MPInt(2));
+  n = f2.b - s;
+
+  // u a2 = d mod a1.
+  MPInt u, t;
+  const MPInt d = gcdCofactor(u, f1.a, f2.a);
+  if (d == 1) {
+    d1 = d;
+    t = -(u*n);
+  } else {
+    MPInt::mod(t, s, d);
+    if (t.isZero()) {
+      d1 = d;
+      t = -(u*n);
+    } else {
+      // x2 s + y2 d = d1.
+      MPInt x2, y2;
+      d1 = impl::gcdext(x2, y2, s, d);
+      t = -(u*y2*n) - x2*f2.c;
+    }
+  }
+  if (d1 == 1) {
+    v1 = f1.a;
+    v2 = f2.a;
+  } else {
+    divexact(v1, f1.a, d1);
+    divexact(v2, f2.a, d1);
+  }
+  MPInt::mod(r, t, v1);
+}
+
+/*
+  f = (a, b, c) with -a < b <= a by x -> x + q y.
+*/
+void normalize(QuadraticForm& f)
+{
+  const MPInt a2 = f.a + f.a;
+  MPInt q, t;
+  MPInt::divmod(q, t, f.a - f.b, a2);
+  if (t.isNeg()) {
+    q -= MPInt(1);
+  }
+  if (q.isZero()) {
+    return;
+  }
+  // b' = b + 2aq, c' = c + q (b + b')/2 = c + q (b + aq).
+  const MPInt aq = f.a*q;
+  f.c += q*(f.b + aq);
+  f.b += aq + aq;
+}
+
+} // namespace
+
+MPInt QuadraticForm::discriminant() const
+{
+  return b*b - MPInt(4)*a*c;
+}
+
+bool QuadraticForm::isReduced() const
+{
+  const MPInt bb = b.abs();
+  if (a < bb || c < a) {
+    return false;
+  }
+  if (bb == a || a == c) {
+    return ! b.isNeg();
+  }
+  return true;
+}
+
+std::string QuadraticForm::toString() const
+{
+  return "(" + a.toString() + ", " + b.toString() + ", " + c.toString() + ")";
+}
+
+ClassGroup::ClassGroup(const MPInt& D)
+  : D_(D), L_()
+{
+  if (! D.isNeg()) {
+    throw std::invalid_argument("ClassGroup: D must be negative");
+  }
+  const value_type m = D[0] & 3;
+  if (m != 0 && m != 3) {
+    // -D = 0, 3 mod 4.
+    throw std::invalid_argument("ClassGroup: D must be 0 or 1 modulo 4");
+  }
+  L_ = impl::iroot(D.abs() >> 2, 4);
+  if (L_.isZero()) {
+    L_ = MPInt(1);
+  }
+}
+
+QuadraticForm ClassGroup::identity() const
+{
+  const MPInt b(D_.isOdd() ? 1 : 0);
+  MPInt c;
+  divexact(c, b - D_, MPInt(4));
+  return QuadraticForm(MPInt(1), b, c);
+}
+
+bool ClassGroup::primeForm(QuadraticForm& f, const uint32_t p) const
+{
+  // (D/2) depends on D mod 8.
+  MPInt r;
+  MPInt::mod(r, D_, MPInt(p == 2 ? 8 : (int64_t)p));
+  const int64_t dp = r.isZero() ? 0 : (int64_t)r[0];
+  if (kronecker(dp, (int64_t)p) == -1) {
+    return false;
+  }
+
+  MPInt b;
+  if (p == 2) {
+    // D = 0, 1, 4 mod 8.
+    b = MPInt(dp == 1 ? 1 : dp == 4 ? 2 : 0);
+  } else {
+    const bool found = impl::sqrtmod(b, r, MPInt((int64_t)p));
+    assert(found);
+    (void)found;
+    if (b.isOdd() != D_.isOdd()) {
+      b = MPInt((int64_t)p) - b;
+    }
+  }
+  QuadraticForm g(MPInt((int64_t)p), b, MPInt());
+  divexact(g.c, b*b - D_, MPInt(4*(int64_t)p));
+  MPInt::mod(r, b, g.a);
+  if (r.isZero()) {
+    MPInt::mod(r, g.c, g.a);
+    if (r.isZero()) {
+      return false;
+    }
+  }
+  reduce(g);
+  f = g;
+  return true;
+}
+
+bool ClassGroup::isForm(const QuadraticForm& f) const
+{
+  return f.a > 0 && f.discriminant() == D_;
+}
+
+void ClassGroup::reduce(QuadraticForm& f)
+{
+  normalize(f);
+  while (f.c < f.a || (f.a == f.c && f.b.isNeg())) {
+    f.a.swap(f.c);
+    f.b = -f.b;
+    normalize(f);
+  }
+}
+
+void ClassGroup::inverse(QuadraticForm& z, const QuadraticForm& x) const
+{
+  z.a = x.a;
+  z.b = -x.b;
+  z.c = x.c;
+  reduce(z);
+}
+
+/*
+  With v1, v2, r from unite(), the composite (A, B, C) = (v1 v2, b2 + 2 v2 r, *)
+  takes (x, y) to f(x, y) = (v2 R^2 + b2 R y + d1 c2 y^2)/v1 for R = v1 x + r y,
+  by 4 A f(x, y) = (2 A x + B y)^2 - D y^2.
+  For consecutive remainders R, Rp of the Euclid on (v1, r),
+  (x, xp; y, yp) is a basis of determinant det = x yp - xp y = +-1,
+  and b = (v2 R + n y)/v1, e = (s R + d1 c2 y)/v1 are exact by the
+  congruences on r, which give
+    f(x, y) = R b + y e,
+    f(xp, yp) = Rp bp + yp ep,
+    B' = det (R bp + y ep + Rp b + yp e),
+  where bp y - b yp = -v2 det and ep y - e yp = -s det
+  by R yp - Rp y = v1 det.
+  The partial Euclid stops at R <= L, where both terms of f(x, y) are
+  about |D|^(1/2) for reduced x and y, so the result is nearly reduced.
+*/
+void ClassGroup::compose(QuadraticForm& z, const QuadraticForm& x, const QuadraticForm& y) const
+{
+  const QuadraticForm& f1 = x.a < y.a ? y : x;
+  const QuadraticForm& f2 = x.a < y.a ? x : y;
+
+  MPInt s, n, d1, v1, v2, r;
+  unite(s, n, d1, v1, v2, r, f1, f2);
+
+  PartialEuclid euclid(v1, r);
+  euclid.run(L_);
+  const int det = euclid.det();
+  MPInt Rp, R, yp, yy;
+  euclid.get(Rp, R, yp, yy);
+
+  MPInt b, e, bp, ep;
+  divexact(b, v2*R + n*yy, v1);
+  divexact(e, s*R + d1*f2.c*yy, v1);
+  const MPInt sdet(det);
+  divexact(bp, b*yp - v2*sdet, yy);
+  divexact(ep, e*yp - s*sdet, yy);
+
+  QuadraticForm g;
+  g.a = R*b + yy*e;
+  g.b = R*bp + yy*ep + Rp*b + yp*e;
+  if (det < 0) {
+    g.b = -g.b;
+  }
+  g.c = Rp*bp + yp*ep;
+  reduce(g);
+  z.a.swap(g.a);
+  z.b.swap(g.b);
+  z.c.swap(g.c);
+}
+
+/*
+  compose with f1 = f2 = (a, b, c): s = b, n = 0, v1 = v2 = a/d1
+  for d1 = gcd(a, b), so that b = R, bp = Rp, and r = -u c mod v1
+  for u b = d1 mod a.
+*/
+void ClassGroup::square(QuadraticForm& z, const QuadraticForm& x) const
+{
+  MPInt u, v1, r;
+  const MPInt d1 = gcdCofactor(u, x.a, x.b);
+  if (d1 == 1) {
+    v1 = x.a;
+  } else {
+    divexact(v1, x.a, d1);
+  }
+  MPInt::mod(r, -(u*x.c), v1);
+
+  PartialEuclid euclid(v1, r);
+  euclid.run(L_);
+  const int det = euclid.det();
+  MPInt Rp, R, yp, yy;
+  euclid.get(Rp, R, yp, yy);
+
+  MPInt e, ep;
+  divexact(e, x.b*R + d1*x.c*yy, v1);
+  divexact(ep, e*yp - x.b*MPInt(det), yy);
+
+  QuadraticForm g;
+  g.a = R*R + yy*e;
+  const MPInt RRp = R*Rp;
+  g.b = RRp + RRp + yy*ep + yp*e;
+  if (det < 0) {
+    g.b = -g.b;
+  }
+  g.c = Rp*Rp + yp*ep;
+  reduce(g);
+  z.a.swap(g.a);
+  z.b.swap(g.b);
+  z.c.swap(g.c);
+}
+
+void ClassGroup::pow(QuadraticForm& z, const QuadraticForm& x, const MPInt& e) const
+{
+  QuadraticForm base;
+  if (e.isNeg()) {
+    inverse(base, x);
+  } else {
+    base = x;
+  }
+  if (e.isZero()) {
+    z = identity();
+    return;
+  }
+
+  const size_t n = e.size();
+  const value_type top = e[n - 1];
+  int i = 63 - __builtin_clzll(top);
+  QuadraticForm g(base);
+  for (size_t j = n; j-- > 0;) {
+    const value_type w = e[j];
+    for (--i; i >= 0; --i) {
+      square(g, g);
+      if ((w >> i) & 1) {
+        compose(g, g, base);
+      }
+    }
+    i = 64;
+  }
+  z = g;
+}
+
+void ClassGroup::composeClassic(QuadraticForm& z, const QuadraticForm& x, const QuadraticForm& y) const
+{
+  MPInt s, n, d1, v1, v2, r;
+  unite(s, n, d1, v1, v2, r, x, y);
+
+  QuadraticForm g;
+  g.a = v1*v2;
+  g.b = y.b + MPInt(2)*v2*r;
+  divexact(g.c, g.b*g.b - D_, MPInt(4)*g.a);
+  reduce(g);
+  z = g;
+}
+
+} // namespace integer
@@ -0,0 +1,194 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "qr-batch.hpp"
+#include "barrett.hpp"
+
+namespace integer {
+
+using mpint::MPInt;
+using mpint::BarrettContext;
+typedef MPInt::value_type value_type;
+
+namespace {
+
+/*
+  fn(begin, end) for the ranges of [0, count) split among threads,
+  the boundaries are multiples of align.
+*/
+template <class F>
+void parallel(const size_t count, const size_t threads, const size_t align, F fn)
+{
+  if (threads < 1) {
+    throw std::invalid_argument("QRBatch: threads must be at least 1");
+  }
+  const size_t chunk = ((count + align - 1) / align + threads - 1) / threads * align;
+  if (threads == 1 || count <= chunk) {
+    fn((size_t)0, count);
+    return;
+  }
+
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < count; i += chunk) {
+    workers.push_back(std::thread(fn, i, std::min(count, i + chunk)));
+  }
+  for (size_t t = 0; t < workers.size(); ++t) {
+    workers[t].join();
+  }
+}
+
+} // namespace
+
+const size_t QRBatch::blockSize;
+
+struct QRBatch::Factor {
+  explicit Factor(const MPInt& p)
+    : barrett(p), batch(p)
+  {
+  }
+
+  /*
+    s[i] = (c_i/p) of n digits c_i.
+  */
+  void symbols(int8_t* s, const value_type* c, const size_t n, const size_t count) const;
+
+  BarrettContext barrett;
+  JacobiBatch batch;
+};
+
+void QRBatch::Factor::symbols(int8_t* s, const value_type* c, const size_t n, const size_t count) const
+{
+  const size_t k = barrett.size();
+  std::vector<value_type> work(barrett.workSize());
+  std::vector<value_type> t(2*k);
+  std::vector<value_type> r(blockSize*k);
+
+  for (size_t j = 0; j < count; j += blockSize) {
+    const size_t m = std::min(blockSize, count - j);
+    for (size_t i = 0; i < m; ++i) {
+      const value_type* x = c + (j + i)*n;
+      value_type* ri = &r[i*k];
+      if (n <= 2*k) {
+        barrett.reduce(ri, x, n, &work[0]);
+        continue;
+      }
+      // 2k digits from the top, then k digits at once under the remainder.
+      size_t pos = n - 2*k;
+      barrett.reduce(ri, x + pos, 2*k, &work[0]);
+      while (pos > 0) {
+        const size_t step = std::min(k, pos);
+        pos -= step;
+        std::copy(x + pos, x + pos + step, t.begin());
+        std::copy(ri, ri + k, t.begin() + step);
+        barrett.reduce(ri, &t[0], step + k, &work[0]);
+      }
+    }
+    batch.symbols(s + j, &r[0], m);
+  }
+}
+
+QRBatch::QRBatch(const MPInt& N)
+  : batch_(N)
+{
+}
+
+QRBatch::QRBatch(const MPInt& p, const MPInt& q)
+  : batch_(p*q)
+{
+  if (! p.isOdd() || ! (p > 1) || ! q.isOdd() || ! (q > 1)) {
+    throw std::invalid_argument("QRBatch: p and q must be odd and greater than 1");
+  }
+  if (p == q) {
+    throw std::invalid_argument("QRBatch: p and q must be distinct");
+  }
+  // p_ is the larger one, so that a ciphertext has at most 2 p_.size() digits.
+  const bool swap = p < q;
+  p_.reset(new Factor(swap ? q : p));
+  q_.reset(new Factor(swap ? p : q));
+}
+
+QRBatch::~QRBatch()
+{
+}
+
+void QRBatch::jacobi(int8_t* s, const value_type* c, const size_t count, const size_t threads) const
+{
+  parallel(count, threads, 1, [this, s, c](const size_t begin, const size_t end) {
+      jacobi_(s + begin, c + begin*size(), end - begin);
+    });
+}
+
+void QRBatch::decrypt(uint8_t* out, const value_type* c, const size_t count, const size_t threads) const
+{
+  if (! hasFactors()) {
+    throw std::invalid_argument("QRBatch: decrypt requires the factors");
+  }
+  parallel(count, threads, 8, [this, out, c](const size_t begin, const size_t end) {
+      decrypt_(out + begin / 8, c + begin*size(), end - begin);
+    });
+}
+
+void QRBatch::jacobi_(int8_t* s, const value_type* c, const size_t count) const
+{
+  if (! hasFactors()) {
+    batch_.symbols(s, c, count);
+    return;
+  }
+
+  // (c/N) = (c/p)(c/q).
+  int8_t sq[blockSize];
+  for (size_t j = 0; j < count; j += blockSize) {
+    const size_t m = std::min(blockSize, count - j);
+    p_->symbols(s + j, c + j*size(), size(), m);
+    q_->symbols(sq, c + j*size(), size(), m);
+    for (size_t i = 0; i < m; ++i) {
+      s[j + i] = (int8_t)(s[j + i] * sq[i]);
+    }
+  }
+}
+
+void QRBatch::decrypt_(uint8_t* out, const value_type* c, const size_t count) const
+{
+  int8_t s[blockSize];
+  std::fill(out, out + (count + 7) / 8, 0);
+  for (size_t j = 0; j < count; j += blockSize) {
+    const size_t m = std::min(blockSize, count - j);
+    p_->symbols(s, c + j*size(), size(), m);
+    for (size_t i = 0; i < m; ++i) {
+      const size_t b = j + i;
+      out[b / 8] |= (uint8_t)((s[i] < 0) << (b % 8));
+    }
+  }
+}
+
+} // namespace integer
@@ -0,0 +1,151 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#include <stdexcept>
+
+#include "qrcache.hpp"
+
+namespace integer {
+
+namespace {
+
+bool isSmallOddPrime(const uint32_t p)
+{
+  if (p < 3 || p >= (1u << 16) || ! (p & 0x1)) {
+    return false;
+  }
+  for (uint32_t d = 3; d*d <= p; d += 2) {
+    if (p % d == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+QRBitmap::QRBitmap(const uint32_t p)
+  : p_(p), bits_((p + 63) / 64, 0)
+{
+  if (! isSmallOddPrime(p)) {
+    throw std::invalid_argument("QRBitmap: p must be an odd prime less than 2^16");
+  }
+  // (p - i)^2 = i^2, and (i + 1)^2 = i^2 + 2i + 1.
+  uint32_t r = 0;
+  for (uint32_t i = 1; i <= p / 2; ++i) {
+    r += 2*i - 1;
+    if (r >= p) {
+      r -= p;
+    }
+    bits_[r >> 6] |= uint64_t(1) << (r & 63);
+  }
+}
+
+int QRBitmap::kronecker(const int64_t x) const
+{
+  int64_t r = x % (int64_t)p_;
+  if (r < 0) {
+    r += p_;
+  }
+  return legendre((uint32_t)r);
+}
+
+int QRBitmap::kronecker(const mpint::MPInt& x) const
+{
+  uint32_t r = (uint32_t)mpint::MPInt::divrem_1(0, x.get(), x.size(), p_);
+  if (x.isNeg() && r != 0) {
+    r = p_ - r;
+  }
+  return legendre(r);
+}
+
+QRCache::QRCache(const size_t maxBytes)
+  : maxBytes_(maxBytes), mutex_(), bytes_(0), lru_(), index_()
+{
+}
+
+QRCache::bitmap_ptr QRCache::get(const uint32_t p)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(p);
+    if (it != index_.end()) {
+      lru_.splice(lru_.begin(), lru_, it->second);
+      return *it->second;
+    }
+  }
+
+  // build without the lock, another thread may insert the same one.
+  bitmap_ptr b(new QRBitmap(p));
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(p);
+  if (it != index_.end()) {
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return *it->second;
+  }
+  lru_.push_front(b);
+  index_[p] = lru_.begin();
+  bytes_ += b->bytes();
+  // the new one is kept even if it is larger than maxBytes_.
+  while (bytes_ > maxBytes_ && lru_.size() > 1) {
+    const bitmap_ptr& last = lru_.back();
+    bytes_ -= last->bytes();
+    index_.erase(last->prime());
+    lru_.pop_back();
+  }
+  return b;
+}
+
+size_t QRCache::size() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return lru_.size();
+}
+
+size_t QRCache::bytes() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_;
+}
+
+void QRCache::clear()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  index_.clear();
+  lru_.clear();
+  bytes_ = 0;
+}
+
+QRCache& QRCache::shared()
+{
+  static QRCache cache;
+  return cache;
+}
+
+} // namespace integer
@@ -0,0 +1,202 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "rho.hpp"
+#include "montgomery.hpp"
+#include "gcd.hpp"
+
+namespace integer {
+
+namespace impl {
+
+size_t rhoBatchSize = 100;
+
+namespace {
+
+using mpint::MPInt;
+using mpint::MontgomeryContext;
+typedef MPInt::value_type value_type;
+
+/*
+  gcd(x, n) of x in Montgomery form, which is gcd(x R, n) as gcd(R, n) = 1.
+*/
+MPInt gcdMont(const value_type* x, const size_t len, const MPInt& n)
+{
+  MPInt t;
+  t.set(x, len);
+  return gcd(t, n);
+}
+
+void checkModulus(const MPInt& n)
+{
+  if (! n.isOdd() || ! (n > 1)) {
+    throw std::invalid_argument("pollardRho: n must be odd and greater than 1");
+  }
+}
+
+} // namespace
+
+/*
+  Brent, "An improved Monte Carlo factorization algorithm", 1980:
+  y runs r steps ahead of x, for r = 1, 2, 4, ...,
+  and prod (x - y) is taken by batches of rhoBatchSize steps.
+*/
+bool pollardBrent(MPInt& d, const MPInt& n, const uint64_t c, const uint64_t x0,
+                  const uint64_t maxSteps, const std::atomic<bool>* cancel)
+{
+  checkModulus(n);
+
+  const MontgomeryContext ctx(n);
+  const size_t len = ctx.size();
+  std::vector<value_type> buf(len*5);
+  value_type* x = &buf[0];
+  value_type* y = x + len;
+  value_type* ys = y + len;
+  value_type* q = ys + len;
+  value_type* cm = q + len;
+  MPInt t;
+  t.set(&c, 1);
+  ctx.toMont(cm, t);
+  t.set(&x0, 1);
+  ctx.toMont(y, t);
+  std::copy(ctx.one(), ctx.one() + len, q);
+  std::vector<value_type> diff(len);
+  value_type* z = &diff[0];
+
+  // y = y^2 + c.
+  auto f = [&ctx, cm](value_type* v) {
+    ctx.sqr(v, v);
+    ctx.add(v, v, cm);
+  };
+
+  const uint64_t m = std::max<size_t>(rhoBatchSize, 1);
+  uint64_t steps = 0;
+  MPInt g(1);
+  for (uint64_t r = 1; ; r *= 2) {
+    std::copy(y, y + len, x);
+    // the advance is also taken by batches to see cancel.
+    for (uint64_t i = 0; i < r; ) {
+      if (cancel && cancel->load(std::memory_order_relaxed)) {
+        return false;
+      }
+      const uint64_t batch = std::min(m, r - i);
+      for (uint64_t j = 0; j < batch; ++j) {
+        f(y);
+      }
+      i += batch;
+    }
+    steps += r;
+    for (uint64_t k = 0; k < r && g == 1; ) {
+      if (cancel && cancel->load(std::memory_order_relaxed)) {
+        return false;
+      }
+      std::copy(y, y + len, ys);
+      const uint64_t batch = std::min(m, r - k);
+      for (uint64_t i = 0; i < batch; ++i) {
+        f(y);
+        ctx.sub(z, x, y);
+        ctx.mul(q, q, z);
+      }
+      g = gcdMont(q, len, n);
+      k += batch;
+      steps += batch;
+    }
+    if (g != 1) {
+      break;
+    }
+    if (steps >= maxSteps) {
+      return false;
+    }
+  }
+
+  if (g == n) {
+    // one of the differences since ys has a factor.
+    do {
+      f(ys);
+      ctx.sub(z, x, ys);
+      g = gcdMont(z, len, n);
+    } while (g == 1);
+  }
+  if (g == n) {
+    return false;
+  }
+  d = g;
+  return true;
+}
+
+bool pollardRho(MPInt& d, const MPInt& n, const size_t threads,
+                const uint64_t maxSteps, const uint64_t maxSequences)
+{
+  checkModulus(n);
+  if (threads < 1) {
+    throw std::invalid_argument("pollardRho: threads must be positive");
+  }
+
+  if (threads == 1) {
+    for (uint64_t c = 1; c < maxSequences; ++c) {
+      if (pollardBrent(d, n, c, 2, maxSteps)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::atomic<bool> found(false);
+  std::atomic<uint64_t> next(1);
+  std::mutex mutex;
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < threads; ++i) {
+    workers.push_back(std::thread([&]() {
+          MPInt f;
+          for (uint64_t c = next++; c < maxSequences && ! found; c = next++) {
+            if (pollardBrent(f, n, c, 2, maxSteps, &found)) {
+              std::lock_guard<std::mutex> lock(mutex);
+              if (! found) {
+                d = f;
+                found = true;
+              }
+              return;
+            }
+          }
+        }));
+  }
+  for (size_t i = 0; i < workers.size(); ++i) {
+    workers[i].join();
+  }
+  return found;
+}
+
+} // namespace impl
+
+} // namespace integer
@@ -0,0 +1,968 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+#include "siqs.hpp"
+#include "gcd.hpp"
+#include "isqrt.hpp"
+#include "kronecker-jacobi.hpp"
+#include "prime.hpp"
+#include "integer-util.hpp"
+
+namespace integer {
+
+namespace {
+
+using mpint::MPInt;
+using impl::invmod32;
+using impl::oddPrimes;
+using impl::sqrtmod32;
+typedef MPInt::value_type value_type;
+
+/*
+  Odd primes below smallSieveBound are not sieved,
+  the threshold is lowered by their expected contribution instead.
+*/
+const uint32_t smallSieveBound = 32;
+
+/*
+  Slack of the sieve threshold in units of log2(pmax).
+*/
+const double thresholdFactor = 2.0;
+
+/*
+  Relations beyond the number of columns, each one more gives
+  a dependency with probability about 1/2.
+*/
+const size_t extraRelations = 64;
+
+/*
+  Root sentinel of the primes of A, which are not sieved.
+*/
+const uint32_t noRoot = 0xffffffff;
+
+/*
+  @return: |x| mod p.
+*/
+inline uint32_t modSmall(const MPInt& x, const uint32_t p)
+{
+  return x.isZero() ? 0 : (uint32_t)MPInt::divrem_1(0, x.get(), x.size(), p);
+}
+
+/*
+  @return: x mod p in [0, p).
+*/
+inline uint32_t modSigned(const MPInt& x, const uint32_t p)
+{
+  const uint32_t r = modSmall(x, p);
+  return x.isNeg() && r != 0 ? p - r : r;
+}
+
+/*
+  @require: x > 0.
+*/
+double log2(const MPInt& x)
+{
+  const size_t n = x.size();
+  double t = (double)x[n - 1];
+  if (n > 1) {
+    t += (double)x[n - 2] / 18446744073709551616.0;
+  }
+  return std::log2(t) + 64.0*(double)(n - 1);
+}
+
+/*
+  Knuth-Schroeppel: the squarefree k which maximizes the expected
+  contribution of the small primes to log(kn x^2 - ...), less log(k)/2.
+*/
+uint32_t chooseMultiplier(const MPInt& n, const std::vector<uint32_t>& primes)
+{
+  static const uint32_t multipliers[] = {
+    1, 3, 5, 7, 11, 13, 15, 17, 19, 21, 23, 29, 31, 33, 35,
+    37, 39, 41, 43, 47, 51, 53, 55, 57, 59, 61, 67, 69, 71, 73
+  };
+  const size_t count = std::min<size_t>(primes.size(), 300);
+  std::vector<uint32_t> r(count);
+  for (size_t i = 0; i < count; ++i) {
+    r[i] = modSmall(n, primes[i]);
+  }
+  const double ln2 = std::log(2.0);
+  uint32_t best = 1;
+  double bestScore = -1e300;
+  for (size_t m = 0; m < sizeof(multipliers) / sizeof(multipliers[0]); ++m) {
+    const uint32_t k = multipliers[m];
+    double f = -0.5*std::log((double)k);
+    switch ((k*n[0]) & 7) {
+    case 1: f += 2*ln2; break;
+    case 5: f += ln2; break;
+    default: f += 0.5*ln2; break;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      const uint32_t p = primes[i];
+      const uint32_t kn = (uint32_t)((uint64_t)(k % p) * r[i] % p);
+      if (kn == 0) {
+        f += std::log((double)p) / p;
+      } else if (kronecker((int64_t)kn, (int64_t)p) == 1) {
+        f += 2*std::log((double)p) / (p - 1);
+      }
+    }
+    if (f > bestScore) {
+      bestScore = f;
+      best = k;
+    }
+  }
+  return best;
+}
+
+size_t decimalDigits(const MPInt& n)
+{
+  return n.isZero() ? 0 : (size_t)std::ceil(log2(n.abs()) * 0.30102999566398120);
+}
+
+} // namespace
+
+/*
+  Parameters per number of digits,
+  in the spirit of the tables of msieve and YAFU.
+*/
+QuadraticSieve::Params QuadraticSieve::defaultParams(const size_t digits, const size_t threads)
+{
+  static const size_t table[][3] = {
+    // digits, factor base, blocks
+    {20, 120, 1},
+    {25, 150, 1},
+    {30, 200, 1},
+    {35, 300, 1},
+    {40, 500, 1},
+    {45, 800, 1},
+    {50, 1200, 1},
+    {55, 1800, 2},
+    {60, 2700, 2},
+    {65, 3800, 3},
+    {70, 5000, 3},
+    {75, 6500, 4},
+    {80, 8500, 4},
+    {85, 11000, 5},
+    {90, 14000, 6},
+    {95, 18000, 7},
+    {100, 23000, 8},
+  };
+  const size_t rows = sizeof(table) / sizeof(table[0]);
+  size_t i = 0;
+  while (i + 1 < rows && table[i][0] < digits) {
+    ++i;
+  }
+  Params params;
+  params.factorBase = table[i][1];
+  params.blockSize = 1 << 15;
+  params.blocks = table[i][2];
+  params.largePrimeMultiplier = 40;
+  params.threads = threads;
+  params.seed = 1;
+  return params;
+}
+
+/*
+  State shared by the sieving threads:
+  the choice of A, the relations and the partial relations.
+*/
+class QuadraticSieve::Collector {
+public:
+  Collector(QuadraticSieve& qs, const size_t needed)
+    : qs_(qs), needed_(needed), mutex_(), rng_(qs.params_.seed), used_(), partials_(), done_(false)
+  {}
+
+  bool done() const { return done_; }
+
+  /*
+    Indexes of the primes of a new A, in increasing order.
+    @return: false if enough relations are found, or no new A is found.
+  */
+  bool nextA(std::vector<uint32_t>& q);
+
+  /*
+    Move the relations of a thread into the object.
+  */
+  void add(std::vector<Relation>& full, std::vector<Relation>& partial, const size_t polynomials);
+
+private:
+  Collector(const Collector&);
+  void operator=(const Collector&);
+
+  QuadraticSieve& qs_;
+  size_t needed_;
+  std::mutex mutex_;
+  std::mt19937_64 rng_;
+  std::set<std::vector<uint32_t> > used_;
+  std::map<uint64_t, Relation> partials_;
+  std::atomic<bool> done_;
+};
+
+bool QuadraticSieve::Collector::nextA(std::vector<uint32_t>& q)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (done_) {
+    return false;
+  }
+  const std::vector<uint32_t>& P = qs_.primes_;
+  const size_t width = qs_.aHigh_ - qs_.aLow_;
+  const size_t random = qs_.s_ == 1 ? 1 : qs_.s_ - 1;
+  for (size_t attempt = 0; attempt < 1000; ++attempt) {
+    q.clear();
+    double rest = qs_.logA_;
+    for (size_t tries = 0; q.size() < random && tries < 100; ++tries) {
+      const uint32_t i = (uint32_t)(qs_.aLow_ + rng_() % width);
+      if (qs_.roots_[i] == 0 || std::find(q.begin(), q.end(), i) != q.end()) {
+        continue;
+      }
+      q.push_back(i);
+      rest -= std::log2((double)P[i]);
+    }
+    if (q.size() < random) {
+      continue;
+    }
+    if (qs_.s_ > 1) {
+      // the last prime makes log2(A) closest to logA_.
+      const double target = std::exp2(std::max(rest, 1.0));
+      const size_t j = std::lower_bound(P.begin(), P.end(), (uint32_t)std::min(target, 4e9)) - P.begin();
+      size_t best = 0;
+      double error = 1e300;
+      for (size_t i = j > 8 ? j - 8 : 1; i < std::min(j + 8, P.size()); ++i) {
+        const double e = std::fabs(std::log2((double)P[i]) - rest);
+        if (i == 0 || qs_.roots_[i] == 0 || std::find(q.begin(), q.end(), i) != q.end() || e >= error) {
+          continue;
+        }
+        best = i;
+        error = e;
+      }
+      if (best == 0) {
+        continue;
+      }
+      q.push_back((uint32_t)best);
+    }
+    std::sort(q.begin(), q.end());
+    if (used_.insert(q).second) {
+      return true;
+    }
+  }
+  done_ = true;
+  return false;
+}
+
+void QuadraticSieve::Collector::add(std::vector<Relation>& full, std::vector<Relation>& partial,
+                                    const size_t polynomials)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats& stats = qs_.stats_;
+  std::vector<Relation>& relations = qs_.relations_;
+  stats.polynomials += polynomials;
+  stats.full += full.size();
+  stats.partial += partial.size();
+  for (size_t i = 0; i < full.size(); ++i) {
+    relations.push_back(std::move(full[i]));
+  }
+  for (size_t i = 0; i < partial.size(); ++i) {
+    Relation& r = partial[i];
+    const uint64_t large = r.large[0];
+    std::map<uint64_t, Relation>::iterator it = partials_.find(large);
+    if (it == partials_.end()) {
+      partials_.insert(std::make_pair(large, std::move(r)));
+      continue;
+    }
+    const Relation& s = it->second;
+    if (s.y == r.y) {
+      continue;
+    }
+    Relation c;
+    MPInt::mul(c.y, s.y, r.y);
+    MPInt::mod(c.y, c.y, qs_.n_);
+    c.factors = s.factors;
+    c.factors.insert(c.factors.end(), r.factors.begin(), r.factors.end());
+    c.large.push_back(large);
+    relations.push_back(std::move(c));
+    ++stats.combined;
+  }
+  full.clear();
+  partial.clear();
+  if (relations.size() >= needed_) {
+    done_ = true;
+  }
+}
+
+/*
+  Sieve of one thread, with the roots of the current polynomial
+  and the sieve block.
+*/
+class QuadraticSieve::Sieve {
+public:
+  Sieve(const QuadraticSieve& qs, Collector& collector);
+
+  void run();
+
+private:
+  Sieve(const Sieve&);
+  void operator=(const Sieve&);
+
+  void initA_(const std::vector<uint32_t>& q);
+  void nextB_(const size_t g);
+  void setC_();
+  void sieve_();
+  void check_(const uint32_t j);
+  void divide_(size_t& n, const uint32_t p, const uint32_t column, Relation& r);
+
+  const QuadraticSieve& qs_;
+  Collector& collector_;
+  uint32_t M_;
+  std::vector<uint32_t> q_;
+  MPInt A_;
+  MPInt B_;
+  MPInt C_;
+  std::vector<MPInt> Bl_;
+  // roots of the current polynomial as indexes x + M mod p.
+  std::vector<uint32_t> root1_;
+  std::vector<uint32_t> root2_;
+  // 2 B_l / A mod p for each l.
+  std::vector<uint32_t> bainv_;
+  /*
+    Primes less than blockSize with the next index of each root,
+    sieved block by block.
+  */
+  struct Prime {
+    uint32_t p;
+    uint32_t next1;
+    uint32_t next2;
+    uint32_t logp;
+  };
+  std::vector<Prime> medium_;
+  // primes_[large_..] hit a block at most once per root, and go to the buckets.
+  size_t large_;
+  size_t shift_;
+  // (offset << 8) | logp of the hits of the large primes in each block.
+  std::vector<std::vector<uint32_t> > buckets_;
+  std::vector<uint64_t> block_;
+  std::vector<value_type> d_;
+  std::vector<value_type> t_;
+  std::vector<Relation> full_;
+  std::vector<Relation> partial_;
+  size_t polynomials_;
+};
+
+QuadraticSieve::Sieve::Sieve(const QuadraticSieve& qs, Collector& collector)
+  : qs_(qs), collector_(collector), M_((uint32_t)(qs.params_.blocks*qs.params_.blockSize)),
+    q_(), A_(), B_(), C_(), Bl_(), root1_(qs.primes_.size()), root2_(qs.primes_.size()), bainv_(),
+    medium_(),
+    large_(std::lower_bound(qs.primes_.begin(), qs.primes_.end(), qs.params_.blockSize) - qs.primes_.begin()),
+    shift_((size_t)__builtin_ctzll(qs.params_.blockSize)), buckets_(2*qs.params_.blocks),
+    block_(qs.params_.blockSize / 8), d_(), t_(), full_(), partial_(), polynomials_(0)
+{
+  large_ = std::max(large_, qs.firstSieved_);
+}
+
+void QuadraticSieve::Sieve::run()
+{
+  std::vector<uint32_t> q;
+  while (collector_.nextA(q)) {
+    initA_(q);
+    const size_t polynomials = (size_t)1 << (q.size() - 1);
+    for (size_t g = 0; g < polynomials && ! collector_.done(); ++g) {
+      if (g > 0) {
+        nextB_(g);
+      }
+      sieve_();
+    }
+    collector_.add(full_, partial_, polynomials_);
+    polynomials_ = 0;
+  }
+}
+
+/*
+  B_l = (A/q_l) gamma_l with gamma_l = t_(q_l) (A/q_l)^(-1) mod q_l,
+  so B = sum B_l satisfies B^2 = kn mod A.
+*/
+void QuadraticSieve::Sieve::initA_(const std::vector<uint32_t>& q)
+{
+  const std::vector<uint32_t>& P = qs_.primes_;
+  const size_t F = P.size();
+  const size_t s = q.size();
+  q_ = q;
+  A_ = MPInt((int64_t)P[q[0]]);
+  for (size_t l = 1; l < s; ++l) {
+    A_ *= MPInt((int64_t)P[q[l]]);
+  }
+  B_ = MPInt(0);
+  Bl_.resize(s);
+  MPInt r;
+  for (size_t l = 0; l < s; ++l) {
+    const uint32_t p = P[q[l]];
+    MPInt Aq;
+    MPInt::divmod(Aq, r, A_, MPInt((int64_t)p));
+    uint32_t gamma = (uint32_t)((uint64_t)qs_.roots_[q[l]] * invmod32(modSmall(Aq, p), p) % p);
+    if (gamma > p / 2) {
+      gamma = p - gamma;
+    }
+    Bl_[l] = Aq * MPInt((int64_t)gamma);
+    B_ += Bl_[l];
+  }
+  setC_();
+
+  bainv_.resize(s*F);
+  for (size_t i = 1; i < F; ++i) {
+    if (std::binary_search(q.begin(), q.end(), (uint32_t)i)) {
+      root1_[i] = root2_[i] = noRoot;
+      continue;
+    }
+    const uint32_t p = P[i];
+    const uint64_t ainv = invmod32(modSmall(A_, p), p);
+    const uint32_t b = modSigned(B_, p);
+    const uint32_t t = qs_.roots_[i];
+    const uint64_t r1 = ainv * ((t + p - b) % p) % p;
+    const uint64_t r2 = ainv * ((2*p - t - b) % p) % p;
+    root1_[i] = (uint32_t)((r1 + M_) % p);
+    root2_[i] = (uint32_t)((r2 + M_) % p);
+    for (size_t l = 0; l < s; ++l) {
+      bainv_[l*F + i] = (uint32_t)(2 * (uint64_t)modSmall(Bl_[l], p) % p * ainv % p);
+    }
+  }
+}
+
+/*
+  Gray code: B_(g+1) = B_g + 2 (-1)^ceil(g/2^(l+1)) B_l, where 2^l || g,
+  and the roots move by -+ 2 B_l/A.
+*/
+void QuadraticSieve::Sieve::nextB_(const size_t g)
+{
+  const std::vector<uint32_t>& P = qs_.primes_;
+  const size_t F = P.size();
+  const size_t l = (size_t)__builtin_ctzll(g);
+  const bool plus = ((((g >> l) + 1) / 2) & 1) == 0;
+  MPInt twoBl;
+  MPInt::shl(twoBl, Bl_[l], 1);
+  if (plus) {
+    B_ += twoBl;
+  } else {
+    B_ -= twoBl;
+  }
+  setC_();
+
+  const uint32_t* d = &bainv_[l*F];
+  for (size_t i = 1; i < F; ++i) {
+    if (root1_[i] == noRoot) {
+      continue;
+    }
+    const uint32_t p = P[i];
+    if (plus) {
+      root1_[i] = root1_[i] >= d[i] ? root1_[i] - d[i] : root1_[i] + p - d[i];
+      root2_[i] = root2_[i] >= d[i] ? root2_[i] - d[i] : root2_[i] + p - d[i];
+    } else {
+      root1_[i] += d[i];
+      root1_[i] -= root1_[i] >= p ? p : 0;
+      root2_[i] += d[i];
+      root2_[i] -= root2_[i] >= p ? p : 0;
+    }
+  }
+}
+
+/*
+  C = (B^2 - kn)/A.
+*/
+void QuadraticSieve::Sieve::setC_()
+{
+  MPInt t = B_*B_ - qs_.kn_;
+  MPInt r;
+  MPInt::divmod(C_, r, t, A_);
+  assert(r.isZero());
+}
+
+void QuadraticSieve::Sieve::sieve_()
+{
+  const std::vector<uint32_t>& P = qs_.primes_;
+  const std::vector<uint8_t>& logp = qs_.logp_;
+  const size_t F = P.size();
+  const uint32_t size = (uint32_t)qs_.params_.blockSize;
+  const uint32_t length = 2*M_;
+  const uint8_t init = (uint8_t)(128 - qs_.threshold_);
+  uint8_t* s = (uint8_t*)&block_[0];
+  ++polynomials_;
+
+  medium_.clear();
+  for (size_t i = qs_.firstSieved_; i < large_; ++i) {
+    if (root1_[i] != noRoot) {
+      // a prime dividing k has one root.
+      const Prime e = { P[i], root1_[i], root2_[i] == root1_[i] ? noRoot : root2_[i], logp[i] };
+      medium_.push_back(e);
+    }
+  }
+  for (size_t b = 0; b < buckets_.size(); ++b) {
+    buckets_[b].clear();
+  }
+  const uint32_t mask = size - 1;
+  for (size_t i = large_; i < F; ++i) {
+    if (root1_[i] == noRoot) {
+      continue;
+    }
+    const uint32_t p = P[i];
+    const uint32_t lg = logp[i];
+    for (uint32_t k = root1_[i]; k < length; k += p) {
+      buckets_[k >> shift_].push_back(((k & mask) << 8) | lg);
+    }
+    if (root2_[i] == root1_[i]) {
+      continue;
+    }
+    for (uint32_t k = root2_[i]; k < length; k += p) {
+      buckets_[k >> shift_].push_back(((k & mask) << 8) | lg);
+    }
+  }
+
+  for (uint32_t b = 0; b < buckets_.size(); ++b) {
+    const uint32_t start = b*size;
+    const uint32_t end = start + size;
+    std::memset(s, init, size);
+    for (size_t i = 0; i < medium_.size(); ++i) {
+      Prime& e = medium_[i];
+      const uint8_t lg = (uint8_t)e.logp;
+      uint32_t k = e.next1;
+      for (; k < end; k += e.p) {
+        s[k - start] += lg;
+      }
+      e.next1 = k;
+      k = e.next2;
+      for (; k < end; k += e.p) {
+        s[k - start] += lg;
+      }
+      e.next2 = k;
+    }
+    const std::vector<uint32_t>& bucket = buckets_[b];
+    for (size_t i = 0; i < bucket.size(); ++i) {
+      s[bucket[i] >> 8] += (uint8_t)bucket[i];
+    }
+    // bytes >= 128, i.e. the sum of logs is at least the threshold.
+    for (size_t w = 0; w < size / 8; ++w) {
+      uint64_t v = block_[w] & 0x8080808080808080ULL;
+      while (v) {
+        const uint32_t j = start + (uint32_t)(w*8 + (size_t)__builtin_ctzll(v) / 8);
+        v &= v - 1;
+        check_(j);
+      }
+    }
+  }
+}
+
+void QuadraticSieve::Sieve::divide_(size_t& n, const uint32_t p, const uint32_t column, Relation& r)
+{
+  while (n > 0 && MPInt::divrem_1(&t_[0], &d_[0], n, p) == 0) {
+    std::swap(d_, t_);
+    while (n > 0 && d_[n - 1] == 0) {
+      --n;
+    }
+    r.factors.push_back(column);
+  }
+}
+
+/*
+  Trial division of (Ax + B)^2 - kn = A (Ax^2 + 2Bx + C) for x = j - M,
+  where only the primes with a root at j are tried.
+*/
+void QuadraticSieve::Sieve::check_(const uint32_t j)
+{
+  const std::vector<uint32_t>& P = qs_.primes_;
+  const size_t F = P.size();
+  const MPInt x((int64_t)j - (int64_t)M_);
+  MPInt y = A_*x;
+  MPInt twoB;
+  MPInt::shl(twoB, B_, 1);
+  MPInt v = (y + twoB)*x + C_;
+  y += B_;
+  if (v.isZero()) {
+    return;
+  }
+  assert(y*y - qs_.kn_ == A_*v);
+
+  Relation r;
+  if (v.isNeg()) {
+    r.factors.push_back(0);
+  }
+  const size_t tz = v.NTZ();
+  for (size_t i = 0; i < tz; ++i) {
+    r.factors.push_back(1);
+  }
+  MPInt w;
+  MPInt::shr(w, v.abs(), tz);
+  size_t n = w.size();
+  d_.assign(w.get(), w.get() + n);
+  t_.resize(n);
+  for (size_t i = 1; i < F && n > 0; ++i) {
+    const uint32_t p = P[i];
+    if (root1_[i] != noRoot) {
+      const uint32_t jm = j % p;
+      if (jm != root1_[i] && jm != root2_[i]) {
+        continue;
+      }
+    }
+    divide_(n, p, (uint32_t)(i + 1), r);
+  }
+  for (size_t l = 0; l < q_.size(); ++l) {
+    r.factors.push_back(q_[l] + 1);
+  }
+  MPInt::mod(r.y, y, qs_.n_);
+  if (n == 1 && d_[0] == 1) {
+    full_.push_back(std::move(r));
+  } else if (n == 1 && d_[0] < qs_.largeBound_) {
+    r.large.push_back(d_[0]);
+    partial_.push_back(std::move(r));
+  }
+}
+
+QuadraticSieve::QuadraticSieve(const MPInt& n, const size_t threads)
+  : QuadraticSieve(n, defaultParams(decimalDigits(n), threads))
+{}
+
+QuadraticSieve::QuadraticSieve(const MPInt& n, const Params& params)
+  : n_(n), kn_(), k_(1), params_(params), primes_(), roots_(), logp_(), firstSieved_(0),
+    smallFactor_(0), largeBound_(0), threshold_(0), aLow_(0), aHigh_(0), s_(1), logA_(0),
+    relations_(), stats_()
+{
+  if (! n.isPos() || ! n.isOdd() || n.size() < 2) {
+    throw std::invalid_argument("QuadraticSieve: n must be odd and n >= 2^64");
+  }
+  if (params.factorBase < 16 || params.blockSize < 64 || params.blockSize > (1 << 24)
+      || (params.blockSize & (params.blockSize - 1)) != 0 || params.blocks < 1 || params.largePrimeMultiplier < 1 || params.threads < 1
+      || params.blocks*params.blockSize > ((size_t)1 << 30)) {
+    throw std::invalid_argument("QuadraticSieve: invalid parameters");
+  }
+  if (impl::isProbablePrime(n)) {
+    throw std::invalid_argument("QuadraticSieve: n is a prime");
+  }
+  if (impl::isPerfectPower(n)) {
+    throw std::invalid_argument("QuadraticSieve: n is a perfect power");
+  }
+  init_();
+}
+
+void QuadraticSieve::init_()
+{
+  // the factor base has about half of the primes.
+  uint32_t limit = (uint32_t)std::max<size_t>(1000, 30*params_.factorBase);
+  std::vector<uint32_t> odd = oddPrimes(limit);
+  while (odd.size() < 3*params_.factorBase) {
+    limit *= 2;
+    odd = oddPrimes(limit);
+  }
+  k_ = chooseMultiplier(n_, odd);
+  kn_ = n_ * MPInt((int64_t)k_);
+
+  primes_.push_back(2);
+  roots_.push_back(1);
+  for (size_t i = 0; primes_.size() < params_.factorBase; ++i) {
+    if (i == odd.size()) {
+      limit *= 2;
+      odd = oddPrimes(limit);
+    }
+    const uint32_t p = odd[i];
+    if (modSmall(n_, p) == 0) {
+      smallFactor_ = p;
+      return;
+    }
+    const uint32_t r = modSmall(kn_, p);
+    if (r != 0 && kronecker((int64_t)r, (int64_t)p) != 1) {
+      continue;
+    }
+    primes_.push_back(p);
+    roots_.push_back(r == 0 ? 0 : sqrtmod32(r, p));
+  }
+  const size_t F = primes_.size();
+  firstSieved_ = std::lower_bound(primes_.begin(), primes_.end(), smallSieveBound) - primes_.begin();
+
+  const double pmax = (double)primes_.back();
+  largeBound_ = (uint64_t)std::min(pmax*(double)params_.largePrimeMultiplier, pmax*pmax);
+
+  /*
+    |Ax^2 + 2Bx + C| <= M sqrt(kn/2) on [-M, M),
+    and the values are kept when the sieved logs reach this
+    less thresholdFactor log2(pmax), as in Contini's thesis.
+    The skipped primes contribute about 2 log(p)/(p - 1) each,
+    and 2 about 1.
+  */
+  const double M = (double)(params_.blocks*params_.blockSize);
+  const double logQ = std::log2(M) + 0.5*(log2(kn_) - 1);
+  double skipped = 1;
+  for (size_t i = 1; i < firstSieved_; ++i) {
+    skipped += 2*std::log2((double)primes_[i]) / (primes_[i] - 1);
+  }
+  const double threshold = logQ - thresholdFactor*std::log2(pmax) - skipped;
+
+  /*
+    A hit is a byte reaching 128, so the logs are scaled down
+    for the threshold to fit in 7 bits instead of clamping it.
+  */
+  const double scale = threshold > 127 ? 127 / threshold : 1;
+  threshold_ = (uint8_t)std::max(1.0, std::floor(scale*threshold));
+  logp_.push_back(1);
+  for (size_t i = 1; i < F; ++i) {
+    logp_.push_back((uint8_t)std::lround(scale*std::log2((double)primes_[i])));
+  }
+
+  /*
+    s primes of about 11 bits, or larger for a small factor base,
+    from a window of at least 2s + 16 primes.
+  */
+  logA_ = std::max(1.0, 0.5*(log2(kn_) + 1) - std::log2(M));
+  s_ = std::max<size_t>(1, (size_t)std::lround(logA_ / 11));
+  while (s_ > 1 && logA_ / (double)s_ < 5) {
+    --s_;
+  }
+  while (logA_ / (double)s_ > std::log2(pmax) - 1) {
+    ++s_;
+  }
+  const double center = std::exp2(logA_ / (double)s_);
+  aLow_ = std::lower_bound(primes_.begin(), primes_.end(), (uint32_t)std::min(center / 2, pmax)) - primes_.begin();
+  aHigh_ = std::upper_bound(primes_.begin(), primes_.end(), (uint32_t)std::min(center*2, pmax)) - primes_.begin();
+  aLow_ = std::max<size_t>(aLow_, 1);
+  aHigh_ = std::max(aHigh_, aLow_);
+  while (aHigh_ - aLow_ < 2*s_ + 16 && (aLow_ > 1 || aHigh_ < F)) {
+    if (aLow_ > 1) {
+      --aLow_;
+    }
+    if (aHigh_ < F) {
+      ++aHigh_;
+    }
+  }
+}
+
+bool QuadraticSieve::factor(MPInt& d)
+{
+  stats_ = Stats();
+  stats_.multiplier = k_;
+  stats_.factorBase = primes_.size();
+  if (smallFactor_ != 0) {
+    d = MPInt((int64_t)smallFactor_);
+    return true;
+  }
+  relations_.clear();
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  Collector collector(*this, primes_.size() + 1 + extraRelations);
+  if (params_.threads == 1) {
+    Sieve sieve(*this, collector);
+    sieve.run();
+  } else {
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < params_.threads; ++i) {
+      workers.push_back(std::thread([this, &collector]() {
+            Sieve sieve(*this, collector);
+            sieve.run();
+          }));
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+      workers[i].join();
+    }
+  }
+  std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+  stats_.sieveSeconds = std::chrono::duration<double>(stop - start).count();
+
+  start = stop;
+  std::vector<std::vector<uint32_t> > deps;
+  stats_.dependencies = solve_(deps);
+  bool found = false;
+  for (size_t i = 0; i < deps.size() && ! found; ++i) {
+    found = sqrt_(d, deps[i]);
+  }
+  stop = std::chrono::steady_clock::now();
+  stats_.linearSeconds = std::chrono::duration<double>(stop - start).count();
+  return found;
+}
+
+/*
+  Relations with a column of weight one are removed until none is left,
+  then the rows are reduced by Gaussian elimination on bit vectors,
+  each with the identity part recording the combination of relations.
+*/
+size_t QuadraticSieve::solve_(std::vector<std::vector<uint32_t> >& deps) const
+{
+  const size_t R = relations_.size();
+  const size_t C = primes_.size() + 1;
+  std::vector<std::vector<uint32_t> > odd(R);
+  for (size_t r = 0; r < R; ++r) {
+    std::vector<uint32_t> f = relations_[r].factors;
+    std::sort(f.begin(), f.end());
+    for (size_t i = 0; i < f.size(); ) {
+      size_t j = i;
+      while (j < f.size() && f[j] == f[i]) {
+        ++j;
+      }
+      if ((j - i) & 1) {
+        odd[r].push_back(f[i]);
+      }
+      i = j;
+    }
+  }
+
+  std::vector<bool> alive(R, true);
+  std::vector<uint32_t> weight(C);
+  for (bool changed = true; changed; ) {
+    changed = false;
+    std::fill(weight.begin(), weight.end(), 0);
+    for (size_t r = 0; r < R; ++r) {
+      for (size_t i = 0; alive[r] && i < odd[r].size(); ++i) {
+        ++weight[odd[r][i]];
+      }
+    }
+    for (size_t r = 0; r < R; ++r) {
+      for (size_t i = 0; alive[r] && i < odd[r].size(); ++i) {
+        if (weight[odd[r][i]] == 1) {
+          alive[r] = false;
+          changed = true;
+        }
+      }
+    }
+  }
+  std::vector<uint32_t> column(C);
+  size_t cols = 0;
+  for (size_t c = 0; c < C; ++c) {
+    column[c] = (uint32_t)cols;
+    cols += weight[c] > 0;
+  }
+  std::vector<size_t> rows;
+  for (size_t r = 0; r < R && rows.size() < cols + extraRelations; ++r) {
+    if (alive[r]) {
+      rows.push_back(r);
+    }
+  }
+
+  const size_t n = rows.size();
+  const size_t W1 = (cols + 63) / 64;
+  const size_t W = W1 + (n + 63) / 64;
+  std::vector<uint64_t> m(n*W, 0);
+  for (size_t i = 0; i < n; ++i) {
+    uint64_t* row = &m[i*W];
+    const std::vector<uint32_t>& o = odd[rows[i]];
+    for (size_t k = 0; k < o.size(); ++k) {
+      const uint32_t c = column[o[k]];
+      row[c / 64] |= (uint64_t)1 << (c % 64);
+    }
+    row[W1 + i / 64] |= (uint64_t)1 << (i % 64);
+  }
+
+  size_t rank = 0;
+  for (size_t c = 0; c < cols && rank < n; ++c) {
+    const size_t w = c / 64;
+    const uint64_t bit = (uint64_t)1 << (c % 64);
+    size_t pivot = rank;
+    while (pivot < n && (m[pivot*W + w] & bit) == 0) {
+      ++pivot;
+    }
+    if (pivot == n) {
+      continue;
+    }
+    if (pivot != rank) {
+      std::swap_ranges(&m[pivot*W], &m[pivot*W] + W, &m[rank*W]);
+    }
+    const uint64_t* p = &m[rank*W];
+    for (size_t i = rank + 1; i < n; ++i) {
+      uint64_t* row = &m[i*W];
+      if (row[w] & bit) {
+        for (size_t k = w; k < W; ++k) {
+          row[k] ^= p[k];
+        }
+      }
+    }
+    ++rank;
+  }
+
+  for (size_t i = rank; i < n && deps.size() < extraRelations; ++i) {
+    const uint64_t* row = &m[i*W + W1];
+    std::vector<uint32_t> dep;
+    for (size_t k = 0; k < n; ++k) {
+      if ((row[k / 64] >> (k % 64)) & 1) {
+        dep.push_back((uint32_t)rows[k]);
+      }
+    }
+    deps.push_back(dep);
+  }
+  return n - rank;
+}
+
+/*
+  X = prod y, Y = prod p^(e_p/2) prod large mod n,
+  and d = gcd(X - Y, n).
+*/
+bool QuadraticSieve::sqrt_(MPInt& d, const std::vector<uint32_t>& dep) const
+{
+  const size_t C = primes_.size() + 1;
+  std::vector<uint32_t> e(C, 0);
+  MPInt x(1);
+  MPInt y(1);
+  for (size_t i = 0; i < dep.size(); ++i) {
+    const Relation& r = relations_[dep[i]];
+    x *= r.y;
+    MPInt::mod(x, x, n_);
+    for (size_t k = 0; k < r.factors.size(); ++k) {
+      ++e[r.factors[k]];
+    }
+    for (size_t k = 0; k < r.large.size(); ++k) {
+      y *= MPInt((int64_t)r.large[k]);
+      MPInt::mod(y, y, n_);
+    }
+  }
+  for (size_t c = 0; c < C; ++c) {
+    if (e[c] & 1) {
+      return false;
+    }
+  }
+  for (size_t c = 1; c < C; ++c) {
+    const uint64_t p = primes_[c - 1];
+    uint64_t t = 1;
+    for (uint32_t k = 0; k < e[c] / 2; ++k) {
+      if (t >= ((uint64_t)1 << 32)) {
+        y *= MPInt((int64_t)t);
+        MPInt::mod(y, y, n_);
+        t = 1;
+      }
+      t *= p;
+    }
+    if (t > 1) {
+      y *= MPInt((int64_t)t);
+      MPInt::mod(y, y, n_);
+    }
+  }
+  d = impl::gcd(x - y, n_);
+  return d > 1 && d < n_;
+}
+
+} // namespace integer
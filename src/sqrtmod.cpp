@@ -0,0 +1,298 @@
+/* -*- mode: c++; coding: utf-8-unix -*- */
+/*
+  Copyright (c) 2011-2011 Tadanori TERUYA (tell) <tadanori.teruya@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+  @license: The MIT license <http://opensource.org/licenses/MIT>
+*/
+
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "sqrtmod.hpp"
+#include "prime.hpp"
+#include "kronecker-jacobi.hpp"
+#include "integer-util.hpp"
+
+namespace integer {
+
+namespace {
+
+using mpint::MPInt;
+using impl::bitLength;
+using impl::isZero;
+typedef MPInt::value_type value_type;
+
+const MPInt& checkedPrime(const MPInt& p)
+{
+  if (! (p > 2) || ! impl::isProbablePrime(p)) {
+    throw std::invalid_argument("SqrtModContext: p must be an odd prime");
+  }
+  return p;
+}
+
+inline bool equal(const value_type* x, const value_type* y, const size_t n)
+{
+  return std::equal(x, x + n, y);
+}
+
+} // namespace
+
+SqrtModContext::SqrtModContext(const MPInt& p, const Method method)
+  : p_(checkedPrime(p)), ctx_(p_), powm_(ctx_), method_(method), s_(0), z_(), e_(), c_(), work_()
+{
+  const size_t n = ctx_.size();
+  MPInt pm1, q;
+  MPInt::sub(pm1, p_, MPInt(1));
+  s_ = pm1.NTZ();
+  MPInt::shr(q, pm1, s_);
+
+  const value_type r8 = p_[0] & 0x7;
+  if (method_ == Auto) {
+    if (r8 % 4 == 3) {
+      method_ = Mod4;
+    } else if (r8 == 5) {
+      method_ = Mod8;
+    } else if (s_*s_ > cipollaRatio*bitLength(p_)) {
+      method_ = Cipolla;
+    } else {
+      method_ = TonelliShanks;
+    }
+  } else if ((method_ == Mod4 && r8 % 4 != 3) || (method_ == Mod8 && r8 != 5)) {
+    throw std::invalid_argument("SqrtModContext: the method does not fit p");
+  }
+
+  // the smallest non-residue is a prime less than p.
+  for (int64_t z = 2; ; ++z) {
+    z_ = MPInt(z);
+    if (impl::kronecker(z_, p_) == -1) {
+      break;
+    }
+  }
+
+  switch (method_) {
+  case Mod4:
+    MPInt::add(e_, p_, MPInt(1));
+    e_ >>= 2;
+    break;
+  case Mod8:
+    MPInt::sub(e_, p_, MPInt(5));
+    e_ >>= 3;
+    break;
+  case TonelliShanks:
+    MPInt::shr(e_, q, 1);
+    c_.resize(n);
+    ctx_.toMont(&c_[0], z_);
+    powm_.pow(&c_[0], &c_[0], q.get(), q.size());
+    break;
+  default:
+    MPInt::add(e_, p_, MPInt(1));
+    e_ >>= 1;
+    break;
+  }
+  work_.resize(6*n);
+}
+
+bool SqrtModContext::sqrtMod4_(value_type* z, const value_type* x)
+{
+  const size_t n = ctx_.size();
+  value_type* r = &work_[0];
+  value_type* t = r + n;
+  powm_.pow(r, x, e_.get(), e_.size());
+  ctx_.sqr(t, r);
+  if (! equal(t, x, n)) {
+    return false;
+  }
+  std::copy(r, r + n, z);
+  return true;
+}
+
+bool SqrtModContext::sqrtMod8_(value_type* z, const value_type* x)
+{
+  // b = (2x)^((p-5)/8), i = 2x b^2 is a square root of -1, r = x b (i - 1).
+  const size_t n = ctx_.size();
+  value_type* x2 = &work_[0];
+  value_type* b = x2 + n;
+  value_type* i = b + n;
+  value_type* r = i + n;
+  ctx_.add(x2, x, x);
+  powm_.pow(b, x2, e_.get(), e_.size());
+  ctx_.sqr(i, b);
+  ctx_.mul(i, i, x2);
+  ctx_.sub(i, i, ctx_.one());
+  ctx_.mul(r, x, b);
+  ctx_.mul(r, r, i);
+  ctx_.sqr(i, r);
+  if (! equal(i, x, n)) {
+    return false;
+  }
+  std::copy(r, r + n, z);
+  return true;
+}
+
+bool SqrtModContext::sqrtTonelliShanks_(value_type* z, const value_type* x)
+{
+  const size_t n = ctx_.size();
+  value_type* w = &work_[0];
+  value_type* r = w + n;
+  value_type* t = r + n;
+  value_type* c = t + n;
+  value_type* b = c + n;
+  const value_type* one = ctx_.one();
+  if (isZero(x, n)) {
+    std::fill(z, z + n, 0);
+    return true;
+  }
+
+  // w = x^((q-1)/2), r = x^((q+1)/2), t = x^q.
+  powm_.pow(w, x, e_.get(), e_.size());
+  ctx_.mul(r, x, w);
+  ctx_.mul(t, r, w);
+  std::copy(c_.begin(), c_.end(), c);
+  size_t m = s_;
+  while (! equal(t, one, n)) {
+    // the least i with t^(2^i) = 1.
+    size_t i = 0;
+    std::copy(t, t + n, b);
+    do {
+      ctx_.sqr(b, b);
+      ++i;
+    } while (! equal(b, one, n) && i < m);
+    if (i == m) {
+      return false;
+    }
+    // b = c^(2^(m-i-1)), r = r b, c = b^2, t = t c.
+    std::copy(c, c + n, b);
+    for (size_t j = i + 1; j < m; ++j) {
+      ctx_.sqr(b, b);
+    }
+    ctx_.mul(r, r, b);
+    ctx_.sqr(c, b);
+    ctx_.mul(t, t, c);
+    m = i;
+  }
+  std::copy(r, r + n, z);
+  return true;
+}
+
+bool SqrtModContext::sqrtCipolla_(value_type* z, const value_type* x)
+{
+  const size_t n = ctx_.size();
+  value_type* w = &work_[0];
+  value_type* tm = w + n;
+  value_type* a = tm + n;
+  value_type* b = a + n;
+  value_type* u = b + n;
+  value_type* v = u + n;
+  MPInt y;
+  ctx_.fromMont(y, x);
+  const int j = impl::kronecker(y, p_);
+  if (j != 1) {
+    std::fill(z, z + n, 0);
+    return j == 0;
+  }
+
+  // the least t > 0 with ((t^2 - x)/p) = -1, w = t^2 - x.
+  std::fill(tm, tm + n, 0);
+  for (;;) {
+    ctx_.add(tm, tm, ctx_.one());
+    ctx_.sqr(w, tm);
+    ctx_.sub(w, w, x);
+    ctx_.fromMont(y, w);
+    if (impl::kronecker(y, p_) == -1) {
+      break;
+    }
+  }
+
+  // (a + b sqrt(w)) = (t + sqrt(w))^((p+1)/2), then b = 0.
+  std::copy(tm, tm + n, a);
+  std::copy(ctx_.one(), ctx_.one() + n, b);
+  const size_t bits = bitLength(e_);
+  for (size_t i = bits - 1; i > 0; --i) {
+    // (a + b sqrt(w))^2 = (a^2 + b^2 w) + 2ab sqrt(w).
+    ctx_.mul(u, a, b);
+    ctx_.sqr(a, a);
+    ctx_.sqr(v, b);
+    ctx_.mul(v, v, w);
+    ctx_.add(a, a, v);
+    ctx_.add(b, u, u);
+    if ((e_[(i - 1) / 64] >> ((i - 1) % 64)) & 0x1) {
+      // (a + b sqrt(w))(t + sqrt(w)) = (a t + b w) + (a + b t) sqrt(w).
+      ctx_.mul(u, a, tm);
+      ctx_.mul(v, b, w);
+      ctx_.add(u, u, v);
+      ctx_.mul(v, b, tm);
+      ctx_.add(b, a, v);
+      std::copy(u, u + n, a);
+    }
+  }
+  std::copy(a, a + n, z);
+  return true;
+}
+
+bool SqrtModContext::sqrt(value_type* z, const value_type* x)
+{
+  switch (method_) {
+  case Mod4:
+    return sqrtMod4_(z, x);
+  case Mod8:
+    return sqrtMod8_(z, x);
+  case TonelliShanks:
+    return sqrtTonelliShanks_(z, x);
+  default:
+    return sqrtCipolla_(z, x);
+  }
+}
+
+bool SqrtModContext::sqrt(MPInt& z, const MPInt& x)
+{
+  const size_t n = ctx_.size();
+  std::vector<value_type> buf(n);
+  MPInt r;
+  MPInt::mod(r, x, p_);
+  ctx_.toMont(&buf[0], r);
+  if (! sqrt(&buf[0], &buf[0])) {
+    return false;
+  }
+  ctx_.fromMont(r, &buf[0]);
+  // the smaller one of r and p - r.
+  MPInt h;
+  MPInt::shr(h, p_, 1);
+  if (h < r) {
+    MPInt::sub(r, p_, r);
+  }
+  z.swap(r);
+  return true;
+}
+
+namespace impl {
+
+bool sqrtmod(MPInt& z, const MPInt& a, const MPInt& p)
+{
+  SqrtModContext ctx(p);
+  return ctx.sqrt(z, a);
+}
+
+} // namespace impl
+
+} // namespace integer